@@ -15,10 +15,15 @@
  * License along with this library; if not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "dct_hal.h"
+
 int dct_lock(int write) {
     return 0;
 }
 
 int dct_unlock(int write) {
+    if (write) {
+        return dct_flush(NULL);
+    }
     return 0;
 }
@@ -28,7 +28,7 @@ namespace {
 const size_t BUFFER_SIZE = (1 << INFLATE_MAX_WINDOW_BITS);
 
 inflate_ctx g_ctx = {};
-char g_buf[BUFFER_SIZE] = {};
+alignas(uint32_t) char g_buf[BUFFER_SIZE] = {};
 bool g_alloced = false;
 
 } // namespace
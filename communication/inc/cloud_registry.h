@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "spark_wiring_vector.h"
+
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+namespace particle {
+
+namespace protocol {
+
+/**
+ * Table of cloud functions or variables registered by the application.
+ *
+ * Entries are kept in the order of registration, which is the order in which they appear in
+ * the describe message. Lookups by key go through an open-addressed hash index that is updated
+ * on registration, and the checksum of the entries used for the application describe is
+ * maintained incrementally.
+ *
+ * The traits class should provide the following members:
+ *
+ * - `static const size_t KEY_LENGTH`: Maximum length of a key. Longer keys are compared by their
+ *   first `KEY_LENGTH` characters.
+ * - `static const char* key(const T& entry)`: Returns the key of an entry.
+ * - `static uint32_t checksum(const T& entry)`: Returns the checksum of an entry.
+ *
+ * `T` must be trivially copyable. Pointers to entries are invalidated when an entry is added or
+ * removed.
+ *
+ * The number of entries is limited only by the available memory. If the index cannot be allocated,
+ * or the number of entries exceeds `MAX_INDEXED_SIZE`, lookups fall back to a linear search.
+ */
+template<typename T, typename TraitsT>
+class CloudRegistry {
+public:
+    /**
+     * Maximum number of entries that can be looked up via the hash index.
+     */
+    static const size_t MAX_INDEXED_SIZE = std::numeric_limits<uint16_t>::max();
+
+    CloudRegistry() :
+            checksum_(0) {
+    }
+
+    CloudRegistry(const CloudRegistry&) = delete;
+    CloudRegistry& operator=(const CloudRegistry&) = delete;
+
+    /**
+     * Returns the index of the entry with the specified key, or -1 if there's no such entry.
+     */
+    int indexOf(const char* key) const {
+        const size_t len = keyLength(key);
+        const size_t tableSize = index_.size();
+        if (tableSize == 0) {
+            // The index couldn't be allocated or there are too many entries, fall back to a linear search
+            for (int i = entries_.size(); i-- > 0;) {
+                if (keyEquals(entries_[i], key, len)) {
+                    return i;
+                }
+            }
+            return -1;
+        }
+        for (size_t slot = hash(key, len) & (tableSize - 1);; slot = (slot + 1) & (tableSize - 1)) {
+            const uint16_t v = index_[slot];
+            if (v == 0) {
+                return -1;
+            }
+            if (keyEquals(entries_[v - 1], key, len)) {
+                return v - 1;
+            }
+        }
+    }
+
+    /**
+     * Returns the entry with the specified key, or `nullptr` if there's no such entry.
+     */
+    T* find(const char* key) {
+        const int i = indexOf(key);
+        return (i >= 0) ? &entries_[i] : nullptr;
+    }
+
+    /**
+     * Adds an entry. The caller is responsible for checking that there's no entry with the same
+     * key already.
+     *
+     * @return Pointer to the added entry, or `nullptr` if the entry cannot be added.
+     */
+    T* add(const T& entry) {
+        const int n = entries_.size();
+        if (n == entries_.capacity() && !entries_.reserve(n + BLOCK_SIZE)) {
+            return nullptr;
+        }
+        entries_.append(entry);
+        checksum_ += TraitsT::checksum(entry);
+        if ((size_t)(n + 1) * 2 > (size_t)index_.size()) {
+            rebuildIndex();
+        } else {
+            insertIndex(n);
+        }
+        return &entries_[n];
+    }
+
+    /**
+     * Replaces an entry. The key of the entry must not change.
+     */
+    void replace(int i, const T& entry) {
+        checksum_ -= TraitsT::checksum(entries_[i]);
+        entries_[i] = entry;
+        checksum_ += TraitsT::checksum(entry);
+    }
+
+    /**
+     * Removes an entry.
+     */
+    void removeAt(int i) {
+        if (i < 0 || i >= entries_.size()) {
+            return;
+        }
+        checksum_ -= TraitsT::checksum(entries_[i]);
+        entries_.removeAt(i);
+        rebuildIndex();
+    }
+
+    /**
+     * Removes all entries.
+     */
+    void clear() {
+        entries_.clear();
+        index_.clear();
+        checksum_ = 0;
+    }
+
+    /**
+     * Returns the sum of the checksums of all entries.
+     */
+    uint32_t checksum() const {
+        return checksum_;
+    }
+
+    int size() const {
+        return entries_.size();
+    }
+
+    T& operator[](int i) {
+        return entries_[i];
+    }
+
+    const T& operator[](int i) const {
+        return entries_[i];
+    }
+
+private:
+    // Number of entries by which the storage grows
+    static const int BLOCK_SIZE = 5;
+    // Minimum size of the hash index
+    static const int MIN_INDEX_SIZE = 16;
+
+    spark::Vector<T> entries_;
+    // Slots of the hash index contain an entry index plus one, or 0 if the slot is empty
+    spark::Vector<uint16_t> index_;
+    uint32_t checksum_;
+
+    void rebuildIndex() {
+        if ((size_t)entries_.size() > MAX_INDEXED_SIZE) {
+            index_.clear();
+            return;
+        }
+        int tableSize = MIN_INDEX_SIZE;
+        while (tableSize < entries_.size() * 2) {
+            tableSize *= 2;
+        }
+        if (!index_.resize(tableSize)) {
+            // Lookups will be done linearly
+            index_.clear();
+            return;
+        }
+        index_.fill(0);
+        for (int i = 0; i < entries_.size(); ++i) {
+            insertIndex(i);
+        }
+    }
+
+    void insertIndex(int i) {
+        const size_t tableSize = index_.size();
+        if (tableSize == 0) {
+            return;
+        }
+        const char* key = TraitsT::key(entries_[i]);
+        size_t slot = hash(key, keyLength(key)) & (tableSize - 1);
+        while (index_[slot] != 0) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        index_[slot] = i + 1;
+    }
+
+    static bool keyEquals(const T& entry, const char* key, size_t len) {
+        const char* k = TraitsT::key(entry);
+        return keyLength(k) == len && std::memcmp(k, key, len) == 0;
+    }
+
+    static size_t keyLength(const char* key) {
+        size_t len = 0;
+        while (len < TraitsT::KEY_LENGTH && key[len] != '\0') {
+            ++len;
+        }
+        return len;
+    }
+
+    // FNV-1a
+    static uint32_t hash(const char* key, size_t len) {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < len; ++i) {
+            h ^= (uint8_t)key[i];
+            h *= 16777619u;
+        }
+        return h;
+    }
+};
+
+template<typename T, typename TraitsT>
+const size_t CloudRegistry<T, TraitsT>::MAX_INDEXED_SIZE;
+
+} // namespace protocol
+
+} // namespace particle
@@ -295,7 +295,8 @@ protected:
 	 * @sa particle::protocol::ProtocolError
 	 */
 	ProtocolError generate_and_send_description(MessageChannel& channel, Message& message,
-												size_t header_size, int desc_flags);
+												size_t header_size, int desc_flags,
+												CompletionHandler handler = CompletionHandler());
 
 	/**
 	 * Produces a describe message and transmits it as a separate response.
@@ -454,13 +455,14 @@ public:
 	 * @arg \p DESCRIBE_SYSTEM
 	 *
 	 * @param force Ignore cached application state.
+	 * @param handler Completion handler invoked when the message is acknowledged.
 	 *
 	 * @returns \s ProtocolError result value
 	 * @retval \p particle::protocol::NO_ERROR
 	 *
 	 * @sa particle::protocol::ProtocolError
 	 */
-	ProtocolError post_description(int desc_flags, bool force);
+	ProtocolError post_description(int desc_flags, bool force, CompletionHandler handler = CompletionHandler());
 
 	// Returns true on success, false on sending timeout or rate-limiting failure
 	bool send_event(const char *event_name, const char *data, int ttl,
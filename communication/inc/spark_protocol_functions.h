@@ -184,6 +184,9 @@ typedef struct {
 
 typedef completion_handler_data spark_protocol_send_event_data;
 
+// Additional parameters for spark_protocol_post_description()
+typedef completion_handler_data spark_protocol_post_description_data;
+
 bool spark_protocol_send_event(ProtocolFacade* protocol, const char *event_name, const char *data,
                 int ttl, uint32_t flags, void* reserved);
 bool spark_protocol_send_subscription_device(ProtocolFacade* protocol, const char *event_name, const char *device_id, void* reserved=NULL);
@@ -219,7 +222,8 @@ int spark_protocol_get_describe_data(ProtocolFacade* protocol, spark_protocol_de
  * @arg \p DESCRIBE_APPLICATION
  * @arg \p DESCRIBE_METRICS
  * @arg \p DESCRIBE_SYSTEM
- * @param[in,out] reserved Reserved for future use (default value: \p NULL).
+ * @param[in] reserved Optional \p spark_protocol_post_description_data with a completion
+ *                     callback invoked when the message is acknowledged (default value: \p NULL).
  *
  * @returns \p ProtocolError result code
  * @retval \p ProtocolError::NO_ERROR
@@ -35,6 +35,7 @@ LOG_SOURCE_CATEGORY("comm.dtls")
 #include <stdio.h>
 #include <string.h>
 #include "dtls_session_persist.h"
+#include "dtls_move_session.h"
 
 namespace particle { namespace protocol {
 
@@ -240,19 +241,12 @@ ProtocolError DTLSMessageChannel::init(
  */
 inline int DTLSMessageChannel::send(const uint8_t* data, size_t len)
 {
-	if (move_session && len && data[0]==23)
+	if (move_session && len && data[0]==DTLS_APPLICATION_DATA_RECORD_TYPE)
 	{
-		// buffer for a new packet that contains the device ID length and a byte for the length appended to the existing data.
-		uint8_t d[len+DEVICE_ID_LEN+1];
-		memcpy(d, data, len);						// original application data
-		d[0] = 254;									// move session record type
-		memcpy(d+len, device_id, DEVICE_ID_LEN);	// set the device ID
-		d[len+DEVICE_ID_LEN] = DEVICE_ID_LEN;			// set the device ID length as the last byte in the packet
-		int result = callbacks.send(d, len+DEVICE_ID_LEN+1, callbacks.tx_context);
-		// hide the increased length from DTLS
-		if (result==int(len+DEVICE_ID_LEN+1))
-			result = len;
-		return result;
+		// The record is normally located in the output buffer of the SSL context, which is large
+		// enough to accommodate the device ID suffix, so the move session record is built in place
+		return sendMoveSessionRecord(data, len, ssl_context.out_buf, MBEDTLS_SSL_OUT_BUFFER_LEN, device_id,
+				DEVICE_ID_LEN, callbacks.send, callbacks.tx_context, MBEDTLS_ERR_SSL_ALLOC_FAILED);
 	}
 	else
 		return callbacks.send(data, len, callbacks.tx_context);
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+namespace particle {
+
+namespace protocol {
+
+/**
+ * Type of a DTLS application data record.
+ */
+const uint8_t DTLS_APPLICATION_DATA_RECORD_TYPE = 23;
+
+/**
+ * Type of a move session record.
+ */
+const uint8_t DTLS_MOVE_SESSION_RECORD_TYPE = 254;
+
+/**
+ * Sends an application data record as a move session record.
+ *
+ * The record type is changed to the move session type, and the device ID followed by its length is
+ * appended to the record. See: https://github.com/particle-iot/knowledge/blob/8df146d88c4237e90553f3fd6d8465ab58ec79e0/services/dtls-ip-change.md
+ *
+ * If the record is located in the buffer `buf` and there's enough room in that buffer after the
+ * record, the move session record is built in place, and the record type is restored after
+ * sending, since the same record may be sent again. Otherwise, the record is copied to the heap.
+ *
+ * @param data Record data.
+ * @param len Record size.
+ * @param buf Buffer containing the record, or `nullptr`.
+ * @param bufSize Buffer size.
+ * @param deviceId Device ID.
+ * @param deviceIdLen Size of the device ID.
+ * @param send Send function.
+ * @param ctx Context of the send function.
+ * @param allocError Error code to return if the record can't be copied.
+ * @return `len` if the entire record has been sent, otherwise the result of the send function.
+ */
+inline int sendMoveSessionRecord(const uint8_t* data, size_t len, uint8_t* buf, size_t bufSize,
+        const uint8_t* deviceId, size_t deviceIdLen, int (*send)(const unsigned char*, uint32_t, void*),
+        void* ctx, int allocError)
+{
+	const size_t moveLen = len + deviceIdLen + 1;
+	uint8_t* d = nullptr;
+	uint8_t* heapBuf = nullptr;
+	if (buf && data >= buf && data + moveLen <= buf + bufSize)
+	{
+		d = const_cast<uint8_t*>(data);
+	}
+	else
+	{
+		heapBuf = new(std::nothrow) uint8_t[moveLen];
+		if (!heapBuf)
+			return allocError;
+		memcpy(heapBuf, data, len);
+		d = heapBuf;
+	}
+	d[0] = DTLS_MOVE_SESSION_RECORD_TYPE;
+	memcpy(d + len, deviceId, deviceIdLen);	// set the device ID
+	d[len + deviceIdLen] = deviceIdLen;		// set the device ID length as the last byte in the packet
+	int result = send(d, moveLen, ctx);
+	if (heapBuf)
+		delete[] heapBuf;
+	else
+		d[0] = DTLS_APPLICATION_DATA_RECORD_TYPE;
+	// hide the increased length from DTLS
+	if (result == int(moveLen))
+		result = len;
+	return result;
+}
+
+} // namespace protocol
+
+} // namespace particle
@@ -627,7 +627,8 @@ void Protocol::build_describe_message(Appender& appender, int desc_flags)
 }
 
 ProtocolError Protocol::generate_and_send_description(MessageChannel& channel, Message& message,
-                                                      size_t header_size, int desc_flags)
+                                                      size_t header_size, int desc_flags,
+                                                      CompletionHandler handler)
 {
     ProtocolError error;
 
@@ -653,7 +654,13 @@ ProtocolError Protocol::generate_and_send_description(MessageChannel& channel, M
     error = channel.send(message);
     if (error != ProtocolError::NO_ERROR) {
         LOG(ERROR, "Channel failed to send message; error code: %d", (int)error);
-    } else if (descriptor.app_state_selector_info) {
+        handler.setError(toSystemError(error));
+        return error;
+    }
+    if (handler) {
+        add_ack_handler(message.get_id(), std::move(handler), SEND_EVENT_ACK_TIMEOUT);
+    }
+    if (descriptor.app_state_selector_info) {
         const auto msg_id = message.get_id();
         if (desc_flags & DescriptionType::DESCRIBE_APPLICATION) {
             app_describe_msg_id = msg_id;
@@ -666,7 +673,7 @@ ProtocolError Protocol::generate_and_send_description(MessageChannel& channel, M
     return error;
 }
 
-ProtocolError Protocol::post_description(int desc_flags, bool force)
+ProtocolError Protocol::post_description(int desc_flags, bool force, CompletionHandler handler)
 {
 	if (!force && descriptor.app_state_selector_info) {
 		const auto cachedState = channel.cached_app_state_descriptor();
@@ -686,15 +693,17 @@ ProtocolError Protocol::post_description(int desc_flags, bool force)
 		}
 	}
 	if (!desc_flags) {
+		handler.setResult();
 		return ProtocolError::NO_ERROR;
 	}
 	Message message;
 	const ProtocolError error = channel.create(message);
 	if (error != ProtocolError::NO_ERROR) {
+		handler.setError(toSystemError(error));
 		return error;
 	}
 	const size_t header_size = Messages::describe_post_header(message.buf(), message.capacity(), 0 /* message_id */, desc_flags);
-	return generate_and_send_description(channel, message, header_size, desc_flags);
+	return generate_and_send_description(channel, message, header_size, desc_flags, std::move(handler));
 }
 
 ProtocolError Protocol::send_description_response(token_t token, message_id_t msg_id, int desc_flags)
@@ -124,8 +124,12 @@ int spark_protocol_presence_announcement(ProtocolFacade* protocol, uint8_t *buf,
 
 int spark_protocol_post_description(ProtocolFacade* protocol, int desc_flags, void* reserved) {
     ASSERT_ON_SYSTEM_THREAD();
-    (void)reserved;
-    return protocol->post_description(desc_flags, false /* force */);
+    CompletionHandler handler;
+    if (reserved) {
+        auto r = static_cast<const spark_protocol_post_description_data*>(reserved);
+        handler = CompletionHandler(r->handler_callback, r->handler_data);
+    }
+    return protocol->post_description(desc_flags, false /* force */, std::move(handler));
 }
 
 bool spark_protocol_send_event(ProtocolFacade* protocol, const char *event_name, const char *data,
@@ -265,6 +265,54 @@ typedef struct hal_ble_conn_info_t {
     hal_ble_conn_handle_t conn_handle;
 } hal_ble_conn_info_t;
 
+/*
+ * Connection statistics. The counters are maintained by the SoftDevice event handlers and are reset
+ * when the connection is established. The link layer doesn't report retransmissions and CRC errors,
+ * so they are not included.
+ */
+typedef struct hal_ble_link_stats_t {
+    uint16_t version;
+    uint16_t size;
+    hal_ble_conn_handle_t conn_handle;
+    int8_t rssi;                        /* Last RSSI measurement in dBm */
+    uint8_t reserved;
+    uint32_t duration_ms;               /* Time elapsed since the connection was established */
+    uint32_t tx_packets;                /* Number of transmitted ATT packets */
+    uint32_t rx_packets;                /* Number of received ATT packets */
+    uint32_t tx_bytes;                  /* Number of transmitted ATT payload bytes */
+    uint32_t rx_bytes;                  /* Number of received ATT payload bytes */
+    uint32_t hvx_queued;                /* Number of notifications and indications passed to the stack */
+    uint32_t hvx_completed;             /* Number of notifications sent and indications confirmed */
+    uint32_t throughput;                /* Effective throughput in bits per second */
+    uint32_t conn_events;               /* Estimated number of connection events */
+    uint32_t conn_event_utilization;    /* Number of ATT packets per 100 connection events */
+    uint8_t tx_phy;                     /* BLE_GAP_PHY_* */
+    uint8_t rx_phy;
+    uint16_t max_tx_octets;             /* Effective data length */
+    uint16_t max_rx_octets;
+    uint16_t reserved1;
+    /* RSSI histogram: < -90, -90..-81, -80..-71, ..., -40..-31, >= -30 dBm */
+    uint32_t rssi_histogram[BLE_LINK_STATS_RSSI_BUCKET_COUNT];
+    int8_t rssi_min;                    /* Lowest, highest and average RSSI since the connection was established */
+    int8_t rssi_max;
+    int8_t rssi_avg;
+    uint8_t reserved2;
+} hal_ble_link_stats_t;
+
+/*
+ * Statistics of all active connections combined.
+ */
+typedef struct hal_ble_link_totals_t {
+    uint16_t version;
+    uint16_t size;
+    uint8_t link_count;                 /* Number of active connections */
+    int8_t rssi;                        /* Lowest RSSI of the active connections in dBm, 0 if not measured yet */
+    uint16_t reserved;
+    uint32_t tx_packets;                /* Number of transmitted ATT packets */
+    uint32_t rx_packets;                /* Number of received ATT packets */
+    uint32_t throughput;                /* Effective throughput in bits per second */
+} hal_ble_link_totals_t;
+
 /* BLE events structure */
 typedef struct hal_ble_adv_evt_t {
     hal_ble_evts_type_t type;
@@ -856,10 +904,30 @@ int hal_ble_gap_get_connection_info(hal_ble_conn_handle_t conn_handle, hal_ble_c
  *
  * @param[in]   conn_handle BLE connection handle.
  *
- * @returns     the RSSI value.
+ * @returns     the RSSI value, 0 if it is not measured yet, or SYSTEM_ERROR_NOT_FOUND if there's
+ *              no such connection.
  */
 int hal_ble_gap_get_rssi(hal_ble_conn_handle_t conn_handle, void* reserved);
 
+/**
+ * Get the statistics of the specific BLE connection.
+ *
+ * @param[in]       conn_handle BLE connection handle.
+ * @param[in,out]   stats Pointer to where the statistics being stored.
+ *
+ * @returns     0 on success, system_error_t on error.
+ */
+int hal_ble_gap_get_link_stats(hal_ble_conn_handle_t conn_handle, hal_ble_link_stats_t* stats, void* reserved);
+
+/**
+ * Get the statistics of all active BLE connections combined.
+ *
+ * @param[in,out]   totals Pointer to where the statistics being stored.
+ *
+ * @returns     0 on success, system_error_t on error.
+ */
+int hal_ble_gap_get_link_totals(hal_ble_link_totals_t* totals, void* reserved);
+
 /**
  * Set pairing configurations
  *
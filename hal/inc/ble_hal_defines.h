@@ -285,6 +285,16 @@ typedef enum ble_sig_cccd_value_t {
 /**@} */
 
 
+/**@defgroup BLE link statistics
+ * @{ */
+// Number of buckets in the RSSI histogram of a connection
+#define BLE_LINK_STATS_RSSI_BUCKET_COUNT                        (8)
+
+// RSSI value reported when no RSSI measurement is available
+#define BLE_LINK_STATS_RSSI_INVALID                             (0x7F)
+/**@} */
+
+
 /**
  * @}
  */
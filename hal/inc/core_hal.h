@@ -90,6 +90,7 @@ typedef enum
 #include "core_subsys_hal.h"
 #include "interrupts_hal.h"
 #include "system_defs.h"
+#include "hal_platform.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -107,6 +108,34 @@ void HAL_Core_Factory_Reset(void);
 void HAL_Core_System_Reset_Ex(int reason, uint32_t data, void *reserved);
 int HAL_Core_Get_Last_Reset_Info(int *reason, uint32_t *data, void *reserved);
 
+#if HAL_PLATFORM_BOOT_TIMING
+
+/**
+ * Phases of the device startup, in the order they are completed.
+ */
+typedef enum hal_boot_phase {
+    HAL_BOOT_PHASE_LOW_LEVEL_INIT = 0, ///< Clocks, interrupts and the radio stack.
+    HAL_BOOT_PHASE_USER_MODULE_VALIDATION = 1, ///< Validation and pre-initialization of the user module.
+    HAL_BOOT_PHASE_CORE_CONFIG = 2, ///< Remaining part of HAL_Core_Config().
+    HAL_BOOT_PHASE_MODULE_VALIDATION = 3, ///< Validation of the system modules.
+    HAL_BOOT_PHASE_SYSTEM_INIT = 4, ///< Initialization of the system until the application's setup().
+    HAL_BOOT_PHASE_COUNT = 5
+} hal_boot_phase;
+
+/**
+ * Records the time at which a boot phase has completed.
+ */
+void hal_boot_phase_complete(hal_boot_phase phase);
+
+/**
+ * Returns the duration of a boot phase in microseconds, or 0 if the phase hasn't completed yet.
+ *
+ * The time spent in the bootloader is not accounted for.
+ */
+uint32_t hal_boot_phase_duration(hal_boot_phase phase);
+
+#endif // HAL_PLATFORM_BOOT_TIMING
+
 /**
  * Notification from hal to the external system.
  * @param button    The button that was pressed, 0-based
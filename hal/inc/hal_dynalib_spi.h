@@ -63,6 +63,9 @@ DYNALIB_FN(17, hal_spi, hal_spi_release, int32_t(hal_spi_interface_t, void*))
 #define BASE_IDX 16
 #endif
 DYNALIB_FN(BASE_IDX + 0, hal_spi, hal_spi_sleep, int(hal_spi_interface_t, bool, void*))
+#if HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+DYNALIB_FN(BASE_IDX + 1, hal_spi, hal_spi_queue_transactions, int(hal_spi_interface_t, hal_spi_transaction_t*, void*))
+#endif // HAL_PLATFORM_SPI_TRANSACTION_QUEUE
 DYNALIB_END(hal_spi)
 
 #undef BASE_IDX
@@ -239,6 +239,14 @@
 #define HAL_PLATFORM_SPI_HAL_THREAD_SAFETY (0)
 #endif // HAL_PLATFORM_SPI_HAL_THREAD_SAFETY
 
+#ifndef HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+#define HAL_PLATFORM_SPI_TRANSACTION_QUEUE (0)
+#endif // HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+
+#ifndef HAL_PLATFORM_I2C_TRANSACTION_QUEUE
+#define HAL_PLATFORM_I2C_TRANSACTION_QUEUE (0)
+#endif // HAL_PLATFORM_I2C_TRANSACTION_QUEUE
+
 #ifndef HAL_PLATFORM_KEEP_DEPRECATED_APP_USB_REQUEST_HANDLERS
 #define HAL_PLATFORM_KEEP_DEPRECATED_APP_USB_REQUEST_HANDLERS (0)
 #endif // HAL_PLATFORM_KEEP_DEPRECATED_APP_USB_REQUEST_HANDLERS
@@ -442,4 +450,8 @@
 #define HAL_PLATFORM_WIFI_SCAN_ONLY (0)
 #endif // HAL_PLATFORM_WIFI_SCAN_ONLY
 
+#ifndef HAL_PLATFORM_BOOT_TIMING
+#define HAL_PLATFORM_BOOT_TIMING (0)
+#endif // HAL_PLATFORM_BOOT_TIMING
+
 #endif /* HAL_PLATFORM_H */
@@ -68,6 +68,24 @@ typedef struct hal_i2c_transmission_config_t {
     uint32_t flags;
 } hal_i2c_transmission_config_t;
 
+typedef void (*hal_i2c_transaction_callback)(int result, void* context);
+
+typedef struct hal_i2c_transaction_t {
+    uint16_t size;
+    uint16_t version;
+    uint8_t address;
+    uint8_t reserved[3];
+    const uint8_t* tx_buffer;                   // Data to write before reading, must be located in RAM
+    size_t tx_length;
+    uint8_t* rx_buffer;
+    size_t rx_length;
+    system_tick_t timeout_ms;
+    uint32_t flags;                             // See hal_i2c_transmission_flag_t
+    hal_i2c_transaction_callback callback;      // Can be invoked in an ISR context
+    void* context;
+    struct hal_i2c_transaction_t* next;         // Next transaction in the batch
+} hal_i2c_transaction_t;
+
 typedef enum hal_i2c_state_t {
     HAL_I2C_STATE_DISABLED,
     HAL_I2C_STATE_ENABLED,
@@ -108,6 +126,34 @@ int hal_i2c_sleep(hal_i2c_interface_t i2c, bool sleep, void* reserved);
 int32_t hal_i2c_lock(hal_i2c_interface_t i2c, void* reserved);
 int32_t hal_i2c_unlock(hal_i2c_interface_t i2c, void* reserved);
 
+#if HAL_PLATFORM_I2C_TRANSACTION_QUEUE
+/**
+ * Queues a batch of master mode transactions.
+ *
+ * The transactions are linked via the `next` field and are performed in order after any
+ * previously queued transactions. Each transaction writes `tx_length` bytes and then reads
+ * `rx_length` bytes from the device using a repeated start condition. The transactions must
+ * remain valid until their callbacks are invoked. The `next` field is managed by the queue and
+ * is reset before a transaction's callback is invoked, so that the transaction can be queued
+ * again.
+ *
+ * Queued transactions don't acquire the I2C lock (see `hal_i2c_lock()`), so they can be performed
+ * between the synchronous transfers of a thread that holds the lock. The only exception is a
+ * synchronous write without a stop condition: the queued transactions are held until the
+ * thread performs its next synchronous transfer, so that the repeated start sequence is not
+ * interrupted. A transaction whose timeout expires is aborted and the bus is recovered without
+ * cancelling the other queued transactions.
+ *
+ * This function doesn't block and can be called from an ISR.
+ *
+ * @param i2c I2C interface.
+ * @param trans First transaction of the batch.
+ * @param reserved Reserved argument. Must be set to `NULL`.
+ * @return 0 on success, or a negative result code in case of an error.
+ */
+int hal_i2c_queue_transactions(hal_i2c_interface_t i2c, hal_i2c_transaction_t* trans, void* reserved);
+#endif // HAL_PLATFORM_I2C_TRANSACTION_QUEUE
+
 void hal_i2c_set_speed_deprecated(uint32_t speed);
 void hal_i2c_enable_dma_mode_deprecated(bool enable);
 void hal_i2c_stretch_clock_deprecated(bool stretch);
@@ -33,6 +33,7 @@
 #include "flash_device_hal.h"
 #include "module_info_hal.h"
 #include "module_info.h"
+#include "hal_platform.h"
 
 #ifdef	__cplusplus
 extern "C" {
@@ -154,6 +155,13 @@ typedef enum {
  */
 int HAL_FLASH_End(void* reserved);
 
+#if HAL_PLATFORM_COMPRESSED_OTA
+/**
+ * Releases the resources used by an OTA update that has been cancelled or has failed.
+ */
+void HAL_FLASH_Cancel(void* reserved);
+#endif // HAL_PLATFORM_COMPRESSED_OTA
+
 /**
  * @param module Optional pointer to a module that receives the module definition of the firmware that was flashed.
  * @param dryRun when true, only test that the system has a pending update in memory. When false, the test is performed and the module
@@ -107,6 +107,30 @@ typedef struct hal_spi_acquire_config_t {
     system_tick_t timeout;
 } hal_spi_acquire_config_t;
 
+typedef enum hal_spi_transaction_flag_t {
+    HAL_SPI_TRANSACTION_FLAG_SETTINGS = 0x01,           // Use the settings specified in the transaction
+    HAL_SPI_TRANSACTION_FLAG_DEFAULT_SETTINGS = 0x02,   // Use the default settings
+    HAL_SPI_TRANSACTION_FLAG_KEEP_SELECTED = 0x04       // Keep the CS pin asserted if the next transaction uses the same pin
+} hal_spi_transaction_flag_t;
+
+typedef void (*hal_spi_transaction_callback)(int result, void* context);
+
+typedef struct hal_spi_transaction_t {
+    uint16_t size;
+    uint16_t version;
+    const void* tx_buffer;                  // Can be located in flash
+    void* rx_buffer;                        // Must be located in RAM
+    uint32_t length;
+    pin_t cs_pin;                           // PIN_INVALID if the CS pin is not managed by the HAL
+    uint8_t flags;                          // See hal_spi_transaction_flag_t
+    uint8_t clock_div;
+    uint8_t bit_order;
+    uint8_t data_mode;
+    hal_spi_transaction_callback callback;  // Invoked in an ISR context
+    void* context;
+    struct hal_spi_transaction_t* next;     // Next transaction in the batch
+} hal_spi_transaction_t;
+
 void hal_spi_init(hal_spi_interface_t spi);
 void hal_spi_begin(hal_spi_interface_t spi, uint16_t pin);
 void hal_spi_begin_ext(hal_spi_interface_t spi, hal_spi_mode_t mode, uint16_t pin, void* reserved);
@@ -134,6 +158,24 @@ int32_t hal_spi_release(hal_spi_interface_t spi, void* reserved);
 
 int hal_spi_get_clock_divider(hal_spi_interface_t spi, uint32_t clock, void* reserved);
 
+#if HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+/**
+ * Queues a batch of master mode transactions.
+ *
+ * The transactions are linked via the `next` field and are performed back-to-back after any
+ * previously queued transactions. The HAL asserts the transaction's CS pin before transferring
+ * its data and deasserts it afterwards. The transactions must remain valid until their callbacks
+ * are invoked. The `next` field of the last transaction is modified when more transactions are
+ * queued after it.
+ *
+ * @param spi SPI interface.
+ * @param trans First transaction of the batch.
+ * @param reserved Reserved argument. Must be set to `NULL`.
+ * @return 0 on success, or a negative result code in case of an error.
+ */
+int hal_spi_queue_transactions(hal_spi_interface_t spi, hal_spi_transaction_t* trans, void* reserved);
+#endif // HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+
 #include "spi_hal_compat.h"
 
 #ifdef __cplusplus
@@ -146,6 +146,42 @@ typedef struct hal_usart_buffer_config_t {
     uint16_t tx_buffer_size;
 } hal_usart_buffer_config_t;
 
+/**
+ * A segment of a scatter-gather write.
+ */
+typedef struct hal_usart_iovec_t {
+    const void* data;
+    size_t size;
+} hal_usart_iovec_t;
+
+/**
+ * Flags for `hal_usart_write_iov()`.
+ */
+typedef enum hal_usart_write_flag {
+    HAL_USART_WRITE_FLAG_NONE = 0x00,
+    /**
+     * Allow large segments residing in RAM to be transmitted directly from the caller's buffer
+     * rather than copied into the TX buffer. The call then blocks until those segments are sent.
+     */
+    HAL_USART_WRITE_FLAG_ZERO_COPY = 0x01
+} hal_usart_write_flag;
+
+#define HAL_USART_STATS_VERSION 1
+
+/**
+ * Per-port transfer statistics.
+ */
+typedef struct hal_usart_stats_t {
+    uint16_t size; ///< Size of this structure. Set by the caller, updated to the number of bytes filled.
+    uint16_t version; ///< Version of this structure (`HAL_USART_STATS_VERSION`).
+    uint32_t tx_bytes; ///< Number of bytes transmitted.
+    uint32_t rx_bytes; ///< Number of bytes received.
+    uint32_t tx_overruns; ///< Number of writes that didn't fit entirely into the TX buffer.
+    uint32_t rx_overruns; ///< Number of receiver overrun errors.
+    uint32_t rx_errors; ///< Number of framing, parity and break errors.
+    uint32_t tx_direct_bytes; ///< Number of bytes transmitted without copying into the TX buffer.
+} hal_usart_stats_t;
+
 int hal_usart_init_ex(hal_usart_interface_t serial, const hal_usart_buffer_config_t* config, void*);
 void hal_usart_init(hal_usart_interface_t serial, hal_usart_ring_buffer_t *rx_buffer, hal_usart_ring_buffer_t *tx_buffer);
 void hal_usart_begin(hal_usart_interface_t serial, uint32_t baud);
@@ -167,6 +203,8 @@ int hal_usart_sleep(hal_usart_interface_t serial, bool sleep, void* reserved);
 ssize_t hal_usart_write_buffer(hal_usart_interface_t serial, const void* buffer, size_t size, size_t elementSize);
 ssize_t hal_usart_read_buffer(hal_usart_interface_t serial, void* buffer, size_t size, size_t elementSize);
 ssize_t hal_usart_peek_buffer(hal_usart_interface_t serial, void* buffer, size_t size, size_t elementSize);
+ssize_t hal_usart_write_iov(hal_usart_interface_t serial, const hal_usart_iovec_t* iov, size_t count, unsigned flags, void* reserved);
+int hal_usart_get_stats(hal_usart_interface_t serial, hal_usart_stats_t* stats, void* reserved);
 
 
 #include "usart_hal_compat.h"
@@ -330,8 +330,13 @@ void PppNcpNetif::pppEventHandler(uint64_t ev) {
 }
 
 void PppNcpNetif::ncpEventHandlerCb(const NcpEvent& ev, void* ctx) {
-    LOG(TRACE, "NCP event %d", (int)ev.type);
     auto self = (PppNcpNetif*)ctx;
+    if (ev.type == NcpEvent::AT_DATA_RECEIVED) {
+        // Process URCs as soon as possible
+        os_semaphore_give(self->netifSemaphore_, false);
+        return;
+    }
+    LOG(TRACE, "NCP event %d", (int)ev.type);
     if (ev.type == NcpEvent::CONNECTION_STATE_CHANGED) {
         const auto& cev = static_cast<const NcpConnectionStateChangedEvent&>(ev);
         LOG(TRACE, "State changed event: %d", (int)cev.state);
@@ -34,6 +34,7 @@ extern "C" {
 #include "system_error.h"
 #include "lwiplock.h"
 #include <lwip/stats.h>
+#include <lwip/tcpip.h>
 #include <algorithm>
 #include "delay_hal.h"
 #include "platform_ncp.h"
@@ -51,6 +52,7 @@ netif_ext_callback_t Client::netifCb_ = {};
 int Client::netifClientDataIdx_ = -1;
 constexpr const char* Client::eventNames_[];
 constexpr const char* Client::stateNames_[];
+constexpr size_t Client::TX_BUFFER_SIZE;
 
 Client::Client() {
   std::call_once(once_, []() {
@@ -78,6 +80,9 @@ void Client::init() {
     inited_ = true;
     pcb_ = pppapi_pppos_create(&if_, &Client::outputCb, &Client::notifyStatusCb, this);
     SPARK_ASSERT(pcb_);
+    // Not critical, the frame chunks are written as is if the buffer can't be allocated
+    txBuf_.reset(new (std::nothrow) uint8_t[TX_BUFFER_SIZE]);
+    txLen_ = 0;
     if_.flags &= ~NETIF_FLAG_UP;
 
     LOCK_TCPIP_CORE();
@@ -210,7 +215,7 @@ int Client::input(const uint8_t* data, size_t size) {
       case STATE_DISCONNECTING:
       case STATE_CONNECTED: {
         LOG_DEBUG(TRACE, "RX: %lu", size);
-#if !PPP_INPROC_IRQ_SAFE
+#if !PPP_INPROC_IRQ_SAFE && !PPPOS_INPUT_OVERRIDE
         err_t err = pppos_input_tcpip(pcb_, (u8_t*)data, size);
 #else
         // We can safely pass the data directly to PPPoS without going
@@ -219,7 +224,11 @@ int Client::input(const uint8_t* data, size_t size) {
         auto linkDropBefore = lwip_stats.link.drop;
 #endif // DEBUG_BUILD
 
+#if PPPOS_INPUT_OVERRIDE
+        inputFrames(data, size);
+#else
         pppos_input(pcb_, (u8_t*)data, size);
+#endif // PPPOS_INPUT_OVERRIDE
 
 #ifdef DEBUG_BUILD
         auto linkDropAfter = lwip_stats.link.drop;
@@ -234,7 +243,7 @@ int Client::input(const uint8_t* data, size_t size) {
           LOG_DEBUG(WARN, "Almost out of pbufs");
           return SYSTEM_ERROR_NO_MEMORY;
         }
-#endif // PPP_INPROC_IRQ_SAFE
+#endif // !PPP_INPROC_IRQ_SAFE && !PPPOS_INPUT_OVERRIDE
         if (err) {
           return SYSTEM_ERROR_INTERNAL;
         }
@@ -245,6 +254,108 @@ int Client::input(const uint8_t* data, size_t size) {
   return SYSTEM_ERROR_INVALID_STATE;
 }
 
+#if PPPOS_INPUT_OVERRIDE
+int Client::inputFrames(const uint8_t* data, size_t size) {
+  auto pppos = static_cast<pppos_pcb*>(pcb_->link_ctx_cb);
+  bool open = false;
+  uint32_t accm = 0;
+  {
+    SYS_ARCH_DECL_PROTECT(lev);
+    SYS_ARCH_PROTECT(lev);
+    open = pppos->open;
+    // Only the control characters can be discarded on input
+    for (unsigned i = 0; i < sizeof(accm); i++) {
+      accm |= (uint32_t)pppos->in_accm[i] << (i * 8);
+    }
+    SYS_ARCH_UNPROTECT(lev);
+  }
+  if (!open) {
+    // Same as pppos_input(), drop everything until the link is open
+    decoder_.reset();
+    return SYSTEM_ERROR_INVALID_STATE;
+  }
+  decoder_.accm(accm);
+  decoder_.input(data, size);
+  return 0;
+}
+
+void Client::inputFrameCb(void* arg) {
+  auto p = static_cast<pbuf*>(arg);
+  Client* self = nullptr;
+  memcpy(&self, p->payload, sizeof(self));
+  pbuf_remove_header(p, sizeof(self));
+  ppp_input(self->pcb_, p);
+}
+
+bool Client::InputSink::begin(uint16_t protocol) {
+  abort();
+  head_ = pbuf_alloc(PBUF_RAW, PBUF_POOL_BUFSIZE, PBUF_POOL);
+  if (!head_) {
+    LINK_STATS_INC(link.memerr);
+    LINK_STATS_INC(link.drop);
+    return false;
+  }
+  tail_ = head_;
+  // The frame is passed to the TCP/IP thread along with the client instance, and ppp_input()
+  // expects the protocol field to be uncompressed
+  auto d = (uint8_t*)head_->payload;
+  memcpy(d, &client_, sizeof(client_));
+  d[sizeof(client_)] = protocol >> 8;
+  d[sizeof(client_) + 1] = protocol & 0xff;
+  offset_ = sizeof(client_) + sizeof(protocol);
+  size_ = offset_;
+  return true;
+}
+
+uint8_t* Client::InputSink::buffer(size_t* size) {
+  if (!tail_) {
+    return nullptr;
+  }
+  if (offset_ >= tail_->len) {
+    pbuf* next = tail_->next;
+    if (!next) {
+      next = pbuf_alloc(PBUF_RAW, PBUF_POOL_BUFSIZE, PBUF_POOL);
+      if (!next) {
+        LINK_STATS_INC(link.memerr);
+        return nullptr;
+      }
+      pbuf_cat(head_, next);
+    }
+    tail_ = next;
+    offset_ = 0;
+  }
+  *size = tail_->len - offset_;
+  return (uint8_t*)tail_->payload + offset_;
+}
+
+void Client::InputSink::commit(size_t size) {
+  offset_ += size;
+  size_ += size;
+}
+
+void Client::InputSink::end(size_t trim) {
+  if (!head_) {
+    return;
+  }
+  pbuf* p = head_;
+  head_ = tail_ = nullptr;
+  // Release the space that is not occupied by the frame
+  pbuf_realloc(p, size_ - trim);
+  if (tcpip_try_callback(&Client::inputFrameCb, p) != ERR_OK) {
+    pbuf_free(p);
+    LINK_STATS_INC(link.drop);
+  }
+}
+
+void Client::InputSink::abort() {
+  if (head_) {
+    pbuf_free(head_);
+    head_ = tail_ = nullptr;
+    LINK_STATS_INC(link.drop);
+  }
+}
+#endif // PPPOS_INPUT_OVERRIDE
+
 void Client::setNotifyCallback(NotifyCallback cb, void* ctx) {
   std::lock_guard<std::mutex> lk(mutex_);
   cb_ = cb;
@@ -435,16 +546,51 @@ uint32_t Client::outputCb(ppp_pcb* pcb, uint8_t* data, uint32_t len, void* ctx)
 uint32_t Client::output(const uint8_t* data, size_t len) {
   LOG_DEBUG(TRACE, "TX: %lu", len);
 
-  if (oCb_) {
-    auto r = oCb_(data, len, oCbCtx_);
-    if (r >= 0) {
-      return r;
+  if (!oCb_ || !len) {
+    return 0;
+  }
+  // PPPoS passes an outgoing frame in chunks, one per pbuf. Coalesce them so that the frame
+  // is written to the muxer at once and takes fewer muxer frames
+  const bool frameEnd = data[len - 1] == PPP_FLAG;
+  if (txBuf_ && (txLen_ > 0 || !frameEnd)) {
+    if (txLen_ + len > TX_BUFFER_SIZE && flushOutput() < 0) {
+      // The beginning of the frame is lost. Report the error so that PPP discards the rest of
+      // the frame and starts the next one with a flag
+      return 0;
     }
+    if (txLen_ + len <= TX_BUFFER_SIZE) {
+      memcpy(txBuf_.get() + txLen_, data, len);
+      txLen_ += len;
+      if (frameEnd && flushOutput() < 0) {
+        return 0;
+      }
+      return len;
+    }
+  }
+
+  auto r = oCb_(data, len, oCbCtx_);
+  if (r >= 0) {
+    return r;
   }
 
   return 0;
 }
 
+int Client::flushOutput() {
+  if (!txLen_) {
+    return 0;
+  }
+  // The buffered data is discarded even if it cannot be written
+  const size_t len = txLen_;
+  txLen_ = 0;
+  auto r = oCb_(txBuf_.get(), len, oCbCtx_);
+  if (r < 0 || (size_t)r != len) {
+    LOG_DEBUG(WARN, "Failed to write %u bytes: %d", (unsigned)len, r);
+    return SYSTEM_ERROR_IO;
+  }
+  return 0;
+}
+
 void Client::notifyPhaseCb(ppp_pcb* pcb, uint8_t phase, void* ctx) {
   Client* self = static_cast<Client*>(ctx);
   if (self) {
@@ -32,6 +32,9 @@ extern "C" {
 #include <mutex>
 #include <atomic>
 #include "stream.h"
+#if PPPOS_INPUT_OVERRIDE
+#include "ppp_hdlc.h"
+#endif // PPPOS_INPUT_OVERRIDE
 
 #ifdef __cplusplus
 
@@ -127,6 +130,7 @@ private:
 
   static uint32_t outputCb(ppp_pcb* pcb, uint8_t* data, uint32_t len, void* ctx);
   uint32_t output(const uint8_t* data, size_t len);
+  int flushOutput();
 
   static void notifyPhaseCb(ppp_pcb* pcb, uint8_t phase, void* ctx);
   void notifyPhase(uint8_t phase);
@@ -141,6 +145,36 @@ private:
 
   void transition(State newState);
 
+#if PPPOS_INPUT_OVERRIDE
+  /* Assembles decoded frames in pbuf chains allocated from PBUF_POOL */
+  class InputSink {
+  public:
+    explicit InputSink(Client* client)
+        : client_(client) {
+    }
+
+    ~InputSink() {
+      abort();
+    }
+
+    bool begin(uint16_t protocol);
+    uint8_t* buffer(size_t* size);
+    void commit(size_t size);
+    void end(size_t trim);
+    void abort();
+
+  private:
+    Client* client_;
+    pbuf* head_ = nullptr;
+    pbuf* tail_ = nullptr;
+    size_t offset_ = 0;
+    size_t size_ = 0;
+  };
+
+  int inputFrames(const uint8_t* data, size_t size);
+  static void inputFrameCb(void* arg);
+#endif // PPPOS_INPUT_OVERRIDE
+
 private:
   netif if_ = {};
   ppp_pcb* pcb_ = nullptr;
@@ -167,9 +201,19 @@ private:
   OutputCallback oCb_ = nullptr;
   void* oCbCtx_ = nullptr;
 
+  /* Buffer for coalescing the chunks of an outgoing frame */
+  static constexpr size_t TX_BUFFER_SIZE = PPP_MRU + 128;
+  std::unique_ptr<uint8_t[]> txBuf_;
+  size_t txLen_ = 0;
+
   EnterDataModeCallback enterDataModeCb_ = nullptr;
   void* enterDataModeCbCtx_ = nullptr;
 
+#if PPPOS_INPUT_OVERRIDE
+  InputSink inputSink_{this};
+  HdlcDecoder<InputSink> decoder_{&inputSink_};
+#endif // PPPOS_INPUT_OVERRIDE
+
   bool inited_ = false;
   std::atomic_bool running_;
   std::atomic_bool exit_;
@@ -0,0 +1,336 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAL_NETWORK_LWIP_PPP_HDLC_H
+#define HAL_NETWORK_LWIP_PPP_HDLC_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+#ifdef __cplusplus
+
+namespace particle { namespace net { namespace ppp {
+
+namespace hdlc {
+
+const uint8_t FLAG = 0x7e;
+const uint8_t ESCAPE = 0x7d;
+const uint8_t TRANS = 0x20;
+const uint8_t ALLSTATIONS = 0xff;
+const uint8_t UI = 0x03;
+
+const uint16_t FCS_INIT = 0xffff;
+const uint16_t FCS_GOOD = 0xf0b8;
+const size_t FCS_SIZE = 2;
+
+/* FCS-16 as defined in RFC 1662, Appendix C */
+uint16_t fcs16(uint16_t fcs, const uint8_t* data, size_t size);
+
+namespace detail {
+
+const uint32_t ONES = 0x01010101;
+const uint32_t HIGHS = 0x80808080;
+
+/* Returns a non-zero value if any byte of the word is zero */
+inline uint32_t hasZeroByte(uint32_t w) {
+  return (w - ONES) & ~w & HIGHS;
+}
+
+/* Returns a non-zero value if any byte of the word is equal to b */
+inline uint32_t hasByte(uint32_t w, uint8_t b) {
+  return hasZeroByte(w ^ (ONES * b));
+}
+
+/* Returns a non-zero value if any byte of the word is less than n (n <= 128) */
+inline uint32_t hasByteLessThan(uint32_t w, uint8_t n) {
+  return (w - ONES * n) & ~w & HIGHS;
+}
+
+} /* namespace detail */
+
+} /* namespace hdlc */
+
+/*
+ * Decoder for the HDLC-like framing used by PPP over serial links (RFC 1662).
+ *
+ * The input is unescaped in place and written directly into the buffers provided by
+ * the sink, so the received data is copied only once on its way to the network stack.
+ * The input is scanned for flag and escape characters a word at a time, and runs of bytes
+ * that don't need unescaping are copied in bulk.
+ *
+ * SinkT must provide the following methods:
+ *
+ *   bool begin(uint16_t protocol) - start a new frame, returns false if no memory is available
+ *   uint8_t* buffer(size_t* size) - get a buffer for the next chunk of the frame, or nullptr
+ *   void commit(size_t size) - commit the data written into the buffer
+ *   void end(size_t trim) - complete the frame, discarding the last `trim` bytes (FCS)
+ *   void abort() - discard the frame
+ */
+template <typename SinkT>
+class HdlcDecoder {
+public:
+  explicit HdlcDecoder(SinkT* sink)
+      : sink_(sink) {
+    reset();
+  }
+
+  /* Processes a chunk of the incoming byte stream */
+  void input(const uint8_t* data, size_t size);
+
+  /* Discards the frame being received and waits for the next flag sequence */
+  void reset();
+
+  /* Set of received control characters (0x00-0x1f) that should be discarded */
+  void accm(uint32_t accm) {
+    accm_ = accm;
+  }
+
+  uint32_t accm() const {
+    return accm_;
+  }
+
+  unsigned frames() const {
+    return frames_;
+  }
+
+  unsigned fcsErrors() const {
+    return fcsErrors_;
+  }
+
+  unsigned lengthErrors() const {
+    return lengthErrors_;
+  }
+
+  unsigned dropped() const {
+    return dropped_;
+  }
+
+private:
+  enum State {
+    STATE_HUNT,
+    STATE_ADDRESS,
+    STATE_CONTROL,
+    STATE_PROTOCOL1,
+    STATE_PROTOCOL2,
+    STATE_DATA
+  };
+
+  SinkT* sink_;
+  uint32_t accm_ = 0;
+  size_t size_ = 0;
+  uint16_t fcs_ = hdlc::FCS_INIT;
+  uint16_t protocol_ = 0;
+  State state_ = STATE_HUNT;
+  bool escaped_ = false;
+  bool drop_ = false;
+
+  unsigned frames_ = 0;
+  unsigned fcsErrors_ = 0;
+  unsigned lengthErrors_ = 0;
+  unsigned dropped_ = 0;
+
+  bool isSpecial(uint8_t c) const {
+    return c == hdlc::FLAG || c == hdlc::ESCAPE || (c < 0x20 && (accm_ & (1ul << c)));
+  }
+
+  const uint8_t* findSpecial(const uint8_t* p, const uint8_t* end) const;
+
+  void process(uint8_t c);
+  void write(const uint8_t* data, size_t size);
+  void beginData();
+  void endFrame();
+  void discard();
+};
+
+template <typename SinkT>
+inline void HdlcDecoder<SinkT>::input(const uint8_t* data, size_t size) {
+  const uint8_t* const end = data + size;
+  while (data < end) {
+    if (state_ == STATE_DATA && !escaped_) {
+      const uint8_t* p = findSpecial(data, end);
+      if (p != data) {
+        write(data, p - data);
+        data = p;
+        continue;
+      }
+    }
+    const uint8_t c = *data++;
+    if (c == hdlc::FLAG) {
+      endFrame();
+    } else if (state_ == STATE_HUNT) {
+      // Skip everything until the next flag sequence
+    } else if (c == hdlc::ESCAPE) {
+      escaped_ = true;
+    } else if (c < 0x20 && (accm_ & (1ul << c))) {
+      // Control characters inserted by the link
+    } else if (escaped_) {
+      escaped_ = false;
+      process(c ^ hdlc::TRANS);
+    } else {
+      process(c);
+    }
+  }
+}
+
+template <typename SinkT>
+inline void HdlcDecoder<SinkT>::reset() {
+  discard();
+  state_ = STATE_HUNT;
+  escaped_ = false;
+}
+
+template <typename SinkT>
+inline const uint8_t* HdlcDecoder<SinkT>::findSpecial(const uint8_t* p, const uint8_t* end) const {
+  using namespace hdlc::detail;
+  // Check 4 bytes at a time and only look at individual bytes if the word contains a flag, escape
+  // or control character
+  const bool checkCtrl = accm_ != 0;
+  while (end - p >= 4) {
+    uint32_t w;
+    memcpy(&w, p, sizeof(w));
+    if (hasByte(w, hdlc::FLAG) || hasByte(w, hdlc::ESCAPE) || (checkCtrl && hasByteLessThan(w, 0x20))) {
+      for (unsigned i = 0; i < 4; ++i) {
+        if (isSpecial(p[i])) {
+          return p + i;
+        }
+      }
+    }
+    p += 4;
+  }
+  while (p < end && !isSpecial(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+template <typename SinkT>
+inline void HdlcDecoder<SinkT>::process(uint8_t c) {
+  if (state_ == STATE_DATA) {
+    write(&c, 1);
+    return;
+  }
+  fcs_ = hdlc::fcs16(fcs_, &c, 1);
+  switch (state_) {
+    case STATE_ADDRESS: {
+      if (c == hdlc::ALLSTATIONS) {
+        state_ = STATE_CONTROL;
+        break;
+      }
+      // Address and control fields are compressed
+    } /* fall through */
+    case STATE_CONTROL: {
+      if (c == hdlc::UI) {
+        state_ = STATE_PROTOCOL1;
+        break;
+      }
+    } /* fall through */
+    case STATE_PROTOCOL1: {
+      // The least significant bit is set in the last byte of the protocol field
+      if (c & 1) {
+        protocol_ = c;
+        beginData();
+      } else {
+        protocol_ = (uint16_t)c << 8;
+        state_ = STATE_PROTOCOL2;
+      }
+      break;
+    }
+    case STATE_PROTOCOL2: {
+      protocol_ |= c;
+      beginData();
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+template <typename SinkT>
+inline void HdlcDecoder<SinkT>::write(const uint8_t* data, size_t size) {
+  fcs_ = hdlc::fcs16(fcs_, data, size);
+  if (drop_) {
+    return;
+  }
+  while (size > 0) {
+    size_t n = 0;
+    uint8_t* buf = sink_->buffer(&n);
+    if (!buf || !n) {
+      sink_->abort();
+      drop_ = true;
+      ++dropped_;
+      return;
+    }
+    n = std::min(n, size);
+    memcpy(buf, data, n);
+    sink_->commit(n);
+    data += n;
+    size -= n;
+    size_ += n;
+  }
+}
+
+template <typename SinkT>
+inline void HdlcDecoder<SinkT>::beginData() {
+  state_ = STATE_DATA;
+  size_ = 0;
+  if (!sink_->begin(protocol_)) {
+    drop_ = true;
+    ++dropped_;
+  }
+}
+
+template <typename SinkT>
+inline void HdlcDecoder<SinkT>::endFrame() {
+  if (escaped_) {
+    // Abort sequence
+    discard();
+  } else if (state_ == STATE_HUNT || state_ == STATE_ADDRESS) {
+    // Leading or back-to-back flag sequence
+  } else if (state_ != STATE_DATA || size_ < hdlc::FCS_SIZE) {
+    ++lengthErrors_;
+    discard();
+  } else if (fcs_ != hdlc::FCS_GOOD) {
+    ++fcsErrors_;
+    discard();
+  } else if (!drop_) {
+    sink_->end(hdlc::FCS_SIZE);
+    ++frames_;
+  }
+  state_ = STATE_ADDRESS;
+  escaped_ = false;
+  drop_ = false;
+  size_ = 0;
+  fcs_ = hdlc::FCS_INIT;
+}
+
+template <typename SinkT>
+inline void HdlcDecoder<SinkT>::discard() {
+  if (state_ == STATE_DATA && !drop_) {
+    sink_->abort();
+  }
+  drop_ = false;
+  size_ = 0;
+  fcs_ = hdlc::FCS_INIT;
+}
+
+} } } /* namespace particle::net::ppp */
+
+#endif /* __cplusplus */
+
+#endif /* HAL_NETWORK_LWIP_PPP_HDLC_H */
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "at_command_batch.h"
+
+#include "at_parser.h"
+#include "at_command.h"
+#include "at_response.h"
+
+#include "check.h"
+
+#include <memory>
+#include <cstdio>
+#include <cstring>
+
+namespace particle {
+
+namespace {
+
+// Initial buffer size for the vadd() method
+const size_t PRINTF_INIT_BUF_SIZE = 128;
+
+// Size of the "AT" prefix
+const size_t AT_PREFIX_SIZE = 2;
+
+// Returns true if the command can be concatenated with other commands on the same command line
+bool isExtendedCommand(const char* cmd, size_t size) {
+    return (size > AT_PREFIX_SIZE + 1 && (cmd[0] == 'A' || cmd[0] == 'a') && (cmd[1] == 'T' || cmd[1] == 't') &&
+            (cmd[2] == '+' || cmd[2] == '&'));
+}
+
+} // unnamed
+
+AtCommandBatch::AtCommandBatch(AtParser* parser, size_t maxLineSize) :
+        parser_(parser),
+        maxLineSize_(maxLineSize),
+        timeout_(0),
+        failedCmd_(-1),
+        failedCmdCount_(0),
+        errorCode_(0),
+        lineCount_(0) {
+}
+
+int AtCommandBatch::add(const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    const int ret = vadd(0, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+int AtCommandBatch::add(unsigned flags, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    const int ret = vadd(flags, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+int AtCommandBatch::vadd(const char* fmt, va_list args) {
+    return vadd(0, fmt, args);
+}
+
+int AtCommandBatch::vadd(unsigned flags, const char* fmt, va_list args) {
+    char buf[PRINTF_INIT_BUF_SIZE];
+    va_list args2;
+    va_copy(args2, args);
+    const int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    CString cmd;
+    if (n >= 0 && (size_t)n < sizeof(buf)) {
+        cmd = CString(buf, n);
+    } else if (n > 0) {
+        // Allocate a larger buffer on the heap
+        std::unique_ptr<char[]> buf2(new(std::nothrow) char[n + 1]);
+        if (buf2) {
+            vsnprintf(buf2.get(), n + 1, fmt, args2);
+            cmd = CString::wrap(buf2.release());
+        }
+    }
+    va_end(args2);
+    CHECK_TRUE(n >= 0, SYSTEM_ERROR_UNKNOWN);
+    CHECK_TRUE((const char*)cmd, SYSTEM_ERROR_NO_MEMORY);
+    CHECK_TRUE(cmds_.append(Command{ std::move(cmd), flags }), SYSTEM_ERROR_NO_MEMORY);
+    return 0;
+}
+
+int AtCommandBatch::exec(LineHandler handler, void* data) {
+    CHECK_TRUE(parser_, SYSTEM_ERROR_INVALID_STATE);
+    failedCmd_ = -1;
+    failedCmdCount_ = 0;
+    errorCode_ = 0;
+    lineCount_ = 0;
+    int i = 0;
+    while (i < cmds_.size()) {
+        const int n = lineCommandCount(i);
+        int r = CHECK(execLine(i, n, handler, data));
+        if (r != AtResponse::OK) {
+            if (n == 1 || !isLineIdempotent(i, n)) {
+                // The commands preceding the failed one have been executed already and must not
+                // be executed again
+                failedCmd_ = i;
+                failedCmdCount_ = n;
+                return r;
+            }
+            // Execute the commands one by one to find the failed command
+            for (int j = i; j < i + n; ++j) {
+                r = CHECK(execLine(j, 1, handler, data));
+                if (r != AtResponse::OK) {
+                    failedCmd_ = j;
+                    failedCmdCount_ = 1;
+                    return r;
+                }
+            }
+        }
+        i += n;
+    }
+    return AtResponse::OK;
+}
+
+int AtCommandBatch::execLine(int first, int count, LineHandler handler, void* data) {
+    ++lineCount_;
+    auto cmd = parser_->command();
+    if (timeout_ > 0) {
+        cmd.timeout(timeout_);
+    }
+    cmd.print(cmds_.at(first).text);
+    for (int i = first + 1; i < first + count; ++i) {
+        cmd.print(";");
+        cmd.print((const char*)cmds_.at(i).text + AT_PREFIX_SIZE);
+    }
+    auto resp = cmd.send();
+    if (handler) {
+        while (resp.hasNextLine()) {
+            const auto line = resp.readLine();
+            if (!line) {
+                break;
+            }
+            if (*line != '\0') {
+                CHECK(handler(line, data));
+            }
+        }
+    }
+    const int r = CHECK(resp.readResult());
+    if (r != AtResponse::OK) {
+        errorCode_ = resp.resultErrorCode();
+    }
+    return r;
+}
+
+int AtCommandBatch::lineCommandCount(int first) const {
+    const char* cmd = cmds_.at(first).text;
+    size_t lineSize = strlen(cmd);
+    if (!isExtendedCommand(cmd, lineSize)) {
+        return 1;
+    }
+    int count = 1;
+    for (int i = first + 1; i < cmds_.size(); ++i) {
+        cmd = cmds_.at(i).text;
+        const size_t size = strlen(cmd);
+        // The "AT" prefix is replaced with a separator
+        if (!isExtendedCommand(cmd, size) || lineSize + size - AT_PREFIX_SIZE + 1 > maxLineSize_) {
+            break;
+        }
+        lineSize += size - AT_PREFIX_SIZE + 1;
+        ++count;
+    }
+    return count;
+}
+
+bool AtCommandBatch::isLineIdempotent(int first, int count) const {
+    for (int i = first; i < first + count; ++i) {
+        if (!(cmds_.at(i).flags & Flag::IDEMPOTENT)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // particle
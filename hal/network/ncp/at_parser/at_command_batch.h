@@ -0,0 +1,231 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "c_string.h"
+
+#include "spark_wiring_vector.h"
+
+#include <cstddef>
+#include <cstdarg>
+
+namespace particle {
+
+class AtParser;
+
+/**
+ * Batch of AT commands.
+ *
+ * This class allows executing a sequence of independent AT commands with fewer round trips to
+ * the DCE. Consecutive extended commands (the ones starting with "AT+" or "AT&") are concatenated
+ * into a single command line as described in V.250, section 5.2.1, so the DCE processes them
+ * without waiting for the DTE to send each command separately:
+ *
+ * ```cpp
+ * AtCommandBatch batch(&parser);
+ * batch.add("AT+CREG=%d", 2);
+ * batch.add("AT+CGREG=%d", 2);
+ * batch.add("AT+CEREG=%d", 2);
+ * const int r = batch.exec(); // Sends "AT+CREG=2;+CGREG=2;+CEREG=2"
+ * ```
+ *
+ * The responses are received in the order in which the commands were added to the batch. The
+ * execution stops at the first command line that doesn't complete with "OK". According to V.250,
+ * the DCE executes the commands of a command line up to the failed command and doesn't execute
+ * the remaining ones. The batch doesn't know which command of the line has failed, so it reports
+ * the range of commands of the failed command line (see `failedCommand()` and
+ * `failedCommandCount()`).
+ *
+ * If all commands of a failed command line were added with the `IDEMPOTENT` flag, they are
+ * re-executed one by one in order to find the failed command. Note that the commands preceding
+ * the failed one are executed twice in this case, and their response lines are passed to the
+ * line handler twice as well.
+ */
+class AtCommandBatch {
+public:
+    /**
+     * Default maximum length of a command line, including the "AT" prefix.
+     */
+    static const size_t DEFAULT_MAX_LINE_SIZE = 128;
+
+    /**
+     * Command flags.
+     */
+    enum Flag {
+        /**
+         * The command can be safely executed more than once.
+         */
+        IDEMPOTENT = 0x01
+    };
+
+    /**
+     * Response line handler.
+     *
+     * @param line Response line.
+     * @param data User data.
+     * @return `0` on success, or a negative result code in case of an error.
+     */
+    typedef int(*LineHandler)(const char* line, void* data);
+
+    /**
+     * Constructs a batch object.
+     *
+     * @param parser Parser instance.
+     * @param maxLineSize Maximum length of a command line.
+     */
+    explicit AtCommandBatch(AtParser* parser, size_t maxLineSize = DEFAULT_MAX_LINE_SIZE);
+    /**
+     * Formats and adds an AT command to the batch.
+     *
+     * @param fmt printf-style format string.
+     * @param ... Formatting arguments.
+     * @return `0` on success, or a negative result code in case of an error.
+     */
+    int add(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+    /**
+     * Formats and adds an AT command to the batch.
+     *
+     * @param flags Command flags (a combination of the values defined by the `Flag` enum).
+     * @param fmt printf-style format string.
+     * @param ... Formatting arguments.
+     * @return `0` on success, or a negative result code in case of an error.
+     */
+    int add(unsigned flags, const char* fmt, ...) __attribute__((format(printf, 3, 4)));
+    /**
+     * Formats and adds an AT command to the batch.
+     *
+     * @param fmt printf-style format string.
+     * @param args Formatting arguments.
+     * @return `0` on success, or a negative result code in case of an error.
+     */
+    int vadd(const char* fmt, va_list args);
+    /**
+     * Formats and adds an AT command to the batch.
+     *
+     * @param flags Command flags (a combination of the values defined by the `Flag` enum).
+     * @param fmt printf-style format string.
+     * @param args Formatting arguments.
+     * @return `0` on success, or a negative result code in case of an error.
+     */
+    int vadd(unsigned flags, const char* fmt, va_list args);
+    /**
+     * Sets the timeout for each command line sent to the DCE.
+     *
+     * @param timeout Timeout in milliseconds.
+     * @return This batch object.
+     *
+     * @see `AtParserConfig::commandTimeout()`
+     */
+    AtCommandBatch& timeout(unsigned timeout);
+    /**
+     * Sends the commands and waits for their final result codes.
+     *
+     * @param handler Optional handler that is invoked for every intermediate response line.
+     * @param data User data.
+     * @return `AtResponse::OK` if all commands were executed successfully, the final result code
+     *         of the failed command, or a negative result code in case of an error.
+     *
+     * @see `failedCommand()`
+     * @see `failedCommandCount()`
+     * @see `resultErrorCode()`
+     */
+    int exec(LineHandler handler = nullptr, void* data = nullptr);
+    /**
+     * Removes all commands from the batch.
+     */
+    void clear();
+    /**
+     * Returns the number of commands in the batch.
+     */
+    int size() const;
+    /**
+     * Returns the index of the first command of the command line that failed during the last
+     * execution, or -1 if there was no failed command.
+     */
+    int failedCommand() const;
+    /**
+     * Returns the number of commands of the command line that failed during the last execution,
+     * or 0 if there was no failed command.
+     *
+     * One of these commands has failed. The commands preceding it have been executed by the DCE,
+     * and the commands following it have not.
+     */
+    int failedCommandCount() const;
+    /**
+     * Returns the error code reported via "+CME ERROR" or "+CMS ERROR" by the failed command line.
+     */
+    int resultErrorCode() const;
+    /**
+     * Returns the number of command lines sent to the DCE during the last execution.
+     */
+    int commandLineCount() const;
+
+    // Instances of this class are non-copyable
+    AtCommandBatch(const AtCommandBatch&) = delete;
+    AtCommandBatch& operator=(const AtCommandBatch&) = delete;
+
+private:
+    struct Command {
+        CString text;
+        unsigned flags;
+    };
+
+    spark::Vector<Command> cmds_;
+    AtParser* parser_;
+    size_t maxLineSize_;
+    unsigned timeout_;
+    int failedCmd_;
+    int failedCmdCount_;
+    int errorCode_;
+    int lineCount_;
+
+    int execLine(int first, int count, LineHandler handler, void* data);
+    int lineCommandCount(int first) const;
+    bool isLineIdempotent(int first, int count) const;
+};
+
+inline AtCommandBatch& AtCommandBatch::timeout(unsigned timeout) {
+    timeout_ = timeout;
+    return *this;
+}
+
+inline void AtCommandBatch::clear() {
+    cmds_.clear();
+}
+
+inline int AtCommandBatch::size() const {
+    return cmds_.size();
+}
+
+inline int AtCommandBatch::failedCommand() const {
+    return failedCmd_;
+}
+
+inline int AtCommandBatch::failedCommandCount() const {
+    return failedCmdCount_;
+}
+
+inline int AtCommandBatch::resultErrorCode() const {
+    return errorCode_;
+}
+
+inline int AtCommandBatch::commandLineCount() const {
+    return lineCount_;
+}
+
+} // particle
@@ -81,10 +81,14 @@ inline bool isNewline(char c) {
 }
 
 size_t findNewline(const char* data, size_t size) {
-    for (size_t i = 0; i < size; ++i) {
-        if (isNewline(data[i])) {
-            return i;
-        }
+    // Lines are normally terminated with CR, look for it first and then for LF in the preceding data
+    auto p = (const char*)memchr(data, '\r', size);
+    if (p) {
+        size = p - data;
+    }
+    p = (const char*)memchr(data, '\n', size);
+    if (p) {
+        size = p - data;
     }
     return size;
 }
@@ -269,7 +273,16 @@ int AtParserImpl::addUrcHandler(const char* prefix, AtParser::UrcHandler handler
     if (prefixSize == 0 || prefixSize > INPUT_BUF_SIZE) {
         return SYSTEM_ERROR_INVALID_ARGUMENT;
     }
-    removeUrcHandler(prefix);
+    for (int i = 0; i < urcHandlers_.size(); ++i) {
+        auto& h = urcHandlers_.at(i);
+        if (strcmp(h.prefix, prefix) == 0) {
+            // Replace the existing handler
+            h.prefix = prefix;
+            h.callback = handler;
+            h.data = data;
+            return 0;
+        }
+    }
     UrcHandler h = {};
     h.prefix = prefix;
     h.prefixSize = prefixSize;
@@ -278,16 +291,40 @@ int AtParserImpl::addUrcHandler(const char* prefix, AtParser::UrcHandler handler
     if (!urcHandlers_.append(std::move(h))) {
         return SYSTEM_ERROR_NO_MEMORY;
     }
+    Vector<UrcTrieNode> trie;
+    const int ret = buildUrcTrie(&trie);
+    if (ret < 0) {
+        urcHandlers_.takeLast();
+        return ret;
+    }
+    urcTrie_ = std::move(trie);
     return 0;
 }
 
 void AtParserImpl::removeUrcHandler(const char* prefix) {
+    int index = -1;
     for (int i = 0; i < urcHandlers_.size(); ++i) {
         if (strcmp(urcHandlers_.at(i).prefix, prefix) == 0) {
-            urcHandlers_.removeAt(i);
+            index = i;
             break;
         }
     }
+    if (index < 0) {
+        return;
+    }
+    urcHandlers_.removeAt(index);
+    // Update the existing tree so that it stays valid even if it can't be rebuilt
+    for (auto& node: urcTrie_) {
+        if (node.handler == index) {
+            node.handler = -1;
+        } else if (node.handler > index) {
+            --node.handler;
+        }
+    }
+    Vector<UrcTrieNode> trie;
+    if (buildUrcTrie(&trie) == 0) {
+        urcTrie_ = std::move(trie);
+    }
 }
 
 int AtParserImpl::processUrc(unsigned timeout) {
@@ -296,21 +333,36 @@ int AtParserImpl::processUrc(unsigned timeout) {
     }
     size_t urcCount = 0;
     for (;;) {
-        if (!checkStatus(StatusFlag::LINE_BEGIN)) {
-            PARSER_CHECK(nextLine(&timeout));
+        int ret = 0;
+        // Skip to the next line, including empty lines at the beginning of the stream
+        if (!checkStatus(StatusFlag::LINE_BEGIN) || checkStatus(StatusFlag::LINE_END)) {
+            ret = nextLine(&timeout);
+        }
+        if (ret >= 0) {
+            ret = parseLine(ParseFlag::PARSE_URC, &timeout);
+            if (ret == ParseResult::PARSED_URC) {
+                ++urcCount;
+                // Dispatch the remaining URCs that have already been received without blocking
+                timeout = 0;
+                continue;
+            }
         }
-        const int ret = PARSER_CHECK(parseLine(ParseFlag::PARSE_URC, &timeout));
-        if (ret == ParseResult::PARSED_URC) {
-            ++urcCount;
-            break;
+        if (ret >= 0) {
+            ret = readLine(nullptr, 0, &timeout);
+        }
+        if (ret < 0) {
+            if (ret == SYSTEM_ERROR_WOULD_BLOCK && urcCount > 0) {
+                break;
+            }
+            return error(ret);
         }
-        PARSER_CHECK(readLine(nullptr, 0, &timeout));
     }
     return urcCount;
 }
 
 void AtParserImpl::reset() {
-    bufPos_ = 0;
+    bufOffs_ = 0;
+    bufSize_ = 0;
     cmdSize_ = 0;
     cmdTimeout_ = 0;
     cmdTermOffs_ = 0;
@@ -415,16 +467,17 @@ int AtParserImpl::parseLine(unsigned flags, unsigned* timeout) {
 }
 
 int AtParserImpl::parseResult() {
-    if (bufPos_ == 0) {
+    if (bufSize_ == 0) {
         return ParseResult::READ_MORE;
     }
+    char* const buf = bufData();
     // Look for a result code that matches the buffer contents
     const ResultCode* r = nullptr;
     size_t maxSize = 0;
     for (size_t i = 0; i < RESULT_CODE_COUNT; ++i) {
         const ResultCode& r2 = RESULT_CODES[i];
-        const size_t n = std::min(bufPos_, r2.strSize);
-        if (memcmp(buf_, r2.str, n) == 0 && n > maxSize) {
+        const size_t n = std::min(bufSize_, r2.strSize);
+        if (memcmp(buf, r2.str, n) == 0 && n > maxSize) {
             r = &r2;
             maxSize = n;
         }
@@ -432,20 +485,20 @@ int AtParserImpl::parseResult() {
     if (!r) {
         return ParseResult::NO_MATCH;
     }
-    if (bufPos_ < r->strSize + 1) {
+    if (bufSize_ < r->strSize + 1) {
         return ParseResult::READ_MORE;
     }
-    char c = buf_[r->strSize]; // Separator character
+    char c = buf[r->strSize]; // Separator character
     if (r->val == AtResponse::CME_ERROR || r->val == AtResponse::CMS_ERROR) {
         // "+CME ERROR" or "+CMS ERROR" should be followed by ':'
         if (c != ':') {
             return ParseResult::NO_MATCH;
         }
-        if (bufPos_ < r->strSize + 2) {
+        if (bufSize_ < r->strSize + 2) {
             return ParseResult::READ_MORE;
         }
-        const auto codeStr = buf_ + r->strSize + 1; // First character after ':'
-        const size_t codeStrSize = bufPos_ - r->strSize - 1;
+        const auto codeStr = buf + r->strSize + 1; // First character after ':'
+        const size_t codeStrSize = bufSize_ - r->strSize - 1;
         const size_t n = findNewline(codeStr, codeStrSize);
         if (n == codeStrSize) {
             return ParseResult::READ_MORE;
@@ -476,41 +529,53 @@ int AtParserImpl::parseResult() {
 }
 
 int AtParserImpl::parseUrc(const UrcHandler** handler) {
-    if (bufPos_ == 0) {
+    if (bufSize_ == 0) {
         return ParseResult::READ_MORE;
     }
-    // Look for an URC prefix that matches the buffer contents
-    const UrcHandler* h = nullptr;
-    size_t maxSize = 0;
-    for (size_t i = 0; i < (size_t)urcHandlers_.size(); ++i) {
-        const UrcHandler& h2 = urcHandlers_.at(i);
-        const size_t n = std::min(bufPos_, h2.prefixSize);
-        if (memcmp(buf_, h2.prefix, n) == 0 && n > maxSize) {
-            h = &h2;
-            maxSize = n;
+    if (urcTrie_.isEmpty()) {
+        return ParseResult::NO_MATCH;
+    }
+    // Find the longest URC prefix that matches the buffer contents
+    const char* const buf = bufData();
+    const UrcTrieNode* const nodes = urcTrie_.data();
+    int node = nodes[0].child;
+    int h = -1;
+    size_t n = 0;
+    while (node >= 0) {
+        if (n == bufSize_) {
+            return ParseResult::READ_MORE; // A longer prefix may still match
+        }
+        const char c = buf[n];
+        while (node >= 0 && nodes[node].c != c) {
+            node = nodes[node].next;
+        }
+        if (node < 0) {
+            break;
         }
+        if (nodes[node].handler >= 0) {
+            h = nodes[node].handler;
+        }
+        node = nodes[node].child;
+        ++n;
     }
-    if (!h) {
+    if (h < 0) {
         return ParseResult::NO_MATCH;
     }
-    if (bufPos_ < h->prefixSize) {
-        return ParseResult::READ_MORE;
-    }
-    *handler = h;
+    *handler = &urcHandlers_.at(h);
     return ParseResult::PARSED_URC;
 }
 
 int AtParserImpl::parseEcho() {
-    if (bufPos_ == 0) {
+    if (bufSize_ == 0) {
         return ParseResult::READ_MORE;
     }
     // Check if the command line matches the buffer contents
-    size_t n = std::min(bufPos_, cmdSize_);
-    if (memcmp(buf_, cmdData_, n) != 0) {
+    size_t n = std::min(bufSize_, cmdSize_);
+    if (memcmp(bufData(), cmdData_, n) != 0) {
         return ParseResult::NO_MATCH;
     }
     n = std::min(cmdSize_, INPUT_BUF_SIZE);
-    if (bufPos_ < n) {
+    if (bufSize_ < n) {
         return ParseResult::READ_MORE;
     }
     return ParseResult::PARSED_ECHO;
@@ -519,24 +584,24 @@ int AtParserImpl::parseEcho() {
 int AtParserImpl::readLine(char* data, size_t size, unsigned* timeout) {
     size_t bytesRead = 0;
     for (;;) {
-        size_t n = findNewline(buf_, bufPos_);
+        const char* const buf = bufData();
+        size_t n = findNewline(buf, bufSize_);
         if (data && n > size) {
             n = size;
         }
         if (n > 0) {
             clearStatus(StatusFlag::LINE_BEGIN);
-            respSize_ += appendToBuf(respData_ + respSize_, RESP_BUF_SIZE - respSize_, buf_, n);
+            respSize_ += appendToBuf(respData_ + respSize_, RESP_BUF_SIZE - respSize_, buf, n);
             if (data) {
-                memcpy(data, buf_, n);
+                memcpy(data, buf, n);
                 data += n;
                 size -= n;
             }
             bytesRead += n;
-            bufPos_ -= n;
+            consume(n);
         }
-        if (bufPos_ > 0) {
-            memmove(buf_, buf_ + n, bufPos_);
-            if (isNewline(buf_[0])) {
+        if (bufSize_ > 0) {
+            if (isNewline(*bufData())) {
                 setStatus(StatusFlag::LINE_END);
                 if (conf_.logEnabled()) {
                     logRespLine(respData_, respSize_);
@@ -553,9 +618,10 @@ int AtParserImpl::readLine(char* data, size_t size, unsigned* timeout) {
 int AtParserImpl::nextLine(unsigned* timeout) {
     size_t bytesRead = 0;
     for (;;) {
-        size_t n = findNewline(buf_, bufPos_);
-        respSize_ += appendToBuf(respData_ + respSize_, RESP_BUF_SIZE - respSize_, buf_, n);
-        if (n < bufPos_) {
+        const char* const buf = bufData();
+        size_t n = findNewline(buf, bufSize_);
+        respSize_ += appendToBuf(respData_ + respSize_, RESP_BUF_SIZE - respSize_, buf, n);
+        if (n < bufSize_) {
             setStatus(StatusFlag::LINE_END);
             if (conf_.logEnabled()) {
                 logRespLine(respData_, respSize_);
@@ -563,19 +629,17 @@ int AtParserImpl::nextLine(unsigned* timeout) {
             respSize_ = 0;
             do {
                 ++n;
-            } while (n < bufPos_ && isNewline(buf_[n]));
+            } while (n < bufSize_ && isNewline(buf[n]));
         }
         if (n > 0) {
             clearStatus(StatusFlag::LINE_BEGIN);
             bytesRead += n;
-            bufPos_ -= n;
+            consume(n);
         }
-        if (bufPos_ > 0) {
-            memmove(buf_, buf_ + n, bufPos_);
-        } else {
+        if (bufSize_ == 0) {
             CHECK(readMore(timeout));
         }
-        if (checkStatus(StatusFlag::LINE_END) && !isNewline(buf_[0])) {
+        if (checkStatus(StatusFlag::LINE_END) && !isNewline(*bufData())) {
             clearStatus(StatusFlag::LINE_END);
             setStatus(StatusFlag::LINE_BEGIN);
             break;
@@ -585,11 +649,17 @@ int AtParserImpl::nextLine(unsigned* timeout) {
 }
 
 int AtParserImpl::readMore(unsigned* timeout) {
-    assert(bufPos_ < INPUT_BUF_SIZE);
+    assert(bufSize_ < INPUT_BUF_SIZE);
+    if (bufOffs_ > 0 && INPUT_BUF_SIZE - bufOffs_ - bufSize_ < INPUT_BUF_SIZE / 4) {
+        // Move the unprocessed data to the beginning of the buffer
+        memmove(buf_, buf_ + bufOffs_, bufSize_);
+        bufOffs_ = 0;
+    }
     const auto strm = conf_.stream();
+    const size_t pos = bufOffs_ + bufSize_;
     size_t bytesRead = 0;
     for (;;) {
-        bytesRead = CHECK(strm->read(buf_ + bufPos_, INPUT_BUF_SIZE - bufPos_));
+        bytesRead = CHECK(strm->read(buf_ + pos, INPUT_BUF_SIZE - pos));
         if (bytesRead > 0) {
             break;
         }
@@ -611,10 +681,47 @@ int AtParserImpl::readMore(unsigned* timeout) {
             *timeout -= t;
         }
     }
-    bufPos_ += bytesRead;
+    bufSize_ += bytesRead;
     return bytesRead;
 }
 
+int AtParserImpl::buildUrcTrie(Vector<UrcTrieNode>* trie) const {
+    size_t nodeCount = 1;
+    for (const auto& h: urcHandlers_) {
+        nodeCount += h.prefixSize;
+    }
+    CHECK_TRUE(nodeCount <= INT16_MAX, SYSTEM_ERROR_TOO_LARGE);
+    CHECK_TRUE(trie->reserve(nodeCount), SYSTEM_ERROR_NO_MEMORY);
+    const UrcTrieNode root = { -1, -1, -1, '\0' };
+    trie->append(root);
+    for (int i = 0; i < urcHandlers_.size(); ++i) {
+        const auto& h = urcHandlers_.at(i);
+        int node = 0;
+        for (size_t j = 0; j < h.prefixSize; ++j) {
+            const char c = h.prefix[j];
+            int prev = -1;
+            int child = trie->at(node).child;
+            while (child >= 0 && trie->at(child).c != c) {
+                prev = child;
+                child = trie->at(child).next;
+            }
+            if (child < 0) {
+                child = trie->size();
+                const UrcTrieNode n = { -1, -1, -1, c };
+                trie->append(n); // Can't fail, the memory is reserved
+                if (prev < 0) {
+                    trie->at(node).child = child;
+                } else {
+                    trie->at(prev).next = child;
+                }
+            }
+            node = child;
+        }
+        trie->at(node).handler = i;
+    }
+    return 0;
+}
+
 int AtParserImpl::flushCommand(unsigned* timeout) {
     if (!checkStatus(StatusFlag::FLUSH_CMD)) {
         return 0;
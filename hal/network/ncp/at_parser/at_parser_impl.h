@@ -40,7 +40,7 @@ namespace detail {
 using spark::Vector;
 
 // Size of the intermediate buffer for received data
-const size_t INPUT_BUF_SIZE = 64;
+const size_t INPUT_BUF_SIZE = 256;
 
 // Maximum number of AT command characters stored by the parser
 const size_t CMD_BUF_SIZE = 128;
@@ -111,11 +111,20 @@ private:
         void* data; // User data
     };
 
+    // Node of the prefix tree used to match URC prefixes. The root node is stored at index 0
+    struct UrcTrieNode {
+        int16_t child; // Index of the first child node or -1
+        int16_t next; // Index of the next sibling node or -1
+        int16_t handler; // Index of the URC handler or -1
+        char c; // Prefix character
+    };
+
     const char* const cmdTerm_; // Command terminator string
     const size_t cmdTermSize_; // Size of the command terminator string
 
     char buf_[INPUT_BUF_SIZE]; // Input buffer
-    size_t bufPos_; // Number of bytes in the input buffer
+    size_t bufOffs_; // Offset of the unprocessed data in the input buffer
+    size_t bufSize_; // Number of unprocessed bytes in the input buffer
 
     char cmdData_[CMD_BUF_SIZE]; // Command data
     size_t cmdSize_; // Size of the command data
@@ -130,6 +139,7 @@ private:
     unsigned status_; // Status flags
 
     Vector<UrcHandler> urcHandlers_; // URC handlers
+    Vector<UrcTrieNode> urcTrie_; // Prefix tree of the URC handlers
     AtParserConfig conf_; // Parser settings
 
     int readRespLine(char* data, size_t size);
@@ -143,6 +153,10 @@ private:
     int readLine(char* data, size_t size, unsigned* timeout);
     int nextLine(unsigned* timeout);
     int readMore(unsigned* timeout);
+    void consume(size_t size);
+    char* bufData();
+
+    int buildUrcTrie(Vector<UrcTrieNode>* trie) const;
 
     int flushCommand(unsigned* timeout);
     int write(const char* data, size_t* size, unsigned* timeout);
@@ -177,6 +191,18 @@ inline const AtParserConfig& AtParserImpl::config() const {
     return conf_;
 }
 
+inline void AtParserImpl::consume(size_t size) {
+    bufOffs_ += size;
+    bufSize_ -= size;
+    if (bufSize_ == 0) {
+        bufOffs_ = 0;
+    }
+}
+
+inline char* AtParserImpl::bufData() {
+    return buf_ + bufOffs_;
+}
+
 inline void AtParserImpl::setStatus(unsigned flags) {
     status_ |= flags;
 }
@@ -49,6 +49,7 @@ struct NcpEvent {
         NCP_STATE_CHANGED = 1,
         CONNECTION_STATE_CHANGED = 2,
         POWER_STATE_CHANGED = 3,
+        AT_DATA_RECEIVED = 4, // Unsolicited data is available on the AT channel (sent from the muxer thread)
         CUSTOM_EVENT_TYPE_BASE = 100
     };
 
@@ -23,6 +23,7 @@ LOG_SOURCE_CATEGORY("ncp.client");
 
 #include "at_command.h"
 #include "at_response.h"
+#include "at_command_batch.h"
 #include "network/ncp/cellular/network_config_db.h"
 
 #include "serial_stream.h"
@@ -150,6 +151,7 @@ int QuectelNcpClient::init(const NcpClientConfig& conf) {
     decltype(muxerAtStream_) muxStrm(new (std::nothrow) decltype(muxerAtStream_)::element_type(&muxer_, QUECTEL_NCP_AT_CHANNEL));
     CHECK_TRUE(muxStrm, SYSTEM_ERROR_NO_MEMORY);
     CHECK(muxStrm->init(QUECTEL_NCP_AT_CHANNEL_RX_BUFFER_SIZE));
+    muxStrm->dataCallback(muxAtChannelDataCb, this);
     CHECK(initParser(serial.get()));
     decltype(muxerDataStream_) muxDataStrm(new(std::nothrow) decltype(muxerDataStream_)::element_type(&muxer_, QUECTEL_NCP_PPP_CHANNEL));
     CHECK_TRUE(muxDataStrm, SYSTEM_ERROR_NO_MEMORY);
@@ -1222,11 +1224,11 @@ int QuectelNcpClient::registerNet() {
     resetRegistrationState();
 
     // Register GPRS, LET, NB-IOT network
-    r = CHECK_PARSER(parser_.execCommand("AT+CREG=2"));
-    CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_UNKNOWN);
-    r = CHECK_PARSER(parser_.execCommand("AT+CGREG=2"));
-    CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_UNKNOWN);
-    r = CHECK_PARSER(parser_.execCommand("AT+CEREG=2"));
+    AtCommandBatch regBatch(&parser_);
+    CHECK(regBatch.add("AT+CREG=2"));
+    CHECK(regBatch.add("AT+CGREG=2"));
+    CHECK(regBatch.add("AT+CEREG=2"));
+    r = CHECK_PARSER(regBatch.exec());
     CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_UNKNOWN);
 
     connectionState(NcpConnectionState::CONNECTING);
@@ -1272,9 +1274,7 @@ int QuectelNcpClient::registerNet() {
         }
     }
 
-    CHECK_PARSER_OK(parser_.execCommand("AT+CREG?"));
-    CHECK_PARSER_OK(parser_.execCommand("AT+CGREG?"));
-    CHECK_PARSER_OK(parser_.execCommand("AT+CEREG?"));
+    CHECK_PARSER_OK(queryRegistrationStatus());
 
     regStartTime_ = millis();
     regCheckTime_ = regStartTime_;
@@ -1282,6 +1282,15 @@ int QuectelNcpClient::registerNet() {
     return SYSTEM_ERROR_NONE;
 }
 
+int QuectelNcpClient::queryRegistrationStatus() {
+    // The responses are handled by the URC handlers
+    AtCommandBatch batch(&parser_);
+    CHECK(batch.add("AT+CREG?"));
+    CHECK(batch.add("AT+CGREG?"));
+    CHECK(batch.add("AT+CEREG?"));
+    return batch.exec();
+}
+
 void QuectelNcpClient::ncpState(NcpState state) {
     if (ncpState_ == NcpState::DISABLED) {
         return;
@@ -1461,6 +1470,21 @@ void QuectelNcpClient::connectionState(NcpConnectionState state) {
     }
 }
 
+void QuectelNcpClient::muxAtChannelDataCb(void* ctx) {
+    // Wake up the thread processing URCs instead of waiting for the next poll
+    const auto self = (QuectelNcpClient*)ctx;
+    if (self->lockCount_.load(std::memory_order_relaxed) > 0) {
+        // A command is in progress and its response is being received
+        return;
+    }
+    const auto handler = self->conf_.eventHandler();
+    if (handler) {
+        NcpEvent event = {};
+        event.type = NcpEvent::AT_DATA_RECEIVED;
+        handler(event, self->conf_.eventHandlerData());
+    }
+}
+
 int QuectelNcpClient::muxChannelStateCb(uint8_t channel, decltype(muxer_)::ChannelState oldState, decltype(muxer_)::ChannelState newState, void* ctx) {
     auto self = (QuectelNcpClient*)ctx;
 
@@ -1624,9 +1648,7 @@ int QuectelNcpClient::processEventsImpl() {
 
     // Check GPRS, LET, NB-IOT network registration status
     CHECK_PARSER(parser_.execCommand("AT+CEER"));
-    CHECK_PARSER_OK(parser_.execCommand("AT+CREG?"));
-    CHECK_PARSER_OK(parser_.execCommand("AT+CGREG?"));
-    CHECK_PARSER_OK(parser_.execCommand("AT+CEREG?"));
+    CHECK_PARSER_OK(queryRegistrationStatus());
     // Check the signal seen by the module while trying to register
     // Do not need to check for an OK, as this is just for debugging purpose
     CHECK_PARSER(parser_.execCommand("AT+QCSQ"));
@@ -24,6 +24,7 @@ LOG_SOURCE_CATEGORY("ncp.client");
 
 #include "at_command.h"
 #include "at_response.h"
+#include "at_command_batch.h"
 #include "network/ncp/cellular/network_config_db.h"
 
 #include "serial_stream.h"
@@ -157,6 +158,7 @@ int SaraNcpClient::init(const NcpClientConfig& conf) {
     decltype(muxerAtStream_) muxStrm(new(std::nothrow) decltype(muxerAtStream_)::element_type(&muxer_, UBLOX_NCP_AT_CHANNEL));
     CHECK_TRUE(muxStrm, SYSTEM_ERROR_NO_MEMORY);
     CHECK(muxStrm->init(UBLOX_NCP_AT_CHANNEL_RX_BUFFER_SIZE));
+    muxStrm->dataCallback(muxAtChannelDataCb, this);
     CHECK(initParser(serial.get()));
     decltype(muxerDataStream_) muxDataStrm(new(std::nothrow) decltype(muxerDataStream_)::element_type(&muxer_, UBLOX_NCP_PPP_CHANNEL));
     CHECK_TRUE(muxDataStrm, SYSTEM_ERROR_NO_MEMORY);
@@ -1578,9 +1580,10 @@ int SaraNcpClient::registerNet() {
     resetRegistrationState();
 
     if (conf_.ncpIdentifier() != PLATFORM_NCP_SARA_R410) {
-        r = CHECK_PARSER(parser_.execCommand("AT+CREG=2"));
-        CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_AT_NOT_OK);
-        r = CHECK_PARSER(parser_.execCommand("AT+CGREG=2"));
+        AtCommandBatch batch(&parser_);
+        CHECK(batch.add("AT+CREG=2"));
+        CHECK(batch.add("AT+CGREG=2"));
+        r = CHECK_PARSER(batch.exec());
         CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_AT_NOT_OK);
     } else {
         r = CHECK_PARSER(parser_.execCommand("AT+CEREG=2"));
@@ -1607,9 +1610,10 @@ int SaraNcpClient::registerNet() {
     }
 
     if (conf_.ncpIdentifier() != PLATFORM_NCP_SARA_R410) {
-        r = CHECK_PARSER(parser_.execCommand("AT+CREG?"));
-        CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_AT_NOT_OK);
-        r = CHECK_PARSER(parser_.execCommand("AT+CGREG?"));
+        AtCommandBatch batch(&parser_);
+        CHECK(batch.add("AT+CREG?"));
+        CHECK(batch.add("AT+CGREG?"));
+        r = CHECK_PARSER(batch.exec());
         CHECK_TRUE(r == AtResponse::OK, SYSTEM_ERROR_AT_NOT_OK);
     } else {
         r = CHECK_PARSER(parser_.execCommand("AT+CEREG?"));
@@ -1783,6 +1787,21 @@ void SaraNcpClient::connectionState(NcpConnectionState state) {
     }
 }
 
+void SaraNcpClient::muxAtChannelDataCb(void* ctx) {
+    // Wake up the thread processing URCs instead of waiting for the next poll
+    const auto self = (SaraNcpClient*)ctx;
+    if (self->lockCount_.load(std::memory_order_relaxed) > 0) {
+        // A command is in progress and its response is being received
+        return;
+    }
+    const auto handler = self->conf_.eventHandler();
+    if (handler) {
+        NcpEvent event = {};
+        event.type = NcpEvent::AT_DATA_RECEIVED;
+        handler(event, self->conf_.eventHandlerData());
+    }
+}
+
 int SaraNcpClient::muxChannelStateCb(uint8_t channel, decltype(muxer_)::ChannelState oldState,
         decltype(muxer_)::ChannelState newState, void* ctx) {
     auto self = (SaraNcpClient*)ctx;
@@ -29,6 +29,8 @@
 #include "static_recursive_mutex.h"
 #include "serial_stream.h"
 
+#include <atomic>
+
 namespace particle {
 
 class SerialStream;
@@ -76,6 +78,9 @@ private:
     AtParser dataParser_;
     std::unique_ptr<SerialStream> serial_;
     RecursiveMutex mutex_;
+    // Number of nested lock() calls. AT data received while the client is not locked can only
+    // contain URCs, anything else is read by the thread that issued the command
+    std::atomic<int> lockCount_{0};
     CellularNcpClientConfig conf_;
     volatile NcpState ncpState_ = NcpState::OFF;
     volatile NcpState prevNcpState_;
@@ -130,6 +135,7 @@ private:
     int configureApn(const CellularNetworkConfig& conf);
     int registerNet();
     int changeBaudRate(unsigned int baud);
+    static void muxAtChannelDataCb(void* ctx);
     static int muxChannelStateCb(uint8_t channel, decltype(muxer_)::ChannelState oldState,
             decltype(muxer_)::ChannelState newState, void* ctx);
     void ncpState(NcpState state);
@@ -163,9 +169,11 @@ inline AtParser* SaraNcpClient::atParser() {
 
 inline void SaraNcpClient::lock() {
     mutex_.lock();
+    ++lockCount_;
 }
 
 inline void SaraNcpClient::unlock() {
+    --lockCount_;
     mutex_.unlock();
 }
 
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "hal_platform.h"
+#include "ble_hal_defines.h"
+
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+namespace particle {
+
+namespace ble {
+
+/**
+ * RSSI measurements of a single connection.
+ *
+ * The measurements are recorded by the SoftDevice event handler, which is the only writer. The
+ * values can be read from any thread; a reading taken concurrently with an update may combine
+ * the fields of two consecutive measurements.
+ */
+class BleRssiStats {
+public:
+    BleRssiStats() {
+        reset();
+    }
+
+    void reset() {
+        last_ = BLE_LINK_STATS_RSSI_INVALID;
+        min_ = BLE_LINK_STATS_RSSI_INVALID;
+        max_ = BLE_LINK_STATS_RSSI_INVALID;
+        sum_.store(0, std::memory_order_relaxed);
+        count_.store(0, std::memory_order_relaxed);
+        for (auto& bucket : histogram_) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void update(int8_t rssi) {
+        if (rssi == BLE_LINK_STATS_RSSI_INVALID) {
+            return;
+        }
+        last_ = rssi;
+        if (min_ == BLE_LINK_STATS_RSSI_INVALID || rssi < min_) {
+            min_ = rssi;
+        }
+        if (max_ == BLE_LINK_STATS_RSSI_INVALID || rssi > max_) {
+            max_ = rssi;
+        }
+        sum_.fetch_add(rssi, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        histogram_[bucket(rssi)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the last measurement, or `BLE_LINK_STATS_RSSI_INVALID` if there are no measurements.
+     */
+    int8_t last() const {
+        return last_;
+    }
+
+    int8_t min() const {
+        return min_;
+    }
+
+    int8_t max() const {
+        return max_;
+    }
+
+    /**
+     * Returns the average of all measurements rounded to the nearest integer, or
+     * `BLE_LINK_STATS_RSSI_INVALID` if there are no measurements.
+     */
+    int8_t average() const {
+        return averageOf(sum_.load(std::memory_order_relaxed), count_.load(std::memory_order_relaxed));
+    }
+
+    uint32_t count() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+    uint32_t histogram(int bucket) const {
+        return histogram_[bucket].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Returns the histogram bucket for a measurement: < -90, -90..-81, ..., -40..-31, >= -30 dBm.
+     */
+    static int bucket(int8_t rssi) {
+        const int b = (rssi + 100) / 10;
+        return std::max(0, std::min(b, BLE_LINK_STATS_RSSI_BUCKET_COUNT - 1));
+    }
+
+    static int8_t averageOf(int32_t sum, uint32_t count) {
+        if (!count) {
+            return BLE_LINK_STATS_RSSI_INVALID;
+        }
+        const int32_t n = count;
+        return (sum < 0) ? (sum - n / 2) / n : (sum + n / 2) / n;
+    }
+
+private:
+    volatile int8_t last_;
+    volatile int8_t min_;
+    volatile int8_t max_;
+    std::atomic<int32_t> sum_;
+    std::atomic<uint32_t> count_;
+    std::atomic<uint32_t> histogram_[BLE_LINK_STATS_RSSI_BUCKET_COUNT];
+};
+
+/**
+ * Aggregates the last RSSI measurements of several connections.
+ */
+class BleRssiTotals {
+public:
+    BleRssiTotals() :
+            min_(BLE_LINK_STATS_RSSI_INVALID),
+            max_(BLE_LINK_STATS_RSSI_INVALID),
+            sum_(0),
+            count_(0) {
+    }
+
+    void add(const BleRssiStats& stats) {
+        const int8_t rssi = stats.last();
+        if (rssi == BLE_LINK_STATS_RSSI_INVALID) {
+            return;
+        }
+        if (min_ == BLE_LINK_STATS_RSSI_INVALID || rssi < min_) {
+            min_ = rssi;
+        }
+        if (max_ == BLE_LINK_STATS_RSSI_INVALID || rssi > max_) {
+            max_ = rssi;
+        }
+        sum_ += rssi;
+        ++count_;
+    }
+
+    /**
+     * Returns the RSSI of the weakest link, or `BLE_LINK_STATS_RSSI_INVALID` if no link has
+     * a measurement.
+     */
+    int8_t min() const {
+        return min_;
+    }
+
+    int8_t max() const {
+        return max_;
+    }
+
+    int8_t average() const {
+        return BleRssiStats::averageOf(sum_, count_);
+    }
+
+private:
+    int8_t min_;
+    int8_t max_;
+    int32_t sum_;
+    uint32_t count_;
+};
+
+} // namespace ble
+
+} // namespace particle
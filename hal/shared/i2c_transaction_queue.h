@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "i2c_hal.h"
+#include "hal_irq_flag.h"
+#include "system_error.h"
+#include "check.h"
+
+namespace particle {
+
+/**
+ * Low-level interface of an I2C master peripheral used by `I2cTransactionQueue`.
+ */
+class I2cBus {
+public:
+    /**
+     * Starts a transaction without waiting for its completion. Called with interrupts disabled.
+     *
+     * The queue must be notified via `I2cTransactionQueue::transferDone()` when the transaction
+     * completes.
+     */
+    virtual int startTransfer(const hal_i2c_transaction_t* trans) = 0;
+    /**
+     * Aborts the current transaction. Called with interrupts disabled.
+     *
+     * No completion notification is expected for an aborted transaction.
+     */
+    virtual void abortTransfer() = 0;
+    /**
+     * Recovers the bus after a transaction has timed out, e.g. by clocking out a device that
+     * holds the data line low. Called with interrupts enabled.
+     *
+     * No transactions are started until this method returns.
+     */
+    virtual void recoverBus() = 0;
+    /**
+     * Requests a call to `I2cTransactionQueue::checkTimeout()` after the specified number of
+     * milliseconds.
+     */
+    virtual void startTimer(system_tick_t timeout) = 0;
+    /**
+     * Returns the current time in milliseconds.
+     */
+    virtual system_tick_t millis() = 0;
+
+protected:
+    ~I2cBus() = default;
+};
+
+/**
+ * Queue of I2C master transactions.
+ *
+ * Transactions are performed in the order in which they were queued. The next transaction is
+ * started before the completion callback of the previous one is invoked, so that the bus stays
+ * busy while the application processes the received data.
+ *
+ * A write without a stop condition leaves the bus claimed by the master. If such a write is the
+ * last transaction of an exclusive batch, the queue is held until the next exclusive batch is
+ * queued, so that the other transactions can't be performed in the middle of a repeated start
+ * sequence.
+ */
+class I2cTransactionQueue {
+public:
+    constexpr I2cTransactionQueue() :
+            bus_(nullptr),
+            front_(nullptr),
+            back_(nullptr),
+            holdTrans_(nullptr),
+            startTime_(0),
+            timeout_(0),
+            active_(false),
+            held_(false),
+            recovering_(false) {
+    }
+
+    I2cTransactionQueue(const I2cTransactionQueue&) = delete;
+    I2cTransactionQueue& operator=(const I2cTransactionQueue&) = delete;
+
+    void init(I2cBus* bus) {
+        bus_ = bus;
+    }
+
+    /**
+     * Queues a batch of transactions linked via the `next` field.
+     *
+     * If `exclusive` is true and the queue is held, the batch is performed before any other
+     * queued transactions. The queue is then held again if the last transaction of the batch is
+     * a write without a stop condition that completes successfully.
+     */
+    int push(hal_i2c_transaction_t* trans, bool exclusive = false) {
+        CHECK_TRUE(bus_ && trans, SYSTEM_ERROR_INVALID_ARGUMENT);
+        auto last = trans;
+        for (;;) {
+            CHECK_TRUE(!last->tx_length || last->tx_buffer, SYSTEM_ERROR_INVALID_ARGUMENT);
+            CHECK_TRUE(!last->rx_length || last->rx_buffer, SYSTEM_ERROR_INVALID_ARGUMENT);
+            if (!last->next) {
+                break;
+            }
+            last = last->next;
+        }
+        {
+            IrqLock lock;
+            if (exclusive && held_) {
+                // Continue the repeated start sequence ahead of the other transactions
+                last->next = front_;
+                front_ = trans;
+                if (!back_) {
+                    back_ = last;
+                }
+                held_ = false;
+            } else if (back_) {
+                back_->next = trans;
+                back_ = last;
+            } else {
+                front_ = trans;
+                back_ = last;
+            }
+            if (exclusive) {
+                holdTrans_ = last;
+            }
+        }
+        finish(nullptr, 0);
+        return 0;
+    }
+
+    /**
+     * Notifies the queue that the current transaction has completed.
+     *
+     * This method can be called from an ISR.
+     */
+    void transferDone(int result) {
+        hal_i2c_transaction_t* trans = nullptr;
+        {
+            IrqLock lock;
+            if (!active_) {
+                return;
+            }
+            const bool exclusive = (front_ == holdTrans_);
+            trans = pop();
+            if (exclusive) {
+                held_ = (result == 0 && leavesBusClaimed(trans));
+            }
+        }
+        finish(trans, result);
+    }
+
+    /**
+     * Aborts the current transaction and recovers the bus if the transaction has timed out.
+     * Other queued transactions are not affected.
+     *
+     * Returns the number of milliseconds left until the current transaction times out, or 0 if
+     * no transaction is in progress or the current transaction has been aborted.
+     */
+    system_tick_t checkTimeout() {
+        hal_i2c_transaction_t* trans = nullptr;
+        {
+            IrqLock lock;
+            if (!active_) {
+                return 0;
+            }
+            const system_tick_t elapsed = bus_->millis() - startTime_;
+            if (elapsed < timeout_) {
+                return timeout_ - elapsed;
+            }
+            bus_->abortTransfer();
+            trans = pop();
+            recovering_ = true;
+        }
+        bus_->recoverBus();
+        {
+            IrqLock lock;
+            recovering_ = false;
+        }
+        finish(trans, SYSTEM_ERROR_TIMEOUT);
+        return 0;
+    }
+
+    /**
+     * Cancels all queued transactions.
+     *
+     * The callbacks of the cancelled transactions are invoked with `SYSTEM_ERROR_CANCELLED`.
+     */
+    void cancel() {
+        hal_i2c_transaction_t* trans = nullptr;
+        {
+            IrqLock lock;
+            if (active_) {
+                bus_->abortTransfer();
+                active_ = false;
+            }
+            trans = front_;
+            front_ = nullptr;
+            back_ = nullptr;
+            holdTrans_ = nullptr;
+            held_ = false;
+        }
+        while (trans) {
+            const auto next = trans->next;
+            trans->next = nullptr;
+            notify(trans, SYSTEM_ERROR_CANCELLED);
+            trans = next;
+        }
+    }
+
+    bool isIdle() const {
+        return !front_;
+    }
+
+    /**
+     * Returns `true` if the queue is held by a write without a stop condition.
+     */
+    bool isHeld() const {
+        return held_;
+    }
+
+private:
+    class IrqLock {
+    public:
+        IrqLock() :
+                state_(HAL_disable_irq()) {
+        }
+
+        ~IrqLock() {
+            HAL_enable_irq(state_);
+        }
+
+    private:
+        int state_;
+    };
+
+    I2cBus* bus_;
+    hal_i2c_transaction_t* volatile front_;
+    hal_i2c_transaction_t* back_;
+    hal_i2c_transaction_t* holdTrans_; // Last transaction of the current exclusive batch
+    system_tick_t startTime_;
+    system_tick_t timeout_;
+    volatile bool active_;
+    volatile bool held_;
+    volatile bool recovering_;
+
+    // Removes the first transaction from the queue so that it can be queued again by the
+    // application. Must be called with interrupts disabled
+    hal_i2c_transaction_t* pop() {
+        const auto trans = front_;
+        front_ = trans->next;
+        trans->next = nullptr;
+        if (!front_) {
+            back_ = nullptr;
+        }
+        if (trans == holdTrans_) {
+            holdTrans_ = nullptr;
+        }
+        active_ = false;
+        return trans;
+    }
+
+    // Starts the next transaction if the bus is idle and notifies the application about the
+    // completion of a previous transaction
+    void finish(hal_i2c_transaction_t* trans, int result) {
+        for (;;) {
+            hal_i2c_transaction_t* failed = nullptr;
+            system_tick_t timeout = 0;
+            int error = 0;
+            {
+                IrqLock lock;
+                if (front_ && !active_ && !held_ && !recovering_) {
+                    error = bus_->startTransfer(front_);
+                    if (error < 0) {
+                        failed = pop();
+                    } else {
+                        timeout = front_->timeout_ms ? front_->timeout_ms : HAL_I2C_DEFAULT_TIMEOUT_MS;
+                        startTime_ = bus_->millis();
+                        timeout_ = timeout;
+                        active_ = true;
+                    }
+                }
+            }
+            if (timeout) {
+                bus_->startTimer(timeout);
+            }
+            if (trans) {
+                notify(trans, result);
+            }
+            if (!failed) {
+                break;
+            }
+            trans = failed;
+            result = error;
+        }
+    }
+
+    // The peripheral doesn't generate a stop condition after a write-only transaction unless
+    // requested
+    static bool leavesBusClaimed(const hal_i2c_transaction_t* trans) {
+        return !trans->rx_length && !(trans->flags & HAL_I2C_TRANSMISSION_FLAG_STOP);
+    }
+
+    static void notify(hal_i2c_transaction_t* trans, int result) {
+        if (trans->callback) {
+            trans->callback(result, trans->context);
+        }
+    }
+};
+
+} // namespace particle
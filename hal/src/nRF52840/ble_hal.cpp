@@ -43,14 +43,18 @@ LOG_SOURCE_CATEGORY("hal.ble");
 #include <mutex>
 
 #include "gpio_hal.h"
+#include "timer_hal.h"
 #include "device_code.h"
 #include "radio_common.h"
 #include "nrf_system_error.h"
 #include "sdk_config_system.h"
 #include "spark_wiring_vector.h"
 #include "simple_pool_allocator.h"
+#include "ble_rssi_stats.h"
 #include <string.h>
 #include <memory>
+#include <atomic>
+#include <algorithm>
 #include "check_nrf.h"
 #include "check.h"
 #include "scope_guard.h"
@@ -182,6 +186,241 @@ hal_ble_addr_t chipDefaultAddress() {
     return localAddr;
 }
 
+// RSSI change that triggers a BLE_GAP_EVT_RSSI_CHANGED event, in dBm.
+constexpr uint8_t BLE_LINK_STATS_RSSI_THRESHOLD_DBM = 2;
+// Number of RSSI samples with a change exceeding the threshold before the event is generated.
+constexpr uint8_t BLE_LINK_STATS_RSSI_SKIP_COUNT = 4;
+
+/*
+ * Per-connection statistics. The counters are updated from the SoftDevice event handlers and from
+ * the API calls, so they are atomic; a snapshot can be taken from any thread without locking.
+ */
+class BleLinkStatistics {
+public:
+    BleLinkStatistics() {
+        for (auto& link : links_) {
+            link.connHandle = BLE_INVALID_CONN_HANDLE;
+        }
+    }
+
+    void onConnected(hal_ble_conn_handle_t connHandle, uint16_t connInterval) {
+        Link* link = find(BLE_INVALID_CONN_HANDLE);
+        if (!link) {
+            return;
+        }
+        link->reset(connInterval);
+        link->connHandle = connHandle;
+        int ret = sd_ble_gap_rssi_start(connHandle, BLE_LINK_STATS_RSSI_THRESHOLD_DBM, BLE_LINK_STATS_RSSI_SKIP_COUNT);
+        if (ret != NRF_SUCCESS) {
+            LOG(ERROR, "sd_ble_gap_rssi_start() failed: %u", (unsigned)ret);
+        }
+    }
+
+    void onDisconnected(hal_ble_conn_handle_t connHandle) {
+        Link* link = find(connHandle);
+        if (link) {
+            link->connHandle = BLE_INVALID_CONN_HANDLE;
+        }
+    }
+
+    void onConnParamsUpdated(hal_ble_conn_handle_t connHandle, uint16_t connInterval) {
+        Link* link = find(connHandle);
+        if (link) {
+            const system_tick_t now = HAL_Timer_Get_Milli_Seconds();
+            link->connEvents += connEventsSince(link->intervalStart, link->connInterval, now);
+            link->intervalStart = now;
+            link->connInterval = connInterval;
+        }
+    }
+
+    void onRssi(hal_ble_conn_handle_t connHandle, int8_t rssi) {
+        Link* link = find(connHandle);
+        if (link) {
+            link->rssi.update(rssi);
+        }
+    }
+
+    void onPhyUpdated(hal_ble_conn_handle_t connHandle, uint8_t txPhy, uint8_t rxPhy) {
+        Link* link = find(connHandle);
+        if (link) {
+            link->txPhy = txPhy;
+            link->rxPhy = rxPhy;
+        }
+    }
+
+    void onDataLengthUpdated(hal_ble_conn_handle_t connHandle, uint16_t maxTxOctets, uint16_t maxRxOctets) {
+        Link* link = find(connHandle);
+        if (link) {
+            link->maxTxOctets = maxTxOctets;
+            link->maxRxOctets = maxRxOctets;
+        }
+    }
+
+    void onTxQueued(hal_ble_conn_handle_t connHandle, size_t bytes, bool hvx) {
+        Link* link = find(connHandle);
+        if (link) {
+            link->txBytes.fetch_add(bytes, std::memory_order_relaxed);
+            if (hvx) {
+                link->hvxQueued.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void onTxCompleted(hal_ble_conn_handle_t connHandle, unsigned count, bool hvx) {
+        Link* link = find(connHandle);
+        if (link) {
+            link->txPackets.fetch_add(count, std::memory_order_relaxed);
+            if (hvx) {
+                link->hvxCompleted.fetch_add(count, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void onRx(hal_ble_conn_handle_t connHandle, size_t bytes) {
+        Link* link = find(connHandle);
+        if (link) {
+            link->rxPackets.fetch_add(1, std::memory_order_relaxed);
+            link->rxBytes.fetch_add(bytes, std::memory_order_relaxed);
+        }
+    }
+
+    int rssi(hal_ble_conn_handle_t connHandle) const {
+        const Link* link = find(connHandle);
+        CHECK_TRUE(link, SYSTEM_ERROR_NOT_FOUND);
+        const int8_t rssi = link->rssi.last();
+        // Existing callers expect 0 if the RSSI hasn't been measured yet
+        return (rssi != BLE_LINK_STATS_RSSI_INVALID) ? rssi : 0;
+    }
+
+    int get(hal_ble_conn_handle_t connHandle, hal_ble_link_stats_t* stats) const {
+        CHECK_TRUE(stats, SYSTEM_ERROR_INVALID_ARGUMENT);
+        const Link* link = find(connHandle);
+        CHECK_TRUE(link, SYSTEM_ERROR_NOT_FOUND);
+        const system_tick_t now = HAL_Timer_Get_Milli_Seconds();
+        hal_ble_link_stats_t s = {};
+        s.version = BLE_API_VERSION;
+        s.size = sizeof(hal_ble_link_stats_t);
+        s.conn_handle = connHandle;
+        s.rssi = link->rssi.last();
+        s.duration_ms = now - link->connectedAt;
+        s.tx_packets = link->txPackets.load(std::memory_order_relaxed);
+        s.rx_packets = link->rxPackets.load(std::memory_order_relaxed);
+        s.tx_bytes = link->txBytes.load(std::memory_order_relaxed);
+        s.rx_bytes = link->rxBytes.load(std::memory_order_relaxed);
+        s.hvx_queued = link->hvxQueued.load(std::memory_order_relaxed);
+        s.hvx_completed = link->hvxCompleted.load(std::memory_order_relaxed);
+        if (s.duration_ms > 0) {
+            s.throughput = ((uint64_t)s.tx_bytes + s.rx_bytes) * 8 * 1000 / s.duration_ms;
+        }
+        s.conn_events = link->connEvents + connEventsSince(link->intervalStart, link->connInterval, now);
+        if (s.conn_events > 0) {
+            s.conn_event_utilization = ((uint64_t)s.tx_packets + s.rx_packets) * 100 / s.conn_events;
+        }
+        s.tx_phy = link->txPhy;
+        s.rx_phy = link->rxPhy;
+        s.max_tx_octets = link->maxTxOctets;
+        s.max_rx_octets = link->maxRxOctets;
+        for (int i = 0; i < BLE_LINK_STATS_RSSI_BUCKET_COUNT; i++) {
+            s.rssi_histogram[i] = link->rssi.histogram(i);
+        }
+        s.rssi_min = link->rssi.min();
+        s.rssi_max = link->rssi.max();
+        s.rssi_avg = link->rssi.average();
+        // Copy only as much as the caller's structure can hold
+        s.size = stats->size;
+        memcpy(stats, &s, std::min((size_t)stats->size, sizeof(hal_ble_link_stats_t)));
+        return SYSTEM_ERROR_NONE;
+    }
+
+    // Totals for all active links
+    int totals(hal_ble_link_totals_t* totals) const {
+        CHECK_TRUE(totals, SYSTEM_ERROR_INVALID_ARGUMENT);
+        const system_tick_t now = HAL_Timer_Get_Milli_Seconds();
+        hal_ble_link_totals_t t = {};
+        t.version = BLE_API_VERSION;
+        BleRssiTotals rssiTotals;
+        for (const auto& link : links_) {
+            if (link.connHandle == BLE_INVALID_CONN_HANDLE) {
+                continue;
+            }
+            ++t.link_count;
+            t.tx_packets += link.txPackets.load(std::memory_order_relaxed);
+            t.rx_packets += link.rxPackets.load(std::memory_order_relaxed);
+            const system_tick_t duration = now - link.connectedAt;
+            if (duration > 0) {
+                t.throughput += ((uint64_t)link.txBytes.load(std::memory_order_relaxed) + link.rxBytes.load(std::memory_order_relaxed)) * 8 * 1000 / duration;
+            }
+            rssiTotals.add(link.rssi);
+        }
+        // Reported as 0 if the RSSI hasn't been measured yet, like hal_ble_gap_get_rssi()
+        t.rssi = (rssiTotals.min() != BLE_LINK_STATS_RSSI_INVALID) ? rssiTotals.min() : 0;
+        // Copy only as much as the caller's structure can hold
+        t.size = totals->size;
+        memcpy(totals, &t, std::min((size_t)totals->size, sizeof(hal_ble_link_totals_t)));
+        return SYSTEM_ERROR_NONE;
+    }
+
+private:
+    struct Link {
+        volatile hal_ble_conn_handle_t connHandle;
+        system_tick_t connectedAt;
+        system_tick_t intervalStart;
+        uint32_t connEvents;                    /**< Connection events before intervalStart. */
+        volatile uint16_t connInterval;         /**< In units of 1.25 ms. */
+        BleRssiStats rssi;
+        volatile uint8_t txPhy;
+        volatile uint8_t rxPhy;
+        volatile uint16_t maxTxOctets;
+        volatile uint16_t maxRxOctets;
+        std::atomic<uint32_t> txPackets;
+        std::atomic<uint32_t> rxPackets;
+        std::atomic<uint32_t> txBytes;
+        std::atomic<uint32_t> rxBytes;
+        std::atomic<uint32_t> hvxQueued;
+        std::atomic<uint32_t> hvxCompleted;
+
+        void reset(uint16_t interval) {
+            connectedAt = HAL_Timer_Get_Milli_Seconds();
+            intervalStart = connectedAt;
+            connEvents = 0;
+            connInterval = interval;
+            rssi.reset();
+            txPhy = BLE_GAP_PHY_1MBPS;
+            rxPhy = BLE_GAP_PHY_1MBPS;
+            maxTxOctets = BLE_GAP_DATA_LENGTH_DEFAULT;
+            maxRxOctets = BLE_GAP_DATA_LENGTH_DEFAULT;
+            txPackets = 0;
+            rxPackets = 0;
+            txBytes = 0;
+            rxBytes = 0;
+            hvxQueued = 0;
+            hvxCompleted = 0;
+        }
+    };
+
+    static uint32_t connEventsSince(system_tick_t start, uint16_t interval, system_tick_t now) {
+        // The connection interval is in units of 1.25 ms
+        return interval ? (uint64_t)(now - start) * 4 / ((uint32_t)interval * 5) : 0;
+    }
+
+    Link* find(hal_ble_conn_handle_t connHandle) {
+        for (auto& link : links_) {
+            if (link.connHandle == connHandle) {
+                return &link;
+            }
+        }
+        return nullptr;
+    }
+
+    const Link* find(hal_ble_conn_handle_t connHandle) const {
+        return const_cast<BleLinkStatistics*>(this)->find(connHandle);
+    }
+
+    Link links_[BLE_MAX_LINK_COUNT];
+};
+
+BleLinkStatistics s_linkStats;
+
 } //anonymous namespace
 
 class BleObject {
@@ -922,6 +1161,14 @@ void BleObject::BleGap::processBleGapEvents(const ble_evt_t* event, void* contex
         }
         case BLE_GAP_EVT_PHY_UPDATE: {
             LOG_DEBUG(TRACE, "BLE GAP event: physical updated.");
+            const ble_gap_evt_phy_update_t& phyUpdate = event->evt.gap_evt.params.phy_update;
+            if (phyUpdate.status == BLE_HCI_STATUS_CODE_SUCCESS) {
+                s_linkStats.onPhyUpdated(event->evt.gap_evt.conn_handle, phyUpdate.tx_phy, phyUpdate.rx_phy);
+            }
+            break;
+        }
+        case BLE_GAP_EVT_RSSI_CHANGED: {
+            s_linkStats.onRssi(event->evt.gap_evt.conn_handle, event->evt.gap_evt.params.rssi_changed.rssi);
             break;
         }
         case BLE_GAP_EVT_DATA_LENGTH_UPDATE: {
@@ -930,6 +1177,9 @@ void BleObject::BleGap::processBleGapEvents(const ble_evt_t* event, void* contex
             LOG_DEBUG(TRACE, "  %d    %d     %d        %d",
                     event->evt.gap_evt.params.data_length_update.effective_params.max_tx_octets, event->evt.gap_evt.params.data_length_update.effective_params.max_rx_octets,
                     event->evt.gap_evt.params.data_length_update.effective_params.max_tx_time_us, event->evt.gap_evt.params.data_length_update.effective_params.max_rx_time_us);
+            s_linkStats.onDataLengthUpdated(event->evt.gap_evt.conn_handle,
+                    event->evt.gap_evt.params.data_length_update.effective_params.max_tx_octets,
+                    event->evt.gap_evt.params.data_length_update.effective_params.max_rx_octets);
             break;
         }
         case BLE_GAP_EVT_DATA_LENGTH_UPDATE_REQUEST: {
@@ -2639,12 +2889,14 @@ void BleObject::ConnectionsManager::processConnectionEvents(const ble_evt_t* eve
                 }
                 break;
             }
+            s_linkStats.onConnected(event->evt.gap_evt.conn_handle, connected.conn_params.max_conn_interval);
             memcpy(connectedEvent, event, sizeof(ble_evt_t));
             BleObject::getInstance().dispatcher()->enqueue(&connectedEvent);
             break;
         }
         case BLE_GAP_EVT_DISCONNECTED: {
             LOG_DEBUG(TRACE, "BLE GAP event: disconnected.");
+            s_linkStats.onDisconnected(event->evt.gap_evt.conn_handle);
             BleObject::getInstance().dispatcher()->enqueue(event);
             break;
         }
@@ -2658,6 +2910,8 @@ void BleObject::ConnectionsManager::processConnectionEvents(const ble_evt_t* eve
         }
         case BLE_GAP_EVT_CONN_PARAM_UPDATE: {
             LOG_DEBUG(TRACE, "BLE GAP event: connection parameters updated.");
+            s_linkStats.onConnParamsUpdated(event->evt.gap_evt.conn_handle,
+                    event->evt.gap_evt.params.conn_param_update.conn_params.max_conn_interval);
             BleObject::getInstance().dispatcher()->enqueue(event);
             break;
         }
@@ -2894,6 +3148,7 @@ ssize_t BleObject::GattServer::notifyValue(hal_ble_attr_handle_t attrHandle, con
             LOG(ERROR, "sd_ble_gatts_hvx() failed: %u", (unsigned)ret);
             continue;
         }
+        s_linkStats.onTxQueued(subscriber.connHandle, hvxLen, true /* hvx */);
         isHvxing_ = true;
         currHvxConnHandle_ = subscriber.connHandle;
         if (os_semaphore_take(hvxSemaphore_, BLE_OPERATION_TIMEOUT_MS, false)) {
@@ -3037,6 +3292,7 @@ void BleObject::GattServer::processGattServerEvents(const ble_evt_t* event, void
         }
         case BLE_GATTS_EVT_WRITE: {
             LOG_DEBUG(TRACE, "BLE GATT Server event: data written.");
+            s_linkStats.onRx(event->evt.gatts_evt.conn_handle, event->evt.gatts_evt.params.write.len);
             ble_evt_t* dataWrittenEvent = (ble_evt_t*)BleObject::getInstance().dispatcher()->allocEventData(sizeof(ble_evt_t) +
                     SUB1(event->evt.gatts_evt.params.write.len) * sizeof(uint8_t));
             if (!dataWrittenEvent) {
@@ -3051,6 +3307,7 @@ void BleObject::GattServer::processGattServerEvents(const ble_evt_t* event, void
         }
         case BLE_GATTS_EVT_HVN_TX_COMPLETE: {
             LOG_DEBUG(TRACE, "BLE GATT Server event: notification sent.");
+            s_linkStats.onTxCompleted(event->evt.gatts_evt.conn_handle, event->evt.gatts_evt.params.hvn_tx_complete.count, true /* hvx */);
             if (gatts->isHvxing_ && gatts->currHvxConnHandle_ == event->evt.gatts_evt.conn_handle) {
                 gatts->isHvxing_ = false;
                 os_semaphore_give(gatts->hvxSemaphore_, false);
@@ -3059,6 +3316,7 @@ void BleObject::GattServer::processGattServerEvents(const ble_evt_t* event, void
         }
         case BLE_GATTS_EVT_HVC: {
             LOG_DEBUG(TRACE, "BLE GATT Server event: indication confirmed.");
+            s_linkStats.onTxCompleted(event->evt.gatts_evt.conn_handle, 1, true /* hvx */);
             if (gatts->isHvxing_ && gatts->currHvxConnHandle_ == event->evt.gatts_evt.conn_handle) {
                 gatts->isHvxing_ = false;
                 os_semaphore_give(gatts->hvxSemaphore_, false);
@@ -3203,6 +3461,7 @@ ssize_t BleObject::GattClient::writeAttribute(hal_ble_conn_handle_t connHandle,
     writeParams.p_value = buf;
     int ret = sd_ble_gattc_write(connHandle, &writeParams);
     CHECK_NRF_RETURN(ret, nrf_system_error(ret));
+    s_linkStats.onTxQueued(connHandle, len, false /* hvx */);
     isWriting_ = true;
     currWriteConnHandle_ = connHandle;
     if (os_semaphore_take(writeSemaphore_, BLE_OPERATION_TIMEOUT_MS, false)) {
@@ -3669,6 +3928,7 @@ void BleObject::GattClient::processGattClientEvents(const ble_evt_t* event, void
         }
         case BLE_GATTC_EVT_READ_RSP: {
             LOG_DEBUG(TRACE, "BLE GATT Client event: read response.");
+            s_linkStats.onRx(event->evt.gattc_evt.conn_handle, event->evt.gattc_evt.params.read_rsp.len);
             ble_evt_t* readRspEvent = (ble_evt_t*)BleObject::getInstance().dispatcher()->allocEventData(sizeof(ble_evt_t) +
                     SUB1(event->evt.gattc_evt.params.read_rsp.len) * sizeof(uint8_t));
             if (!readRspEvent) {
@@ -3687,6 +3947,7 @@ void BleObject::GattClient::processGattClientEvents(const ble_evt_t* event, void
         }
         case BLE_GATTC_EVT_WRITE_RSP: {
             LOG_DEBUG(TRACE, "BLE GATT Client event: write with response completed.");
+            s_linkStats.onTxCompleted(event->evt.gattc_evt.conn_handle, 1, false /* hvx */);
             if (gattc->isWriting_ && gattc->currWriteConnHandle_ == event->evt.gattc_evt.conn_handle) {
                 gattc->isWriting_ = false;
                 os_semaphore_give(gattc->writeSemaphore_, false);
@@ -3695,6 +3956,7 @@ void BleObject::GattClient::processGattClientEvents(const ble_evt_t* event, void
         }
         case BLE_GATTC_EVT_WRITE_CMD_TX_COMPLETE: {
             LOG_DEBUG(TRACE, "BLE GATT Client event: write without response completed.");
+            s_linkStats.onTxCompleted(event->evt.gattc_evt.conn_handle, event->evt.gattc_evt.params.write_cmd_tx_complete.count, false /* hvx */);
             if (gattc->isWriting_ && gattc->currWriteConnHandle_ == event->evt.gattc_evt.conn_handle) {
                 gattc->isWriting_ = false;
                 os_semaphore_give(gattc->writeSemaphore_, false);
@@ -3703,6 +3965,7 @@ void BleObject::GattClient::processGattClientEvents(const ble_evt_t* event, void
         }
         case BLE_GATTC_EVT_HVX: {
             LOG_DEBUG(TRACE, "BLE GATT Client event: data notified.");
+            s_linkStats.onRx(event->evt.gattc_evt.conn_handle, event->evt.gattc_evt.params.hvx.len);
             ble_evt_t* dataNotifiedEvent = (ble_evt_t*)BleObject::getInstance().dispatcher()->allocEventData(sizeof(ble_evt_t) +
                     SUB1(event->evt.gattc_evt.params.hvx.len) * sizeof(uint8_t));
             if (!dataNotifiedEvent) {
@@ -4194,7 +4457,21 @@ int hal_ble_gap_get_rssi(hal_ble_conn_handle_t conn_handle, void* reserved) {
     BleLock lk;
     LOG_DEBUG(TRACE, "hal_ble_gap_get_rssi().");
     CHECK_TRUE(BleObject::getInstance().initialized(), SYSTEM_ERROR_INVALID_STATE);
-    return 0;
+    return s_linkStats.rssi(conn_handle);
+}
+
+int hal_ble_gap_get_link_stats(hal_ble_conn_handle_t conn_handle, hal_ble_link_stats_t* stats, void* reserved) {
+    BleLock lk;
+    LOG_DEBUG(TRACE, "hal_ble_gap_get_link_stats().");
+    CHECK_TRUE(BleObject::getInstance().initialized(), SYSTEM_ERROR_INVALID_STATE);
+    return s_linkStats.get(conn_handle, stats);
+}
+
+int hal_ble_gap_get_link_totals(hal_ble_link_totals_t* totals, void* reserved) {
+    BleLock lk;
+    LOG_DEBUG(TRACE, "hal_ble_gap_get_link_totals().");
+    // The statistics are kept regardless of whether BLE is initialized
+    return s_linkStats.totals(totals);
 }
 
 int hal_ble_gap_set_pairing_config(const hal_ble_pairing_config_t* config, void* reserved) {
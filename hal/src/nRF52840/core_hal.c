@@ -295,6 +295,8 @@ void HAL_Core_Config(void) {
 
     HAL_RNG_Configuration();
 
+    hal_boot_phase_complete(HAL_BOOT_PHASE_LOW_LEVEL_INIT);
+
 #if defined(MODULAR_FIRMWARE)
     if (HAL_Core_Validate_User_Module()) {
         new_heap_end = module_user_pre_init();
@@ -310,6 +312,8 @@ void HAL_Core_Config(void) {
     malloc_enable(1);
 #endif
 
+    hal_boot_phase_complete(HAL_BOOT_PHASE_USER_MODULE_VALIDATION);
+
 #ifdef DFU_BUILD_ENABLE
     Load_SystemFlags();
 #endif
@@ -327,6 +331,33 @@ void HAL_Core_Config(void) {
       FLASH_INTERNAL, EXTERNAL_FLASH_FAC_XIP_ADDRESS,
       FLASH_INTERNAL, USER_FIRMWARE_IMAGE_LOCATION, FIRMWARE_IMAGE_SIZE,
       FACTORY_RESET_MODULE_FUNCTION, MODULE_VERIFY_CRC|MODULE_VERIFY_FUNCTION|MODULE_VERIFY_DESTINATION_IS_START_ADDRESS); //true to verify the CRC during copy also
+
+    hal_boot_phase_complete(HAL_BOOT_PHASE_CORE_CONFIG);
+}
+
+// Time at which each of the boot phases has completed, in microseconds since the timer was
+// initialized in HAL_Core_Config()
+static uint32_t boot_phase_time[HAL_BOOT_PHASE_COUNT] = {};
+
+void hal_boot_phase_complete(hal_boot_phase phase) {
+    if (phase < HAL_BOOT_PHASE_COUNT && !boot_phase_time[phase]) {
+        const uint32_t t = hal_timer_micros(NULL);
+        boot_phase_time[phase] = t ? t : 1;
+    }
+}
+
+uint32_t hal_boot_phase_duration(hal_boot_phase phase) {
+    if (phase >= HAL_BOOT_PHASE_COUNT || !boot_phase_time[phase]) {
+        return 0;
+    }
+    uint32_t start = 0;
+    for (int i = (int)phase - 1; i >= 0; --i) {
+        if (boot_phase_time[i]) {
+            start = boot_phase_time[i];
+            break;
+        }
+    }
+    return boot_phase_time[phase] - start;
 }
 
 void HAL_Core_Setup(void) {
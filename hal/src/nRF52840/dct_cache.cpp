@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dct_cache.h"
+
+#include "check.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace particle {
+
+namespace {
+
+// Accesses spanning more blocks than this bypass the cache for the blocks that are not cached
+const size_t MAX_CACHED_ACCESS_BLOCKS = DctCache::BLOCK_COUNT / 2;
+
+} // unnamed
+
+const size_t DctCache::BLOCK_SIZE;
+const size_t DctCache::BLOCK_COUNT;
+
+DctCache::DctCache(DctStorage* storage, size_t size) :
+        storage_(storage),
+        size_(size),
+        useCounter_(0),
+        unsynced_(false) {
+    invalidate();
+}
+
+int DctCache::read(size_t offset, uint8_t* data, size_t size) {
+    CHECK_TRUE(offset <= size_ && size <= size_ - offset, SYSTEM_ERROR_OUT_OF_RANGE);
+    const size_t firstIndex = offset / BLOCK_SIZE;
+    const size_t lastIndex = (offset + size - 1) / BLOCK_SIZE;
+    const bool bypass = (size > 0 && lastIndex - firstIndex + 1 > MAX_CACHED_ACCESS_BLOCKS);
+    size_t pos = 0;
+    while (pos < size) {
+        const size_t index = (offset + pos) / BLOCK_SIZE;
+        const size_t blockOffs = (offset + pos) % BLOCK_SIZE;
+        size_t n = std::min(size - pos, BLOCK_SIZE - blockOffs);
+        Block* block = findBlock(index);
+        if (!block && bypass) {
+            // Access all subsequent blocks that are not cached at once
+            n = uncachedRangeSize(offset + pos, size - pos);
+            const int r = CHECK(storage_->read(offset + pos, data + pos, n));
+            CHECK_TRUE((size_t)r == n, SYSTEM_ERROR_IO);
+        } else {
+            if (!block) {
+                CHECK(loadBlock(index, &block));
+            }
+            memcpy(data + pos, block->data + blockOffs, n);
+        }
+        pos += n;
+    }
+    return size;
+}
+
+int DctCache::write(size_t offset, const uint8_t* data, size_t size) {
+    CHECK_TRUE(offset <= size_ && size <= size_ - offset, SYSTEM_ERROR_OUT_OF_RANGE);
+    const size_t firstIndex = offset / BLOCK_SIZE;
+    const size_t lastIndex = (offset + size - 1) / BLOCK_SIZE;
+    const bool bypass = (size > 0 && lastIndex - firstIndex + 1 > MAX_CACHED_ACCESS_BLOCKS);
+    size_t pos = 0;
+    while (pos < size) {
+        const size_t index = (offset + pos) / BLOCK_SIZE;
+        const size_t blockOffs = (offset + pos) % BLOCK_SIZE;
+        size_t n = std::min(size - pos, BLOCK_SIZE - blockOffs);
+        Block* block = findBlock(index);
+        if (!block && bypass) {
+            // Access all subsequent blocks that are not cached at once
+            n = uncachedRangeSize(offset + pos, size - pos);
+            unsynced_ = true;
+            const int r = CHECK(storage_->write(offset + pos, data + pos, n));
+            CHECK_TRUE((size_t)r == n, SYSTEM_ERROR_IO);
+        } else {
+            if (!block) {
+                CHECK(loadBlock(index, &block));
+            }
+            if (memcmp(block->data + blockOffs, data + pos, n) != 0) {
+                memcpy(block->data + blockOffs, data + pos, n);
+                if (block->dirtyBegin < block->dirtyEnd) {
+                    block->dirtyBegin = std::min<size_t>(block->dirtyBegin, blockOffs);
+                    block->dirtyEnd = std::max<size_t>(block->dirtyEnd, blockOffs + n);
+                } else {
+                    block->dirtyBegin = blockOffs;
+                    block->dirtyEnd = blockOffs + n;
+                }
+            }
+        }
+        pos += n;
+    }
+    return size;
+}
+
+int DctCache::flush() {
+    // Write the blocks in the order of their offsets
+    for (;;) {
+        Block* block = nullptr;
+        for (size_t i = 0; i < BLOCK_COUNT; ++i) {
+            Block* b = &blocks_[i];
+            if (b->valid && b->dirtyBegin < b->dirtyEnd && (!block || b->index < block->index)) {
+                block = b;
+            }
+        }
+        if (!block) {
+            break;
+        }
+        CHECK(writeBackBlock(block));
+    }
+    if (unsynced_) {
+        CHECK(storage_->sync());
+        unsynced_ = false;
+    }
+    return 0;
+}
+
+void DctCache::invalidate() {
+    for (size_t i = 0; i < BLOCK_COUNT; ++i) {
+        Block* b = &blocks_[i];
+        b->lastUse = 0;
+        b->index = 0;
+        b->dirtyBegin = 0;
+        b->dirtyEnd = 0;
+        b->valid = false;
+    }
+}
+
+bool DctCache::dirty() const {
+    if (unsynced_) {
+        return true;
+    }
+    for (size_t i = 0; i < BLOCK_COUNT; ++i) {
+        const Block* b = &blocks_[i];
+        if (b->valid && b->dirtyBegin < b->dirtyEnd) {
+            return true;
+        }
+    }
+    return false;
+}
+
+DctCache::Block* DctCache::findBlock(size_t index) {
+    for (size_t i = 0; i < BLOCK_COUNT; ++i) {
+        Block* b = &blocks_[i];
+        if (b->valid && b->index == index) {
+            b->lastUse = ++useCounter_;
+            return b;
+        }
+    }
+    return nullptr;
+}
+
+int DctCache::loadBlock(size_t index, Block** block) {
+    // Find a free or the least recently used block
+    Block* b = &blocks_[0];
+    for (size_t i = 0; i < BLOCK_COUNT && b->valid; ++i) {
+        if (!blocks_[i].valid || blocks_[i].lastUse < b->lastUse) {
+            b = &blocks_[i];
+        }
+    }
+    if (b->valid) {
+        CHECK(writeBackBlock(b));
+        b->valid = false;
+    }
+    const size_t size = blockSize(index);
+    const int r = CHECK(storage_->read(index * BLOCK_SIZE, b->data, size));
+    CHECK_TRUE((size_t)r == size, SYSTEM_ERROR_IO);
+    b->index = index;
+    b->dirtyBegin = 0;
+    b->dirtyEnd = 0;
+    b->lastUse = ++useCounter_;
+    b->valid = true;
+    *block = b;
+    return 0;
+}
+
+int DctCache::writeBackBlock(Block* block) {
+    if (block->dirtyBegin < block->dirtyEnd) {
+        const size_t n = block->dirtyEnd - block->dirtyBegin;
+        unsynced_ = true;
+        const int r = storage_->write(block->index * BLOCK_SIZE + block->dirtyBegin, block->data + block->dirtyBegin, n);
+        if (r < 0 || (size_t)r != n) {
+            // The storage may contain a part of the modified data. Discard the block so that it's
+            // reloaded from the storage rather than retried with each flush
+            block->valid = false;
+            return (r < 0) ? r : SYSTEM_ERROR_IO;
+        }
+        block->dirtyBegin = 0;
+        block->dirtyEnd = 0;
+    }
+    return 0;
+}
+
+size_t DctCache::uncachedRangeSize(size_t offset, size_t size) {
+    size_t n = std::min(size, BLOCK_SIZE - offset % BLOCK_SIZE);
+    while (n < size && !findBlock((offset + n) / BLOCK_SIZE)) {
+        n += std::min(size - n, BLOCK_SIZE);
+    }
+    return n;
+}
+
+size_t DctCache::blockSize(size_t index) const {
+    return std::min(BLOCK_SIZE, size_ - index * BLOCK_SIZE);
+}
+
+} // particle
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace particle {
+
+/**
+ * Backing storage of the DCT.
+ */
+class DctStorage {
+public:
+    virtual ~DctStorage() = default;
+
+    /**
+     * Reads data from the storage.
+     *
+     * @return Number of bytes read, or a negative result code in case of an error.
+     */
+    virtual int read(size_t offset, uint8_t* data, size_t size) = 0;
+    /**
+     * Writes data to the storage.
+     *
+     * @return Number of bytes written, or a negative result code in case of an error.
+     */
+    virtual int write(size_t offset, const uint8_t* data, size_t size) = 0;
+    /**
+     * Commits all written data to the storage.
+     *
+     * @return `0` on success, or a negative result code in case of an error.
+     */
+    virtual int sync() = 0;
+};
+
+/**
+ * Write-back cache for the DCT.
+ *
+ * The cache keeps a small number of DCT blocks in RAM. Reads that hit a cached block don't
+ * access the storage. Writes are applied to the cached blocks and only the modified range of
+ * each block is written to the storage when the cache is flushed, followed by a single commit.
+ * Large reads and writes that don't fit in the cache bypass it for the blocks that are not
+ * cached.
+ */
+class DctCache {
+public:
+    /**
+     * Size of a cache block.
+     */
+    static const size_t BLOCK_SIZE = 256;
+    /**
+     * Number of cache blocks.
+     */
+    static const size_t BLOCK_COUNT = 4;
+
+    /**
+     * Constructs a cache.
+     *
+     * @param storage Backing storage.
+     * @param size Size of the DCT.
+     */
+    DctCache(DctStorage* storage, size_t size);
+
+    /**
+     * Reads data from the DCT.
+     *
+     * @return Number of bytes read, or a negative result code in case of an error.
+     */
+    int read(size_t offset, uint8_t* data, size_t size);
+    /**
+     * Writes data to the DCT.
+     *
+     * The data is not written to the storage until `flush()` is called, or the modified block
+     * needs to be evicted from the cache.
+     *
+     * @return Number of bytes written, or a negative result code in case of an error.
+     */
+    int write(size_t offset, const uint8_t* data, size_t size);
+    /**
+     * Writes all modified data to the storage.
+     *
+     * @return `0` on success, or a negative result code in case of an error.
+     */
+    int flush();
+    /**
+     * Discards all cached data, including the data that has not been written to the storage.
+     */
+    void invalidate();
+    /**
+     * Returns `true` if there is data that has not been written to the storage.
+     */
+    bool dirty() const;
+
+private:
+    struct Block {
+        uint8_t data[BLOCK_SIZE];
+        unsigned lastUse;
+        uint16_t index;
+        uint16_t dirtyBegin;
+        uint16_t dirtyEnd;
+        bool valid;
+    };
+
+    Block blocks_[BLOCK_COUNT];
+    DctStorage* storage_;
+    size_t size_;
+    unsigned useCounter_;
+    bool unsynced_;
+
+    Block* findBlock(size_t index);
+    int loadBlock(size_t index, Block** block);
+    int writeBackBlock(Block* block);
+    size_t uncachedRangeSize(size_t offset, size_t size);
+    size_t blockSize(size_t index) const;
+};
+
+} // particle
@@ -16,8 +16,8 @@
  */
 
 #include "dct_hal.h"
+#include "dct_cache.h"
 #include "dcd_flash_impl.h"
-#include "scope_guard.h"
 #include "system_error.h"
 #include "service_debug.h"
 
@@ -30,7 +30,8 @@ namespace {
 
 using namespace particle::fs;
 
-class DcdFile {
+// Persistent handle of the DCT file
+class DcdFile: public particle::DctStorage {
 public:
     DcdFile() {
         init();
@@ -40,55 +41,16 @@ public:
         deinit();
     }
 
-    ssize_t read(size_t offset, uint8_t* buffer, size_t size) {
-        FsLock lk(fs_);
-        open(LFS_O_RDONLY);
-        ssize_t r = seek(offset);
-        if (r < 0) {
-            close();
-            return r;
-        }
-        r = lfs_file_read(lfs(), &file_, buffer, size);
-        close();
-        return r;
-    }
-
-    ssize_t write(size_t offset, const uint8_t* buffer, size_t size) {
-        FsLock lk(fs_);
-
-        open(LFS_O_WRONLY);
-
-        ssize_t r = seek(offset);
-        if (r < 0) {
-            close();
-            return r;
-        }
-
-        r = lfs_file_write(lfs(), &file_, buffer, size);
-        if (r < 0) {
-            /* Error */
-            LOG_DEBUG(ERROR, "Failed to write to DCD: %d", r);
-        }
-
-        close();
-
-        return r;
-    }
-
     bool clear() {
-        FsLock lk(fs_);
-        if (!open(LFS_O_WRONLY)) {
-            return false;
-        }
-        SCOPE_GUARD({
-            close();
-        });
         char buf[128];
         memset(buf, 0xff, sizeof(buf));
         const lfs_ssize_t size = lfs_file_size(lfs(), &file_);
         if (size < 0) {
             return false;
         }
+        if (seek(0) < 0) {
+            return false;
+        }
         size_t offs = 0;
         while (offs < (size_t)size) {
             const size_t n = std::min(sizeof(buf), (size_t)size - offs);
@@ -98,9 +60,32 @@ public:
             }
             offs += n;
         }
-        return true;
+        return sync() == 0;
+    }
+
+    int read(size_t offset, uint8_t* data, size_t size) override {
+        const int r = seek(offset);
+        if (r < 0) {
+            return r;
+        }
+        return lfs_file_read(lfs(), &file_, data, size);
     }
 
+    int write(size_t offset, const uint8_t* data, size_t size) override {
+        const int r = seek(offset);
+        if (r < 0) {
+            return r;
+        }
+        return lfs_file_write(lfs(), &file_, data, size);
+    }
+
+    int sync() override {
+        return lfs_file_sync(lfs(), &file_);
+    }
+
+    filesystem_t* fs() const {
+        return fs_;
+    }
 
 private:
 
@@ -144,6 +129,7 @@ private:
             flags |= LFS_O_CREAT;
         }
 
+        /* The file is kept open so that accessing the DCT doesn't require a path lookup */
         SPARK_ASSERT(open(flags));
 
         if (flags & LFS_O_CREAT) {
@@ -155,15 +141,14 @@ private:
                 SPARK_ASSERT(r > 0);
                 offset += r;
             }
+            SPARK_ASSERT(sync() == 0);
         }
-
-        SPARK_ASSERT(close());
     }
 
     void deinit() {
         FsLock lk(fs_);
 
-        lfs_file_close(lfs(), &file_);
+        close();
         filesystem_unmount(fs_);
     }
 
@@ -177,8 +162,59 @@ private:
     static constexpr const char* path_ = "/sys/dct.bin";
 };
 
-DcdFile& dcd() {
-    static DcdFile dcd;
+class Dcd {
+public:
+    Dcd() :
+            cache_(&file_, sizeof(application_dct_t)) {
+    }
+
+    ~Dcd() {
+        flush();
+    }
+
+    ssize_t read(size_t offset, uint8_t* buffer, size_t size) {
+        FsLock lk(file_.fs());
+        return cache_.read(offset, buffer, size);
+    }
+
+    ssize_t write(size_t offset, const uint8_t* buffer, size_t size) {
+        FsLock lk(file_.fs());
+        const int r = cache_.write(offset, buffer, size);
+        if (r < 0) {
+            /* Error */
+            LOG_DEBUG(ERROR, "Failed to write to DCD: %d", r);
+        }
+        return r;
+    }
+
+    int flush() {
+        FsLock lk(file_.fs());
+        if (!cache_.dirty()) {
+            return 0;
+        }
+        const int r = cache_.flush();
+        if (r < 0) {
+            LOG_DEBUG(ERROR, "Failed to flush DCD: %d", r);
+        }
+        return r;
+    }
+
+    bool clear() {
+        FsLock lk(file_.fs());
+        cache_.invalidate();
+        return file_.clear();
+    }
+
+private:
+    DcdFile file_;
+    particle::DctCache cache_;
+};
+
+bool g_dcdCreated = false;
+
+Dcd& dcd() {
+    static Dcd dcd;
+    g_dcdCreated = true;
     return dcd;
 }
 
@@ -210,8 +246,19 @@ int dct_read_app_data_unlock(uint32_t offset) {
 int dct_write_app_data(const void* data, uint32_t offset, uint32_t size) {
     dct_lock(1);
     const int result = dcd().write(offset, (const uint8_t*)data, size);
-    dct_unlock(1);
-    return result > 0 ? 0 : result;
+    // The data is written to the storage when the outermost lock is released
+    const int flushResult = dct_unlock(1);
+    if (result < 0) {
+        return result;
+    }
+    return flushResult;
+}
+
+int dct_flush(void* reserved) {
+    if (!g_dcdCreated) {
+        return 0;
+    }
+    return dcd().flush();
 }
 
 int dct_clear() {
@@ -39,6 +39,15 @@ int dct_unlock(int write);
 
 int dct_clear();
 
+/**
+ * Writes the cached DCT changes to the storage.
+ *
+ * The changes are written automatically when the outermost DCT lock is released, in which case
+ * `dct_unlock()` returns the result of the flush. This function should only be called while the
+ * DCT is locked.
+ */
+int dct_flush(void* reserved);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
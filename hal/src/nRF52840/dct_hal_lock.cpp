@@ -29,6 +29,7 @@ int dctLockCounter = 0;
 #endif
 
 StaticRecursiveMutex dctLock;
+int dctLockDepth = 0;
 
 } // namespace
 
@@ -36,6 +37,7 @@ int dct_lock(int write) {
     SPARK_ASSERT(!HAL_IsISR());
     const bool ok = dctLock.lock(DCT_LOCK_TIMEOUT);
     SPARK_ASSERT(ok);
+    ++dctLockDepth;
 #ifdef DEBUG_BUILD
     ++dctLockCounter;
     SPARK_ASSERT(dctLockCounter == 1 || !write);
@@ -45,11 +47,19 @@ int dct_lock(int write) {
 
 int dct_unlock(int write) {
     SPARK_ASSERT(!HAL_IsISR());
+    int result = 0;
+    if (--dctLockDepth == 0) {
+        // Write the changes made while the DCT was locked
+        result = dct_flush(nullptr);
+    }
     const bool ok = dctLock.unlock();
     SPARK_ASSERT(ok);
 #ifdef DEBUG_BUILD
     --dctLockCounter;
     SPARK_ASSERT(dctLockCounter == 0 || !write);
 #endif
-    return !ok;
+    if (!ok) {
+        return 1;
+    }
+    return result;
 }
@@ -34,6 +34,7 @@
 #include "concurrent_hal.h"
 #include "gpio_hal.h"
 #include "system_error.h"
+#include "exflash_read_cache.h"
 
 enum qspi_cmds_t {
     QSPI_STD_CMD_WRSR     = 0x01,
@@ -52,6 +53,11 @@ static const size_t MX25_OTP_SECTOR_SIZE = 4096 / 8; /* 4Kb or 512B */
 
 static hal_exflash_state_t qspi_state = HAL_EXFLASH_STATE_DISABLED;
 
+/* Cached flash line for small reads. Invalidated whenever the contents of the flash
+ * may change or become inaccessible
+ */
+static exflash_read_cache read_cache;
+
 // Mitigations for nRF52840 anomaly 215
 // [215] QSPI: Reading QSPI registers after XIP might halt CPU
 // Conditions
@@ -146,6 +152,10 @@ static int perform_write(uintptr_t addr, const uint8_t* data, size_t size) {
     return nrfx_qspi_write(data, size, addr);
 }
 
+static int perform_read(uintptr_t addr, uint8_t* data, size_t size) {
+    return nrfx_qspi_read(data, size, addr);
+}
+
 static int enter_secure_otp() {
     return exflash_qspi_cinstr_quick_send(QSPI_MX25_CMD_ENSO, 1, NULL);
 }
@@ -164,6 +174,8 @@ int hal_exflash_init(void) {
 
     hal_exflash_lock();
 
+    exflash_read_cache_init(&read_cache);
+
     nrfx_qspi_config_t config = {
         .xip_offset  = NRFX_QSPI_CONFIG_XIP_OFFSET,
         .pins = {
@@ -227,6 +239,7 @@ hal_exflash_init_done:
 int hal_exflash_uninit(void) {
     hal_exflash_lock();
 
+    exflash_read_cache_invalidate(&read_cache);
     nrfx_qspi_uninit();
     // PATCH: Initialize CS pin, external memory discharge
     nrf_gpio_cfg_output(QSPI_FLASH_CSN_PIN);
@@ -244,6 +257,7 @@ int hal_exflash_uninit(void) {
 
 int hal_exflash_write(uintptr_t addr, const uint8_t* data_buf, size_t data_size) {
     hal_exflash_lock();
+    exflash_read_cache_invalidate(&read_cache);
     int ret = hal_flash_common_write(addr, data_buf, data_size,
                                      &perform_write, &hal_flash_common_dummy_read);
     exflash_qspi_wait_completion();
@@ -252,72 +266,15 @@ int hal_exflash_write(uintptr_t addr, const uint8_t* data_buf, size_t data_size)
 }
 
 int hal_exflash_read(uintptr_t addr, uint8_t* data_buf, size_t data_size) {
-    int ret = 0;
     hal_exflash_lock();
-    {
-        const uintptr_t src_aligned = ADDR_ALIGN_WORD(addr);
-        uint8_t* dst_aligned = (uint8_t*)ADDR_ALIGN_WORD_RIGHT((uintptr_t)data_buf);
-        const size_t unaligned_bytes = MIN(data_size, (size_t)(dst_aligned - data_buf));
-        const size_t size_aligned = ADDR_ALIGN_WORD(data_size - unaligned_bytes);
-
-        if (size_aligned > 0) {
-            /* Read-out the aligned portion into an aligned address in the buffer
-             * with an adjusted size in multiples of 4.
-             */
-            ret = nrfx_qspi_read(dst_aligned, size_aligned, src_aligned);
-
-            if (ret != NRF_SUCCESS) {
-                goto hal_exflash_read_done;
-            }
-
-            /* Move the data if necessary */
-            if (dst_aligned != data_buf || src_aligned != addr) {
-                const unsigned offset_front = addr - src_aligned;
-                const size_t bytes_read = size_aligned - offset_front;
-
-                memmove(data_buf, dst_aligned + offset_front, bytes_read);
-
-                /* Adjust addresses and size */
-                addr += bytes_read;
-                data_buf += bytes_read;
-                data_size -= bytes_read;
-            } else {
-                /* Adjust addresses and size */
-                addr += size_aligned;
-                data_buf += size_aligned;
-                data_size -= size_aligned;
-            }
-        }
-    }
-
-    /* Read the remaining unaligned portion into a temporary buffer and copy into
-     * the destination buffer
-     */
-    if (data_size > 0) {
-        uint8_t tmpbuf[sizeof(uint32_t) * 2] __attribute__((aligned(4)));
-
-        /* Read the remainder */
-        const uintptr_t src_aligned = ADDR_ALIGN_WORD(addr);
-        const size_t size_aligned = ADDR_ALIGN_WORD_RIGHT((addr + data_size) - src_aligned);
-
-        ret = nrfx_qspi_read(tmpbuf, size_aligned, src_aligned);
-
-        if (ret != NRF_SUCCESS) {
-            goto hal_exflash_read_done;
-        }
-
-        const unsigned offset_front = addr - src_aligned;
-
-        memcpy(data_buf, tmpbuf + offset_front, data_size);
-    }
-
-hal_exflash_read_done:
+    const int ret = exflash_read_cache_read(&read_cache, addr, data_buf, data_size, &perform_read);
     hal_exflash_unlock();
     return ret;
 }
 
 static int erase_common(uintptr_t start_addr, size_t num_blocks, nrf_qspi_erase_len_t len) {
     hal_exflash_lock();
+    exflash_read_cache_invalidate(&read_cache);
     int err_code = NRF_SUCCESS;
 
     const size_t block_length = len == QSPI_ERASE_LEN_LEN_4KB ? 4096 : 64 * 1024;
@@ -409,7 +366,10 @@ int hal_exflash_read_special(hal_exflash_special_sector_t sp, uintptr_t addr, ui
         goto hal_exflash_read_special_done;
     }
 
-    ret = hal_exflash_read(addr, data_buf, data_size);
+    /* The OTP sector is mapped at the same addresses as the main array, so the data
+     * must not go through the read cache
+     */
+    ret = exflash_read_cache_read(NULL, addr, data_buf, data_size, &perform_read);
 
 hal_exflash_read_special_done:
     /* Exit Secure OTP mode */
@@ -455,6 +415,7 @@ int hal_exflash_special_command(hal_exflash_special_sector_t sp, hal_exflash_com
     int ret = -1;
 
     hal_exflash_lock();
+    exflash_read_cache_invalidate(&read_cache);
     /* General commands */
     if (sp == HAL_EXFLASH_SPECIAL_SECTOR_NONE) {
         nrf_qspi_cinstr_conf_t cinstr_cfg = {
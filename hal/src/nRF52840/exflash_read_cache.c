@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "exflash_read_cache.h"
+#include "flash_common.h"
+#include <string.h>
+
+#define LINE_ADDR_MASK ((uintptr_t)EXFLASH_READ_CACHE_LINE_SIZE - 1)
+
+static size_t min_size(size_t a, size_t b) {
+    return (a < b) ? a : b;
+}
+
+/* Reads the data directly into the destination buffer */
+static int read_direct(uintptr_t addr, uint8_t* data, size_t size, size_t* bytes_read,
+                       exflash_read_cache_read_cb read) {
+    const uintptr_t src_aligned = ADDR_ALIGN_WORD(addr);
+    const unsigned offset_front = addr - src_aligned;
+    uint8_t* dst_aligned = (uint8_t*)ADDR_ALIGN_WORD_RIGHT((uintptr_t)data);
+    const size_t unaligned_bytes = min_size(size, dst_aligned - data);
+    const size_t size_aligned = ADDR_ALIGN_WORD(size - unaligned_bytes);
+    if (size_aligned > offset_front) {
+        /* Read-out the aligned portion into an aligned address in the buffer
+         * with an adjusted size in multiples of 4.
+         */
+        const int ret = read(src_aligned, dst_aligned, size_aligned);
+        if (ret) {
+            return ret;
+        }
+        /* Move the data if necessary */
+        *bytes_read = size_aligned - offset_front;
+        if (dst_aligned + offset_front != data) {
+            memmove(data, dst_aligned + offset_front, *bytes_read);
+        }
+        return 0;
+    }
+    /* Read a few remaining bytes into a temporary buffer and copy into the destination buffer */
+    uint8_t tmpbuf[sizeof(uint32_t) * 2] __attribute__((aligned(4)));
+    *bytes_read = min_size(size, sizeof(uint32_t));
+    const int ret = read(src_aligned, tmpbuf, ADDR_ALIGN_WORD_RIGHT(addr + *bytes_read) - src_aligned);
+    if (ret) {
+        return ret;
+    }
+    memcpy(data, tmpbuf + offset_front, *bytes_read);
+    return 0;
+}
+
+void exflash_read_cache_init(exflash_read_cache* cache) {
+    cache->addr = 0;
+    cache->valid = false;
+}
+
+void exflash_read_cache_invalidate(exflash_read_cache* cache) {
+    cache->valid = false;
+}
+
+int exflash_read_cache_read(exflash_read_cache* cache, uintptr_t addr, uint8_t* data, size_t size,
+                            exflash_read_cache_read_cb read) {
+    /* Larger reads are not worth caching, except for the unaligned bytes at the boundaries
+     * of the read that happen to be in the cache already
+     */
+    const bool fill_cache = (cache && size < EXFLASH_READ_CACHE_LINE_SIZE);
+    while (size > 0) {
+        size_t n = 0;
+        if (cache && cache->valid && addr - cache->addr < EXFLASH_READ_CACHE_LINE_SIZE) {
+            const size_t offs = addr - cache->addr;
+            n = min_size(size, EXFLASH_READ_CACHE_LINE_SIZE - offs);
+            memcpy(data, cache->data + offs, n);
+        } else if (fill_cache) {
+            const uintptr_t line_addr = addr & ~LINE_ADDR_MASK;
+            cache->valid = false;
+            const int ret = read(line_addr, cache->data, EXFLASH_READ_CACHE_LINE_SIZE);
+            if (ret) {
+                return ret;
+            }
+            cache->addr = line_addr;
+            cache->valid = true;
+            continue;
+        } else {
+            const int ret = read_direct(addr, data, size, &n, read);
+            if (ret) {
+                return ret;
+            }
+        }
+        addr += n;
+        data += n;
+        size -= n;
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HAL_NRF52840_EXFLASH_READ_CACHE_H
+#define HAL_NRF52840_EXFLASH_READ_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Size of the cache line. Must be a power of 2 */
+#define EXFLASH_READ_CACHE_LINE_SIZE 256
+
+/* Reads data from the flash. The address, buffer and size are always word-aligned */
+typedef int (*exflash_read_cache_read_cb)(uintptr_t addr, uint8_t* data, size_t size);
+
+typedef struct exflash_read_cache {
+    uint8_t data[EXFLASH_READ_CACHE_LINE_SIZE] __attribute__((aligned(4)));
+    uintptr_t addr;
+    bool valid;
+} exflash_read_cache;
+
+void exflash_read_cache_init(exflash_read_cache* cache);
+void exflash_read_cache_invalidate(exflash_read_cache* cache);
+
+/* Reads data at an arbitrary address into a buffer of arbitrary alignment and size.
+ *
+ * The word-aligned middle part of a read is transferred directly into the destination buffer.
+ * Small reads and the unaligned head and tail are served from a single cache line, which is
+ * filled with one transaction if necessary, so that sequential small reads don't access the
+ * flash again. If `cache` is NULL, the unaligned parts are read using a temporary buffer.
+ */
+int exflash_read_cache_read(exflash_read_cache* cache, uintptr_t addr, uint8_t* data, size_t size,
+                            exflash_read_cache_read_cb read);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* HAL_NRF52840_EXFLASH_READ_CACHE_H */
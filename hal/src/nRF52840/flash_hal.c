@@ -104,6 +104,8 @@ int hal_flash_write(uintptr_t addr, const uint8_t* data_buf, size_t data_size)
 {
     __flash_acquire();
 
+    FLASH_InvalidateVerifiedCRC32(addr, data_size);
+
     int ret = hal_flash_common_write(addr, data_buf, data_size,
                                      &fstorage_perform_write, &hal_flash_common_dummy_read);
 
@@ -128,6 +130,7 @@ int hal_flash_erase_sector(uintptr_t addr, size_t num_sectors)
     }
 
     addr = (addr / INTERNAL_FLASH_PAGE_SIZE) * INTERNAL_FLASH_PAGE_SIZE; // Address must be aligned to a page boundary.
+    FLASH_InvalidateVerifiedCRC32(addr, num_sectors * INTERNAL_FLASH_PAGE_SIZE);
     fs_op_state = FS_OP_STATE_BUSY; //should before calling nrf_fstorage_erase
     ret_code = nrf_fstorage_erase(&m_fs, addr, num_sectors, (fs_op_state_t *)&fs_op_state);
     if (ret_code != NRF_SUCCESS) {
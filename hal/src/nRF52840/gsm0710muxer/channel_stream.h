@@ -38,6 +38,8 @@ const auto MUXER_CHANNEL_RESUME_THRESHOLD = 2; // 1/2
 template <typename MuxerT>
 class MuxerChannelStream : virtual public Stream {
 public:
+    typedef void (*DataCallback)(void* ctx);
+
     MuxerChannelStream(MuxerT* muxer, uint8_t channel);
     virtual ~MuxerChannelStream();
 
@@ -59,6 +61,9 @@ public:
     void enabled(bool enabled);
     bool enabled() const;
 
+    // Sets a callback invoked from the muxer thread whenever new data is received
+    void dataCallback(DataCallback callback, void* ctx);
+
 private:
     void suspend();
     void resume();
@@ -72,6 +77,8 @@ private:
     os_semaphore_t sem_ = nullptr;
     volatile bool flow_ = false;
     volatile bool enabled_ = true;
+    DataCallback dataCallback_ = nullptr;
+    void* dataCallbackCtx_ = nullptr;
     RecursiveMutex mutex_;
 };
 
@@ -124,6 +131,10 @@ inline int MuxerChannelStream<MuxerT>::channelDataCb(const uint8_t* data, size_t
     }
     self->suspend();
     os_semaphore_give(self->sem_, false);
+    const auto callback = self->dataCallback_;
+    if (callback) {
+        callback(self->dataCallbackCtx_);
+    }
     return 0;
 }
 
@@ -288,6 +299,13 @@ inline bool MuxerChannelStream<MuxerT>::enabled() const {
     return enabled_;
 }
 
+template <typename MuxerT>
+inline void MuxerChannelStream<MuxerT>::dataCallback(DataCallback callback, void* ctx) {
+    std::lock_guard<RecursiveMutex> lock(mutex_);
+    dataCallbackCtx_ = ctx;
+    dataCallback_ = callback;
+}
+
 } // particle
 
 #endif // GSM0710_MUXER_CHANNEL_STREAM_H
@@ -70,6 +70,10 @@
 
 #define HAL_PLATFORM_SPI_HAL_THREAD_SAFETY (1)
 
+#define HAL_PLATFORM_SPI_TRANSACTION_QUEUE (1)
+
+#define HAL_PLATFORM_I2C_TRANSACTION_QUEUE (1)
+
 #define HAL_PLATFORM_FILESYSTEM (1)
 
 #define HAL_PLATFORM_CORE_ENTER_PANIC_MODE (1)
@@ -105,3 +109,5 @@
 #define HAL_PLATFORM_RESUMABLE_OTA (1)
 
 #define HAL_PLATFORM_ERROR_MESSAGES (1)
+
+#define HAL_PLATFORM_BOOT_TIMING (1)
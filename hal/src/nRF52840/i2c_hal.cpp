@@ -32,6 +32,7 @@
 #include "timer_hal.h"
 #include <memory>
 #include "check.h"
+#include "i2c_transaction_queue.h"
 
 #if PLATFORM_ID == PLATFORM_TRACKER
 #include "usart_hal.h"
@@ -39,20 +40,6 @@
 
 #define I2C_IRQ_PRIORITY            APP_IRQ_PRIORITY_LOWEST
 
-#define WAIT_TIMED(timeout_ms, what) ({ \
-    system_tick_t _micros = HAL_Timer_Get_Micro_Seconds();                      \
-    bool res = true;                                                            \
-    while ((what)) {                                                            \
-        system_tick_t dt = (HAL_Timer_Get_Micro_Seconds() - _micros);           \
-        bool nok = (((timeout_ms * 1000) < dt) && (what));                      \
-        if (nok) {                                                              \
-            res = false;                                                        \
-            break;                                                              \
-        }                                                                       \
-    }                                                                           \
-    res;                                                                        \
-})
-
 class I2cLock {
 public:
     I2cLock() = delete;
@@ -76,12 +63,25 @@ static nrfx_twim_t m_twim1 = NRFX_TWIM_INSTANCE(1);
 static nrfx_twis_t m_twis0 = NRFX_TWIS_INSTANCE(0);
 static nrfx_twis_t m_twis1 = NRFX_TWIS_INSTANCE(1);
 
-typedef enum transfer_state_t {
-    TRANSFER_STATE_IDLE,
-    TRANSFER_STATE_BUSY,
-    TRANSFER_STATE_ERROR_ADDRESS,
-    TRANSFER_STATE_ERROR_DATA
-} transfer_state_t;
+class TwimBus: public particle::I2cBus {
+public:
+    constexpr TwimBus() :
+            i2c_(HAL_I2C_INTERFACE1) {
+    }
+
+    void init(hal_i2c_interface_t i2c) {
+        i2c_ = i2c;
+    }
+
+    int startTransfer(const hal_i2c_transaction_t* trans) override;
+    void abortTransfer() override;
+    void recoverBus() override;
+    void startTimer(system_tick_t timeout) override;
+    system_tick_t millis() override;
+
+private:
+    hal_i2c_interface_t i2c_;
+};
 
 typedef struct nrf5x_i2c_info_t {
     nrfx_twim_t                 *master;
@@ -91,7 +91,6 @@ typedef struct nrf5x_i2c_info_t {
     uint8_t                     sda_pin;
 
     volatile hal_i2c_state_t    state;
-    volatile transfer_state_t   transfer_state;
     hal_i2c_mode_t              mode;
     uint32_t                    speed;
 
@@ -112,6 +111,10 @@ typedef struct nrf5x_i2c_info_t {
     void (*callback_on_receive)(int);
 
     hal_i2c_transmission_config_t transfer_config;
+
+    TwimBus                     bus;
+    particle::I2cTransactionQueue queue;
+    os_timer_t                  timer;
 } nrf5x_i2c_info_t;
 
 static void twis0Handler(nrfx_twis_evt_t const * p_event);
@@ -193,26 +196,154 @@ static void twis1Handler(nrfx_twis_evt_t const * p_event) {
 
 static void twimHandler(nrfx_twim_evt_t const * p_event, void * p_context) {
     uint32_t interface = (uint32_t)p_context;
+    int result = SYSTEM_ERROR_NONE;
     switch (p_event->type) {
         case NRFX_TWIM_EVT_DONE: {
             // LOG_DEBUG(TRACE, "NRFX_TWIM_EVT_DONE");
-            i2cMap[interface].transfer_state = TRANSFER_STATE_IDLE;
             break;
         }
         case NRFX_TWIM_EVT_ADDRESS_NACK: {
             LOG_DEBUG(TRACE, "NRFX_TWIM_EVT_ADDRESS_NACK");
-            i2cMap[interface].transfer_state = TRANSFER_STATE_ERROR_ADDRESS;
+            result = SYSTEM_ERROR_IO;
             break;
         }
         case NRFX_TWIM_EVT_DATA_NACK: {
             LOG_DEBUG(TRACE, "NRFX_TWIM_EVT_DATA_NACK");
-            i2cMap[interface].transfer_state = TRANSFER_STATE_ERROR_DATA;
+            result = SYSTEM_ERROR_IO;
             break;
         }
         default: {
-            break;
+            return;
         }
     }
+    i2cMap[interface].queue.transferDone(result);
+}
+
+static void twimTimerCallback(os_timer_t timer) {
+    void* id = nullptr;
+    os_timer_get_id(timer, &id);
+    const auto i2c = (hal_i2c_interface_t)(uintptr_t)id;
+    const system_tick_t timeout = i2cMap[i2c].queue.checkTimeout();
+    if (timeout) {
+        // The timer was started for a transaction that has already completed
+        i2cMap[i2c].bus.startTimer(timeout);
+    }
+}
+
+// Generates 9 pulses on SCL to make a slave that is stuck in the middle of a byte release SDA
+static void clockOutBus(hal_i2c_interface_t i2c) {
+    HAL_Pin_Mode(i2cMap[i2c].sda_pin, INPUT_PULLUP); //Turn SCA into high impedance input
+    HAL_Pin_Mode(i2cMap[i2c].scl_pin, OUTPUT);       //Turn SCL into a normal GPO
+    HAL_GPIO_Write(i2cMap[i2c].scl_pin, 1);     // Start idle HIGH
+
+    //Generate 9 pulses on SCL to tell slave to release the bus
+    for (int i = 0; i < 9; i++) {
+        HAL_GPIO_Write(i2cMap[i2c].scl_pin, 0);
+        HAL_Delay_Microseconds(100);
+        HAL_GPIO_Write(i2cMap[i2c].scl_pin, 1);
+        HAL_Delay_Microseconds(100);
+    }
+
+    //Change SCL to be an input
+    HAL_Pin_Mode(i2cMap[i2c].scl_pin, INPUT_PULLUP);
+}
+
+static int twimInit(hal_i2c_interface_t i2c) {
+    nrf_twim_frequency_t nrfFrequency = (i2cMap[i2c].speed == CLOCK_SPEED_400KHZ) ? NRF_TWIM_FREQ_400K : NRF_TWIM_FREQ_100K;
+    Hal_Pin_Info* PIN_MAP = HAL_Pin_Map();
+    const nrfx_twim_config_t twi_config = {
+    .scl                = (uint32_t)NRF_GPIO_PIN_MAP(PIN_MAP[i2cMap[i2c].scl_pin].gpio_port, PIN_MAP[i2cMap[i2c].scl_pin].gpio_pin),
+    .sda                = (uint32_t)NRF_GPIO_PIN_MAP(PIN_MAP[i2cMap[i2c].sda_pin].gpio_port, PIN_MAP[i2cMap[i2c].sda_pin].gpio_pin),
+    .frequency          = nrfFrequency,
+    .interrupt_priority = I2C_IRQ_PRIORITY,
+    .hold_bus_uninit    = false
+    };
+
+    void *p_context = (void *)i2c;
+    ret_code_t ret = nrfx_twim_init(i2cMap[i2c].master, &twi_config, twimHandler, p_context);
+    SPARK_ASSERT(ret == NRF_SUCCESS);
+
+    nrfx_twim_enable(i2cMap[i2c].master);
+    return SYSTEM_ERROR_NONE;
+}
+
+int TwimBus::startTransfer(const hal_i2c_transaction_t* trans) {
+    const auto& info = i2cMap[i2c_];
+    CHECK_TRUE(info.state == HAL_I2C_STATE_ENABLED && info.mode == I2C_MODE_MASTER, SYSTEM_ERROR_INVALID_STATE);
+    // Maximum size of an EasyDMA transfer
+    CHECK_TRUE(trans->tx_length <= 0xffff && trans->rx_length <= 0xffff, SYSTEM_ERROR_TOO_LARGE);
+    nrfx_twim_xfer_desc_t desc = {};
+    uint32_t flags = 0;
+    if (trans->tx_length && trans->rx_length) {
+        // The peripheral generates a repeated start condition between the write and read parts
+        desc = NRFX_TWIM_XFER_DESC_TXRX(trans->address, (uint8_t*)trans->tx_buffer, trans->tx_length,
+                trans->rx_buffer, trans->rx_length);
+    } else if (trans->rx_length) {
+        desc = NRFX_TWIM_XFER_DESC_RX(trans->address, trans->rx_buffer, trans->rx_length);
+    } else {
+        desc = NRFX_TWIM_XFER_DESC_TX(trans->address, (uint8_t*)trans->tx_buffer, trans->tx_length);
+        if (!(trans->flags & HAL_I2C_TRANSMISSION_FLAG_STOP)) {
+            flags = NRFX_TWIM_FLAG_TX_NO_STOP;
+        }
+    }
+    const auto ret = nrfx_twim_xfer(info.master, &desc, flags);
+    switch (ret) {
+        case NRFX_SUCCESS:
+            return SYSTEM_ERROR_NONE;
+        case NRFX_ERROR_BUSY:
+            return SYSTEM_ERROR_BUSY;
+        case NRFX_ERROR_INVALID_ADDR:
+            // The data to be written is not located in RAM
+            return SYSTEM_ERROR_INVALID_ARGUMENT;
+        default:
+            return SYSTEM_ERROR_IO;
+    }
+}
+
+void TwimBus::abortTransfer() {
+    // The driver doesn't provide a way to abort a transfer, so the peripheral is reinitialized
+    const auto twim = i2cMap[i2c_].master;
+    nrfx_twim_uninit(twim);
+    nrf_twim_event_clear(twim->p_twim, NRF_TWIM_EVENT_STOPPED);
+    nrf_twim_event_clear(twim->p_twim, NRF_TWIM_EVENT_ERROR);
+    NVIC_ClearPendingIRQ(nrfx_get_irq_number(twim->p_twim));
+    twimInit(i2c_);
+}
+
+void TwimBus::recoverBus() {
+    const auto& info = i2cMap[i2c_];
+    if (info.state != HAL_I2C_STATE_ENABLED || info.mode != I2C_MODE_MASTER) {
+        return;
+    }
+    nrfx_twim_uninit(info.master);
+    clockOutBus(i2c_);
+    HAL_Set_Pin_Function(info.scl_pin, PF_I2C);
+    HAL_Set_Pin_Function(info.sda_pin, PF_I2C);
+    twimInit(i2c_);
+}
+
+void TwimBus::startTimer(system_tick_t timeout) {
+    os_timer_change(i2cMap[i2c_].timer, OS_TIMER_CHANGE_PERIOD, HAL_IsISR(), timeout, 0, nullptr);
+}
+
+system_tick_t TwimBus::millis() {
+    return HAL_Timer_Get_Milli_Seconds();
+}
+
+// Performs a transaction via the queue and waits for its completion. A write without a stop
+// condition holds the queue until the next synchronous transaction, which is performed ahead of
+// the transactions queued by other callers
+static int twimTransfer(hal_i2c_interface_t i2c, hal_i2c_transaction_t* trans) {
+    volatile int result = 1; // Pending
+    trans->callback = [](int error, void* ctx) {
+        *(volatile int*)ctx = error;
+    };
+    trans->context = (void*)&result;
+    CHECK(i2cMap[i2c].queue.push(trans, true /* exclusive */));
+    while (result > 0) {
+        i2cMap[i2c].queue.checkTimeout();
+    }
+    return result;
 }
 
 static int twiUninit(hal_i2c_interface_t i2c) {
@@ -221,6 +352,9 @@ static int twiUninit(hal_i2c_interface_t i2c) {
     }
 
     if (i2cMap[i2c].mode == I2C_MODE_MASTER) {
+        // Prevent new transactions from being started by the callbacks of the cancelled ones
+        i2cMap[i2c].state = HAL_I2C_STATE_DISABLED;
+        i2cMap[i2c].queue.cancel();
         nrfx_twim_uninit(i2cMap[i2c].master);
     } else {
         nrfx_twis_uninit(i2cMap[i2c].slave);
@@ -237,24 +371,10 @@ static int twiUninit(hal_i2c_interface_t i2c) {
 
 static int twiInit(hal_i2c_interface_t i2c) {
     ret_code_t ret;
-    nrf_twim_frequency_t nrfFrequency = (i2cMap[i2c].speed == CLOCK_SPEED_400KHZ) ? NRF_TWIM_FREQ_400K : NRF_TWIM_FREQ_100K;
-
     Hal_Pin_Info* PIN_MAP = HAL_Pin_Map();
 
     if (i2cMap[i2c].mode == I2C_MODE_MASTER) {
-        const nrfx_twim_config_t twi_config = {
-        .scl                = (uint32_t)NRF_GPIO_PIN_MAP(PIN_MAP[i2cMap[i2c].scl_pin].gpio_port, PIN_MAP[i2cMap[i2c].scl_pin].gpio_pin),
-        .sda                = (uint32_t)NRF_GPIO_PIN_MAP(PIN_MAP[i2cMap[i2c].sda_pin].gpio_port, PIN_MAP[i2cMap[i2c].sda_pin].gpio_pin),
-        .frequency          = nrfFrequency,
-        .interrupt_priority = I2C_IRQ_PRIORITY,
-        .hold_bus_uninit    = false
-        };
-
-        void *p_context = (void *)i2c;
-        ret = nrfx_twim_init(i2cMap[i2c].master, &twi_config, twimHandler, p_context);
-        SPARK_ASSERT(ret == NRF_SUCCESS);
-
-        nrfx_twim_enable(i2cMap[i2c].master);
+        twimInit(i2c);
     } else {
         const nrfx_twis_config_t twi_config = {
         .addr               = {i2cMap[i2c].address, 0},
@@ -305,6 +425,13 @@ int hal_i2c_init(hal_i2c_interface_t i2c, const hal_i2c_config_t* config) {
     I2cLock lk(i2c);
     os_thread_scheduling(true, nullptr);
 
+    i2cMap[i2c].bus.init(i2c);
+    i2cMap[i2c].queue.init(&i2cMap[i2c].bus);
+    if (os_timer_create(&i2cMap[i2c].timer, HAL_I2C_DEFAULT_TIMEOUT_MS, twimTimerCallback, (void*)i2c, true /* one_shot */, nullptr)) {
+        i2cMap[i2c].timer = nullptr;
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+
     // Initialize internal data structure
     if (isConfigValid(config)) {
         i2cMap[i2c].rx_buf = config->rx_buffer;
@@ -327,7 +454,6 @@ int hal_i2c_init(hal_i2c_interface_t i2c, const hal_i2c_config_t* config) {
     // Initialize I2C state
     i2cMap[i2c].state = HAL_I2C_STATE_DISABLED;
     i2cMap[i2c].mode = I2C_MODE_MASTER;
-    i2cMap[i2c].transfer_state = TRANSFER_STATE_IDLE;
     i2cMap[i2c].speed = CLOCK_SPEED_100KHZ;
     i2cMap[i2c].rx_index_head = 0;
     i2cMap[i2c].rx_index_tail = 0;
@@ -416,6 +542,15 @@ void hal_i2c_end(hal_i2c_interface_t i2c,void* reserved) {
     }
 }
 
+// The bus is not reset after a NACK or a timeout, as that would cancel the transactions queued by
+// other callers. The peripheral is idle after a NACK, and the queue has already recovered the bus
+// if the transfer timed out
+static void resetAfterError(hal_i2c_interface_t i2c, int error) {
+    if (error != SYSTEM_ERROR_IO && error != SYSTEM_ERROR_TIMEOUT) {
+        hal_i2c_reset(i2c, 0, nullptr);
+    }
+}
+
 uint32_t hal_i2c_request(hal_i2c_interface_t i2c, uint8_t address, uint8_t quantity, uint8_t stop, void* reserved) {
     hal_i2c_transmission_config_t conf = {
         .size = sizeof(hal_i2c_transmission_config_t),
@@ -435,46 +570,31 @@ int32_t hal_i2c_request_ex(hal_i2c_interface_t i2c, const hal_i2c_transmission_c
     }
 
     I2cLock lk(i2c);
-    uint32_t ret;
     size_t quantity = 0;
 
-    if (!config) {
-        goto ret;
-    }
-
-    quantity = config->quantity;
-
-    // clamp to buffer length
-    if (quantity > i2cMap[i2c].rx_buf_size) {
-        quantity = i2cMap[i2c].rx_buf_size;
-    }
-
-    i2cMap[i2c].transfer_state = TRANSFER_STATE_BUSY;
-    ret = nrfx_twim_rx(i2cMap[i2c].master, config->address, (uint8_t *)i2cMap[i2c].rx_buf, quantity);
-    if (ret) {
-        // FIXME: There is a bug in nrfx_twim driver, if we call nrfx_twim_rx repeatedly and quickly,
-        // p_cb->busy will be set and never cleared, in this case nrfx_twim_rx always returns busy error
-        LOG_DEBUG(TRACE, "BUSY ERROR, restore twi.");
-        hal_i2c_reset(i2c, 0, nullptr);
-        quantity = 0;
-        goto ret;
-    }
+    if (config) {
+        quantity = config->quantity;
 
-    if (!WAIT_TIMED(config->timeout_ms, i2cMap[i2c].transfer_state == TRANSFER_STATE_BUSY)) {
-        hal_i2c_reset(i2c, 0, nullptr);
-        quantity = 0;
-        goto ret;
-    }
+        // clamp to buffer length
+        if (quantity > i2cMap[i2c].rx_buf_size) {
+            quantity = i2cMap[i2c].rx_buf_size;
+        }
 
-    if (i2cMap[i2c].transfer_state != TRANSFER_STATE_IDLE) {
-        // Get into error state
-        hal_i2c_reset(i2c, 0, nullptr);
-        quantity = 0;
-        goto ret;
+        hal_i2c_transaction_t trans = {};
+        trans.size = sizeof(trans);
+        trans.address = config->address;
+        trans.rx_buffer = i2cMap[i2c].rx_buf;
+        trans.rx_length = quantity;
+        trans.timeout_ms = config->timeout_ms;
+        trans.flags = config->flags;
+        const int r = twimTransfer(i2c, &trans);
+        if (r < 0) {
+            LOG_DEBUG(TRACE, "Transfer failed: %d", r);
+            resetAfterError(i2c, r);
+            quantity = 0;
+        }
     }
 
-ret:
-    i2cMap[i2c].transfer_state = TRANSFER_STATE_IDLE;
     i2cMap[i2c].rx_index_head = 0;
     i2cMap[i2c].rx_index_tail = quantity;
     return quantity;
@@ -502,36 +622,31 @@ uint8_t hal_i2c_end_transmission(hal_i2c_interface_t i2c, uint8_t stop, void* re
 
     I2cLock lk(i2c);
 
-    uint32_t ret;
     uint8_t ret_code = 0;
 
     if (i2cMap[i2c].transfer_config.address != 0xff) {
         stop = i2cMap[i2c].transfer_config.flags & HAL_I2C_TRANSMISSION_FLAG_STOP;
     }
 
-    i2cMap[i2c].transfer_state = TRANSFER_STATE_BUSY;
-    ret = nrfx_twim_tx(i2cMap[i2c].master, i2cMap[i2c].address, (uint8_t *)i2cMap[i2c].tx_buf,
-                                    i2cMap[i2c].tx_index_tail, !stop);
-    if (ret) {
-        hal_i2c_reset(i2c, 0, nullptr);
-        ret_code = 1;
-        goto ret;
-    }
-
-    if (!WAIT_TIMED(i2cMap[i2c].transfer_config.timeout_ms, i2cMap[i2c].transfer_state == TRANSFER_STATE_BUSY)) {
-        hal_i2c_reset(i2c, 0, nullptr);
-        ret_code = 2;
-        goto ret;
-    }
-
-    if (i2cMap[i2c].transfer_state != TRANSFER_STATE_IDLE) {
-        hal_i2c_reset(i2c, 0, nullptr);
-        ret_code = 3;
-        goto ret;
+    hal_i2c_transaction_t trans = {};
+    trans.size = sizeof(trans);
+    trans.address = i2cMap[i2c].address;
+    trans.tx_buffer = i2cMap[i2c].tx_buf;
+    trans.tx_length = i2cMap[i2c].tx_index_tail;
+    trans.timeout_ms = i2cMap[i2c].transfer_config.timeout_ms;
+    trans.flags = stop ? HAL_I2C_TRANSMISSION_FLAG_STOP : 0;
+    const int r = twimTransfer(i2c, &trans);
+    if (r < 0) {
+        resetAfterError(i2c, r);
+        if (r == SYSTEM_ERROR_TIMEOUT) {
+            ret_code = 2;
+        } else if (r == SYSTEM_ERROR_IO) {
+            ret_code = 3;
+        } else {
+            ret_code = 1;
+        }
     }
 
-ret:
-    i2cMap[i2c].transfer_state = TRANSFER_STATE_IDLE;
     i2cMap[i2c].tx_index_head = 0;
     i2cMap[i2c].tx_index_tail = 0;
     return ret_code;
@@ -638,22 +753,7 @@ uint8_t hal_i2c_reset(hal_i2c_interface_t i2c, uint32_t reserved, void* reserved
     I2cLock lk(i2c);
     if (hal_i2c_is_enabled(i2c, nullptr)) {
         hal_i2c_end(i2c, nullptr);
-
-        HAL_Pin_Mode(i2cMap[i2c].sda_pin, INPUT_PULLUP); //Turn SCA into high impedance input
-        HAL_Pin_Mode(i2cMap[i2c].scl_pin, OUTPUT);       //Turn SCL into a normal GPO
-        HAL_GPIO_Write(i2cMap[i2c].scl_pin, 1);     // Start idle HIGH
-
-        //Generate 9 pulses on SCL to tell slave to release the bus
-        for (int i = 0; i < 9; i++) {
-            HAL_GPIO_Write(i2cMap[i2c].scl_pin, 0);
-            HAL_Delay_Microseconds(100);
-            HAL_GPIO_Write(i2cMap[i2c].scl_pin, 1);
-            HAL_Delay_Microseconds(100);
-        }
-
-        //Change SCL to be an input
-        HAL_Pin_Mode(i2cMap[i2c].scl_pin, INPUT_PULLUP);
-
+        clockOutBus(i2c);
         hal_i2c_begin(i2c, i2cMap[i2c].mode, i2cMap[i2c].address, nullptr);
         HAL_Delay_Milliseconds(50);
         return 0;
@@ -706,3 +806,9 @@ int hal_i2c_sleep(hal_i2c_interface_t i2c, bool sleep, void* reserved) {
 
     return SYSTEM_ERROR_NONE;
 }
+
+int hal_i2c_queue_transactions(hal_i2c_interface_t i2c, hal_i2c_transaction_t* trans, void* reserved) {
+    CHECK_TRUE(i2c < HAL_PLATFORM_I2C_NUM, SYSTEM_ERROR_INVALID_ARGUMENT);
+    CHECK_TRUE(i2cMap[i2c].state == HAL_I2C_STATE_ENABLED && i2cMap[i2c].mode == I2C_MODE_MASTER, SYSTEM_ERROR_INVALID_STATE);
+    return i2cMap[i2c].queue.push(trans);
+}
@@ -23,6 +23,8 @@
 
 #include "check.h"
 
+#include <algorithm>
+
 int inflate_create(inflate_ctx** ctx, const inflate_opts* opts, inflate_output output, void* user_data) {
     CHECK_TRUE(output, SYSTEM_ERROR_INVALID_ARGUMENT);
     size_t bufSize = (1 << INFLATE_MAX_WINDOW_BITS);
@@ -36,6 +38,7 @@ int inflate_create(inflate_ctx** ctx, const inflate_opts* opts, inflate_output o
     CHECK(inflate_alloc_ctx(ctx, &buf, bufSize));
     (*ctx)->buf = buf;
     (*ctx)->buf_size = bufSize;
+    (*ctx)->block_size = std::min<size_t>(bufSize, INFLATE_OUTPUT_BLOCK_SIZE);
     (*ctx)->output = output;
     (*ctx)->user_data = user_data;
     inflate_reset(*ctx);
@@ -49,7 +52,7 @@ void inflate_destroy(inflate_ctx* ctx) {
 }
 
 void inflate_reset(inflate_ctx* ctx) {
-    tinfl_init(&ctx->decomp);
+    inflate_decoder_init(&ctx->decoder);
     ctx->buf_offs = 0;
     ctx->buf_avail = 0;
     ctx->result = INFLATE_NEEDS_MORE_INPUT;
@@ -63,7 +66,8 @@ int inflate_input(inflate_ctx* ctx, const char* data, size_t* size, unsigned fla
     size_t srcOffs = 0;
     bool needMore = false;
     for (;;) {
-        if (ctx->buf_avail > 0) {
+        // Pass the decompressed data to the callback once a complete block is available
+        if (ctx->buf_avail > 0 && (ctx->done || (ctx->buf_offs + ctx->buf_avail) % ctx->block_size == 0)) {
             const int n = ctx->output(ctx->buf + ctx->buf_offs, ctx->buf_avail, ctx->user_data);
             if (n < 0) {
                 ctx->result = n;
@@ -91,9 +95,7 @@ int inflate_input(inflate_ctx* ctx, const char* data, size_t* size, unsigned fla
             break;
         }
         if (ctx->done) {
-            // tinfl_decompress() may return TINFL_STATUS_DONE even if there's still some data left in
-            // the input buffer. In the context of this API, this situation is interpreted as an error,
-            // i.e. the caller is not allowed to provide more data for decompression than necessary.
+            // The caller is not allowed to provide more data for decompression than necessary.
             //
             // Note that having the INFLATE_HAS_MORE_INPUT flag set for the last chunk of the compressed
             // data is fine, as the caller might not know the total size of the data in advance
@@ -104,24 +106,25 @@ int inflate_input(inflate_ctx* ctx, const char* data, size_t* size, unsigned fla
             }
             break;
         }
+        // Decompress up to the end of the current block
+        const size_t destOffs = ctx->buf_offs + ctx->buf_avail;
         size_t srcSize = *size - srcOffs;
-        size_t destSize = ctx->buf_size - ctx->buf_offs;
-        const auto status = tinfl_decompress(&ctx->decomp, (const mz_uint8*)data + srcOffs, &srcSize,
-                (mz_uint8*)ctx->buf, (mz_uint8*)ctx->buf + ctx->buf_offs, &destSize,
-                (flags & INFLATE_HAS_MORE_INPUT) ? TINFL_FLAG_HAS_MORE_INPUT : 0);
-        if (status < 0) {
-            ctx->result = SYSTEM_ERROR_BAD_DATA;
+        size_t destSize = ctx->block_size - destOffs % ctx->block_size;
+        const int r = inflate_decoder_run(&ctx->decoder, (const uint8_t*)data + srcOffs, &srcSize, (uint8_t*)ctx->buf,
+                ctx->buf_size, destOffs, &destSize, flags & INFLATE_HAS_MORE_INPUT);
+        if (r < 0) {
+            ctx->result = r;
             break;
         }
-        if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+        if (r == INFLATE_DECODER_NEEDS_MORE_INPUT) {
             needMore = true;
-        } else if (status == TINFL_STATUS_DONE) {
+        } else if (r == INFLATE_DECODER_DONE) {
             ctx->done = true;
         } else if (!destSize) { // Sanity check to prevent the infinite loop
             ctx->result = SYSTEM_ERROR_INTERNAL;
             break;
         }
-        ctx->buf_avail = destSize;
+        ctx->buf_avail += destSize;
         srcOffs += srcSize;
     }
     if (ctx->result >= 0) { // INFLATE_DONE or an intermediate status
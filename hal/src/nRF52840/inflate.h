@@ -23,6 +23,12 @@
 #define INFLATE_MIN_WINDOW_BITS 8
 #define INFLATE_MAX_WINDOW_BITS 15
 
+// The decompressed data is passed to the output callback in blocks of this size that are aligned
+// at a multiple of the block size in the output stream. The last block of the stream, or a block
+// that has been partially consumed by the callback, can be smaller. If the window is smaller than
+// the block size, the size of the window is used as the block size
+#define INFLATE_OUTPUT_BLOCK_SIZE 4096
+
 typedef struct inflate_ctx inflate_ctx;
 
 typedef int (*inflate_output)(const char* data, size_t size, void* user_data);
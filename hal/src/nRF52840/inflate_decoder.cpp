@@ -0,0 +1,715 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hal_platform.h"
+
+#if HAL_PLATFORM_COMPRESSED_OTA
+
+#include "inflate_decoder.h"
+
+#include "system_error.h"
+
+#include <cstring>
+
+namespace {
+
+/*
+ * Format of a lookup table entry:
+ *
+ * Bits 0-3: Number of bits to consume
+ * Bits 4-6: Entry kind (see below)
+ * Bits 8-15: Literal byte, or the number of extra bits of a length or distance code
+ * Bits 16-31: Base length or distance, or the symbol of a code length code. For a pair of literals:
+ *     bits 16-23 contain the second literal and bits 24-27 the code length of the first literal
+ */
+enum EntryKind {
+    ENTRY_LITERAL = 0,
+    ENTRY_LITERAL_PAIR = 1,
+    ENTRY_VALUE = 2,
+    ENTRY_END_OF_BLOCK = 3,
+    ENTRY_LONG_CODE = 4, // The code is longer than the table index and needs to be decoded canonically
+    ENTRY_INVALID = 5
+};
+
+enum State {
+    STATE_BLOCK_HEADER,
+    STATE_STORED_HEADER,
+    STATE_STORED_DATA,
+    STATE_TABLE_HEADER,
+    STATE_CLEN_LENS,
+    STATE_CODE_LENS,
+    STATE_LITLEN,
+    STATE_LENGTH_EXTRA,
+    STATE_DIST,
+    STATE_DIST_EXTRA,
+    STATE_COPY,
+    STATE_DONE
+};
+
+const unsigned LITLEN_TABLE_BITS = INFLATE_DECODER_LITLEN_TABLE_BITS;
+const unsigned DIST_TABLE_BITS = INFLATE_DECODER_DIST_TABLE_BITS;
+const unsigned CLEN_TABLE_BITS = INFLATE_DECODER_CLEN_TABLE_BITS;
+
+const unsigned MAX_MATCH_LENGTH = 258;
+
+// Minimum amount of input and output space that allows decoding a symbol without checking the
+// bounds of the input and output buffers
+const size_t FAST_MIN_INPUT = 12;
+const size_t FAST_MIN_OUTPUT = MAX_MATCH_LENGTH;
+
+const uint16_t LENGTH_BASE[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115,
+        131, 163, 195, 227, 258 };
+const uint8_t LENGTH_EXTRA[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+const uint16_t DIST_BASE[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025,
+        1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t DIST_EXTRA[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12,
+        13, 13 };
+
+// Order in which the code lengths of the code length alphabet are stored
+const uint8_t CLEN_ORDER[INFLATE_DECODER_MAX_CLEN_CODES] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2,
+        14, 1, 15 };
+
+typedef uint32_t(*MakeEntryFn)(unsigned sym);
+
+inline uint32_t makeEntry(unsigned kind, unsigned bits = 0, unsigned data = 0, unsigned value = 0) {
+    return bits | (kind << 4) | (data << 8) | (value << 16);
+}
+
+inline unsigned entryBits(uint32_t e) {
+    return e & 0x0f;
+}
+
+inline unsigned entryKind(uint32_t e) {
+    return (e >> 4) & 0x07;
+}
+
+inline unsigned entryData(uint32_t e) {
+    return (e >> 8) & 0xff;
+}
+
+inline unsigned entryValue(uint32_t e) {
+    return e >> 16;
+}
+
+uint32_t litlenEntry(unsigned sym) {
+    if (sym < 256) {
+        return makeEntry(ENTRY_LITERAL, 0, sym);
+    }
+    if (sym == 256) {
+        return makeEntry(ENTRY_END_OF_BLOCK);
+    }
+    sym -= 257;
+    if (sym < sizeof(LENGTH_BASE) / sizeof(LENGTH_BASE[0])) {
+        return makeEntry(ENTRY_VALUE, 0, LENGTH_EXTRA[sym], LENGTH_BASE[sym]);
+    }
+    return makeEntry(ENTRY_INVALID);
+}
+
+uint32_t distEntry(unsigned sym) {
+    if (sym < sizeof(DIST_BASE) / sizeof(DIST_BASE[0])) {
+        return makeEntry(ENTRY_VALUE, 0, DIST_EXTRA[sym], DIST_BASE[sym]);
+    }
+    return makeEntry(ENTRY_INVALID);
+}
+
+uint32_t clenEntry(unsigned sym) {
+    return makeEntry(ENTRY_VALUE, 0, 0, sym);
+}
+
+inline unsigned reverseBits(unsigned code, unsigned bits) {
+    unsigned r = 0;
+    for (unsigned i = 0; i < bits; ++i) {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+// Builds the lookup table and canonical code for the given code lengths
+int buildTable(const uint8_t* lens, unsigned count, uint32_t* table, unsigned tableBits, inflate_decoder_code* code,
+        MakeEntryFn makeEntryFn) {
+    memset(code->count, 0, sizeof(code->count));
+    for (unsigned i = 0; i < count; ++i) {
+        ++code->count[lens[i]];
+    }
+    code->count[0] = 0;
+    // Reject over-subscribed codes. Incomplete codes are allowed but the unused codes are invalid
+    int left = 1;
+    for (unsigned len = 1; len <= INFLATE_DECODER_MAX_CODE_BITS; ++len) {
+        left = (left << 1) - code->count[len];
+        if (left < 0) {
+            return SYSTEM_ERROR_BAD_DATA;
+        }
+    }
+    uint16_t offs[INFLATE_DECODER_MAX_CODE_BITS + 1] = {};
+    for (unsigned len = 1; len < INFLATE_DECODER_MAX_CODE_BITS; ++len) {
+        offs[len + 1] = offs[len] + code->count[len];
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        if (lens[i]) {
+            code->symbol[offs[lens[i]]++] = i;
+        }
+    }
+    // Entries that don't correspond to any short code are resolved canonically
+    const unsigned tableSize = 1 << tableBits;
+    const uint32_t longEntry = makeEntry(ENTRY_LONG_CODE);
+    for (unsigned i = 0; i < tableSize; ++i) {
+        table[i] = longEntry;
+    }
+    unsigned c = 0;
+    unsigned index = 0;
+    for (unsigned len = 1; len <= tableBits; ++len) {
+        for (unsigned i = 0; i < code->count[len]; ++i) {
+            const uint32_t e = makeEntryFn(code->symbol[index++]) | len;
+            for (unsigned j = reverseBits(c, len); j < tableSize; j += (1 << len)) {
+                table[j] = e;
+            }
+            ++c;
+        }
+        c <<= 1;
+    }
+    return 0;
+}
+
+// Combines the literals whose codes fit in a single table index into pairs. The table is
+// processed backwards so that the entries it is looking up haven't been combined yet
+void combineLiterals(uint32_t* table, unsigned tableBits) {
+    for (unsigned i = 1 << tableBits; i-- > 0;) {
+        const uint32_t e1 = table[i];
+        const unsigned bits1 = entryBits(e1);
+        if (entryKind(e1) != ENTRY_LITERAL || bits1 >= tableBits) {
+            continue;
+        }
+        const uint32_t e2 = table[i >> bits1];
+        const unsigned bits2 = entryBits(e2);
+        if (entryKind(e2) != ENTRY_LITERAL || bits1 + bits2 > tableBits) {
+            continue;
+        }
+        table[i] = makeEntry(ENTRY_LITERAL_PAIR, bits1 + bits2, entryData(e1), entryData(e2) | (bits1 << 8));
+    }
+}
+
+// Decodes a symbol bit by bit. Returns 1 on success, 0 if more bits are needed, or a negative
+// result code if the code is invalid
+int decodeCanonical(const inflate_decoder_code* code, uint32_t bitBuf, unsigned bitCount, unsigned* sym, unsigned* bits) {
+    int c = 0; // Code bits read so far
+    int first = 0; // First code of the current length
+    int index = 0; // Index of the first code of the current length in the symbol table
+    for (unsigned len = 1; len <= INFLATE_DECODER_MAX_CODE_BITS; ++len) {
+        if (len > bitCount) {
+            return 0;
+        }
+        c |= (bitBuf >> (len - 1)) & 1;
+        const int count = code->count[len];
+        if (c - first < count) {
+            *sym = code->symbol[index + c - first];
+            *bits = len;
+            return 1;
+        }
+        index += count;
+        first = (first + count) << 1;
+        c <<= 1;
+    }
+    return SYSTEM_ERROR_BAD_DATA;
+}
+
+// Decodes a table entry using the bits available. Returns 1 on success, 0 if more bits are needed,
+// or a negative result code if the code is invalid
+inline int decodeEntry(const uint32_t* table, unsigned tableBits, const inflate_decoder_code* code, MakeEntryFn makeEntryFn,
+        uint32_t bitBuf, unsigned bitCount, uint32_t* entry) {
+    uint32_t e = table[bitBuf & ((1u << tableBits) - 1)];
+    if (entryKind(e) == ENTRY_LONG_CODE) {
+        unsigned sym = 0, bits = 0;
+        const int r = decodeCanonical(code, bitBuf, bitCount, &sym, &bits);
+        if (r <= 0) {
+            return r;
+        }
+        e = makeEntryFn(sym) | bits;
+    } else if (entryBits(e) > bitCount) {
+        return 0;
+    }
+    *entry = e;
+    return 1;
+}
+
+// Copies the data forward. `gap` is the distance between the source and destination if the
+// regions overlap
+inline void copyForward(uint8_t* dest, const uint8_t* src, size_t size, size_t gap) {
+    if (gap >= sizeof(uint32_t)) {
+        while (size >= sizeof(uint32_t)) {
+            uint32_t w;
+            memcpy(&w, src, sizeof(w));
+            memcpy(dest, &w, sizeof(w));
+            src += sizeof(w);
+            dest += sizeof(w);
+            size -= sizeof(w);
+        }
+    } else if (gap == 1) {
+        memset(dest, *src, size);
+        return;
+    }
+    while (size > 0) {
+        *dest++ = *src++;
+        --size;
+    }
+}
+
+// Copies a match within the circular buffer. The destination region must not wrap
+inline void copyMatch(uint8_t* buf, size_t bufSize, size_t pos, size_t dist, size_t len) {
+    uint8_t* const dest = buf + pos;
+    if (dist <= pos) {
+        copyForward(dest, dest - dist, len, dist);
+    } else {
+        // The source region wraps around the end of the buffer
+        size_t n = dist - pos;
+        if (n > len) {
+            n = len;
+        }
+        copyForward(dest, buf + bufSize - (dist - pos), n, sizeof(uint32_t) /* The source follows the destination */);
+        copyForward(dest + n, buf, len - n, dist);
+    }
+}
+
+void initFixedTables(inflate_decoder* d) {
+    unsigned i = 0;
+    for (; i < 144; ++i) {
+        d->lens[i] = 8;
+    }
+    for (; i < 256; ++i) {
+        d->lens[i] = 9;
+    }
+    for (; i < 280; ++i) {
+        d->lens[i] = 7;
+    }
+    for (; i < 288; ++i) {
+        d->lens[i] = 8;
+    }
+    buildTable(d->lens, 288, d->litlen_table, LITLEN_TABLE_BITS, &d->litlen_code, litlenEntry);
+    combineLiterals(d->litlen_table, LITLEN_TABLE_BITS);
+    for (i = 0; i < 32; ++i) {
+        d->lens[i] = 5;
+    }
+    buildTable(d->lens, 32, d->dist_table, DIST_TABLE_BITS, &d->dist_code, distEntry);
+}
+
+} // namespace
+
+void inflate_decoder_init(inflate_decoder* d) {
+    d->total_out = 0;
+    d->bit_buf = 0;
+    d->bit_count = 0;
+    d->state = STATE_BLOCK_HEADER;
+    d->final_block = 0;
+    d->length = 0;
+    d->dist = 0;
+}
+
+int inflate_decoder_run(inflate_decoder* d, const uint8_t* src, size_t* src_size, uint8_t* buf, size_t buf_size,
+        size_t buf_offs, size_t* dest_size, int has_more_input) {
+    const uint8_t* in = src;
+    const uint8_t* const inEnd = src + *src_size;
+    size_t pos = buf_offs;
+    const size_t limit = buf_offs + *dest_size;
+    uint32_t bitBuf = d->bit_buf;
+    unsigned bitCount = d->bit_count;
+    int result = 0;
+
+// Ensures that at least `_n` bits are available in the bit buffer
+#define NEED_BITS(_n) \
+        while (bitCount < (_n)) { \
+            if (in == inEnd) { \
+                goto needs_more_input; \
+            } \
+            bitBuf |= (uint32_t)*in++ << bitCount; \
+            bitCount += 8; \
+        }
+
+// Reads one more byte into the bit buffer
+#define PULL_BYTE() \
+        do { \
+            if (in == inEnd) { \
+                goto needs_more_input; \
+            } \
+            bitBuf |= (uint32_t)*in++ << bitCount; \
+            bitCount += 8; \
+        } while (false)
+
+// Ensures that at least 25 bits are available in the bit buffer. Input bounds are not checked
+#define REFILL_BITS() \
+        while (bitCount <= 24) { \
+            bitBuf |= (uint32_t)*in++ << bitCount; \
+            bitCount += 8; \
+        }
+
+#define GET_BITS(_n) \
+        (bitBuf & ((1u << (_n)) - 1))
+
+#define DROP_BITS(_n) \
+        do { \
+            bitBuf >>= (_n); \
+            bitCount -= (_n); \
+        } while (false)
+
+    for (;;) {
+        switch (d->state) {
+        case STATE_BLOCK_HEADER: {
+            if (d->final_block) {
+                d->state = STATE_DONE;
+                break;
+            }
+            NEED_BITS(3);
+            d->final_block = GET_BITS(1);
+            const unsigned type = (bitBuf >> 1) & 0x03;
+            DROP_BITS(3);
+            if (type == 0) {
+                // Skip to the byte boundary
+                DROP_BITS(bitCount & 7);
+                d->state = STATE_STORED_HEADER;
+            } else if (type == 1) {
+                initFixedTables(d);
+                d->state = STATE_LITLEN;
+            } else if (type == 2) {
+                d->state = STATE_TABLE_HEADER;
+            } else {
+                result = SYSTEM_ERROR_BAD_DATA;
+                goto done;
+            }
+            break;
+        }
+        case STATE_STORED_HEADER: {
+            NEED_BITS(16);
+            const unsigned len = GET_BITS(16);
+            NEED_BITS(32);
+            const unsigned nlen = bitBuf >> 16;
+            // The bit buffer is empty now and the block data can be copied directly from the input
+            bitBuf = 0;
+            bitCount = 0;
+            if (len != (~nlen & 0xffff)) {
+                result = SYSTEM_ERROR_BAD_DATA;
+                goto done;
+            }
+            d->length = len;
+            d->state = STATE_STORED_DATA;
+            break;
+        }
+        case STATE_STORED_DATA: {
+            size_t n = d->length;
+            if (n > (size_t)(inEnd - in)) {
+                n = inEnd - in;
+            }
+            if (n > limit - pos) {
+                n = limit - pos;
+            }
+            memcpy(buf + pos, in, n);
+            in += n;
+            pos += n;
+            d->length -= n;
+            if (d->length > 0) {
+                if (pos == limit) {
+                    goto has_more_output;
+                }
+                goto needs_more_input;
+            }
+            d->state = STATE_BLOCK_HEADER;
+            break;
+        }
+        case STATE_TABLE_HEADER: {
+            NEED_BITS(14);
+            d->lit_count = GET_BITS(5) + 257;
+            d->dist_count = ((bitBuf >> 5) & 0x1f) + 1;
+            d->clen_count = ((bitBuf >> 10) & 0x0f) + 4;
+            DROP_BITS(14);
+            if (d->lit_count > 286 || d->dist_count > 30) {
+                result = SYSTEM_ERROR_BAD_DATA;
+                goto done;
+            }
+            memset(d->lens, 0, INFLATE_DECODER_MAX_CLEN_CODES);
+            d->len_index = 0;
+            d->state = STATE_CLEN_LENS;
+            break;
+        }
+        case STATE_CLEN_LENS: {
+            while (d->len_index < d->clen_count) {
+                NEED_BITS(3);
+                d->lens[CLEN_ORDER[d->len_index++]] = GET_BITS(3);
+                DROP_BITS(3);
+            }
+            // The distance table is not in use yet and serves as a table for the code length code
+            result = buildTable(d->lens, INFLATE_DECODER_MAX_CLEN_CODES, d->dist_table, CLEN_TABLE_BITS, &d->dist_code,
+                    clenEntry);
+            if (result < 0) {
+                goto done;
+            }
+            d->len_index = 0;
+            d->state = STATE_CODE_LENS;
+            break;
+        }
+        case STATE_CODE_LENS: {
+            const unsigned total = d->lit_count + d->dist_count;
+            while (d->len_index < total) {
+                uint32_t e = 0;
+                int r = decodeEntry(d->dist_table, CLEN_TABLE_BITS, &d->dist_code, clenEntry, bitBuf, bitCount, &e);
+                if (r < 0) {
+                    result = r;
+                    goto done;
+                }
+                if (r == 0) {
+                    PULL_BYTE();
+                    continue;
+                }
+                const unsigned bits = entryBits(e);
+                const unsigned sym = entryValue(e);
+                if (sym < 16) {
+                    DROP_BITS(bits);
+                    d->lens[d->len_index++] = sym;
+                    continue;
+                }
+                // Repeat codes are followed by extra bits, which are consumed together with the code
+                unsigned len = 0;
+                unsigned count = 0;
+                if (sym == 16) {
+                    if (d->len_index == 0) {
+                        result = SYSTEM_ERROR_BAD_DATA;
+                        goto done;
+                    }
+                    NEED_BITS(bits + 2);
+                    len = d->lens[d->len_index - 1];
+                    count = 3 + ((bitBuf >> bits) & 0x03);
+                    DROP_BITS(bits + 2);
+                } else if (sym == 17) {
+                    NEED_BITS(bits + 3);
+                    count = 3 + ((bitBuf >> bits) & 0x07);
+                    DROP_BITS(bits + 3);
+                } else {
+                    NEED_BITS(bits + 7);
+                    count = 11 + ((bitBuf >> bits) & 0x7f);
+                    DROP_BITS(bits + 7);
+                }
+                if (d->len_index + count > total) {
+                    result = SYSTEM_ERROR_BAD_DATA;
+                    goto done;
+                }
+                memset(d->lens + d->len_index, len, count);
+                d->len_index += count;
+            }
+            if (!d->lens[256]) { // End of block code is required
+                result = SYSTEM_ERROR_BAD_DATA;
+                goto done;
+            }
+            result = buildTable(d->lens, d->lit_count, d->litlen_table, LITLEN_TABLE_BITS, &d->litlen_code, litlenEntry);
+            if (result < 0) {
+                goto done;
+            }
+            combineLiterals(d->litlen_table, LITLEN_TABLE_BITS);
+            result = buildTable(d->lens + d->lit_count, d->dist_count, d->dist_table, DIST_TABLE_BITS, &d->dist_code,
+                    distEntry);
+            if (result < 0) {
+                goto done;
+            }
+            d->state = STATE_LITLEN;
+            break;
+        }
+        case STATE_LITLEN: {
+            // Fast path: decode entire symbols without checking the bounds of the buffers
+            while ((size_t)(inEnd - in) >= FAST_MIN_INPUT && limit - pos >= FAST_MIN_OUTPUT) {
+                REFILL_BITS();
+                uint32_t e = d->litlen_table[GET_BITS(LITLEN_TABLE_BITS)];
+                unsigned kind = entryKind(e);
+                if (kind == ENTRY_LITERAL_PAIR) {
+                    buf[pos] = entryData(e);
+                    buf[pos + 1] = entryValue(e) & 0xff;
+                    pos += 2;
+                    DROP_BITS(entryBits(e));
+                    continue;
+                }
+                if (kind == ENTRY_LONG_CODE) {
+                    unsigned sym = 0, bits = 0;
+                    const int r = decodeCanonical(&d->litlen_code, bitBuf, bitCount, &sym, &bits);
+                    if (r <= 0) {
+                        result = SYSTEM_ERROR_BAD_DATA;
+                        goto done;
+                    }
+                    e = litlenEntry(sym) | bits;
+                    kind = entryKind(e);
+                }
+                if (kind == ENTRY_LITERAL) {
+                    buf[pos++] = entryData(e);
+                    DROP_BITS(entryBits(e));
+                    continue;
+                }
+                if (kind != ENTRY_VALUE) {
+                    break; // End of block or an invalid code
+                }
+                DROP_BITS(entryBits(e));
+                unsigned length = entryValue(e);
+                unsigned extra = entryData(e);
+                length += GET_BITS(extra);
+                DROP_BITS(extra);
+                REFILL_BITS();
+                e = d->dist_table[GET_BITS(DIST_TABLE_BITS)];
+                if (entryKind(e) == ENTRY_LONG_CODE) {
+                    unsigned sym = 0, bits = 0;
+                    const int r = decodeCanonical(&d->dist_code, bitBuf, bitCount, &sym, &bits);
+                    if (r <= 0) {
+                        result = SYSTEM_ERROR_BAD_DATA;
+                        goto done;
+                    }
+                    e = distEntry(sym) | bits;
+                }
+                if (entryKind(e) != ENTRY_VALUE) {
+                    result = SYSTEM_ERROR_BAD_DATA;
+                    goto done;
+                }
+                DROP_BITS(entryBits(e));
+                REFILL_BITS();
+                unsigned dist = entryValue(e);
+                extra = entryData(e);
+                dist += GET_BITS(extra);
+                DROP_BITS(extra);
+                if (dist > buf_size || dist > d->total_out + (pos - buf_offs)) {
+                    result = SYSTEM_ERROR_BAD_DATA;
+                    goto done;
+                }
+                copyMatch(buf, buf_size, pos, dist, length);
+                pos += length;
+            }
+            uint32_t e = 0;
+            const int r = decodeEntry(d->litlen_table, LITLEN_TABLE_BITS, &d->litlen_code, litlenEntry, bitBuf, bitCount, &e);
+            if (r < 0) {
+                result = r;
+                goto done;
+            }
+            if (r == 0) {
+                PULL_BYTE();
+                break;
+            }
+            const unsigned kind = entryKind(e);
+            if (kind == ENTRY_LITERAL || kind == ENTRY_LITERAL_PAIR) {
+                if (pos == limit) {
+                    goto has_more_output;
+                }
+                buf[pos++] = entryData(e);
+                // Only the first literal of a pair is decoded here
+                DROP_BITS((kind == ENTRY_LITERAL_PAIR) ? (entryValue(e) >> 8) : entryBits(e));
+            } else if (kind == ENTRY_VALUE) {
+                DROP_BITS(entryBits(e));
+                d->length = entryValue(e);
+                d->extra = entryData(e);
+                d->state = STATE_LENGTH_EXTRA;
+            } else if (kind == ENTRY_END_OF_BLOCK) {
+                DROP_BITS(entryBits(e));
+                d->state = STATE_BLOCK_HEADER;
+            } else {
+                result = SYSTEM_ERROR_BAD_DATA;
+                goto done;
+            }
+            break;
+        }
+        case STATE_LENGTH_EXTRA: {
+            NEED_BITS(d->extra);
+            d->length += GET_BITS(d->extra);
+            DROP_BITS(d->extra);
+            d->state = STATE_DIST;
+            break;
+        }
+        case STATE_DIST: {
+            uint32_t e = 0;
+            const int r = decodeEntry(d->dist_table, DIST_TABLE_BITS, &d->dist_code, distEntry, bitBuf, bitCount, &e);
+            if (r < 0) {
+                result = r;
+                goto done;
+            }
+            if (r == 0) {
+                PULL_BYTE();
+                break;
+            }
+            if (entryKind(e) != ENTRY_VALUE) {
+                result = SYSTEM_ERROR_BAD_DATA;
+                goto done;
+            }
+            DROP_BITS(entryBits(e));
+            d->dist = entryValue(e);
+            d->extra = entryData(e);
+            d->state = STATE_DIST_EXTRA;
+            break;
+        }
+        case STATE_DIST_EXTRA: {
+            NEED_BITS(d->extra);
+            d->dist += GET_BITS(d->extra);
+            DROP_BITS(d->extra);
+            if (d->dist > buf_size || d->dist > d->total_out + (pos - buf_offs)) {
+                result = SYSTEM_ERROR_BAD_DATA;
+                goto done;
+            }
+            d->state = STATE_COPY;
+            break;
+        }
+        case STATE_COPY: {
+            const size_t mask = buf_size - 1;
+            while (d->length > 0 && pos < limit) {
+                buf[pos] = buf[(pos - d->dist) & mask];
+                ++pos;
+                --d->length;
+            }
+            if (d->length > 0) {
+                goto has_more_output;
+            }
+            d->state = STATE_LITLEN;
+            break;
+        }
+        case STATE_DONE: {
+            result = INFLATE_DECODER_DONE;
+            goto done;
+        }
+        default:
+            result = SYSTEM_ERROR_INTERNAL;
+            goto done;
+        }
+    }
+
+#undef NEED_BITS
+#undef PULL_BYTE
+#undef REFILL_BITS
+#undef GET_BITS
+#undef DROP_BITS
+
+needs_more_input:
+    result = has_more_input ? (int)INFLATE_DECODER_NEEDS_MORE_INPUT : (int)SYSTEM_ERROR_BAD_DATA;
+    goto done;
+has_more_output:
+    result = INFLATE_DECODER_HAS_MORE_OUTPUT;
+done:
+    if (result != INFLATE_DECODER_NEEDS_MORE_INPUT) {
+        // Return the whole bytes prefetched into the bit buffer to the caller
+        size_t n = bitCount >> 3;
+        if (n > (size_t)(in - src)) {
+            n = in - src;
+        }
+        in -= n;
+        bitCount -= n * 8;
+        bitBuf &= (bitCount > 0) ? (0xffffffffu >> (32 - bitCount)) : 0;
+    }
+    d->bit_buf = bitBuf;
+    d->bit_count = bitCount;
+    d->total_out += pos - buf_offs;
+    *src_size = in - src;
+    *dest_size = pos - buf_offs;
+    return result;
+}
+
+#endif // HAL_PLATFORM_COMPRESSED_OTA
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Number of bits used to index the primary lookup tables. Codes that are longer than that are
+// decoded canonically, which is slower but rare in practice
+#define INFLATE_DECODER_LITLEN_TABLE_BITS 11
+#define INFLATE_DECODER_DIST_TABLE_BITS 9
+#define INFLATE_DECODER_CLEN_TABLE_BITS 7
+
+#define INFLATE_DECODER_MAX_LITLEN_CODES 288
+#define INFLATE_DECODER_MAX_DIST_CODES 32
+#define INFLATE_DECODER_MAX_CLEN_CODES 19
+#define INFLATE_DECODER_MAX_CODE_BITS 15
+
+typedef enum inflate_decoder_status {
+    INFLATE_DECODER_DONE = 0,
+    INFLATE_DECODER_NEEDS_MORE_INPUT = 1,
+    INFLATE_DECODER_HAS_MORE_OUTPUT = 2
+} inflate_decoder_status;
+
+// Canonical Huffman code used to decode the symbols that don't fit in a lookup table
+typedef struct inflate_decoder_code {
+    uint16_t count[INFLATE_DECODER_MAX_CODE_BITS + 1]; // Number of codes of each length
+    uint16_t symbol[INFLATE_DECODER_MAX_LITLEN_CODES]; // Symbols ordered by their codes
+} inflate_decoder_code;
+
+typedef struct inflate_decoder {
+    uint32_t litlen_table[1 << INFLATE_DECODER_LITLEN_TABLE_BITS];
+    uint32_t dist_table[1 << INFLATE_DECODER_DIST_TABLE_BITS];
+    inflate_decoder_code litlen_code;
+    inflate_decoder_code dist_code;
+    uint8_t lens[INFLATE_DECODER_MAX_LITLEN_CODES + INFLATE_DECODER_MAX_DIST_CODES];
+    size_t total_out;
+    uint32_t bit_buf;
+    unsigned bit_count;
+    unsigned state;
+    unsigned final_block;
+    unsigned lit_count; // Number of literal/length codes in a dynamic block
+    unsigned dist_count; // Number of distance codes in a dynamic block
+    unsigned clen_count; // Number of code length codes in a dynamic block
+    unsigned len_index; // Number of code lengths decoded so far
+    unsigned length; // Remaining length of a match or a stored block
+    unsigned dist; // Distance of a match
+    unsigned extra; // Number of extra bits of a length or distance code
+} inflate_decoder;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Initializes the decoder.
+ */
+void inflate_decoder_init(inflate_decoder* d);
+/**
+ * Decodes a chunk of a raw Deflate stream.
+ *
+ * The output is written to a circular buffer which also serves as the sliding window. The
+ * decoded data is written at `buf_offs` and up to `*dest_size` bytes are produced, which
+ * shouldn't cross the end of the buffer. Once the buffer is full, the caller needs to continue
+ * from its beginning.
+ *
+ * @param d Decoder instance.
+ * @param src Input data.
+ * @param src_size[in,out] Size of the input data. On return, number of bytes consumed.
+ * @param buf Output buffer.
+ * @param buf_size Size of the output buffer. Must be a power of two.
+ * @param buf_offs Offset in the output buffer.
+ * @param dest_size[in,out] Maximum number of bytes to decode. On return, number of bytes decoded.
+ * @param has_more_input Whether more input data will follow.
+ * @return One of the values defined by the `inflate_decoder_status` enum, or a negative result
+ *         code in case of an error.
+ */
+int inflate_decoder_run(inflate_decoder* d, const uint8_t* src, size_t* src_size, uint8_t* buf, size_t buf_size,
+        size_t buf_offs, size_t* dest_size, int has_more_input);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -18,14 +18,13 @@
 #pragma once
 
 #include "inflate.h"
-
-#include "miniz.h"
-#include "miniz_tinfl.h"
+#include "inflate_decoder.h"
 
 struct inflate_ctx {
-    tinfl_decompressor decomp;
+    inflate_decoder decoder;
     char* buf;
     size_t buf_size;
+    size_t block_size;
     size_t buf_offs;
     size_t buf_avail;
     inflate_output output;
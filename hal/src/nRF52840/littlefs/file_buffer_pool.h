@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstddef>
+
+namespace particle {
+
+namespace fs {
+
+/**
+ * Pool of fixed-size buffers with a fallback to the heap.
+ *
+ * Allocations that fit in a buffer are served from the pool while there are free buffers, all
+ * other allocations are passed to `malloc()`. The pool is not thread-safe.
+ *
+ * The pool has no constructor so that it can be used as a statically allocated object, which is
+ * zero-initialized.
+ */
+template<size_t BufferSize, size_t BufferCount>
+class FileBufferPool {
+public:
+    static_assert(BufferCount <= sizeof(uint32_t) * 8, "Too many buffers");
+
+    void* alloc(size_t size) {
+        if (size <= BufferSize) {
+            for (size_t i = 0; i < BufferCount; ++i) {
+                if (!(used_ & (1u << i))) {
+                    used_ |= (1u << i);
+                    return buffers_[i];
+                }
+            }
+        }
+        return malloc(size);
+    }
+
+    void free(void* ptr) {
+        const uintptr_t offs = (uintptr_t)ptr - (uintptr_t)buffers_;
+        if (offs >= sizeof(buffers_)) {
+            ::free(ptr);
+            return;
+        }
+        // Ignore pointers that don't point to the beginning of a buffer. Freeing a buffer that is
+        // not allocated has no effect
+        if (offs % BufferSize != 0) {
+            return;
+        }
+        used_ &= ~(1u << (offs / BufferSize));
+    }
+
+    /**
+     * Returns the number of allocated buffers.
+     */
+    size_t usedCount() const {
+        return __builtin_popcount(used_);
+    }
+
+    bool isPoolBuffer(const void* ptr) const {
+        return (uintptr_t)ptr - (uintptr_t)buffers_ < sizeof(buffers_);
+    }
+
+private:
+    uint8_t buffers_[BufferCount][BufferSize] __attribute__((aligned(4)));
+    uint32_t used_;
+};
+
+} // namespace fs
+
+} // namespace particle
@@ -16,6 +16,7 @@
  */
 
 #include "filesystem.h"
+#include "file_buffer_pool.h"
 #include "platform_config.h"
 #include "exflash_hal.h"
 #include "rgbled.h"
@@ -234,8 +235,38 @@ void fs_dump(filesystem_t* fs)
 
 filesystem_t s_instance = {};
 
+#if !defined(LFS_NO_MALLOC) && FILESYSTEM_FILE_BUFFER_COUNT > 0
+
+FileBufferPool<FILESYSTEM_PROG_SIZE, FILESYSTEM_FILE_BUFFER_COUNT> s_file_buffers;
+
+#endif /* !defined(LFS_NO_MALLOC) && FILESYSTEM_FILE_BUFFER_COUNT > 0 */
+
 } /* anonymous */
 
+#ifndef LFS_NO_MALLOC
+
+/* littlefs allocates a cache buffer for every open file. If FILESYSTEM_FILE_BUFFER_COUNT is
+ * set, the buffers are taken from a small pool to avoid fragmenting the heap when files are
+ * opened and closed frequently. These functions are called by littlefs with the filesystem locked
+ */
+void* filesystem_buffer_alloc(size_t size) {
+#if FILESYSTEM_FILE_BUFFER_COUNT > 0
+    return s_file_buffers.alloc(size);
+#else
+    return malloc(size);
+#endif /* FILESYSTEM_FILE_BUFFER_COUNT > 0 */
+}
+
+void filesystem_buffer_free(void* ptr) {
+#if FILESYSTEM_FILE_BUFFER_COUNT > 0
+    s_file_buffers.free(ptr);
+#else
+    free(ptr);
+#endif /* FILESYSTEM_FILE_BUFFER_COUNT > 0 */
+}
+
+#endif /* LFS_NO_MALLOC */
+
 int filesystem_mount(filesystem_t* fs) {
     FsLock lk(fs);
     int ret = 0;
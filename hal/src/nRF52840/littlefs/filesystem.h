@@ -29,13 +29,32 @@ extern "C" {
 #include <lfs.h>
 
 /* FIXME */
+#ifndef FILESYSTEM_PROG_SIZE
 #define FILESYSTEM_PROG_SIZE    (256)
+#endif /* FILESYSTEM_PROG_SIZE */
+#ifndef FILESYSTEM_READ_SIZE
 #define FILESYSTEM_READ_SIZE    (256)
+#endif /* FILESYSTEM_READ_SIZE */
 
 #define FILESYSTEM_BLOCK_SIZE   (sFLASH_PAGESIZE)
 /* XXX: Using half of the external flash for now */
 #define FILESYSTEM_BLOCK_COUNT  (sFLASH_PAGECOUNT / 2)
-#define FILESYSTEM_LOOKAHEAD    (128)
+
+/* Number of blocks tracked by the block allocator at once (1 bit per block, multiple of 32).
+ * By default the whole filesystem is covered, so that all free blocks are found with
+ * a single traversal of the filesystem
+ */
+#ifndef FILESYSTEM_LOOKAHEAD
+#define FILESYSTEM_LOOKAHEAD    (((FILESYSTEM_BLOCK_COUNT + 31) / 32) * 32)
+#endif /* FILESYSTEM_LOOKAHEAD */
+
+/* Number of statically allocated buffers for the caches of littlefs, FILESYSTEM_PROG_SIZE bytes
+ * each. Caches are allocated on the heap when all the buffers are in use. Disabled by default,
+ * as the buffers are reserved even when no file is open
+ */
+#ifndef FILESYSTEM_FILE_BUFFER_COUNT
+#define FILESYSTEM_FILE_BUFFER_COUNT (0)
+#endif /* FILESYSTEM_FILE_BUFFER_COUNT */
 
 /* FIXME */
 typedef struct {
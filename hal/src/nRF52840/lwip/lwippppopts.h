@@ -112,6 +112,12 @@
  */
 #define PPP_INPROC_IRQ_SAFE             1
 
+/**
+ * PPPOS_INPUT_OVERRIDE==1: decode incoming PPPoS frames directly into pbuf chains
+ * instead of passing the data to pppos_input()
+ */
+#define PPPOS_INPUT_OVERRIDE            1
+
 /**
  * PRINTPKT_SUPPORT==1: Enable PPP print packet support
  *
@@ -49,6 +49,7 @@ LOG_SOURCE_CATEGORY("hal.ota")
 #include <memory>
 #include "platform_radio_stack.h"
 #include "check.h"
+#include "ota_inflate_stream.h"
 
 #define OTA_CHUNK_SIZE                 (512)
 #define BOOTLOADER_RANDOM_BACKOFF_MIN  (200)
@@ -58,6 +59,75 @@ namespace {
 
 const uint16_t BOOTLOADER_MBR_UPDATE_MIN_VERSION = 1001; // 2.0.0-rc.1
 
+#if HAL_PLATFORM_COMPRESSED_OTA
+
+// Storage for a compressed module decompressed during the transfer. The decompressed module is
+// placed in the OTA section after the compressed one, so that the bootloader only needs to copy it
+class ExflashInflateStorage: public particle::OtaInflateStorage {
+public:
+    ExflashInflateStorage() :
+            addr_(0) {
+    }
+
+    void address(uintptr_t addr) {
+        addr_ = addr;
+    }
+
+    uintptr_t address() const {
+        return addr_;
+    }
+
+    int erase(size_t offset, size_t size) override {
+        return (hal_exflash_erase_sector(addr_ + offset, size / sFLASH_PAGESIZE) == 0) ? 0 : SYSTEM_ERROR_FLASH_IO;
+    }
+
+    int write(size_t offset, const uint8_t* data, size_t size) override {
+        return (hal_exflash_write(addr_ + offset, data, size) == 0) ? 0 : SYSTEM_ERROR_FLASH_IO;
+    }
+
+private:
+    uintptr_t addr_;
+};
+
+ExflashInflateStorage g_inflateStorage;
+particle::OtaInflateStream g_inflateStream;
+
+void startInflateStream(uint32_t address, uint32_t length) {
+    const uintptr_t otaEnd = EXTERNAL_FLASH_OTA_ADDRESS + EXTERNAL_FLASH_OTA_LENGTH;
+    const uintptr_t addr = (address + length + sFLASH_PAGESIZE - 1) / sFLASH_PAGESIZE * sFLASH_PAGESIZE;
+    if (address != EXTERNAL_FLASH_OTA_ADDRESS || addr >= otaEnd) {
+        g_inflateStream.destroy();
+        return;
+    }
+    g_inflateStorage.address(addr);
+    g_inflateStream.init(&g_inflateStorage, otaEnd - addr);
+}
+
+// Returns the address of a module in the external flash if it has been decompressed during the transfer
+bool getInflatedModule(const hal_module_t* module, const module_info_t* info, uintptr_t* addr, size_t* size) {
+    if (!g_inflateStream.isDone() || module->bounds.start_address != module_ota.start_address) {
+        return false;
+    }
+    const uintptr_t inflAddr = g_inflateStorage.address();
+    const size_t inflSize = g_inflateStream.outputSize();
+    const auto inflInfo = FLASH_ModuleInfo(FLASH_SERIAL, inflAddr, nullptr);
+    if (!inflInfo || inflInfo->module_start_address != info->module_start_address ||
+            inflInfo->module_function != info->module_function ||
+            inflInfo->platform_id != info->platform_id ||
+            (inflInfo->flags & (MODULE_INFO_FLAG_DROP_MODULE_INFO | MODULE_INFO_FLAG_COMPRESSED))) {
+        return false;
+    }
+    const size_t moduleSize = module_length(inflInfo);
+    if (inflSize < moduleSize + 4 /* CRC-32 */ || !FLASH_VerifyCRC32(FLASH_SERIAL, inflAddr, moduleSize)) {
+        return false;
+    }
+    *addr = inflAddr;
+    *size = moduleSize + 4;
+    return true;
+}
+
+#endif // HAL_PLATFORM_COMPRESSED_OTA
+
 } // anonymous
 
 static int flash_bootloader(const hal_module_t* mod, uint32_t moduleLength);
@@ -369,12 +439,26 @@ uint16_t HAL_OTA_ChunkSize()
 bool HAL_FLASH_Begin(uint32_t address, uint32_t length, void* reserved)
 {
     FLASH_Begin(address, length);
+#if HAL_PLATFORM_COMPRESSED_OTA
+    startInflateStream(address, length);
+#endif
     return true;
 }
 
 int HAL_FLASH_Update(const uint8_t *pBuffer, uint32_t address, uint32_t length, void* reserved)
 {
-    return FLASH_Update(pBuffer, address, length);
+    const int ret = FLASH_Update(pBuffer, address, length);
+#if HAL_PLATFORM_COMPRESSED_OTA
+    if (ret == 0 && !g_inflateStream.isFailed() && address >= EXTERNAL_FLASH_OTA_ADDRESS) {
+        // Decompress the module while it's being received. If that fails, the module will be
+        // decompressed by the bootloader
+        const int r = g_inflateStream.process((const char*)pBuffer, length, address - EXTERNAL_FLASH_OTA_ADDRESS);
+        if (r < 0) {
+            LOG_DEBUG(TRACE, "Module will be decompressed by the bootloader: %d", r);
+        }
+    }
+#endif
+    return ret;
 }
 
 int HAL_OTA_Flash_Read(uintptr_t address, uint8_t* buffer, size_t size)
@@ -621,13 +705,23 @@ __attribute__((optimize("O0"))) int HAL_FLASH_End(void* reserved)
             if (info.flags & MODULE_INFO_FLAG_DROP_MODULE_INFO) {
                 slotFlags |= MODULE_DROP_MODULE_INFO;
             }
+            // Convert the module's XIP address to an address in the external flash :sweat_smile:
+            uintptr_t otaAddr = EXTERNAL_FLASH_OTA_ADDRESS + module->bounds.start_address - EXTERNAL_FLASH_OTA_XIP_ADDRESS;
+            size_t slotSize = moduleSize + 4 /* CRC-32 */;
             if (info.flags & MODULE_INFO_FLAG_COMPRESSED) {
+#if HAL_PLATFORM_COMPRESSED_OTA
+                if (getInflatedModule(module, &info, &otaAddr, &slotSize)) {
+                    // The module has been decompressed during the transfer
+                    LOG(INFO, "Using decompressed module");
+                } else {
+                    slotFlags |= MODULE_COMPRESSED;
+                }
+#else
                 slotFlags |= MODULE_COMPRESSED;
+#endif
             }
-            // Convert the module's XIP address to an address in the external flash :sweat_smile:
-            const uintptr_t otaAddr = EXTERNAL_FLASH_OTA_ADDRESS + module->bounds.start_address - EXTERNAL_FLASH_OTA_XIP_ADDRESS;
             const bool ok = FLASH_AddToNextAvailableModulesSlot(FLASH_SERIAL, otaAddr, FLASH_INTERNAL,
-                    (uint32_t)info.module_start_address, moduleSize + 4 /* CRC-32 */, moduleFunc, slotFlags);
+                    (uint32_t)info.module_start_address, slotSize, moduleFunc, slotFlags);
             if (!ok) {
                 SYSTEM_ERROR_MESSAGE("No module slot available");
                 result = SYSTEM_ERROR_NO_MEMORY;
@@ -646,9 +740,19 @@ __attribute__((optimize("O0"))) int HAL_FLASH_End(void* reserved)
             restartPending = true;
         }
     }
+#if HAL_PLATFORM_COMPRESSED_OTA
+    g_inflateStream.destroy();
+#endif
     return restartPending ? HAL_UPDATE_APPLIED_PENDING_RESTART : HAL_UPDATE_APPLIED;
 }
 
+#if HAL_PLATFORM_COMPRESSED_OTA
+void HAL_FLASH_Cancel(void* reserved)
+{
+    g_inflateStream.destroy();
+}
+#endif // HAL_PLATFORM_COMPRESSED_OTA
+
 // Todo this code and much of the code here is duplicated between Gen2 and Gen3
 // This should be factored out into directory shared by both platforms.
 int HAL_FLASH_ApplyPendingUpdate(bool dryRun, void* reserved)
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ota_inflate_stream.h"
+
+#if HAL_PLATFORM_COMPRESSED_OTA
+
+#include "system_error.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace particle {
+
+OtaInflateStream::OtaInflateStream() :
+        header_(),
+        outBuf_(),
+        storage_(nullptr),
+        inflate_(nullptr),
+        maxOutputSize_(0),
+        origSize_(0),
+        dataOffs_(0),
+        dataEnd_(0),
+        inOffs_(0),
+        outBufSize_(0),
+        outOffs_(0),
+        erasedSize_(0),
+        maxWindowBits_(0),
+        error_(SYSTEM_ERROR_INVALID_STATE),
+        done_(false) {
+}
+
+OtaInflateStream::~OtaInflateStream() {
+    destroy();
+}
+
+int OtaInflateStream::init(OtaInflateStorage* storage, size_t maxOutputSize, unsigned maxWindowBits) {
+    destroy();
+    CHECK_TRUE(storage, SYSTEM_ERROR_INVALID_ARGUMENT);
+    storage_ = storage;
+    maxOutputSize_ = maxOutputSize;
+    maxWindowBits_ = maxWindowBits;
+    origSize_ = 0;
+    dataOffs_ = 0;
+    dataEnd_ = 0;
+    inOffs_ = 0;
+    outBufSize_ = 0;
+    outOffs_ = 0;
+    erasedSize_ = 0;
+    error_ = 0;
+    done_ = false;
+    return 0;
+}
+
+void OtaInflateStream::destroy() {
+    inflate_destroy(inflate_);
+    inflate_ = nullptr;
+    storage_ = nullptr;
+    error_ = SYSTEM_ERROR_INVALID_STATE;
+    done_ = false;
+}
+
+int OtaInflateStream::process(const char* data, size_t size, size_t offset) {
+    if (error_ < 0) {
+        return error_;
+    }
+    if (offset != inOffs_) {
+        // The data is not received sequentially
+        return fail(SYSTEM_ERROR_INVALID_STATE);
+    }
+    while (size > 0) {
+        size_t n = 0;
+        if (inOffs_ < HEADER_SIZE) {
+            n = std::min(size, HEADER_SIZE - inOffs_);
+            memcpy(header_ + inOffs_, data, n);
+            if (inOffs_ + n == HEADER_SIZE) {
+                const int r = parseHeader();
+                if (r < 0) {
+                    return fail(r);
+                }
+            }
+        } else if (inOffs_ < dataOffs_) {
+            // Skip the rest of the compressed data header
+            n = std::min(size, dataOffs_ - inOffs_);
+        } else if (done_ || inOffs_ >= dataEnd_) {
+            // Skip the module suffix and CRC
+            n = size;
+        } else {
+            n = std::min(size, dataEnd_ - inOffs_);
+            const int r = decompress(data, n);
+            if (r < 0) {
+                return fail(r);
+            }
+        }
+        data += n;
+        size -= n;
+        inOffs_ += n;
+    }
+    return 0;
+}
+
+int OtaInflateStream::parseHeader() {
+    module_info_t info = {};
+    memcpy(&info, header_, sizeof(info));
+    if (!(info.flags & MODULE_INFO_FLAG_COMPRESSED) || (info.flags & MODULE_INFO_FLAG_COMBINED)) {
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    compressed_module_header header = {};
+    memcpy(&header, header_ + sizeof(info), sizeof(header));
+    if (header.method != 0) { // Raw Deflate
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    const unsigned windowBits = header.window_bits ? header.window_bits : INFLATE_MAX_WINDOW_BITS;
+    if (windowBits > maxWindowBits_) {
+        return SYSTEM_ERROR_NOT_SUPPORTED;
+    }
+    if (header.size < sizeof(header)) {
+        return SYSTEM_ERROR_BAD_DATA;
+    }
+    // The module suffix is at least as large as module_info_suffix_t. Feeding the decompressor
+    // with any data past the end of the compressed stream would be an error
+    const size_t moduleSize = (uintptr_t)info.module_end_address - (uintptr_t)info.module_start_address;
+    dataOffs_ = sizeof(info) + header.size;
+    if (moduleSize < dataOffs_ + sizeof(module_info_suffix_t)) {
+        return SYSTEM_ERROR_BAD_DATA;
+    }
+    dataEnd_ = moduleSize - sizeof(module_info_suffix_t);
+    if (!header.original_size || header.original_size > maxOutputSize_) {
+        return SYSTEM_ERROR_TOO_LARGE;
+    }
+    origSize_ = header.original_size;
+    inflate_opts opts = {};
+    opts.window_bits = windowBits;
+    CHECK(inflate_create(&inflate_, &opts, outputCallback, this));
+    return 0;
+}
+
+int OtaInflateStream::decompress(const char* data, size_t size) {
+    size_t offs = 0;
+    int r = 0;
+    do {
+        size_t n = size - offs;
+        r = CHECK(inflate_input(inflate_, data + offs, &n, INFLATE_HAS_MORE_INPUT));
+        offs += n;
+        if (r == INFLATE_DONE) {
+            CHECK(flush());
+            if (outOffs_ != origSize_) {
+                return SYSTEM_ERROR_BAD_DATA;
+            }
+            // The decompressor is no longer needed
+            inflate_destroy(inflate_);
+            inflate_ = nullptr;
+            done_ = true;
+            break;
+        }
+    } while (offs < size || r == INFLATE_HAS_MORE_OUTPUT);
+    return 0;
+}
+
+int OtaInflateStream::flush() {
+    if (!outBufSize_) {
+        return 0;
+    }
+    CHECK(write(outBuf_, outBufSize_));
+    outBufSize_ = 0;
+    return 0;
+}
+
+int OtaInflateStream::write(const uint8_t* data, size_t size) {
+    if (outOffs_ + size > origSize_) {
+        return SYSTEM_ERROR_TOO_LARGE;
+    }
+    while (outOffs_ + size > erasedSize_) {
+        CHECK(storage_->erase(erasedSize_, SECTOR_SIZE));
+        erasedSize_ += SECTOR_SIZE;
+    }
+    CHECK(storage_->write(outOffs_, data, size));
+    outOffs_ += size;
+    return 0;
+}
+
+int OtaInflateStream::fail(int error) {
+    inflate_destroy(inflate_);
+    inflate_ = nullptr;
+    error_ = error;
+    done_ = false;
+    return error;
+}
+
+int OtaInflateStream::outputCallback(const char* data, size_t size, void* userData) {
+    const auto self = (OtaInflateStream*)userData;
+    if (!self->outBufSize_ && size >= WRITE_BLOCK_SIZE) {
+        // The decompressor produces data in large aligned blocks, which can be written as is
+        const size_t n = size / WRITE_BLOCK_SIZE * WRITE_BLOCK_SIZE;
+        CHECK(self->write((const uint8_t*)data, n));
+        return n;
+    }
+    const size_t n = std::min(size, WRITE_BLOCK_SIZE - self->outBufSize_);
+    memcpy(self->outBuf_ + self->outBufSize_, data, n);
+    self->outBufSize_ += n;
+    if (self->outBufSize_ == WRITE_BLOCK_SIZE) {
+        CHECK(self->flush());
+    }
+    return n;
+}
+
+} // namespace particle
+
+#endif // HAL_PLATFORM_COMPRESSED_OTA
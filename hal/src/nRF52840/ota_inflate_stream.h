@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "hal_platform.h"
+
+#if HAL_PLATFORM_COMPRESSED_OTA
+
+#include "inflate.h"
+#include "module_info.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace particle {
+
+/**
+ * Storage for the decompressed module data.
+ */
+class OtaInflateStorage {
+public:
+    virtual ~OtaInflateStorage() = default;
+
+    /**
+     * Erases a region of the storage. The offset and size are multiples of the sector size.
+     *
+     * @return `0` on success, or a negative result code in case of an error.
+     */
+    virtual int erase(size_t offset, size_t size) = 0;
+    /**
+     * Writes data to an erased region of the storage.
+     *
+     * @return `0` on success, or a negative result code in case of an error.
+     */
+    virtual int write(size_t offset, const uint8_t* data, size_t size) = 0;
+};
+
+/**
+ * Decompressor for a compressed firmware module that is being received.
+ *
+ * The data of the compressed module needs to be provided sequentially, as it arrives. The
+ * decompressed module is written to the storage, which is erased one sector at a time ahead of
+ * the output. If the data is received out of order or cannot be decompressed for any other
+ * reason, the stream enters a failed state and ignores the rest of the data, in which case the
+ * module can still be decompressed in full once it's received.
+ */
+class OtaInflateStream {
+public:
+    /**
+     * Size of a storage sector.
+     */
+    static const size_t SECTOR_SIZE = 4096;
+    /**
+     * Size of a block of decompressed data written to the storage.
+     */
+    static const size_t WRITE_BLOCK_SIZE = 256;
+
+    OtaInflateStream();
+    ~OtaInflateStream();
+
+    /**
+     * Prepares the stream for receiving a new module.
+     *
+     * @param storage Storage for the decompressed data.
+     * @param maxOutputSize Maximum size of the decompressed data.
+     * @param maxWindowBits Maximum window size supported, which bounds the amount of memory used
+     *        by the decompressor.
+     * @return `0` on success, or a negative result code in case of an error.
+     */
+    int init(OtaInflateStorage* storage, size_t maxOutputSize, unsigned maxWindowBits = INFLATE_MAX_WINDOW_BITS);
+    /**
+     * Releases the decompressor.
+     */
+    void destroy();
+
+    /**
+     * Processes the next chunk of the compressed module.
+     *
+     * @param data Chunk data.
+     * @param size Chunk size.
+     * @param offset Offset of the chunk in the module.
+     * @return `0` on success, or a negative result code in case of an error.
+     */
+    int process(const char* data, size_t size, size_t offset);
+
+    /**
+     * Returns `true` if the entire module has been decompressed.
+     */
+    bool isDone() const {
+        return done_;
+    }
+
+    /**
+     * Returns `true` if the stream has failed to decompress the module.
+     */
+    bool isFailed() const {
+        return error_ < 0;
+    }
+
+    /**
+     * Returns the size of the decompressed data written to the storage.
+     */
+    size_t outputSize() const {
+        return outOffs_;
+    }
+
+private:
+    static const size_t HEADER_SIZE = sizeof(module_info_t) + sizeof(compressed_module_header);
+
+    uint8_t header_[HEADER_SIZE];
+    uint8_t outBuf_[WRITE_BLOCK_SIZE];
+    OtaInflateStorage* storage_;
+    inflate_ctx* inflate_;
+    size_t maxOutputSize_;
+    size_t origSize_; // Size of the decompressed module
+    size_t dataOffs_; // Offset of the compressed data in the module
+    size_t dataEnd_; // Maximum offset of the end of the compressed data
+    size_t inOffs_; // Number of bytes of the module received
+    size_t outBufSize_;
+    size_t outOffs_; // Number of decompressed bytes written to the storage
+    size_t erasedSize_;
+    unsigned maxWindowBits_;
+    int error_;
+    bool done_;
+
+    int parseHeader();
+    int decompress(const char* data, size_t size);
+    int flush();
+    int write(const uint8_t* data, size_t size);
+    int fail(int error);
+
+    static int outputCallback(const char* data, size_t size, void* userData);
+};
+
+} // namespace particle
+
+#endif // HAL_PLATFORM_COMPRESSED_OTA
@@ -15,6 +15,9 @@
  * License along with this library; if not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "logging.h"
+LOG_SOURCE_CATEGORY("ncp.serial");
+
 #include "serial_stream.h"
 
 #include "concurrent_hal.h"
@@ -27,6 +30,17 @@ namespace {
 const auto SERIAL_STREAM_BUFFER_SIZE_RX = 2048;
 const auto SERIAL_STREAM_BUFFER_SIZE_TX = 2048;
 
+void logStats(hal_usart_interface_t serial) {
+    hal_usart_stats_t stats = {};
+    stats.size = sizeof(stats);
+    if (hal_usart_get_stats(serial, &stats, nullptr) < 0) {
+        return;
+    }
+    LOG(TRACE, "Serial stats: TX %u bytes (%u direct), RX %u bytes, TX overruns %u, RX overruns %u, RX errors %u",
+            (unsigned)stats.tx_bytes, (unsigned)stats.tx_direct_bytes, (unsigned)stats.rx_bytes,
+            (unsigned)stats.tx_overruns, (unsigned)stats.rx_overruns, (unsigned)stats.rx_errors);
+}
+
 } // anonymous
 
 namespace particle {
@@ -63,6 +77,7 @@ SerialStream::SerialStream(hal_usart_interface_t serial, uint32_t baudrate, uint
 }
 
 SerialStream::~SerialStream() {
+    logStats(serial_);
     hal_usart_end(serial_);
 }
 
@@ -105,7 +120,9 @@ int SerialStream::write(const char* data, size_t size) {
     if (size == 0) {
         return 0;
     }
-    auto r = hal_usart_write_buffer(serial_, data, size, sizeof(char));
+    // Large writes, such as PPP frames, are sent directly from the caller's buffer if possible
+    const hal_usart_iovec_t iov = { .data = data, .size = size };
+    auto r = hal_usart_write_iov(serial_, &iov, 1, HAL_USART_WRITE_FLAG_ZERO_COPY, nullptr);
     if (r == SYSTEM_ERROR_NO_MEMORY) {
         return 0;
     }
@@ -181,6 +198,7 @@ int SerialStream::on(bool on) {
         phyOn_ = true;
     } else {
         CHECK_TRUE(phyOn_, SYSTEM_ERROR_NONE);
+        logStats(serial_);
         hal_usart_end(serial_);
         phyOn_ = false;
     }
@@ -34,7 +34,10 @@
 #define DEFAULT_SPI_CLOCK       SPI_CLOCK_DIV256
 #define SPI_SYSTEM_CLOCK        (64000000UL)
 
-#define SPI_BUFFER_LENGTH       32
+// EasyDMA can't read data from flash, so such data is copied to a pair of bounce buffers: one
+// buffer is being transferred while the other one is filled with the next chunk of data
+#define SPI_BOUNCE_BUFFER_LENGTH    64
+#define SPI_MAX_DMA_LENGTH          0xffff
 
 typedef struct nrf5x_spi_info_t {
     const nrfx_spim_t*                  master;
@@ -55,18 +58,24 @@ typedef struct nrf5x_spi_info_t {
     uint8_t*                            slave_rx_buf;
     uint32_t                            slave_buf_length;
     bool                                slave_tx_buf_heap;
-    const uint8_t*                      master_tx_data;
-    uint32_t                            master_tx_data_length;
-    uint32_t                            master_tx_data_index;
-    uint8_t*                            master_tx_buf;
-    uint8_t*                            master_rx_buf;
+
+    hal_spi_transaction_t*              queue_head;
+    hal_spi_transaction_t*              queue_tail;
+    hal_spi_transaction_t*              current;
+    uint32_t                            chunk_offset;
+    uint32_t                            chunk_length;
+    uint8_t                             bounce_index;
+    bool                                settings_changed;
+
+    hal_spi_transaction_t               dma_transaction;
+    volatile bool                       dma_transfer_pending;
 
     hal_spi_dma_user_callback           dma_user_callback;
     hal_spi_select_user_callback        select_user_callback;
 
     volatile hal_spi_state_t            state;
     volatile bool                       transmitting;
-    volatile uint16_t                   transfer_length;
+    volatile uint32_t                   transfer_length;
 
     os_mutex_recursive_t                mutex;
 } nrf5x_spi_info_t;
@@ -84,60 +93,190 @@ static nrf5x_spi_info_t spiMap[HAL_PLATFORM_SPI_NUM] = {
 #endif
 };
 
+static uint8_t spiBounceBuf[HAL_PLATFORM_SPI_NUM][2][SPI_BOUNCE_BUFFER_LENGTH] __attribute__((aligned(4)));
+
+static const nrf_spim_mode_t nrf_spim_mode[4] = {NRF_SPIM_MODE_0, NRF_SPIM_MODE_1, NRF_SPIM_MODE_2, NRF_SPIM_MODE_3};
+
 static uint32_t spiTransfer(hal_spi_interface_t spi, uint8_t *tx_buf, uint8_t *rx_buf, uint32_t size);
+static inline nrf_spim_frequency_t getNrfSpiFrequency(hal_spi_interface_t spi, uint8_t clock_div);
 
 /*
  * We could potentially use ISRTaskQueue::Task and system_pool_alloc() in ISR to free these memory
  * asychronously in the system thread.
  */
 static void freeMemoryIfNecessary(hal_spi_interface_t spi) {
-    if (spiMap[spi].master_tx_buf) {
-        free(spiMap[spi].master_tx_buf);
-        spiMap[spi].master_tx_buf = nullptr;
-    }
     if (spiMap[spi].slave_tx_buf_heap && spiMap[spi].slave_tx_buf) {
         free(spiMap[spi].slave_tx_buf);
         spiMap[spi].slave_tx_buf = nullptr;
     }
 }
 
-static bool spiMasterTransferChunk(hal_spi_interface_t spi) {
-    if (!spiMap[spi].master_tx_data || !spiMap[spi].master_tx_buf) {
-        return false;
+static void spiApplySettings(hal_spi_interface_t spi, uint8_t clock, uint8_t order, uint8_t mode) {
+    // The peripheral doesn't need to be reinitialized to change these settings between transfers
+    NRF_SPIM_Type* const reg = spiMap[spi].master->p_reg;
+    nrf_spim_frequency_set(reg, getNrfSpiFrequency(spi, clock));
+    nrf_spim_configure(reg, nrf_spim_mode[mode & 0x03], (order == MSBFIRST) ? NRF_SPIM_BIT_ORDER_MSB_FIRST : NRF_SPIM_BIT_ORDER_LSB_FIRST);
+}
+
+static void spiRestoreSettings(hal_spi_interface_t spi) {
+    if (spiMap[spi].settings_changed) {
+        spiApplySettings(spi, spiMap[spi].clock, spiMap[spi].bit_order, spiMap[spi].data_mode);
+        spiMap[spi].settings_changed = false;
     }
-    if (spiMap[spi].master_tx_data_index >= spiMap[spi].master_tx_data_length) {
-        return false;
+}
+
+static inline bool spiUsesBounceBuffer(const hal_spi_transaction_t* trans) {
+    return trans->tx_buffer && !nrfx_is_in_ram(trans->tx_buffer);
+}
+
+static void spiFillBounceBuffer(hal_spi_interface_t spi, const hal_spi_transaction_t* trans, uint32_t offset) {
+    if (offset < trans->length) {
+        const uint32_t size = std::min(trans->length - offset, (uint32_t)SPI_BOUNCE_BUFFER_LENGTH);
+        memcpy(spiBounceBuf[spi][spiMap[spi].bounce_index], (const uint8_t*)trans->tx_buffer + offset, size);
     }
-    spiMap[spi].transmitting = true; // Just in case
-    uint32_t chunkSize = std::min(spiMap[spi].master_tx_data_length - spiMap[spi].master_tx_data_index, (uint32_t)SPI_BUFFER_LENGTH);
-    uint32_t index = spiMap[spi].master_tx_data_index;
-    memcpy(spiMap[spi].master_tx_buf, &spiMap[spi].master_tx_data[index], chunkSize);
-    uint8_t* rxPtr = spiMap[spi].master_rx_buf ? &spiMap[spi].master_rx_buf[index] : nullptr;
-    SPARK_ASSERT(spiTransfer(spi, spiMap[spi].master_tx_buf, rxPtr, chunkSize) == chunkSize);
-    spiMap[spi].master_tx_data_index += chunkSize;
-    spiMap[spi].transfer_length += chunkSize;
-    return true;
 }
 
-static void spiMasterEventHandler(nrfx_spim_evt_t const * p_event, void * p_context) {
-    if (p_event->type == NRFX_SPIM_EVENT_DONE) {
-        // LOG_DEBUG(TRACE, ">> spi: rx: %d, tx: %d", p_event->xfer_desc.tx_length, p_event->xfer_desc.rx_length);
-        int spi = (int)p_context;
+static void spiTransferChunk(hal_spi_interface_t spi) {
+    const auto trans = spiMap[spi].current;
+    const uint32_t offset = spiMap[spi].chunk_offset;
+    const bool bounce = spiUsesBounceBuffer(trans);
+    const uint32_t size = std::min(trans->length - offset, bounce ? (uint32_t)SPI_BOUNCE_BUFFER_LENGTH : (uint32_t)SPI_MAX_DMA_LENGTH);
+    uint8_t* txBuf = nullptr;
+    if (trans->tx_buffer) {
+        txBuf = bounce ? spiBounceBuf[spi][spiMap[spi].bounce_index] : (uint8_t*)trans->tx_buffer + offset;
+    }
+    uint8_t* rxBuf = trans->rx_buffer ? (uint8_t*)trans->rx_buffer + offset : nullptr;
+    spiMap[spi].chunk_length = size;
+    SPARK_ASSERT(spiTransfer(spi, txBuf, rxBuf, size) == size);
+    if (bounce) {
+        // Prepare the next chunk while this one is being transferred
+        spiMap[spi].bounce_index ^= 1;
+        spiFillBounceBuffer(spi, trans, offset + size);
+    }
+}
 
-        if (spiMasterTransferChunk((hal_spi_interface_t)spi)) {
-            return;
+static void spiStartTransaction(hal_spi_interface_t spi, hal_spi_transaction_t* trans) {
+    if (trans->flags & HAL_SPI_TRANSACTION_FLAG_DEFAULT_SETTINGS) {
+        spiApplySettings(spi, DEFAULT_SPI_CLOCK, DEFAULT_BIT_ORDER, DEFAULT_DATA_MODE);
+        spiMap[spi].settings_changed = true;
+    } else if (trans->flags & HAL_SPI_TRANSACTION_FLAG_SETTINGS) {
+        spiApplySettings(spi, trans->clock_div, trans->bit_order, trans->data_mode);
+        spiMap[spi].settings_changed = true;
+    } else {
+        spiRestoreSettings(spi);
+    }
+    if (HAL_Pin_Is_Valid(trans->cs_pin)) {
+        HAL_GPIO_Write(trans->cs_pin, 0);
+    }
+    spiMap[spi].current = trans;
+    spiMap[spi].chunk_offset = 0;
+    if (spiUsesBounceBuffer(trans)) {
+        spiMap[spi].bounce_index = 0;
+        spiFillBounceBuffer(spi, trans, 0);
+    }
+    spiTransferChunk(spi);
+}
+
+// Must be called with interrupts disabled
+static void spiStartQueuedTransactions(hal_spi_interface_t spi) {
+    if (!spiMap[spi].transmitting && spiMap[spi].queue_head) {
+        spiMap[spi].transmitting = true;
+        spiStartTransaction(spi, spiMap[spi].queue_head);
+    }
+}
+
+static void spiCompleteTransaction(hal_spi_interface_t spi) {
+    // Transactions can be queued from a higher priority interrupt
+    int32_t state = HAL_disable_irq();
+    const auto trans = spiMap[spi].current;
+    const auto next = trans->next;
+    const bool keepSelected = (trans->flags & HAL_SPI_TRANSACTION_FLAG_KEEP_SELECTED) && next && next->cs_pin == trans->cs_pin;
+    if (HAL_Pin_Is_Valid(trans->cs_pin) && !keepSelected) {
+        HAL_GPIO_Write(trans->cs_pin, 1);
+    }
+    spiMap[spi].current = nullptr;
+    spiMap[spi].queue_head = next;
+    if (next) {
+        // Start the next transaction before notifying the application to avoid gaps on the bus
+        spiStartTransaction(spi, next);
+    } else {
+        spiMap[spi].queue_tail = nullptr;
+        spiRestoreSettings(spi);
+        spiMap[spi].transmitting = false;
+    }
+    HAL_enable_irq(state);
+    if (trans->callback) {
+        trans->callback(SYSTEM_ERROR_NONE, trans->context);
+    }
+}
+
+static void spiEnqueueTransactions(hal_spi_interface_t spi, hal_spi_transaction_t* first, hal_spi_transaction_t* last) {
+    int32_t state = HAL_disable_irq();
+    if (spiMap[spi].queue_tail) {
+        spiMap[spi].queue_tail->next = first;
+    } else {
+        spiMap[spi].queue_head = first;
+    }
+    spiMap[spi].queue_tail = last;
+    spiStartQueuedTransactions(spi);
+    HAL_enable_irq(state);
+}
+
+static void spiCancelTransactions(hal_spi_interface_t spi) {
+    int32_t state = HAL_disable_irq();
+    auto trans = spiMap[spi].queue_head;
+    const auto current = spiMap[spi].current;
+    if (current) {
+        nrfx_spim_abort(spiMap[spi].master);
+        if (HAL_Pin_Is_Valid(current->cs_pin)) {
+            HAL_GPIO_Write(current->cs_pin, 1);
         }
-        spiMap[spi].master_tx_data = nullptr;
-        spiMap[spi].master_rx_buf = nullptr;
-        spiMap[spi].master_tx_data_length = 0;
-        spiMap[spi].master_tx_data_index = 0;
+        spiMap[spi].current = nullptr;
         spiMap[spi].transmitting = false;
+    }
+    spiMap[spi].queue_head = nullptr;
+    spiMap[spi].queue_tail = nullptr;
+    spiRestoreSettings(spi);
+    HAL_enable_irq(state);
+    while (trans) {
+        const auto next = trans->next;
+        if (trans->callback) {
+            trans->callback(SYSTEM_ERROR_CANCELLED, trans->context);
+        }
+        trans = next;
+    }
+}
+
+static void spiDmaTransactionDone(int result, void* context) {
+    int spi = (int)context;
+    spiMap[spi].dma_transfer_pending = false;
+    if (result == SYSTEM_ERROR_NONE) {
+        spiMap[spi].transfer_length = spiMap[spi].dma_transaction.length;
         if (spiMap[spi].dma_user_callback) {
             (*spiMap[spi].dma_user_callback)();
         }
     }
 }
 
+static void spiMasterEventHandler(nrfx_spim_evt_t const * p_event, void * p_context) {
+    if (p_event->type == NRFX_SPIM_EVENT_DONE) {
+        // LOG_DEBUG(TRACE, ">> spi: rx: %d, tx: %d", p_event->xfer_desc.tx_length, p_event->xfer_desc.rx_length);
+        auto spi = (hal_spi_interface_t)(int)p_context;
+        const auto trans = spiMap[spi].current;
+        if (!trans) {
+            // Single byte transfer, see hal_spi_transfer()
+            spiMap[spi].transmitting = false;
+            return;
+        }
+        spiMap[spi].chunk_offset += spiMap[spi].chunk_length;
+        if (spiMap[spi].chunk_offset < trans->length) {
+            spiTransferChunk(spi);
+            return;
+        }
+        spiCompleteTransaction(spi);
+    }
+}
+
 static void spiSlaveEventHandler(nrfx_spis_evt_t const * p_event, void * p_context) {
     int spi = (int) p_context;
 
@@ -223,7 +362,6 @@ static void spiInit(hal_spi_interface_t spi, hal_spi_mode_t mode) {
     uint32_t err_code;
 
     if (mode == SPI_MODE_MASTER) {
-        static const nrf_spim_mode_t nrf_spim_mode[4] = {NRF_SPIM_MODE_0, NRF_SPIM_MODE_1, NRF_SPIM_MODE_2, NRF_SPIM_MODE_3};
         nrfx_spim_config_t spim_config = NRFX_SPIM_DEFAULT_CONFIG;
         spim_config.sck_pin      = getNrfPinNum(spiMap[spi].sck_pin);
         spim_config.mosi_pin     = getNrfPinNum(spiMap[spi].mosi_pin);
@@ -237,6 +375,7 @@ static void spiInit(hal_spi_interface_t spi, hal_spi_mode_t mode) {
 
         err_code = nrfx_spim_init(spiMap[spi].master, &spim_config, spiMasterEventHandler, (void *)((int)spi));
         SPARK_ASSERT(err_code == NRF_SUCCESS);
+        spiMap[spi].settings_changed = false;
 
         if (HAL_Pin_Is_Valid(spiMap[spi].ss_pin)) {
             hal_gpio_config_t conf = {
@@ -294,6 +433,32 @@ static void spiUninit(hal_spi_interface_t spi) {
     HAL_Set_Pin_Function(spiMap[spi].miso_pin, PF_NONE);
 }
 
+// Applies the current settings to an enabled peripheral
+static void spiUpdateSettings(hal_spi_interface_t spi) {
+    if (spiMap[spi].spi_mode == SPI_MODE_SLAVE) {
+        spiUninit(spi);
+        spiInit(spi, spiMap[spi].spi_mode);
+        return;
+    }
+    // Wait for the queued transactions to complete and claim the bus so that no transaction is
+    // started while the settings are being changed
+    for (;;) {
+        int32_t state = HAL_disable_irq();
+        if (!spiMap[spi].transmitting && !spiMap[spi].queue_head) {
+            spiMap[spi].transmitting = true;
+            HAL_enable_irq(state);
+            break;
+        }
+        HAL_enable_irq(state);
+    }
+    spiApplySettings(spi, spiMap[spi].clock, spiMap[spi].bit_order, spiMap[spi].data_mode);
+    spiMap[spi].settings_changed = false;
+    int32_t state = HAL_disable_irq();
+    spiMap[spi].transmitting = false;
+    spiStartQueuedTransactions(spi);
+    HAL_enable_irq(state);
+}
+
 static uint32_t spiTransfer(hal_spi_interface_t spi, uint8_t *tx_buf, uint8_t *rx_buf, uint32_t size) {
     // LOG_DEBUG(TRACE, "spi send, size: %d", size);
 
@@ -347,11 +512,11 @@ void hal_spi_init(hal_spi_interface_t spi) {
     spiMap[spi].dma_user_callback = nullptr;
     spiMap[spi].select_user_callback = nullptr;
     spiMap[spi].transfer_length = 0;
-    spiMap[spi].master_tx_data = nullptr;
-    spiMap[spi].master_tx_buf = nullptr;
-    spiMap[spi].master_rx_buf = nullptr;
-    spiMap[spi].master_tx_data_length = 0;
-    spiMap[spi].master_tx_data_index = 0;
+    spiMap[spi].queue_head = nullptr;
+    spiMap[spi].queue_tail = nullptr;
+    spiMap[spi].current = nullptr;
+    spiMap[spi].settings_changed = false;
+    spiMap[spi].dma_transfer_pending = false;
     spiMap[spi].slave_tx_buf_heap = false;
 
     hal_spi_release(spi, nullptr);
@@ -374,6 +539,9 @@ void hal_spi_begin_ext(hal_spi_interface_t spi, hal_spi_mode_t mode, uint16_t pi
 
     if (spiMap[spi].state == HAL_SPI_STATE_ENABLED) {
         // Make sure we reset the enabled state
+        if (spiMap[spi].spi_mode == SPI_MODE_MASTER) {
+            spiCancelTransactions(spi);
+        }
         spiUninit(spi);
         spiMap[spi].state = HAL_SPI_STATE_DISABLED;
     }
@@ -404,6 +572,9 @@ void hal_spi_begin_ext(hal_spi_interface_t spi, hal_spi_mode_t mode, uint16_t pi
 
 void hal_spi_end(hal_spi_interface_t spi) {
     if (spiMap[spi].state != HAL_SPI_STATE_DISABLED) {
+        if (spiMap[spi].spi_mode == SPI_MODE_MASTER) {
+            spiCancelTransactions(spi);
+        }
         freeMemoryIfNecessary(spi);
         spiUninit(spi);
         spiMap[spi].state = HAL_SPI_STATE_DISABLED;
@@ -413,16 +584,14 @@ void hal_spi_end(hal_spi_interface_t spi) {
 void hal_spi_set_bit_order(hal_spi_interface_t spi, uint8_t order) {
     spiMap[spi].bit_order = order;
     if (spiMap[spi].state == HAL_SPI_STATE_ENABLED) {
-        spiUninit(spi);
-        spiInit(spi, spiMap[spi].spi_mode);
+        spiUpdateSettings(spi);
     }
 }
 
 void hal_spi_set_data_mode(hal_spi_interface_t spi, uint8_t mode) {
     spiMap[spi].data_mode = mode;
     if (spiMap[spi].state == HAL_SPI_STATE_ENABLED) {
-        spiUninit(spi);
-        spiInit(spi, spiMap[spi].spi_mode);
+        spiUpdateSettings(spi);
     }
 }
 
@@ -430,8 +599,7 @@ void hal_spi_set_clock_divider(hal_spi_interface_t spi, uint8_t rate) {
     // actual speed is the system clock divided by some scalar
     spiMap[spi].clock = rate;
     if (spiMap[spi].state == HAL_SPI_STATE_ENABLED) {
-        spiUninit(spi);
-        spiInit(spi, spiMap[spi].spi_mode);
+        spiUpdateSettings(spi);
     }
 }
 
@@ -447,15 +615,18 @@ uint16_t hal_spi_transfer(hal_spi_interface_t spi, uint16_t data) {
     uint8_t rx_buffer __attribute__((__aligned__(4)));
 
     // Wait for SPI transfer finished
-    while(spiMap[spi].transmitting) {
-        ;
+    for (;;) {
+        int32_t state = HAL_disable_irq();
+        if (!spiMap[spi].transmitting && !spiMap[spi].queue_head) {
+            spiMap[spi].transmitting = true;
+            HAL_enable_irq(state);
+            break;
+        }
+        HAL_enable_irq(state);
     }
 
-    freeMemoryIfNecessary(spi);
-
     tx_buffer = data;
 
-    spiMap[spi].dma_user_callback = nullptr;
     spiMap[spi].transfer_length = spiTransfer(spi, &tx_buffer, &rx_buffer, 1);
 
     // Wait for SPI transfer finished
@@ -463,6 +634,11 @@ uint16_t hal_spi_transfer(hal_spi_interface_t spi, uint16_t data) {
         ;
     }
 
+    // Start the transactions that were queued in the meantime
+    int32_t state = HAL_disable_irq();
+    spiStartQueuedTransactions(spi);
+    HAL_enable_irq(state);
+
     return rx_buffer;
 }
 
@@ -520,32 +696,33 @@ void hal_spi_transfer_dma(hal_spi_interface_t spi, const void* tx_buffer, void*
         return;
     }
 
-    while(spiMap[spi].transmitting) {
-        ;
-    }
-
-    freeMemoryIfNecessary(spi);
-
-    spiMap[spi].dma_user_callback = userCallback;
     if (spiMap[spi].spi_mode == SPI_MODE_MASTER) {
-        if (tx_buffer && !nrfx_is_in_ram(tx_buffer)) {
-            // Truncate the data to reuse an allocated pool.
-            spiMap[spi].master_tx_buf = (uint8_t*)malloc(SPI_BUFFER_LENGTH);
-            if (spiMap[spi].master_tx_buf == nullptr) {
-                return;
-            }
-            spiMap[spi].master_tx_data = (const uint8_t *)tx_buffer;
-            spiMap[spi].master_tx_data_length = length;
-            spiMap[spi].master_tx_data_index = 0;
-            spiMap[spi].master_rx_buf = (uint8_t *)rx_buffer;
-            spiMap[spi].transfer_length = 0;
-            spiMasterTransferChunk(spi);
-        } else {
-            // tx_buffer is nullptr, or tx_buffer is pointing to RAM.
-            SPARK_ASSERT(spiTransfer(spi, (uint8_t*)tx_buffer, (uint8_t *)rx_buffer, length) == length);
-            spiMap[spi].transfer_length = length;
+        // Only the previous DMA transfer needs to complete, other transactions are queued
+        while (spiMap[spi].dma_transfer_pending) {
+            ;
         }
+        spiMap[spi].dma_user_callback = userCallback;
+        hal_spi_transaction_t* trans = &spiMap[spi].dma_transaction;
+        memset(trans, 0, sizeof(hal_spi_transaction_t));
+        trans->size = sizeof(hal_spi_transaction_t);
+        trans->tx_buffer = tx_buffer;
+        trans->rx_buffer = rx_buffer;
+        trans->length = length;
+        trans->cs_pin = PIN_INVALID;
+        trans->callback = spiDmaTransactionDone;
+        trans->context = (void*)((int)spi);
+        spiMap[spi].transfer_length = 0;
+        spiMap[spi].dma_transfer_pending = true;
+        spiEnqueueTransactions(spi, trans, trans);
     } else {
+        while(spiMap[spi].transmitting) {
+            ;
+        }
+
+        freeMemoryIfNecessary(spi);
+
+        spiMap[spi].dma_user_callback = userCallback;
+
         if (tx_buffer && !nrfx_is_in_ram(tx_buffer)) {
             // The allocated memory will be freed on hal_spi_end() or hal_spi_transfer_dma() is called
             spiMap[spi].slave_tx_buf = (uint8_t*)malloc(length);
@@ -585,6 +762,11 @@ void hal_spi_transfer_dma(hal_spi_interface_t spi, const void* tx_buffer, void*
 }
 
 void hal_spi_transfer_dma_cancel(hal_spi_interface_t spi) {
+    if (spiMap[spi].spi_mode == SPI_MODE_MASTER) {
+        spiMap[spi].dma_user_callback = nullptr;
+        spiCancelTransactions(spi);
+        return;
+    }
     if (!spiMap[spi].transmitting) {
         return;
     }
@@ -596,8 +778,9 @@ void hal_spi_transfer_dma_cancel(hal_spi_interface_t spi) {
 
 int32_t hal_spi_transfer_dma_status(hal_spi_interface_t spi, hal_spi_transfer_status_t* st) {
     int32_t transfer_length = 0;
+    const bool ongoing = (spiMap[spi].spi_mode == SPI_MODE_MASTER) ? spiMap[spi].dma_transfer_pending : spiMap[spi].transmitting;
 
-    if (spiMap[spi].transmitting) {
+    if (ongoing) {
         transfer_length = 0;
     } else {
         transfer_length = spiMap[spi].transfer_length;
@@ -607,7 +790,7 @@ int32_t hal_spi_transfer_dma_status(hal_spi_interface_t spi, hal_spi_transfer_st
     if (st != nullptr) {
         st->configured_transfer_length = spiMap[spi].transfer_length;
         st->transfer_length = (uint32_t)transfer_length;
-        st->transfer_ongoing = spiMap[spi].transmitting;
+        st->transfer_ongoing = ongoing;
         st->ss_state = spiMap[spi].spi_ss_state;
     }
 
@@ -626,8 +809,7 @@ int32_t hal_spi_set_settings(hal_spi_interface_t spi, uint8_t set_default, uint8
     }
 
     if (spiMap[spi].state == HAL_SPI_STATE_ENABLED) {
-        spiUninit(spi);
-        spiInit(spi, spiMap[spi].spi_mode);
+        spiUpdateSettings(spi);
     }
 
     return 0;
@@ -675,6 +857,23 @@ int32_t hal_spi_release(hal_spi_interface_t spi, void* reserved) {
     return -1;
 }
 
+int hal_spi_queue_transactions(hal_spi_interface_t spi, hal_spi_transaction_t* trans, void* reserved) {
+    CHECK_TRUE(spi < HAL_PLATFORM_SPI_NUM && trans, SYSTEM_ERROR_INVALID_ARGUMENT);
+    CHECK_TRUE(spiMap[spi].state == HAL_SPI_STATE_ENABLED && spiMap[spi].spi_mode == SPI_MODE_MASTER, SYSTEM_ERROR_INVALID_STATE);
+    hal_spi_transaction_t* last = nullptr;
+    for (auto t = trans; t; t = t->next) {
+        CHECK_TRUE(t->length > 0 && (t->tx_buffer || t->rx_buffer), SYSTEM_ERROR_INVALID_ARGUMENT);
+        CHECK_TRUE(!t->rx_buffer || nrfx_is_in_ram(t->rx_buffer), SYSTEM_ERROR_INVALID_ARGUMENT);
+        if (HAL_Pin_Is_Valid(t->cs_pin) && HAL_Get_Pin_Mode(t->cs_pin) != OUTPUT) {
+            HAL_Pin_Mode(t->cs_pin, OUTPUT);
+            HAL_GPIO_Write(t->cs_pin, 1);
+        }
+        last = t;
+    }
+    spiEnqueueTransactions(spi, trans, last);
+    return SYSTEM_ERROR_NONE;
+}
+
 int hal_spi_get_clock_divider(hal_spi_interface_t spi, uint32_t clock, void* reserved) {
     CHECK_TRUE(clock > 0, SYSTEM_ERROR_INVALID_ARGUMENT);
 
@@ -21,17 +21,22 @@
 #include <nrf_timer.h>
 #include "usart_hal.h"
 #include "ringbuffer.h"
+#include "mpsc_ring_buffer.h"
 #include "pinmap_hal.h"
 #include "check_nrf.h"
 #include "gpio_hal.h"
 #include <nrfx_prs.h>
 #include <nrf_gpio.h>
 #include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include "hal_irq_flag.h"
 #include "delay_hal.h"
 #include "interrupts_hal.h"
 #include "usart_hal_private.h"
 #include "timer_hal.h"
+#include "concurrent_hal.h"
+#include <atomic>
 
 #if PLATFORM_ID == PLATFORM_TRACKER
 #include "i2c_hal.h"
@@ -67,20 +72,6 @@ private:
     NRF_UARTE_Type* uarte_;
 };
 
-class TxLock {
-public:
-    TxLock(NRF_UARTE_Type* uarte)
-            : uarte_(uarte) {
-        nrf_uarte_int_disable(uarte, NRF_UARTE_INT_ENDTX_MASK);
-    }
-    ~TxLock() {
-        nrf_uarte_int_enable(uarte_, NRF_UARTE_INT_ENDTX_MASK);
-    }
-
-private:
-    NRF_UARTE_Type* uarte_;
-};
-
 inline uint32_t pinToNrf(pin_t pin) {
     const auto pinMap = HAL_Pin_Map();
     const auto& entry = pinMap[pin];
@@ -96,6 +87,15 @@ const uint8_t MAX_SCHEDULED_RECEIVALS = 1;
 const size_t RESERVED_RX_SIZE = 0;
 const size_t RX_THRESHOLD = 4;
 
+// Maximum size of a single EasyDMA transfer
+const size_t MAX_TX_TRANSFER_SIZE = 0xffff;
+// Segments smaller than this are always copied into the TX buffer
+const size_t MIN_DIRECT_TX_SIZE = 64;
+// Event group bit signalled when a direct transfer completes
+const EventBits_t DIRECT_TX_DONE_EVENT = 0x80;
+// Added to the expected duration of a direct transfer to get its timeout, in milliseconds
+const system_tick_t DIRECT_TX_TIMEOUT_MARGIN = 100;
+
 class Usart {
 public:
     Usart(NRF_UARTE_Type* instance, void (*interruptHandler)(void),
@@ -111,6 +111,7 @@ public:
               ctsPin_(cts),
               rtsPin_(rts),
               transmitting_(false),
+              directTx_(false),
               receiving_(0),
               rxConsumed_(0),
               evGroup_(nullptr) {
@@ -213,7 +214,7 @@ public:
 
         disableInterrupts();
 
-        nrf_uarte_int_enable(uarte_, NRF_UARTE_INT_ENDRX_MASK | NRF_UARTE_INT_ENDTX_MASK);
+        nrf_uarte_int_enable(uarte_, NRF_UARTE_INT_ENDRX_MASK | NRF_UARTE_INT_ENDTX_MASK | NRF_UARTE_INT_ERROR_MASK);
 
         NRFX_IRQ_PRIORITY_SET(nrfx_get_irq_number((void *)uarte_), prio_);
         NRFX_IRQ_ENABLE(nrfx_get_irq_number((void *)uarte_));
@@ -296,7 +297,6 @@ public:
 
     ssize_t space() {
         CHECK_TRUE(isEnabled(), SYSTEM_ERROR_INVALID_STATE);
-        TxLock lk(uarte_);
         return txBuffer_.space();
     }
 
@@ -322,36 +322,100 @@ public:
         return rxBuffer_.peek(buffer, peekSize);
     }
 
-    ssize_t write(const uint8_t* buffer, size_t size) {
+    ssize_t write(const hal_usart_iovec_t* iov, size_t count, unsigned flags) {
         CHECK_TRUE(isEnabled(), SYSTEM_ERROR_INVALID_STATE);
-        const ssize_t canWrite = CHECK(space());
-        const size_t writeSize = std::min((size_t)canWrite, size);
-        CHECK_TRUE(writeSize > 0, SYSTEM_ERROR_NO_MEMORY);
-        ssize_t r;
-        {
-            TxLock lk(uarte_);
-            r = CHECK(txBuffer_.put(buffer, writeSize));
-        }
-        // Start transmission
-        startTransmission();
-        return r;
+        CHECK_TRUE(iov || !count, SYSTEM_ERROR_INVALID_ARGUMENT);
+        size_t written = 0;
+        if (flags & HAL_USART_WRITE_FLAG_ZERO_COPY) {
+            // Leading segments can be sent directly from the caller's buffer while the TX buffer
+            // is empty. The remaining ones are copied to preserve the order of the data
+            for (; count > 0; ++iov, --count) {
+                const ssize_t n = writeDirect(iov->data, iov->size);
+                if (n < 0) {
+                    CHECK_TRUE(written > 0, n);
+                    return written;
+                }
+                if (!n) {
+                    break;
+                }
+                written += n;
+                if ((size_t)n < iov->size) {
+                    // The transfer timed out
+                    return written;
+                }
+            }
+        }
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            CHECK_TRUE(iov[i].data || !iov[i].size, SYSTEM_ERROR_INVALID_ARGUMENT);
+            total += iov[i].size;
+        }
+        if (!total) {
+            return written;
+        }
+        // Reserve space for all segments at once so that the data isn't interleaved with the data
+        // of other writers
+        particle::services::MpscRingBuffer::Reservation r = {};
+        const size_t n = txBuffer_.reserve(1, total, &r);
+        if (n < total) {
+            ++txOverruns_;
+        }
+        if (!n) {
+            CHECK_TRUE(written > 0, SYSTEM_ERROR_NO_MEMORY);
+            return written;
+        }
+        size_t offs = 0;
+        for (; offs < n; ++iov) {
+            const size_t size = std::min(iov->size, n - offs);
+            txBuffer_.write(r, offs, (const uint8_t*)iov->data, size);
+            offs += size;
+        }
+        if (txBuffer_.commit()) {
+            startTransmission();
+        }
+        return written + n;
     }
 
     ssize_t flush() {
-        while (true) {
-            while (transmitting_) {
-                // FIXME: busy loop
-            }
-            {
-                TxLock lk(uarte_);
-                if (!isEnabled() || txBuffer_.empty()) {
-                    break;
-                }
+        while (isEnabled() && (transmitting_ || !txBuffer_.empty())) {
+            // FIXME: busy loop
+            if (txHeldBack() && !waitForWriters()) {
+                break;
             }
         }
         return 0;
     }
 
+    // Returns true if the TX buffer can't be drained further until a writer that was preempted
+    // between reserving and committing its data resumes
+    bool txHeldBack() {
+        return !transmitting_ && !txBuffer_.consumable() && txBuffer_.pending();
+    }
+
+    // Lets a preempted writer commit its data. Returns false if the caller can't block
+    bool waitForWriters() {
+        if (!canBlock()) {
+            return false;
+        }
+        // Unlike yielding, a delay lets lower priority threads run as well
+        HAL_Delay_Milliseconds(1);
+        return true;
+    }
+
+    void getStats(hal_usart_stats_t* stats) const {
+        hal_usart_stats_t s = {};
+        s.version = HAL_USART_STATS_VERSION;
+        s.tx_bytes = txBytes_;
+        s.rx_bytes = rxBytes_;
+        s.tx_overruns = txOverruns_;
+        s.rx_overruns = rxOverruns_;
+        s.rx_errors = rxErrors_;
+        s.tx_direct_bytes = txDirectBytes_;
+        // Copy only as much as the caller's structure can hold and report how much was filled
+        s.size = std::min((size_t)stats->size, sizeof(hal_usart_stats_t));
+        memcpy(stats, &s, s.size);
+    }
+
     bool isConfigured() const {
         return configured_;
     }
@@ -404,26 +468,43 @@ public:
                 if (rxBuffer_.acquirePending() > 0) {
                     rxBuffer_.acquireCommit(rxBuffer_.acquirePending());
                 }
+                rxBytes_ += nrf_uarte_rx_amount_get(uarte_);
 
                 --receiving_;
                 startReceiver();
             }
         }
 
-        // IMPORTANT: we cannot process ENDTX event if we are under the TX lock (ENDTX interrupt is disabled)
         if (nrf_uarte_int_enable_check(uarte_, NRF_UARTE_INT_ENDTX_MASK)) {
             if (nrf_uarte_event_check(uarte_, NRF_UARTE_EVENT_ENDTX)) {
                 nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_ENDTX);
                 nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_TXDRDY);
-                txBuffer_.consumeCommit(nrf_uarte_tx_amount_get(uarte_));
+                const size_t amount = nrf_uarte_tx_amount_get(uarte_);
+                txBytes_ += amount;
+                if (directTx_) {
+                    directTx_ = false;
+                    txDirectBytes_ += amount;
+                    BaseType_t yieldTx = pdFALSE;
+                    if (xEventGroupSetBitsFromISR(evGroup_, DIRECT_TX_DONE_EVENT, &yieldTx) != pdFAIL) {
+                        eventGenerated = true;
+                    }
+                    yield = yield || yieldTx;
+                } else {
+                    txBuffer_.consumeCommit(amount);
+                }
                 transmitting_ = false;
                 startTransmission();
             }
         }
         if (nrf_uarte_event_check(uarte_, NRF_UARTE_EVENT_ERROR)) {
             nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_ERROR);
-            uint32_t uartErrorSource = nrf_uarte_errorsrc_get_and_clear(uarte_);
-            (void)uartErrorSource;
+            const uint32_t uartErrorSource = nrf_uarte_errorsrc_get_and_clear(uarte_);
+            if (uartErrorSource & NRF_UARTE_ERROR_OVERRUN_MASK) {
+                ++rxOverruns_;
+            }
+            if (uartErrorSource & (NRF_UARTE_ERROR_PARITY_MASK | NRF_UARTE_ERROR_FRAMING_MASK | NRF_UARTE_ERROR_BREAK_MASK)) {
+                ++rxErrors_;
+            }
         }
 
         if (eventGenerated) {
@@ -526,20 +607,101 @@ private:
         return SYSTEM_ERROR_NONE;
     }
 
+    // Whoever changes `transmitting_` from false to true owns the transmitter and is the only one
+    // allowed to consume data from the TX buffer until the transfer completes
+    bool acquireTransmitter() {
+        bool expected = false;
+        return transmitting_.compare_exchange_strong(expected, true);
+    }
+
+    void startTransfer(const uint8_t* data, size_t size) {
+        nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_TXDRDY);
+        nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_ENDTX);
+        nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_TXSTOPPED);
+        nrf_uarte_tx_buffer_set(uarte_, data, size);
+        nrf_uarte_task_trigger(uarte_, NRF_UARTE_TASK_STARTTX);
+    }
+
     void startTransmission() {
-        size_t consumable;
-        if (!transmitting_ && (consumable = txBuffer_.consumable())) {
-            transmitting_ = true;
-            auto ptr = txBuffer_.consume(consumable);
-#ifdef DEBUG_BUILD
-            SPARK_ASSERT(ptr);
-#endif // DEBUG_BUILD
-            nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_TXDRDY);
-            nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_ENDTX);
-            nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_TXSTOPPED);
-            nrf_uarte_tx_buffer_set(uarte_, ptr, consumable);
-            nrf_uarte_task_trigger(uarte_, NRF_UARTE_TASK_STARTTX);
+        while (acquireTransmitter()) {
+            size_t size = 0;
+            auto ptr = txBuffer_.consume(&size);
+            if (size > 0) {
+                startTransfer(ptr, std::min(size, MAX_TX_TRANSFER_SIZE));
+                break;
+            }
+            transmitting_ = false;
+            // Some data might have been committed after the TX buffer was checked by this
+            // function but before the transmitter was released
+            if (!txBuffer_.consumable()) {
+                break;
+            }
+        }
+    }
+
+    // Returns true if the caller is a thread that can block
+    bool canBlock() const {
+        return !HAL_IsISR() && willPreempt() && os_scheduler_get_state(nullptr) == OS_SCHEDULER_STATE_RUNNING;
+    }
+
+    // Transmits a segment directly from the caller's buffer if the transmitter is idle. Blocks
+    // until the segment is sent or the transfer times out. Returns the number of bytes sent, or 0
+    // if the segment needs to be copied into the TX buffer
+    ssize_t writeDirect(const void* data, size_t size) {
+        if (size < MIN_DIRECT_TX_SIZE || size > MAX_TX_TRANSFER_SIZE || !nrfx_is_in_ram(data)) {
+            return 0;
+        }
+        if (!canBlock()) {
+            return 0;
+        }
+        if (!txBuffer_.empty() || !acquireTransmitter()) {
+            return 0;
+        }
+        if (!txBuffer_.empty()) {
+            // Another writer got ahead of us
+            transmitting_ = false;
+            startTransmission();
+            return 0;
+        }
+        xEventGroupClearBits(evGroup_, DIRECT_TX_DONE_EVENT);
+        directTx_ = true;
+        startTransfer((const uint8_t*)data, size);
+        // Allow for twice the time it takes to send the data, as the receiver may hold CTS
+        // deasserted for a while
+        const system_tick_t timeout = size * 10 * 1000 / config_.baudRate * 2 + DIRECT_TX_TIMEOUT_MARGIN;
+        const EventBits_t bits = xEventGroupWaitBits(evGroup_, DIRECT_TX_DONE_EVENT, pdTRUE, pdFALSE,
+                timeout / portTICK_PERIOD_MS);
+        if (!(bits & DIRECT_TX_DONE_EVENT)) {
+            return abortDirectTransfer(size);
         }
+        // hal_usart_end() wakes up the writer as well
+        CHECK_TRUE(isEnabled(), SYSTEM_ERROR_INVALID_STATE);
+        return size;
+    }
+
+    // Stops a direct transfer that didn't complete in time. Returns the number of bytes sent
+    ssize_t abortDirectTransfer(size_t size) {
+        AtomicSection lk;
+        if (!directTx_) {
+            // The transfer completed or was stopped by hal_usart_end() after the wait timed out
+            CHECK_TRUE(isEnabled(), SYSTEM_ERROR_INVALID_STATE);
+            return size;
+        }
+        nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_TXSTOPPED);
+        nrf_uarte_task_trigger(uarte_, NRF_UARTE_TASK_STOPTX);
+        while (!nrf_uarte_event_check(uarte_, NRF_UARTE_EVENT_TXSTOPPED));
+        // Stopping the transmitter generates ENDTX, which must not be handled as the end of a
+        // buffered transfer
+        nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_ENDTX);
+        nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_TXDRDY);
+        directTx_ = false;
+        const size_t amount = nrf_uarte_tx_amount_get(uarte_);
+        txBytes_ += amount;
+        txDirectBytes_ += amount;
+        transmitting_ = false;
+        startTransmission();
+        CHECK_TRUE(amount > 0, SYSTEM_ERROR_TIMEOUT);
+        return amount;
     }
 
     void startReceiver(bool flush = false) {
@@ -624,6 +786,11 @@ private:
             nrf_uarte_event_clear(uarte_, NRF_UARTE_EVENT_TXSTOPPED);
             nrf_uarte_task_trigger(uarte_, NRF_UARTE_TASK_STOPTX);
             while (!nrf_uarte_event_check(uarte_, NRF_UARTE_EVENT_TXSTOPPED));
+            if (directTx_) {
+                // Wake up the writer waiting for a direct transfer
+                directTx_ = false;
+                xEventGroupSetBits(evGroup_, DIRECT_TX_DONE_EVENT);
+            }
         }
     }
 
@@ -746,15 +913,23 @@ private:
     bool configured_ = false;
     volatile hal_usart_state_t state_ = HAL_USART_STATE_DISABLED;
 
-    volatile bool transmitting_;
+    std::atomic<bool> transmitting_;
+    volatile bool directTx_;
     volatile uint8_t receiving_;
     volatile size_t rxConsumed_;
 
     Config config_ = {};
 
-    particle::services::RingBuffer<uint8_t> txBuffer_;
+    particle::services::MpscRingBuffer txBuffer_;
     particle::services::RingBuffer<uint8_t> rxBuffer_;
 
+    volatile uint32_t txBytes_ = 0;
+    volatile uint32_t rxBytes_ = 0;
+    std::atomic<uint32_t> txOverruns_{0};
+    volatile uint32_t rxOverruns_ = 0;
+    volatile uint32_t rxErrors_ = 0;
+    volatile uint32_t txDirectBytes_ = 0;
+
     EventGroupHandle_t evGroup_;
 };
 
@@ -880,7 +1055,22 @@ ssize_t hal_usart_write_buffer(hal_usart_interface_t serial, const void* buffer,
     auto usart = CHECK_TRUE_RETURN(getInstance(serial), SYSTEM_ERROR_NOT_FOUND);
     CHECK_TRUE(elementSize == sizeof(uint8_t), SYSTEM_ERROR_INVALID_ARGUMENT);
     usart->pump();
-    return usart->write((const uint8_t*)buffer, size);
+    const hal_usart_iovec_t iov = { .data = buffer, .size = size };
+    return usart->write(&iov, 1, HAL_USART_WRITE_FLAG_NONE);
+}
+
+ssize_t hal_usart_write_iov(hal_usart_interface_t serial, const hal_usart_iovec_t* iov, size_t count, unsigned flags, void* reserved) {
+    auto usart = CHECK_TRUE_RETURN(getInstance(serial), SYSTEM_ERROR_NOT_FOUND);
+    usart->pump();
+    return usart->write(iov, count, flags);
+}
+
+int hal_usart_get_stats(hal_usart_interface_t serial, hal_usart_stats_t* stats, void* reserved) {
+    auto usart = CHECK_TRUE_RETURN(getInstance(serial), SYSTEM_ERROR_NOT_FOUND);
+    CHECK_TRUE(stats, SYSTEM_ERROR_INVALID_ARGUMENT);
+    CHECK_TRUE(stats->size >= offsetof(hal_usart_stats_t, tx_bytes), SYSTEM_ERROR_INVALID_ARGUMENT);
+    usart->getStats(stats);
+    return SYSTEM_ERROR_NONE;
 }
 
 ssize_t hal_usart_read_buffer(hal_usart_interface_t serial, void* buffer, size_t size, size_t elementSize) {
@@ -918,8 +1108,13 @@ uint32_t hal_usart_write(hal_usart_interface_t serial, uint8_t data) {
     // Blocking!
     while(usart->isEnabled() && usart->space() <= 0) {
         usart->pump();
+        if (usart->txHeldBack() && !usart->waitForWriters()) {
+            // The buffer is held back by a preempted writer that can't run until the caller returns
+            return 0;
+        }
     }
-    return CHECK_RETURN(usart->write(&data, sizeof(data)), 0);
+    const hal_usart_iovec_t iov = { .data = &data, .size = sizeof(data) };
+    return CHECK_RETURN(usart->write(&iov, 1, HAL_USART_WRITE_FLAG_NONE), 0);
 }
 
 void hal_usart_send_break(hal_usart_interface_t serial, void* reserved) {
@@ -28,6 +28,8 @@ void system_part1_pre_init() {
         module_user_part_validated = HAL_Core_Validate_User_Module();
     }
 
+    hal_boot_phase_complete(HAL_BOOT_PHASE_MODULE_VALIDATION);
+
     bool safe_mode = HAL_Core_Enter_Safe_Mode_Requested();
 
     if (!bootloader_validated || !is_user_module_valid() || safe_mode) {
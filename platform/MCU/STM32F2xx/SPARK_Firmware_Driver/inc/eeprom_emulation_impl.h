@@ -28,4 +28,11 @@ constexpr uintptr_t EEPROM_SectorBase2 = 0x08010000;
 constexpr size_t EEPROM_SectorSize1 = 16*1024;
 constexpr size_t EEPROM_SectorSize2 = 64*1024;
 
-using FlashEEPROM = EEPROMEmulation<InternalFlashStore, EEPROM_SectorBase1, EEPROM_SectorSize1, EEPROM_SectorBase2, EEPROM_SectorSize2>;
+// Set to 1 to keep a RAM index of the EEPROM records. Speeds up EEPROM reads and
+// writes at the cost of 2 bytes of heap per EEPROM cell (4KB with 2048 cells)
+#ifndef EEPROM_EMULATION_INDEX
+#define EEPROM_EMULATION_INDEX (0)
+#endif /* EEPROM_EMULATION_INDEX */
+
+using FlashEEPROM = EEPROMEmulation<InternalFlashStore, EEPROM_SectorBase1, EEPROM_SectorSize1, EEPROM_SectorBase2, EEPROM_SectorSize2,
+        EEPROM_EMULATION_INDEX>;
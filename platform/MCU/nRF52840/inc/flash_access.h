@@ -63,6 +63,12 @@ uint16_t FLASH_ModuleVersion(flash_device_t flashDeviceID, uint32_t startAddress
 bool FLASH_isUserModuleInfoValid(uint8_t flashDeviceID, uint32_t startAddress, uint32_t expectedAddress);
 bool FLASH_VerifyCRC32(flash_device_t flashDeviceID, uint32_t startAddress, uint32_t length);
 
+/**
+ * Discards the cached CRC check results of the modules in an internal flash region that is
+ * about to be modified.
+ */
+void FLASH_InvalidateVerifiedCRC32(uint32_t startAddress, uint32_t length);
+
 // Old routine signature for Photon
 void FLASH_ClearFlags(void);
 void FLASH_Erase(void);
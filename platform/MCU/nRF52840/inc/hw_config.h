@@ -17,6 +17,7 @@
 #include <stdbool.h>
 #include "hw_ticks.h"
 #include "rgbled.h"
+#include "hw_crc32.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -58,9 +59,6 @@ void Finish_Update(void);
 uint16_t Bootloader_Get_Version(void);
 void Bootloader_Update_Version(uint16_t bootloaderVersion);
 
-uint32_t Compute_CRC32(const uint8_t *pBuffer, uint32_t bufferSize, uint32_t const *p_crc);
-
-
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
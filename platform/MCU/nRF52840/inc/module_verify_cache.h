@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Maximum number of modules with a cached verification result */
+#define MODULE_VERIFY_CACHE_ENTRY_COUNT 4
+
+typedef struct module_verify_cache_entry {
+    uint32_t start_addr;
+    uint32_t length;
+    uint32_t crc; /* CRC stored at the end of the module */
+} module_verify_cache_entry;
+
+/**
+ * Results of the module CRC checks that have succeeded since the last cold boot.
+ *
+ * The cache is meant to be kept in retained RAM. Its contents are protected with a checksum
+ * and are discarded if the RAM has lost its state.
+ */
+typedef struct module_verify_cache {
+    uint32_t magic;
+    uint32_t generation; /* Incremented every time the cache is invalidated */
+    uint32_t next_entry;
+    module_verify_cache_entry entries[MODULE_VERIFY_CACHE_ENTRY_COUNT];
+    uint32_t checksum;
+} module_verify_cache;
+
+/**
+ * Resets the cache if its contents are not valid.
+ */
+void module_verify_cache_init(module_verify_cache* cache);
+
+/**
+ * Returns `true` if the CRC of the module has already been verified.
+ */
+bool module_verify_cache_find(const module_verify_cache* cache, uint32_t start_addr, uint32_t length, uint32_t crc);
+
+/**
+ * Adds a successfully verified module to the cache.
+ *
+ * The module is not added if the cache has been invalidated after `generation` was obtained
+ * via `module_verify_cache_generation()` before verifying the module.
+ */
+void module_verify_cache_add(module_verify_cache* cache, uint32_t generation, uint32_t start_addr, uint32_t length,
+                             uint32_t crc);
+
+/**
+ * Removes the modules overlapping with a flash region that is about to be modified.
+ */
+void module_verify_cache_invalidate(module_verify_cache* cache, uint32_t addr, uint32_t length);
+
+uint32_t module_verify_cache_generation(const module_verify_cache* cache);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -26,7 +26,9 @@
 /* Includes ------------------------------------------------------------------*/
 //#include <string.h>
 #include "hw_config.h"
+#include "hal_irq_flag.h"
 #include "module_info.h"
+#include "module_verify_cache.h"
 #include "module_info_hal.h"
 #include "dct.h"
 #include "flash_mal.h"
@@ -49,10 +51,37 @@
 #define SOFTDEVICE_MBR_UPDATES 0
 #endif // MODULE_FUNCTION == MOD_FUNC_BOOTLOADER
 
+// The bootloader always verifies the modules in full. The system firmware keeps the results of
+// the CRC checks of the internal flash modules in retained RAM, so that they don't need to be
+// verified again on every warm boot
+#if MODULE_FUNCTION != MOD_FUNC_BOOTLOADER
+#define HAS_MODULE_VERIFY_CACHE 1
+#else
+#define HAS_MODULE_VERIFY_CACHE 0
+#endif
+
 #define CEIL_DIV(A, B)        (((A) + (B) - 1) / (B))
 
 #define COPY_BLOCK_SIZE 256
 
+#if HAS_MODULE_VERIFY_CACHE
+static module_verify_cache verify_cache __attribute__((section(".retained_system")));
+static bool verify_cache_inited = false;
+
+static void verify_cache_init(void) {
+    if (!verify_cache_inited) {
+        module_verify_cache_init(&verify_cache);
+        verify_cache_inited = true;
+    }
+}
+
+static bool is_internal_flash_module(uint32_t start_addr, uint32_t length) {
+    // Exclude the external flash mapped via XIP, which is not written via hal_flash_write()
+    return start_addr >= INTERNAL_FLASH_START && length <= INTERNAL_FLASH_SIZE - 4 &&
+            start_addr - INTERNAL_FLASH_START <= INTERNAL_FLASH_SIZE - 4 - length;
+}
+#endif // HAS_MODULE_VERIFY_CACHE
+
 static bool flash_read(flash_device_t dev, uintptr_t addr, uint8_t* buf, size_t size) {
     bool ok = false;
     switch (dev) {
@@ -167,6 +196,18 @@ typedef struct inflate_output_ctx {
 
 static int inflate_output_callback(const char* data, size_t size, void* user_data) {
     inflate_output_ctx* out = (inflate_output_ctx*)user_data;
+    if (out->buf_offs == 0 && size >= sizeof(out->buf)) {
+        // The decompressor produces data in large aligned blocks, which can be written as is
+        size = size / sizeof(out->buf) * sizeof(out->buf);
+        if (out->flash_addr + size > out->flash_end_addr) {
+            return -1;
+        }
+        if (!flash_write(out->flash_dev, out->flash_addr, (const uint8_t*)data, size)) {
+            return -1;
+        }
+        out->flash_addr += size;
+        return size;
+    }
     const size_t avail = sizeof(out->buf) - out->buf_offs;
     if (size > avail) {
         size = avail;
@@ -825,19 +866,42 @@ bool FLASH_VerifyCRC32(uint8_t flashDeviceID, uint32_t startAddress, uint32_t le
     if(flashDeviceID == FLASH_INTERNAL && length > 0)
     {
         uint32_t expectedCRC = __REV((*(__IO uint32_t*) (startAddress + length)));
+#if HAS_MODULE_VERIFY_CACHE
+        const bool cacheable = is_internal_flash_module(startAddress, length);
+        uint32_t generation = 0;
+        if (cacheable) {
+            const int st = HAL_disable_irq();
+            verify_cache_init();
+            const bool found = module_verify_cache_find(&verify_cache, startAddress, length, expectedCRC);
+            generation = module_verify_cache_generation(&verify_cache);
+            HAL_enable_irq(st);
+            if (found) {
+                return true;
+            }
+        }
+#endif // HAS_MODULE_VERIFY_CACHE
         uint32_t computedCRC = Compute_CRC32((uint8_t*)startAddress, length, NULL);
 
         if (expectedCRC == computedCRC)
         {
+#if HAS_MODULE_VERIFY_CACHE
+            if (cacheable) {
+                const int st = HAL_disable_irq();
+                module_verify_cache_add(&verify_cache, generation, startAddress, length, expectedCRC);
+                HAL_enable_irq(st);
+            }
+#endif // HAS_MODULE_VERIFY_CACHE
             return true;
         }
     }
 #ifdef USE_SERIAL_FLASH
     else if(flashDeviceID == FLASH_SERIAL && length > 0)
     {
-        uint8_t serialFlashData[4]; // FIXME: Use XIP or a larger buffer
-        hal_exflash_read((startAddress + length), serialFlashData, 4);
-        uint32_t expectedCRC = (uint32_t)(serialFlashData[3] | (serialFlashData[2] << 8) | (serialFlashData[1] << 16) | (serialFlashData[0] << 24));
+        uint8_t buf[COPY_BLOCK_SIZE] __attribute__((aligned(4)));
+        if (hal_exflash_read((startAddress + length), buf, 4) != 0) {
+            return false;
+        }
+        uint32_t expectedCRC = (uint32_t)(buf[3] | (buf[2] << 8) | (buf[1] << 16) | (buf[0] << 24));
 
         uint32_t endAddress = startAddress + length;
         uint32_t len = 0;
@@ -845,12 +909,14 @@ bool FLASH_VerifyCRC32(uint8_t flashDeviceID, uint32_t startAddress, uint32_t le
 
         do {
             len = endAddress - startAddress;
-            if (len > sizeof(serialFlashData)) {
-                len = sizeof(serialFlashData);
+            if (len > sizeof(buf)) {
+                len = sizeof(buf);
+            }
+            if (hal_exflash_read(startAddress, buf, len) != 0) {
+                return false;
             }
-            hal_exflash_read(startAddress, serialFlashData, len);
 
-            computedCRC = Compute_CRC32(serialFlashData, len, &computedCRC);
+            computedCRC = Compute_CRC32(buf, len, &computedCRC);
 
             startAddress += len;
         } while (startAddress < endAddress);
@@ -865,6 +931,16 @@ bool FLASH_VerifyCRC32(uint8_t flashDeviceID, uint32_t startAddress, uint32_t le
     return false;
 }
 
+void FLASH_InvalidateVerifiedCRC32(uint32_t startAddress, uint32_t length)
+{
+#if HAS_MODULE_VERIFY_CACHE
+    const int st = HAL_disable_irq();
+    verify_cache_init();
+    module_verify_cache_invalidate(&verify_cache, startAddress, length);
+    HAL_enable_irq(st);
+#endif // HAS_MODULE_VERIFY_CACHE
+}
+
 void FLASH_ClearFlags(void)
 {
     return;
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "module_verify_cache.h"
+#include "hw_crc32.h"
+#include <string.h>
+#include <stddef.h>
+
+#define MODULE_VERIFY_CACHE_MAGIC 0x4d564331 /* "MVC1" */
+
+static uint32_t cache_checksum(const module_verify_cache* cache) {
+    return Compute_CRC32((const uint8_t*)cache, offsetof(module_verify_cache, checksum), NULL);
+}
+
+static void update_checksum(module_verify_cache* cache) {
+    cache->checksum = cache_checksum(cache);
+}
+
+void module_verify_cache_init(module_verify_cache* cache) {
+    if (cache->magic == MODULE_VERIFY_CACHE_MAGIC && cache->next_entry < MODULE_VERIFY_CACHE_ENTRY_COUNT &&
+            cache->checksum == cache_checksum(cache)) {
+        return;
+    }
+    memset(cache, 0, sizeof(module_verify_cache));
+    cache->magic = MODULE_VERIFY_CACHE_MAGIC;
+    update_checksum(cache);
+}
+
+bool module_verify_cache_find(const module_verify_cache* cache, uint32_t start_addr, uint32_t length, uint32_t crc) {
+    if (!length) {
+        return false;
+    }
+    for (unsigned i = 0; i < MODULE_VERIFY_CACHE_ENTRY_COUNT; ++i) {
+        const module_verify_cache_entry* entry = &cache->entries[i];
+        if (entry->start_addr == start_addr && entry->length == length && entry->crc == crc) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void module_verify_cache_add(module_verify_cache* cache, uint32_t generation, uint32_t start_addr, uint32_t length,
+                             uint32_t crc) {
+    if (!length || cache->generation != generation ||
+            module_verify_cache_find(cache, start_addr, length, crc)) {
+        return;
+    }
+    /* Replace an entry for the same module, or the oldest entry */
+    unsigned index = cache->next_entry;
+    for (unsigned i = 0; i < MODULE_VERIFY_CACHE_ENTRY_COUNT; ++i) {
+        if (cache->entries[i].start_addr == start_addr || !cache->entries[i].length) {
+            index = i;
+            break;
+        }
+    }
+    module_verify_cache_entry* entry = &cache->entries[index];
+    entry->start_addr = start_addr;
+    entry->length = length;
+    entry->crc = crc;
+    if (index == cache->next_entry) {
+        cache->next_entry = (index + 1) % MODULE_VERIFY_CACHE_ENTRY_COUNT;
+    }
+    update_checksum(cache);
+}
+
+void module_verify_cache_invalidate(module_verify_cache* cache, uint32_t addr, uint32_t length) {
+    for (unsigned i = 0; i < MODULE_VERIFY_CACHE_ENTRY_COUNT; ++i) {
+        module_verify_cache_entry* entry = &cache->entries[i];
+        if (!entry->length) {
+            continue;
+        }
+        /* The CRC is stored right after the module data */
+        const uint32_t entry_end = entry->start_addr + entry->length + sizeof(uint32_t);
+        if (addr < entry_end && entry->start_addr < addr + length) {
+            memset(entry, 0, sizeof(module_verify_cache_entry));
+        }
+    }
+    ++cache->generation;
+    update_checksum(cache);
+}
+
+uint32_t module_verify_cache_generation(const module_verify_cache* cache) {
+    return cache->generation;
+}
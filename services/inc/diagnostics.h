@@ -58,8 +58,13 @@
 #define DIAG_NAME_CLOUD_TRANSMITTED_MESSAGES "coap:transmit"
 #define DIAG_NAME_CLOUD_COAP_ROUND_TRIP "coap:roundtrip"
 #define DIAG_NAME_CLOUD_RATE_LIMITED_EVENTS "pub:limit"
+#define DIAG_NAME_CLOUD_VITALS_BYTES_SAVED "pub:vitals:saved"
 #define DIAG_NAME_SYSTEM_TOTAL_RAM "sys:tram"
 #define DIAG_NAME_SYSTEM_USED_RAM "sys:uram"
+#define DIAG_NAME_BLE_RSSI "ble:rssi"
+#define DIAG_NAME_BLE_TX_PACKETS "ble:tx"
+#define DIAG_NAME_BLE_RX_PACKETS "ble:rx"
+#define DIAG_NAME_BLE_THROUGHPUT "ble:tput"
 
 #ifdef __cplusplus
 extern "C" {
@@ -107,6 +112,11 @@ typedef enum diag_id {
     DIAG_ID_SYSTEM_TOTAL_RAM = 25, // sys:tram
     DIAG_ID_SYSTEM_USED_RAM = 26, // sys:uram
     DIAG_ID_CLOUD_COAP_ROUND_TRIP = 31, // coap:roundtrip
+    DIAG_ID_BLE_RSSI = 44, // ble:rssi
+    DIAG_ID_BLE_TX_PACKETS = 45, // ble:tx
+    DIAG_ID_BLE_RX_PACKETS = 46, // ble:rx
+    DIAG_ID_BLE_THROUGHPUT = 47, // ble:tput
+    DIAG_ID_CLOUD_VITALS_BYTES_SAVED = 48, // pub:vitals:saved
     DIAG_ID_USER = 32768 // Base value for application-specific source IDs
 } diag_id;
 
@@ -22,6 +22,7 @@
 
 #include <cstring>
 #include <memory>
+#include <new>
 #include <vector>
 #include <limits>
 
@@ -47,6 +48,14 @@
  * Reading involves going through the list of valid records in the
  * active page looking for the last record with a specified index.
  *
+ * To avoid scanning the page on every read and write, a RAM index of
+ * the location of the latest record of each EEPROM cell can be enabled
+ * with the UseIndex template parameter. The index is built the first
+ * time the EEPROM is accessed and then updated as new records are
+ * written. It uses 2 bytes of heap per EEPROM cell for the lifetime of
+ * the object. If it is disabled or cannot be allocated, the page is
+ * scanned on every access.
+ *
  * When writing a new value and there is no more room in the current
  * page to append new records, a page swap occurs as follows:
  * - The alternate page is erased if necessary
@@ -91,7 +100,7 @@
  *
  */
 
-template <typename Store, uintptr_t PageBase1, size_t PageSize1, uintptr_t PageBase2, size_t PageSize2>
+template <typename Store, uintptr_t PageBase1, size_t PageSize1, uintptr_t PageBase2, size_t PageSize2, bool UseIndex = false>
 class EEPROMEmulation
 {
 public:
@@ -287,6 +296,8 @@ public:
     // and which one should be used as the target of the page swap
     void updateActivePage()
     {
+        invalidateIndex();
+
         uint32_t status1 = readPageStatus(LogicalPage::Page1);
         uint32_t status2 = readPageStatus(LogicalPage::Page2);
 
@@ -340,6 +351,12 @@ public:
         std::memset(data, FLASH_ERASED, length);
 
         Index indexEnd = indexBegin + length;
+        if(updateIndex() && (indexEnd <= capacity() || !indexHasOutOfRangeRecords))
+        {
+            readRangeFromIndex(indexBegin, data, length);
+            return;
+        }
+
         forEachValidRecord(getActivePage(), [=](Address address, const Record &record)
         {
             if(record.index >= indexBegin && record.index < indexEnd)
@@ -397,6 +414,14 @@ public:
         Index indexEnd = indexBegin + length;
 
         std::memset(existingData, FLASH_ERASED, length);
+
+        if(page == getActivePage() && updateIndex() && indexEnd <= capacity())
+        {
+            readRangeFromIndex(indexBegin, existingData, length);
+            emptyAddress = indexEmptyAddress;
+            return !indexHasInvalidRecords;
+        }
+
         emptyAddress = getPageEnd(page);
 
         forEachRecord(page, [&](Address address, const Record &record) -> bool
@@ -469,6 +494,26 @@ public:
                             writeAddress, endAddress, Record(index, data[i]));
                 }
             }
+
+            // Add the new records to the index. The records were written
+            // backwards so the index is updated in the same order
+            if(success && indexValid)
+            {
+                writeAddress = writeAddressBegin + changedCount * sizeof(Record);
+                for(uint16_t i = 0; i < length; i++)
+                {
+                    if(existingData[i] != data[i])
+                    {
+                        writeAddress -= sizeof(Record);
+                        recordOffsets[indexBegin + i] = writeAddress - getPageBegin(getActivePage());
+                    }
+                }
+                indexEmptyAddress = writeAddressBegin + changedCount * sizeof(Record);
+            }
+            else
+            {
+                invalidateIndex();
+            }
         }
 
         return success;
@@ -544,6 +589,21 @@ public:
     template <typename Func>
     void forEachUniqueValidRecord(LogicalPage page, Func f)
     {
+        if(page == getActivePage() && updateIndex() && !indexHasOutOfRangeRecords)
+        {
+            Address baseAddress = getPageBegin(page);
+            for(Index index = 0; index < capacity(); index++)
+            {
+                if(recordOffsets[index] != 0)
+                {
+                    Address address = baseAddress + recordOffsets[index];
+                    const Record &record = *(const Record *) store.dataAt(address);
+                    f(address, record);
+                }
+            }
+            return;
+        }
+
         // Find latest address of each record in several passes through the page, batching
         // the finds to reduce the number of linear searches through the page.
 
@@ -643,6 +703,10 @@ public:
         LogicalPage sourcePage = getActivePage();
         LogicalPage destinationPage = getAlternatePage();
 
+        // Build the index of the source page to speed up the copy. It is
+        // rebuilt for the new page on the next access
+        updateIndex();
+
         // loop protects against marginal erase: if a page was kind of
         // erased and read back as all 0xFF but when values are written
         // some bits written as 1 actually become 0
@@ -686,6 +750,7 @@ public:
             }
         }
 
+        invalidateIndex();
         return false;
     }
 
@@ -737,6 +802,101 @@ public:
         return success;
     }
 
+    // Build the index of the active page if necessary
+    //
+    // Returns false if the index is not available
+    bool updateIndex()
+    {
+        if(indexValid)
+        {
+            return true;
+        }
+
+        if(!UseIndex)
+        {
+            return false;
+        }
+
+        LogicalPage page = getActivePage();
+        if(page == LogicalPage::NoPage)
+        {
+            return false;
+        }
+
+        using AddressOffset = uint16_t;
+        static_assert(
+            PageSize1 <= std::numeric_limits<AddressOffset>::max() + 1 &&
+            PageSize2 <= std::numeric_limits<AddressOffset>::max() + 1,
+            "PageSize1 or PageSize2 doesn't fit in AddressOffset. "
+            "Make pages smaller or AddressOffset a larger data type"
+        );
+
+        if(!recordOffsets)
+        {
+            recordOffsets.reset(new (std::nothrow) uint16_t[capacity()]);
+            if(!recordOffsets)
+            {
+                return false;
+            }
+        }
+
+        std::memset(recordOffsets.get(), 0, capacity() * sizeof(uint16_t));
+        indexEmptyAddress = getPageEnd(page);
+        indexHasInvalidRecords = false;
+        indexHasOutOfRangeRecords = false;
+
+        Address baseAddress = getPageBegin(page);
+        forEachRecord(page, [&](Address address, const Record &record) -> bool
+        {
+            if(record.empty())
+            {
+                indexEmptyAddress = address;
+                return true;
+            }
+            else if(record.valid())
+            {
+                if(record.index < capacity())
+                {
+                    recordOffsets[record.index] = address - baseAddress;
+                }
+                else
+                {
+                    indexHasOutOfRangeRecords = true;
+                }
+                return false;
+            }
+            else
+            {
+                indexHasInvalidRecords = true;
+                return true;
+            }
+        });
+
+        indexValid = true;
+        return true;
+    }
+
+    // Discard the index after the contents of the active page changed
+    void invalidateIndex()
+    {
+        indexValid = false;
+    }
+
+    // Read the latest values of a range of EEPROM cells using the index
+    void readRangeFromIndex(Index indexBegin, Data *data, uint16_t length)
+    {
+        Address baseAddress = getPageBegin(getActivePage());
+        for(uint16_t i = 0; i < length && indexBegin + i < capacity(); i++)
+        {
+            uint16_t offset = recordOffsets[indexBegin + i];
+            if(offset != 0)
+            {
+                const Record &record = *(const Record *) store.dataAt(baseAddress + offset);
+                data[i] = record.data;
+            }
+        }
+    }
+
     // Which page needs to be erased after a page swap.
     LogicalPage getPendingErasePage()
     {
@@ -756,4 +916,13 @@ public:
 protected:
     LogicalPage activePage;
     LogicalPage alternatePage;
+
+    // Offset of the latest record of each EEPROM cell in the active page,
+    // or 0 if the cell has no record
+    std::unique_ptr<uint16_t[]> recordOffsets;
+    // Address where the next record will be written in the active page
+    Address indexEmptyAddress = 0;
+    bool indexHasInvalidRecords = false;
+    bool indexHasOutOfRangeRecords = false;
+    bool indexValid = false;
 };
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+namespace particle {
+
+namespace services {
+
+/**
+ * Lock-free byte ring buffer with multiple producers and a single consumer.
+ *
+ * Producers reserve a region of the buffer, copy their data into it and then commit it. The
+ * reservation is a single compare-and-swap, so producers never wait for each other and can run
+ * in an ISR. Committed data becomes available to the consumer once all the producers that were
+ * active at the same time have committed their regions as well.
+ *
+ * The consumer side is not thread-safe and is typically run by a DMA completion interrupt.
+ */
+class MpscRingBuffer {
+public:
+    /**
+     * Region of the buffer reserved by a producer.
+     */
+    struct Reservation {
+        uint32_t pos;
+        size_t size;
+    };
+
+    MpscRingBuffer() :
+            buf_(nullptr),
+            size_(0),
+            modulo_(0),
+            state_(0),
+            consumed_(0),
+            committed_(0) {
+    }
+
+    MpscRingBuffer(const MpscRingBuffer&) = delete;
+    MpscRingBuffer& operator=(const MpscRingBuffer&) = delete;
+
+    /**
+     * Initializes the buffer. The size of the buffer cannot exceed `MAX_SIZE` bytes.
+     */
+    void init(uint8_t* buf, size_t size) {
+        buf_ = buf;
+        size_ = (size > MAX_SIZE) ? MAX_SIZE : size;
+        // Positions are counted modulo a multiple of the buffer size so that the index of a
+        // position in the buffer doesn't change when the counter wraps around
+        modulo_ = size_ ? (POS_MASK + 1) / size_ * size_ : 0;
+        reset();
+    }
+
+    /**
+     * Discards all data. Must not be called concurrently with other methods.
+     */
+    void reset() {
+        state_.store(0);
+        consumed_.store(0);
+        committed_.store(0);
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    /**
+     * Returns the number of bytes that can be reserved.
+     */
+    size_t space() const {
+        return size_ - distance(pos(state_.load(std::memory_order_acquire)), consumed_.load(std::memory_order_acquire));
+    }
+
+    /**
+     * Returns `true` if there's no reserved or committed data that hasn't been consumed.
+     */
+    bool empty() const {
+        const uint32_t s = state_.load(std::memory_order_acquire);
+        return writers(s) == 0 && pos(s) == consumed_.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Returns `true` if there are producers that have reserved a region but haven't committed it.
+     *
+     * The data committed after such a region is not available to the consumer until the region
+     * is committed, so a producer that waits for space may need to let those producers run.
+     */
+    bool pending() const {
+        return writers(state_.load(std::memory_order_acquire)) != 0;
+    }
+
+    /**
+     * Reserves a region of at least `minSize` and at most `maxSize` bytes.
+     *
+     * Every successful reservation must be followed by a call to `commit()`.
+     *
+     * @return Size of the reserved region, or 0 if there's not enough space in the buffer.
+     */
+    size_t reserve(size_t minSize, size_t maxSize, Reservation* r) {
+        uint32_t s = state_.load(std::memory_order_acquire);
+        for (;;) {
+            if (writers(s) == MAX_WRITERS) {
+                return 0;
+            }
+            const size_t avail = size_ - distance(pos(s), consumed_.load(std::memory_order_acquire));
+            if (avail < minSize || avail == 0) {
+                return 0;
+            }
+            const size_t n = std::min(maxSize, avail);
+            const uint32_t newState = makeState(advance(pos(s), n), writers(s) + 1);
+            if (state_.compare_exchange_weak(s, newState, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                r->pos = pos(s);
+                r->size = n;
+                return n;
+            }
+        }
+    }
+
+    /**
+     * Copies data into a reserved region.
+     */
+    void write(const Reservation& r, size_t offset, const uint8_t* data, size_t size) {
+        size_t index = (r.pos + offset) % size_;
+        while (size > 0) {
+            const size_t n = std::min(size, size_ - index);
+            memcpy(buf_ + index, data, n);
+            data += n;
+            size -= n;
+            index = 0;
+        }
+    }
+
+    /**
+     * Commits a reserved region.
+     *
+     * @return `true` if the data committed by this and other producers became available to the
+     *         consumer.
+     */
+    bool commit() {
+        uint32_t p = 0;
+        if (!release(&p)) {
+            return false;
+        }
+        publish(p);
+        return true;
+    }
+
+    /**
+     * Returns a contiguous block of committed data. Consumer side.
+     *
+     * @param[out] size Size of the block.
+     * @return Pointer to the block.
+     */
+    const uint8_t* consume(size_t* size) {
+        const uint32_t committed = committed_.load(std::memory_order_acquire);
+        const uint32_t consumed = consumed_.load(std::memory_order_relaxed);
+        const size_t index = consumed % size_;
+        *size = std::min(distance(committed, consumed), size_ - index);
+        return buf_ + index;
+    }
+
+    /**
+     * Returns the number of bytes that can be consumed. Consumer side.
+     */
+    size_t consumable() {
+        size_t n = 0;
+        consume(&n);
+        return n;
+    }
+
+    /**
+     * Releases a block of data returned by `consume()`. Consumer side.
+     */
+    void consumeCommit(size_t size) {
+        consumed_.store(advance(consumed_.load(std::memory_order_relaxed), size), std::memory_order_release);
+    }
+
+    // The state word contains the reserved position and the number of active producers
+    static const unsigned POS_BITS = 24;
+    static const uint32_t POS_MASK = (1ul << POS_BITS) - 1;
+    static const uint32_t WRITER_INC = 1ul << POS_BITS;
+    static const uint32_t MAX_WRITERS = 0xff;
+    static const size_t MAX_SIZE = (POS_MASK + 1) / 2;
+
+protected:
+    // Decrements the number of active producers. Returns `true` and the reserved position if this
+    // was the last active producer
+    bool release(uint32_t* p) {
+        uint32_t s = state_.load(std::memory_order_relaxed);
+        uint32_t newState = 0;
+        do {
+            newState = s - WRITER_INC;
+        } while (!state_.compare_exchange_weak(s, newState, std::memory_order_acq_rel, std::memory_order_relaxed));
+        *p = pos(newState);
+        return writers(newState) == 0;
+    }
+
+    // Makes the data up to the specified position available to the consumer
+    void publish(uint32_t p) {
+        // Another producer may have reserved and committed more data after this producer released
+        // the buffer, so the committed position is only moved forward. If that data has already
+        // been consumed as well, the position is behind the consumed one and is not published
+        uint32_t c = committed_.load(std::memory_order_relaxed);
+        for (;;) {
+            const uint32_t consumed = consumed_.load(std::memory_order_acquire);
+            const size_t d = distance(p, consumed);
+            if (d > size_ || d <= distance(c, consumed)) {
+                break;
+            }
+            if (committed_.compare_exchange_weak(c, p, std::memory_order_release, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+    }
+
+private:
+    uint8_t* buf_;
+    size_t size_;
+    uint32_t modulo_;
+    std::atomic<uint32_t> state_;
+    std::atomic<uint32_t> consumed_;
+    std::atomic<uint32_t> committed_;
+
+    static uint32_t pos(uint32_t state) {
+        return state & POS_MASK;
+    }
+
+    static uint32_t writers(uint32_t state) {
+        return state >> POS_BITS;
+    }
+
+    static uint32_t makeState(uint32_t pos, uint32_t writers) {
+        return (writers << POS_BITS) | pos;
+    }
+
+    uint32_t advance(uint32_t pos, size_t n) const {
+        pos += n;
+        return (pos >= modulo_) ? pos - modulo_ : pos;
+    }
+
+    size_t distance(uint32_t to, uint32_t from) const {
+        return (to >= from) ? to - from : to + modulo_ - from;
+    }
+};
+
+} // namespace services
+
+} // namespace particle
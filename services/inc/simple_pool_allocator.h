@@ -29,53 +29,63 @@
 #define SIMPLE_POOL_PREFER_SMALLER_BLOCK (1)
 #endif
 
+// Number of size classes served from segregated free lists. Blocks that are larger than the
+// largest size class are kept in a single address-ordered free list and coalesced on release
+#ifndef SIMPLE_POOL_SIZE_CLASS_COUNT
+#define SIMPLE_POOL_SIZE_CLASS_COUNT (12)
+#endif
+
 class SimpleBasePool: public particle::SimpleAllocator {
 public:
+    struct Stats {
+        size_t total; // Size of the pool
+        size_t used; // Number of bytes in allocated blocks, including block headers
+        size_t peak; // Maximum number of bytes used
+        size_t largestFree; // Size of the largest block that can be allocated without reclaiming
+        unsigned fragmentation; // Percentage of the free memory not in the largest free block
+        size_t allocCount; // Number of successful allocations
+        size_t failedCount; // Number of failed allocations
+    };
+
     virtual void* alloc(size_t size) override {
         if (!begin_) {
             return nullptr;
         }
-        void* p = nullptr;
-        const size_t alignedSize = aligned(sizeof(BlockHeader) + size);
-        if ((size_ - (ptr_ - begin_)) >= alignedSize) {
-            BlockHeader* b = reinterpret_cast<BlockHeader*>(ptr_);
-            b->size = alignedSize;
-            b->next = nullptr;
-            p = ptr_ + sizeof(BlockHeader);
-            ptr_ += alignedSize;
-        } else {
-            BlockHeader* candidate = nullptr;
-            BlockHeader* prev = nullptr;
-            for (BlockHeader* b = freeList_, *pr = nullptr; b != nullptr; pr = b, b = b->next) {
-                if (b->size >= alignedSize) {
-#if SIMPLE_POOL_PREFER_SMALLER_BLOCK == 1
-                    // Prefer smallest block
-                    if (candidate == nullptr || candidate->size > b->size) {
-#else
-                    // Prefer rightmost block
-                    if (true) {
-#endif // SIMPLE_POOL_PREFER_SMALLER_BLOCK
-                        candidate = b;
-                        prev = pr;
-                    }
-                }
+        // Blocks are not rounded up to their size class, so that a pool that has room for N blocks
+        // of some size can allocate all N of them
+        const size_t blockSize = blockSizeFor(size);
+        const int cls = sizeClass(blockSize);
+        BlockHeader* b = nullptr;
+        if (cls >= 0) {
+            // Common sizes are served from the segregated free lists in constant time
+            b = popBin(cls);
+            if (!b && cls > 0 && bins_[cls - 1] && bins_[cls - 1]->size >= blockSize) {
+                // A freed block of the same size is kept in the bin of the next smaller class
+                b = popBin(cls - 1);
             }
-            if (candidate != nullptr) {
-                // Remove from free list
-                if (prev != nullptr) {
-                    prev->next = candidate->next;
-                } else {
-                    freeList_ = candidate->next;
-                    prev = freeList_;
-                }
-                if (candidate == freeListEnd_) {
-                    freeListEnd_ = prev;
-                }
-                candidate->next = nullptr;
-                p = reinterpret_cast<void*>(candidate->data);
+        }
+        if (!b) {
+            b = allocBlock(blockSize);
+        }
+        if (!b && cls >= 0) {
+            for (int i = cls + 1; i < SIZE_CLASS_COUNT && !b; ++i) {
+                b = popBin(i);
             }
         }
-        return p;
+        if (!b && reclaim()) {
+            b = allocBlock(blockSize);
+        }
+        if (!b) {
+            ++failedCount_;
+            return nullptr;
+        }
+        b->next = nullptr;
+        used_ += b->size;
+        if (used_ > peak_) {
+            peak_ = used_;
+        }
+        ++allocCount_;
+        return reinterpret_cast<void*>(b->data);
     }
 
     virtual void free(void* p) override {
@@ -83,30 +93,51 @@ public:
             return;
         }
         BlockHeader* block = reinterpret_cast<BlockHeader*>(reinterpret_cast<uint8_t*>(p) - sizeof(BlockHeader));
-        if ((reinterpret_cast<uint8_t*>(block) + block->size) == ptr_) {
+        used_ -= block->size;
+        if (used_ == 0) {
+            // Everything has been released
+            clear();
+            return;
+        }
+        if (blockEnd(block) == ptr_) {
             ptr_ -= block->size;
         } else {
-            BlockHeader* ins = nullptr;
-            for(BlockHeader* b = freeList_; b != nullptr; b = b->next) {
-                if (block > b) {
-                    ins = b;
-                }
+            const int cls = binIndex(block->size);
+            if (cls >= 0) {
+                block->next = bins_[cls];
+                bins_[cls] = block;
+                return;
             }
-            if (ins == nullptr) {
-                if (freeList_ == nullptr) {
-                    freeListEnd_ = block;
-                }
-                block->next = freeList_;
-                freeList_ = block;
-            } else {
-                block->next = ins->next;
-                ins->next = block;
-                if (ins == freeListEnd_) {
-                    freeListEnd_ = block;
+            insertFree(block);
+        }
+        shrink();
+    }
+
+    void getStats(Stats* stats) const {
+        stats->total = size_;
+        stats->used = used_;
+        stats->peak = peak_;
+        stats->allocCount = allocCount_;
+        stats->failedCount = failedCount_;
+        size_t largest = (begin_ + size_) - ptr_;
+        for (BlockHeader* b = freeList_; b != nullptr; b = b->next) {
+            if (b->size > largest) {
+                largest = b->size;
+            }
+        }
+        for (int i = SIZE_CLASS_COUNT - 1; i >= 0; --i) {
+            if (bins_[i]) {
+                for (BlockHeader* b = bins_[i]; b != nullptr; b = b->next) {
+                    if (b->size > largest) {
+                        largest = b->size;
+                    }
                 }
+                break;
             }
         }
-        shrink();
+        const size_t freeSize = size_ - used_;
+        stats->largestFree = (largest > sizeof(BlockHeader)) ? largest - sizeof(BlockHeader) : 0;
+        stats->fragmentation = freeSize ? 100 - largest * 100 / freeSize : 0;
     }
 
     // FIXME: This API is here for compatibility with the existing system code and unit tests
@@ -129,10 +160,11 @@ protected:
 
     void reset(uint8_t* data = nullptr, size_t size = 0) {
         begin_ = data;
-        ptr_ = data;
         size_ = size;
-        freeList_ = nullptr;
-        freeListEnd_ = nullptr;
+        peak_ = 0;
+        allocCount_ = 0;
+        failedCount_ = 0;
+        clear();
     }
 
     uint8_t* begin_;
@@ -149,10 +181,164 @@ protected:
 
     static_assert(sizeof(BlockHeader) % sizeof(uintptr_t) == 0, "SimpleBasePool: size of header should be a multiple of uintptr_t");
 
+    static const int SIZE_CLASS_COUNT = SIMPLE_POOL_SIZE_CLASS_COUNT;
+    static const size_t MIN_CLASS_SIZE = sizeof(BlockHeader) * 2;
+
     static size_t aligned(size_t sz) {
         return (sz + (sizeof(uintptr_t) - (sz % sizeof(uintptr_t))));
     }
 
+    // Returns the size of a block for an allocation of the given size. A block can't be smaller
+    // than the smallest size class, which is also the minimum size of a split remainder
+    static size_t blockSizeFor(size_t size) {
+        const size_t sz = aligned(sizeof(BlockHeader) + size);
+        return (sz < MIN_CLASS_SIZE) ? MIN_CLASS_SIZE : sz;
+    }
+
+    // Size classes grow in steps of 1x and 1.5x of a power of two: 16, 24, 32, 48, 64, ...
+    static size_t classSize(int cls) {
+        const size_t sz = MIN_CLASS_SIZE << (cls / 2);
+        return (cls & 1) ? sz + sz / 2 : sz;
+    }
+
+    // Returns the smallest size class that fits a block of the given size
+    static int sizeClass(size_t blockSize) {
+        for (int i = 0; i < SIZE_CLASS_COUNT; ++i) {
+            if (blockSize <= classSize(i)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Returns the bin for a free block, which is the largest size class that doesn't exceed the
+    // size of the block, or -1 if the block is larger than the largest size class. Every block in
+    // a bin can serve any request of that bin's size class
+    static int binIndex(size_t blockSize) {
+        const int cls = sizeClass(blockSize);
+        if (cls < 0) {
+            return -1;
+        }
+        return (classSize(cls) == blockSize) ? cls : cls - 1;
+    }
+
+    static uint8_t* blockEnd(BlockHeader* block) {
+        return reinterpret_cast<uint8_t*>(block) + block->size;
+    }
+
+    BlockHeader* popBin(int cls) {
+        BlockHeader* b = bins_[cls];
+        if (b) {
+            bins_[cls] = b->next;
+        }
+        return b;
+    }
+
+    // Allocates a block from the unused space or the free list of large blocks
+    BlockHeader* allocBlock(size_t blockSize) {
+        if ((size_ - (ptr_ - begin_)) >= blockSize) {
+            BlockHeader* b = reinterpret_cast<BlockHeader*>(ptr_);
+            b->size = blockSize;
+            ptr_ += blockSize;
+            return b;
+        }
+        BlockHeader* candidate = nullptr;
+        BlockHeader* prev = nullptr;
+        for (BlockHeader* b = freeList_, *pr = nullptr; b != nullptr; pr = b, b = b->next) {
+            if (b->size >= blockSize) {
+#if SIMPLE_POOL_PREFER_SMALLER_BLOCK == 1
+                // Prefer smallest block
+                if (candidate == nullptr || candidate->size > b->size) {
+#else
+                // Prefer rightmost block
+                if (true) {
+#endif // SIMPLE_POOL_PREFER_SMALLER_BLOCK
+                    candidate = b;
+                    prev = pr;
+                }
+            }
+        }
+        if (candidate == nullptr) {
+            return nullptr;
+        }
+        if (candidate->size - blockSize >= MIN_CLASS_SIZE) {
+            // Split the block and leave the remainder in the free list
+            BlockHeader* rest = reinterpret_cast<BlockHeader*>(reinterpret_cast<uint8_t*>(candidate) + blockSize);
+            rest->size = candidate->size - blockSize;
+            rest->next = candidate->next;
+            candidate->size = blockSize;
+            candidate->next = rest;
+            if (candidate == freeListEnd_) {
+                freeListEnd_ = rest;
+            }
+        }
+        // Remove from free list
+        if (prev != nullptr) {
+            prev->next = candidate->next;
+        } else {
+            freeList_ = candidate->next;
+        }
+        if (candidate == freeListEnd_) {
+            freeListEnd_ = prev;
+        }
+        return candidate;
+    }
+
+    // Inserts a block into the address-ordered free list and merges it with adjacent free blocks
+    void insertFree(BlockHeader* block) {
+        BlockHeader* prev = nullptr;
+        BlockHeader* next = freeList_;
+        while (next != nullptr && next < block) {
+            prev = next;
+            next = next->next;
+        }
+        if (next != nullptr && blockEnd(block) == reinterpret_cast<uint8_t*>(next)) {
+            block->size += next->size;
+            next = next->next;
+        }
+        block->next = next;
+        if (prev != nullptr && blockEnd(prev) == reinterpret_cast<uint8_t*>(block)) {
+            prev->size += block->size;
+            prev->next = next;
+            block = prev;
+        } else if (prev != nullptr) {
+            prev->next = block;
+        } else {
+            freeList_ = block;
+        }
+        if (next == nullptr) {
+            freeListEnd_ = block;
+        }
+    }
+
+    // Moves the blocks from the segregated free lists to the free list of large blocks so that
+    // they can be coalesced. Returns false if there were no such blocks
+    bool reclaim() {
+        bool reclaimed = false;
+        for (int i = 0; i < SIZE_CLASS_COUNT; ++i) {
+            while (BlockHeader* b = popBin(i)) {
+                if (blockEnd(b) == ptr_) {
+                    ptr_ -= b->size;
+                } else {
+                    insertFree(b);
+                }
+                reclaimed = true;
+            }
+        }
+        shrink();
+        return reclaimed;
+    }
+
+    void clear() {
+        ptr_ = begin_;
+        used_ = 0;
+        freeList_ = nullptr;
+        freeListEnd_ = nullptr;
+        for (int i = 0; i < SIZE_CLASS_COUNT; ++i) {
+            bins_[i] = nullptr;
+        }
+    }
+
     BlockHeader* getPrevFree(BlockHeader* block) const {
         for (BlockHeader* b = freeList_; b != nullptr; b = b->next) {
             if (b->next == block) {
@@ -178,6 +364,12 @@ protected:
 
     BlockHeader* freeList_ = nullptr;
     BlockHeader* freeListEnd_ = nullptr;
+    BlockHeader* bins_[SIZE_CLASS_COUNT];
+
+    size_t used_;
+    size_t peak_;
+    size_t allocCount_;
+    size_t failedCount_;
 };
 
 class SimpleAllocedPool : public SimpleBasePool {
@@ -230,4 +422,37 @@ public:
             SimpleBasePool::free(ptr);
         }
     }
+
+    void getStats(Stats* stats) const {
+        ATOMIC_BLOCK() {
+            SimpleBasePool::getStats(stats);
+        }
+    }
+};
+
+class AtomicStaticPool: public SimpleBasePool {
+public:
+    AtomicStaticPool(void* ptr, size_t size) :
+        SimpleBasePool(ptr, size) {
+    }
+
+    virtual void* alloc(size_t size) override {
+        void* p = nullptr;
+        ATOMIC_BLOCK() {
+            p = SimpleBasePool::alloc(size);
+        }
+        return p;
+    }
+
+    virtual void free(void* ptr) override {
+        ATOMIC_BLOCK() {
+            SimpleBasePool::free(ptr);
+        }
+    }
+
+    void getStats(Stats* stats) const {
+        ATOMIC_BLOCK() {
+            SimpleBasePool::getStats(stats);
+        }
+    }
 };
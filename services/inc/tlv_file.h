@@ -19,12 +19,19 @@
 #define SERVICES_TLV_FILE_H
 
 #include "filesystem.h"
+#include "spark_wiring_vector.h"
 #include <stdio.h>
 
 namespace particle { namespace services { namespace settings {
 
-static constexpr uint32_t TLV_FILE_MAGICK = 0x714f11e5;
+/* Version 1 introduced deleted entries. The magic number was changed along with it so that
+ * older firmware, which ignores the entry flags, discards the file instead of reading stale values
+ */
+static constexpr uint32_t TLV_FILE_MAGICK = 0x714f11e6;
+static constexpr uint32_t TLV_FILE_MAGICK_V0 = 0x714f11e5;
 static constexpr uint32_t TLV_HEADER_MAGICK = 0x4ead;
+static constexpr uint16_t TLV_FILE_VERSION = 1;
+static constexpr uint16_t TLV_HEADER_FLAG_DELETED = 0x0001;
 
 class TlvFile {
 public:
@@ -36,6 +43,8 @@ public:
 
     int purge();
     int sync();
+    /* Removes deleted entries from the file */
+    int compact();
 
     uint16_t currentVersion() const;
     int fileVersion();
@@ -61,10 +70,24 @@ private:
         uint16_t magick;
         uint16_t key;
         uint16_t length;
-        uint16_t reserved;
+        uint16_t flags;
     } __attribute__((__packed__));
     static_assert(sizeof(TlvHeader) == sizeof(uint32_t) * 2, "sizeof(TlvHeader) != 8");
 
+    /* Location of a live entry in the file. The index is sorted by key and then by offset */
+    struct IndexEntry {
+        uint32_t offset;
+        uint16_t key;
+        uint16_t length;
+    };
+
+    /* Compaction is triggered automatically once the deleted entries take this many bytes
+     * and more than half of the file
+     */
+    static constexpr size_t COMPACT_THRESHOLD = 256;
+    /* Size of the buffer used to copy entries during compaction */
+    static constexpr size_t COMPACT_BUFFER_SIZE = 64;
+
 private:
     lfs_t* lfs();
 
@@ -74,7 +97,14 @@ private:
 
     int mkdir(char* dir);
 
-    ssize_t find(uint16_t key, int index, uint16_t* dataSize);
+    int buildIndex();
+    int indexOf(uint16_t key, uint32_t offset) const;
+    int find(uint16_t key, int index) const;
+    int markDeleted(uint16_t key, int index, int* first, int* count);
+    int append(uint16_t key, const uint8_t* value, uint16_t length);
+    int writeFooter();
+    int compactIfNeeded();
+    int copyLiveEntries(lfs_file_t* dest, size_t* size);
     int readFooter(FileFooter& footer);
 
     ssize_t seek(ssize_t offset, int whence = SEEK_SET);
@@ -87,6 +117,10 @@ private:
     bool open_ = false;
     filesystem_t* fs_ = nullptr;
     lfs_file_t file_ = {};
+
+    spark::Vector<IndexEntry> index_;
+    FileFooter footer_ = {};
+    size_t deletedSize_ = 0;
 };
 
 } } } /* namespace particle::services::settings */
@@ -111,4 +111,64 @@ constexpr size_t maxUnsignedVarintSize() {
     return (sizeof(T) * 8 + 6) / 7;
 }
 
+/**
+ * Map a signed integer to an unsigned integer so that values with a small magnitude have a small
+ * encoded representation (ZigZag encoding).
+ *
+ * The ZigZag encoding is described here:
+ * https://developers.google.com/protocol-buffers/docs/encoding#signed-integers
+ *
+ * @param val A value.
+ * @return Encoded value.
+ */
+inline uint32_t encodeZigZag(int32_t val) {
+    return ((uint32_t)val << 1) ^ (uint32_t)(val >> 31);
+}
+
+/**
+ * Decode a ZigZag-encoded integer.
+ *
+ * @param val Encoded value.
+ * @return Decoded value.
+ */
+inline int32_t decodeZigZag(uint32_t val) {
+    return (int32_t)((val >> 1) ^ (~(val & 1) + 1));
+}
+
+/**
+ * Encode a signed integer as a ZigZag varint.
+ *
+ * @param[out] buf Destination buffer.
+ * @param size Buffer size.
+ * @param val A value.
+ * @return The number of bytes written.
+ *
+ * @see encodeUnsignedVarint()
+ */
+inline int encodeSignedVarint(char* buf, size_t size, int32_t val) {
+    return encodeUnsignedVarint(buf, size, encodeZigZag(val));
+}
+
+/**
+ * Decode a ZigZag varint.
+ *
+ * @param buf Source buffer.
+ * @param size Buffer size.
+ * @param[out] val Pointer to the resulting value.
+ * @return The number of bytes read or a negative result code in case of an error.
+ *
+ * @see decodeUnsignedVarint()
+ */
+inline int decodeSignedVarint(const char* buf, size_t size, int32_t* val) {
+    uint32_t v = 0;
+    const int ret = decodeUnsignedVarint(buf, size, &v);
+    if (ret < 0) {
+        return ret;
+    }
+    if (val) {
+        *val = decodeZigZag(v);
+    }
+    return ret;
+}
+
 } // particle
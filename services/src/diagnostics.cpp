@@ -65,12 +65,24 @@ public:
         if (!started_) {
             return SYSTEM_ERROR_INVALID_STATE;
         }
-        const int index = indexForId(id);
-        if (index >= srcs_.size() || srcs_.at(index)->id != id) {
+        const diag_source* d = nullptr;
+        if (id < DIAG_ID_USER && !sysIndex_.isEmpty()) {
+            d = (id < sysIndex_.size()) ? sysIndex_.at(id) : nullptr;
+        } else if (id >= DIAG_ID_USER && !userIndex_.isEmpty()) {
+            const unsigned index = id - DIAG_ID_USER;
+            d = (index < (unsigned)userIndex_.size()) ? userIndex_.at(index) : nullptr;
+        } else {
+            // The IDs are too sparse for a direct-mapped index
+            const int index = indexForId(id);
+            if (index < srcs_.size() && srcs_.at(index)->id == id) {
+                d = srcs_.at(index);
+            }
+        }
+        if (!d) {
             return SYSTEM_ERROR_NOT_FOUND;
         }
         if (src) {
-            *src = srcs_.at(index);
+            *src = d;
         }
         return SYSTEM_ERROR_NONE;
     }
@@ -80,11 +92,17 @@ public:
 #if PLATFORM_ID == 3
         case DIAG_SERVICE_CMD_RESET:
             srcs_.clear();
+            sysIndex_.clear();
+            userIndex_.clear();
             started_ = 0;
             break;
 #endif
         case DIAG_SERVICE_CMD_START:
-            started_ = 1;
+            if (!started_) {
+                // The set of sources is fixed once the service is started
+                buildIndex();
+                started_ = 1;
+            }
             break;
         default:
             return SYSTEM_ERROR_NOT_SUPPORTED;
@@ -98,7 +116,12 @@ public:
     }
 
 private:
-    Vector<const diag_source*> srcs_;
+    // Maximum number of entries in a direct-mapped index
+    static const int MAX_INDEX_SIZE = 128;
+
+    Vector<const diag_source*> srcs_; // Sorted by ID
+    Vector<const diag_source*> sysIndex_; // Indexed by ID
+    Vector<const diag_source*> userIndex_; // Indexed by ID - DIAG_ID_USER
     volatile uint8_t started_;
 
     Diagnostics() :
@@ -106,6 +129,31 @@ private:
         srcs_.reserve(32);
     }
 
+    void buildIndex() {
+        // System sources precede user sources in the sorted array
+        const int userStart = indexForId(DIAG_ID_USER);
+        if (userStart > 0) {
+            buildIndex(&sysIndex_, 0, userStart, 0);
+        }
+        if (userStart < srcs_.size()) {
+            buildIndex(&userIndex_, userStart, srcs_.size(), DIAG_ID_USER);
+        }
+    }
+
+    void buildIndex(Vector<const diag_source*>* index, int begin, int end, unsigned baseId) {
+        const int size = srcs_.at(end - 1)->id - baseId + 1;
+        if (size > MAX_INDEX_SIZE || !index->resize(size)) {
+            // getSource() falls back to the binary search
+            index->clear();
+            return;
+        }
+        std::fill(index->begin(), index->end(), nullptr);
+        for (int i = begin; i < end; ++i) {
+            const diag_source* src = srcs_.at(i);
+            index->at(src->id - baseId) = src;
+        }
+    }
+
     int indexForId(uint16_t id) const {
         return std::distance(srcs_.begin(), std::lower_bound(srcs_.begin(), srcs_.end(), id,
                 [](const diag_source* src, uint16_t id) {
@@ -24,6 +24,9 @@
 #include "service_debug.h"
 #include "system_error.h"
 #include <algorithm>
+#include <memory>
+#include <new>
+#include <cstddef>
 
 /* FIXME: once filesystem interface is finalized, convert the implementation not to use
  * LittleFS API.
@@ -32,6 +35,13 @@
 using namespace particle::services::settings;
 using namespace particle::fs;
 
+namespace {
+
+/* Suffix of the temporary file the entries are copied to during compaction */
+const char* const COMPACT_FILE_SUFFIX = ".tmp";
+
+} /* namespace */
+
 TlvFile::TlvFile(const char* path) {
     SPARK_ASSERT(path != nullptr);
     path_ = strdup(path);
@@ -51,6 +61,10 @@ int TlvFile::init() {
 
     FsLock lk(fs);
 
+    if (open_) {
+        return 0;
+    }
+
     fs_ = fs;
 
     SPARK_ASSERT(!filesystem_mount(fs_));
@@ -108,184 +122,206 @@ ssize_t TlvFile::size() {
     return lfs_file_size(lfs(), &file_);
 }
 
-ssize_t TlvFile::get(uint16_t key, uint8_t* value, uint16_t length, int index) {
+int TlvFile::compact() {
     FsLock lk(fs_);
 
     if (!open_) {
         return SYSTEM_ERROR_INVALID_STATE;
     }
 
-    if (value == nullptr && length != 0) {
-        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    if (!deletedSize_) {
+        return 0;
     }
 
-    uint16_t dataSize;
-    ssize_t ret = SYSTEM_ERROR_NOT_FOUND;
-    ssize_t pos = find(key, index, &dataSize);
-    if (pos >= 0) {
-        /* Found it */
-        const size_t toRead = std::min(length, dataSize);
-        if (toRead) {
-            ret = seek(pos + sizeof(TlvHeader));
-            if (ret >= 0) {
-                ret = read(value, toRead);
-            }
+    /* Copy live entries to a temporary file and replace the original file with it, so that
+     * a failure in the middle of the compaction leaves the original file intact
+     */
+    const size_t pathLen = strlen(path_);
+    std::unique_ptr<char[]> tmpPath(new(std::nothrow) char[pathLen + strlen(COMPACT_FILE_SUFFIX) + 1]);
+    if (!tmpPath) {
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+    memcpy(tmpPath.get(), path_, pathLen);
+    strcpy(tmpPath.get() + pathLen, COMPACT_FILE_SUFFIX);
+
+    lfs_file_t tmpFile = {};
+    int ret = lfs_file_open(lfs(), &tmpFile, tmpPath.get(), LFS_O_CREAT | LFS_O_TRUNC | LFS_O_RDWR);
+    if (ret < 0) {
+        return ret;
+    }
+
+    size_t size = 0;
+    ret = copyLiveEntries(&tmpFile, &size);
+    if (ret >= 0) {
+        FileFooter footer = footer_;
+        footer.magick = TLV_FILE_MAGICK;
+        footer.version = TLV_FILE_VERSION;
+        footer.size = size;
+        ret = lfs_file_write(lfs(), &tmpFile, &footer, sizeof(footer));
+        if (ret >= 0 && ret != sizeof(footer)) {
+            ret = SYSTEM_ERROR_IO;
         }
     }
+    int r = lfs_file_close(lfs(), &tmpFile);
+    if (ret >= 0) {
+        ret = r;
+    }
+    if (ret < 0) {
+        lfs_remove(lfs(), tmpPath.get());
+        return ret;
+    }
 
-    return ret;
+    close();
+    ret = lfs_rename(lfs(), tmpPath.get(), path_);
+    if (ret < 0) {
+        lfs_remove(lfs(), tmpPath.get());
+    }
+    /* The index is rebuilt when the file is reopened */
+    r = open();
+
+    return (ret < 0) ? ret : r;
 }
 
-int TlvFile::set(uint16_t key, const uint8_t* value, uint16_t length, int index) {
+uint16_t TlvFile::currentVersion() const {
+    return TLV_FILE_VERSION;
+}
+
+int TlvFile::fileVersion() {
     FsLock lk(fs_);
 
     if (!open_) {
         return SYSTEM_ERROR_INVALID_STATE;
     }
 
-    /* Delete previous entry */
-    int ret = del(key, index);
-    if (!(ret == 0 || ret == SYSTEM_ERROR_NOT_FOUND)) {
-        return ret;
-    }
-
-    return add(key, value, length);
+    return footer_.version;
 }
 
-int TlvFile::add(uint16_t key, const uint8_t* value, uint16_t length) {
+ssize_t TlvFile::get(uint16_t key, uint8_t* value, uint16_t length, int index) {
     FsLock lk(fs_);
 
     if (!open_) {
         return SYSTEM_ERROR_INVALID_STATE;
     }
 
-    FileFooter footer;
-    int ret = readFooter(footer);
-    if (ret < 0) {
-        return ret;
+    if (value == nullptr && length != 0) {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
     }
-    ssize_t pos = footer.size;
 
-    if (pos < 0) {
-        return pos;
+    const int i = find(key, index);
+    if (i < 0) {
+        return i;
     }
 
-    ret = seek(pos);
-    if (ret < 0) {
-        return ret;
+    const IndexEntry& entry = index_.at(i);
+    ssize_t ret = SYSTEM_ERROR_NOT_FOUND;
+    const size_t toRead = std::min(length, entry.length);
+    if (toRead) {
+        ret = seek(entry.offset + sizeof(TlvHeader));
+        if (ret >= 0) {
+            ret = read(value, toRead);
+        }
     }
 
-    TlvHeader header = {};
-    header.magick = TLV_HEADER_MAGICK;
-    header.key = key;
-    header.length = length;
+    return ret;
+}
 
-    /* Write entry header */
-    ret = write((const uint8_t*)&header, sizeof(header));
-    if (ret < 0) {
-        return ret;
+int TlvFile::set(uint16_t key, const uint8_t* value, uint16_t length, int index) {
+    FsLock lk(fs_);
+
+    if (!open_) {
+        return SYSTEM_ERROR_INVALID_STATE;
     }
-    /* Write data */
-    ret = write((const uint8_t*)value, length);
-    if (ret < 0) {
+
+    /* Mark previous entry as deleted and append the new one. Both changes are committed by a
+     * single sync
+     */
+    int first = 0;
+    int count = 0;
+    int ret = markDeleted(key, index, &first, &count);
+    if (ret < 0 && ret != SYSTEM_ERROR_NOT_FOUND) {
+        if (open_) {
+            buildIndex();
+        }
         return ret;
     }
-    /* Write file footer */
-    footer.magick = TLV_FILE_MAGICK;
-    footer.size += sizeof(header) + length;
-    ret = write((const uint8_t*)&footer, sizeof(footer));
+
+    ret = append(key, value, length);
     if (ret < 0) {
         return ret;
     }
 
-    return sync();
+    for (int i = first; i < first + count; ++i) {
+        deletedSize_ += sizeof(TlvHeader) + index_.at(i).length;
+    }
+    if (count > 0) {
+        index_.removeAt(first, count);
+    }
+
+    const IndexEntry entry = { (uint32_t)ret, key, length };
+    if (!index_.insert(indexOf(key, entry.offset), entry)) {
+        buildIndex();
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+
+    /* The new value is already stored, a failed compaction doesn't affect it */
+    compactIfNeeded();
+
+    return 0;
 }
 
-int TlvFile::del(uint16_t key, int index) {
+int TlvFile::add(uint16_t key, const uint8_t* value, uint16_t length) {
     FsLock lk(fs_);
 
     if (!open_) {
         return SYSTEM_ERROR_INVALID_STATE;
     }
 
-    int ret = 0;
-
-    for (;;) {
-        uint16_t dataSize = 0;
-        ssize_t pos = find(key, index, &dataSize);
-        if (pos < 0) {
-            return pos;
-        }
-
-        /* FIXME: this will only work on LittleFS. Provide a different implementation later
-         * when filesystem API is finalized and TlvFile implementation is refactored not to use
-         * LittleFS API.
-         */
-        const ssize_t fileSize = size();
-
-        FileFooter footer;
-        ret = readFooter(footer);
-
-        while (ret == 0) {
-            lfs_file_t f;
-            ret = lfs_file_open(lfs(), &f, path_, LFS_O_RDONLY);
-            if (ret) {
-                break;
-            }
-
-            size_t wpos = pos;
-            size_t rpos = wpos + sizeof(TlvHeader) + dataSize;
-
-            ret = seek(wpos);
-            if (ret < 0) {
-                break;
-            }
-
-            ret = lfs_file_seek(lfs(), &f, rpos, LFS_SEEK_SET);
-            if (ret < 0) {
-                break;
-            }
+    const int ret = append(key, value, length);
+    if (ret < 0) {
+        return ret;
+    }
 
-            for (; rpos < footer.size && ret > 0; ++wpos, ++rpos) {
-                uint8_t tmp;
-                ret = lfs_file_read(lfs(), &f, &tmp, sizeof(tmp));
-                if (ret < 0) {
-                    break;
-                }
+    const IndexEntry entry = { (uint32_t)ret, key, length };
+    if (!index_.insert(indexOf(key, entry.offset), entry)) {
+        buildIndex();
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
 
-                ret = write(&tmp, sizeof(tmp));
-                if (ret < 0) {
-                    break;
-                }
-            }
+    return 0;
+}
 
-            if (ret > 0) {
-                /* Write footer */
-                footer.size -= sizeof(TlvHeader) + dataSize;
-                ret = write((const uint8_t*)&footer, sizeof(footer));
-                if (ret < 0) {
-                    break;
-                }
-                /* Truncate */
-                ret = lfs_file_truncate(lfs(), &file_, fileSize - (sizeof(TlvHeader) + dataSize));
-                if (ret < 0) {
-                    break;
-                }
-                ret = sync();
-            }
+int TlvFile::del(uint16_t key, int index) {
+    FsLock lk(fs_);
 
-            lfs_file_close(lfs(), &f);
+    if (!open_) {
+        return SYSTEM_ERROR_INVALID_STATE;
+    }
 
-            break;
+    int first = 0;
+    int count = 0;
+    int ret = markDeleted(key, index, &first, &count);
+    if (ret < 0) {
+        if (ret != SYSTEM_ERROR_NOT_FOUND && open_) {
+            buildIndex();
         }
+        return ret;
+    }
 
+    ret = sync();
+    if (ret < 0) {
+        return ret;
+    }
 
-        if (ret || index >= 0) {
-            break;
-        }
+    for (int i = first; i < first + count; ++i) {
+        deletedSize_ += sizeof(TlvHeader) + index_.at(i).length;
+    }
+    if (count > 0) {
+        index_.removeAt(first, count);
     }
 
-    return ret;
+    compactIfNeeded();
+
+    return 0;
 }
 
 lfs_t* TlvFile::lfs() {
@@ -307,14 +343,17 @@ int TlvFile::open() {
     }
 
     open_ = true;
-    FileFooter footer = {};
 
-    if (!validate()) {
+    if (!validate() && !buildIndex()) {
         goto open_done;
     }
 
-    footer.magick = TLV_FILE_MAGICK;
-    footer.size = 0;
+    index_.clear();
+    deletedSize_ = 0;
+    footer_ = {};
+    footer_.magick = TLV_FILE_MAGICK;
+    footer_.version = TLV_FILE_VERSION;
+    footer_.size = 0;
 
     /* Validation failed, create anew */
     r = lfs_file_truncate(lfs(), &file_, 0);
@@ -327,7 +366,7 @@ int TlvFile::open() {
         goto open_done;
     }
 
-    r = lfs_file_write(lfs(), &file_, &footer, sizeof(footer));
+    r = lfs_file_write(lfs(), &file_, &footer_, sizeof(footer_));
     if (r < 0) {
         goto open_done;
     }
@@ -346,7 +385,8 @@ int TlvFile::validate() {
     FileFooter footer = {};
     int ret = readFooter(footer);
     if (!ret) {
-        if (footer.magick != TLV_FILE_MAGICK) {
+        const bool v0 = (footer.magick == TLV_FILE_MAGICK_V0 && footer.version == 0);
+        if (!v0 && (footer.magick != TLV_FILE_MAGICK || footer.version > TLV_FILE_VERSION)) {
             ret = SYSTEM_ERROR_BAD_DATA;
         }
     }
@@ -364,6 +404,8 @@ int TlvFile::close() {
     /* Close */
 
     open_ = false;
+    index_.clear();
+    deletedSize_ = 0;
 
     return lfs_file_close(lfs(), &file_);
 }
@@ -441,19 +483,17 @@ int TlvFile::readFooter(FileFooter& footer) {
     return SYSTEM_ERROR_BAD_DATA;
 }
 
-ssize_t TlvFile::find(uint16_t key, int index, uint16_t* dataSize) {
-    FileFooter footer;
-    int r = readFooter(footer);
+int TlvFile::buildIndex() {
+    index_.clear();
+    deletedSize_ = 0;
+
+    int r = readFooter(footer_);
     if (r) {
         return r;
     }
 
-    ssize_t candidatePos = -1;
-    int candidateIdx = -1;
-    uint16_t candidateSize = 0;
-
     TlvHeader header;
-    for (ssize_t pos = 0; pos >= 0 && (pos + sizeof(TlvHeader)) <= footer.size;) {
+    for (size_t pos = 0; (pos + sizeof(TlvHeader)) <= footer_.size;) {
         r = seek(pos);
         if (r < 0) {
             return r;
@@ -465,31 +505,201 @@ ssize_t TlvFile::find(uint16_t key, int index, uint16_t* dataSize) {
         }
 
         if (header.magick != TLV_HEADER_MAGICK) {
-            /* Attempt to recover */
+            /* Attempt to recover. The garbage is removed by the compaction */
             pos += sizeof(uint16_t);
+            deletedSize_ += sizeof(uint16_t);
             continue;
         }
 
-        if (header.key == key) {
-            candidatePos = pos;
-            ++candidateIdx;
-            candidateSize = header.length;
-            if (index >= 0 && candidateIdx >= index) {
-                break;
+        const size_t entrySize = sizeof(TlvHeader) + header.length;
+        if (header.flags & TLV_HEADER_FLAG_DELETED) {
+            deletedSize_ += entrySize;
+        } else {
+            /* Entries are scanned in the order of their offsets */
+            const IndexEntry entry = { (uint32_t)pos, header.key, header.length };
+            if (!index_.insert(indexOf(entry.key, entry.offset), entry)) {
+                return SYSTEM_ERROR_NO_MEMORY;
             }
         }
 
-        pos += sizeof(TlvHeader) + header.length;
+        pos += entrySize;
+    }
+
+    return 0;
+}
+
+int TlvFile::indexOf(uint16_t key, uint32_t offset) const {
+    return std::distance(index_.begin(), std::lower_bound(index_.begin(), index_.end(), key,
+            [offset](const IndexEntry& entry, uint16_t key) {
+                return entry.key < key || (entry.key == key && entry.offset < offset);
+            }));
+}
+
+int TlvFile::find(uint16_t key, int index) const {
+    const int first = indexOf(key, 0);
+    const int last = indexOf(key, UINT32_MAX);
+    if (first == last) {
+        return SYSTEM_ERROR_NOT_FOUND;
+    }
+
+    if (index < 0) {
+        return last - 1;
+    }
+
+    if (index >= last - first) {
+        return SYSTEM_ERROR_NOT_FOUND;
+    }
+
+    return first + index;
+}
+
+int TlvFile::markDeleted(uint16_t key, int index, int* first, int* count) {
+    if (index >= 0) {
+        const int i = find(key, index);
+        if (i < 0) {
+            return i;
+        }
+        *first = i;
+        *count = 1;
+    } else {
+        *first = indexOf(key, 0);
+        *count = indexOf(key, UINT32_MAX) - *first;
+        if (!*count) {
+            return SYSTEM_ERROR_NOT_FOUND;
+        }
+    }
+
+    const uint16_t flags = TLV_HEADER_FLAG_DELETED;
+    for (int i = *first; i < *first + *count; ++i) {
+        ssize_t r = seek(index_.at(i).offset + offsetof(TlvHeader, flags));
+        if (r < 0) {
+            return r;
+        }
+        r = write((const uint8_t*)&flags, sizeof(flags));
+        if (r < 0) {
+            return r;
+        }
+    }
+
+    if (footer_.magick != TLV_FILE_MAGICK) {
+        /* Files with deleted entries must not be readable by older firmware */
+        const int r = writeFooter();
+        if (r < 0) {
+            return r;
+        }
+    }
+
+    return 0;
+}
+
+int TlvFile::append(uint16_t key, const uint8_t* value, uint16_t length) {
+    const size_t pos = footer_.size;
+    ssize_t ret = seek(pos);
+    if (ret < 0) {
+        return ret;
+    }
+
+    TlvHeader header = {};
+    header.magick = TLV_HEADER_MAGICK;
+    header.key = key;
+    header.length = length;
+
+    /* Write entry header */
+    ret = write((const uint8_t*)&header, sizeof(header));
+    if (ret < 0) {
+        return ret;
+    }
+    /* Write data */
+    ret = write((const uint8_t*)value, length);
+    if (ret < 0) {
+        return ret;
+    }
+    /* Write file footer */
+    footer_.size += sizeof(header) + length;
+    ret = writeFooter();
+    if (ret >= 0) {
+        ret = sync();
+    }
+    if (ret < 0) {
+        if (open_) {
+            buildIndex();
+        }
+        return ret;
+    }
+
+    return pos;
+}
+
+int TlvFile::writeFooter() {
+    footer_.magick = TLV_FILE_MAGICK;
+    footer_.version = TLV_FILE_VERSION;
+    const ssize_t r = seek(footer_.size);
+    if (r < 0) {
+        return r;
     }
+    return write((const uint8_t*)&footer_, sizeof(footer_));
+}
 
-    if ((index >= 0 && candidateIdx == index) || (index < 0 && candidateIdx >= 0)) {
-        if (dataSize) {
-            *dataSize = candidateSize;
+int TlvFile::copyLiveEntries(lfs_file_t* dest, size_t* size) {
+    uint8_t buf[COMPACT_BUFFER_SIZE];
+    size_t wpos = 0;
+    size_t rpos = 0;
+    while (rpos + sizeof(TlvHeader) <= footer_.size) {
+        TlvHeader header;
+        ssize_t ret = seek(rpos);
+        if (ret < 0) {
+            return ret;
+        }
+        ret = read((uint8_t*)&header, sizeof(header));
+        if (ret < (ssize_t)sizeof(header)) {
+            return SYSTEM_ERROR_BAD_DATA;
+        }
+
+        if (header.magick != TLV_HEADER_MAGICK) {
+            /* Garbage is dropped */
+            rpos += sizeof(uint16_t);
+            continue;
+        }
+
+        const size_t entrySize = sizeof(TlvHeader) + header.length;
+        if (!(header.flags & TLV_HEADER_FLAG_DELETED)) {
+            for (size_t offs = 0; offs < entrySize;) {
+                const size_t n = std::min(entrySize - offs, sizeof(buf));
+                ret = seek(rpos + offs);
+                if (ret < 0) {
+                    return ret;
+                }
+                ret = read(buf, n);
+                if (ret < 0) {
+                    return ret;
+                }
+                if ((size_t)ret != n) {
+                    return SYSTEM_ERROR_BAD_DATA;
+                }
+                ret = lfs_file_write(lfs(), dest, buf, n);
+                if (ret < 0) {
+                    return ret;
+                }
+                if ((size_t)ret != n) {
+                    return SYSTEM_ERROR_IO;
+                }
+                offs += n;
+            }
+            wpos += entrySize;
         }
-        return candidatePos;
+        rpos += entrySize;
     }
 
-    return SYSTEM_ERROR_NOT_FOUND;
+    *size = wpos;
+
+    return 0;
+}
+
+int TlvFile::compactIfNeeded() {
+    if (deletedSize_ < COMPACT_THRESHOLD || deletedSize_ * 2 <= footer_.size) {
+        return 0;
+    }
+    return compact();
 }
 
 #endif /* HAL_PLATFORM_FILESYSTEM == 1 */
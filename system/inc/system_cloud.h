@@ -341,7 +341,8 @@ ProtocolFacade* system_cloud_protocol_instance(void);
 typedef enum spark_connection_property {
     SPARK_CLOUD_PING_INTERVAL = 0, ///< Ping interval in milliseconds.
     SPARK_CLOUD_FAST_OTA_ENABLED = 1, ///< Fast OTA override.
-    SPARK_CLOUD_DISCONNECT_OPTIONS = 2 ///< Default disconnection options.
+    SPARK_CLOUD_DISCONNECT_OPTIONS = 2, ///< Default disconnection options.
+    SPARK_CLOUD_VITALS_DELTA_ENCODING = 3 ///< Maximum number of delta-encoded vitals messages between full snapshots (0 disables delta encoding).
 } spark_connection_property;
 
 int spark_set_connection_property(unsigned property, unsigned value, const void* data, void* reserved);
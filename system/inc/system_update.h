@@ -159,6 +159,15 @@ int system_set_flag(system_flag_t flag, uint8_t value, void* reserved);
 int system_get_flag(system_flag_t flag, uint8_t* value,void* reserved);
 int system_refresh_flag(system_flag_t flag);
 
+typedef enum {
+    /**
+     * Binary format: a 4-byte header (size of a source ID and size of a value, 16 bits each)
+     * followed by a fixed-size record (ID, value) per data source. The size of the formatted data
+     * is known upfront, see system_diag_data_binary_size().
+     */
+    SYSTEM_FORMAT_DIAG_FLAG_BINARY = 0x0001
+} system_format_diag_flags_t;
+
 /**
  * Formats the diagnostic data using an appender function.
  *
@@ -172,6 +181,14 @@ int system_refresh_flag(system_flag_t flag);
 int system_format_diag_data(const uint16_t* id, size_t count, unsigned flags, appender_fn append, void* append_data,
         void* reserved);
 
+/**
+ * Returns the size of the diagnostic data formatted with SYSTEM_FORMAT_DIAG_FLAG_BINARY, or a
+ * negative result code in case of an error.
+ *
+ * @param count Number of data source IDs, or 0 to query the size of all registered data sources.
+ */
+int system_diag_data_binary_size(size_t count);
+
 #ifdef __cplusplus
 }
 #endif
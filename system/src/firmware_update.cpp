@@ -423,6 +423,11 @@ void FirmwareUpdate::endUpdate(bool ok) {
     }
 #if HAL_PLATFORM_RESUMABLE_OTA
     transferState_.reset();
+#endif
+#if HAL_PLATFORM_COMPRESSED_OTA
+    if (!ok) {
+        HAL_FLASH_Cancel(nullptr /* reserved */);
+    }
 #endif
     if (!ledOverridden_) {
         RGB.control(false);
@@ -462,6 +462,27 @@ void applicationSetupDone() {
     }
 }
 
+#if HAL_PLATFORM_BOOT_TIMING
+
+void logBootTiming() {
+    hal_boot_phase_complete(HAL_BOOT_PHASE_SYSTEM_INIT);
+    if (LOG_ENABLED(TRACE)) {
+        uint32_t phaseTime[HAL_BOOT_PHASE_COUNT] = {};
+        uint32_t totalTime = 0;
+        for (int i = 0; i < HAL_BOOT_PHASE_COUNT; ++i) {
+            phaseTime[i] = hal_boot_phase_duration((hal_boot_phase)i);
+            totalTime += phaseTime[i];
+        }
+        LOG(TRACE, "Time to setup(): %u us (low-level init: %u us, user module validation: %u us, core config: %u us, "
+                "module validation: %u us, system init: %u us)", (unsigned)totalTime,
+                (unsigned)phaseTime[HAL_BOOT_PHASE_LOW_LEVEL_INIT], (unsigned)phaseTime[HAL_BOOT_PHASE_USER_MODULE_VALIDATION],
+                (unsigned)phaseTime[HAL_BOOT_PHASE_CORE_CONFIG], (unsigned)phaseTime[HAL_BOOT_PHASE_MODULE_VALIDATION],
+                (unsigned)phaseTime[HAL_BOOT_PHASE_SYSTEM_INIT]);
+    }
+}
+
+#endif // HAL_PLATFORM_BOOT_TIMING
+
 } // namespace
 
 void app_loop(bool threaded)
@@ -489,6 +510,9 @@ void app_loop(bool threaded)
             if (SPARK_WIRING_APPLICATION != 1) {
                 //Execute user application setup only once
                 DECLARE_SYS_HEALTH(ENTERED_Setup);
+#if HAL_PLATFORM_BOOT_TIMING
+                logBootTiming();
+#endif
                 if (system_mode() != SAFE_MODE) {
                     setup();
                 }
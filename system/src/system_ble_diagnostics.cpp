@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hal_platform.h"
+
+#if HAL_PLATFORM_BLE
+
+#include "ble_hal.h"
+#include "check.h"
+#include "spark_wiring_diagnostics.h"
+
+namespace {
+
+using namespace particle;
+
+int getLinkTotals(hal_ble_link_totals_t* totals) {
+    *totals = {};
+    totals->size = sizeof(hal_ble_link_totals_t);
+    return hal_ble_gap_get_link_totals(totals, nullptr);
+}
+
+class BleRssiDiagnosticData: public AbstractIntegerDiagnosticData {
+public:
+    BleRssiDiagnosticData() :
+            AbstractIntegerDiagnosticData(DIAG_ID_BLE_RSSI, DIAG_NAME_BLE_RSSI) {
+    }
+
+    virtual int get(IntType& val) override {
+        hal_ble_link_totals_t totals;
+        CHECK(getLinkTotals(&totals));
+        val = totals.rssi;
+        return SYSTEM_ERROR_NONE;
+    }
+} g_bleRssiDiagData;
+
+// Diagnostic data source reporting a counter of the combined link statistics
+class BleLinkTotalsDiagnosticData: public AbstractUnsignedIntegerDiagnosticData {
+public:
+    typedef uint32_t hal_ble_link_totals_t::*Field;
+
+    BleLinkTotalsDiagnosticData(uint16_t id, const char* name, Field field) :
+            AbstractUnsignedIntegerDiagnosticData(id, name),
+            field_(field) {
+    }
+
+    virtual int get(IntType& val) override {
+        hal_ble_link_totals_t totals;
+        CHECK(getLinkTotals(&totals));
+        val = totals.*field_;
+        return SYSTEM_ERROR_NONE;
+    }
+
+private:
+    Field field_;
+};
+
+BleLinkTotalsDiagnosticData g_bleTxPacketsDiagData(DIAG_ID_BLE_TX_PACKETS, DIAG_NAME_BLE_TX_PACKETS,
+        &hal_ble_link_totals_t::tx_packets);
+BleLinkTotalsDiagnosticData g_bleRxPacketsDiagData(DIAG_ID_BLE_RX_PACKETS, DIAG_NAME_BLE_RX_PACKETS,
+        &hal_ble_link_totals_t::rx_packets);
+BleLinkTotalsDiagnosticData g_bleThroughputDiagData(DIAG_ID_BLE_THROUGHPUT, DIAG_NAME_BLE_THROUGHPUT,
+        &hal_ble_link_totals_t::throughput);
+
+} // namespace
+
+#endif // HAL_PLATFORM_BLE
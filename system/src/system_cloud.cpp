@@ -44,6 +44,7 @@
 #include "events.h"
 #include "deviceid_hal.h"
 #include "system_mode.h"
+#include "spark_wiring_diagnostics.h"
 
 #if PLATFORM_THREADING
 #include "spark_wiring_timer.h"
@@ -62,6 +63,22 @@ VitalsPublisher<Timer> _vitals;
 VitalsPublisher<particle::NullTimer> _vitals;
 #endif // PLATFORM_THREADING
 
+// Bytes saved by delta encoding of the vitals since it was last enabled
+class VitalsBytesSavedDiagnosticData: public particle::AbstractUnsignedIntegerDiagnosticData {
+public:
+    VitalsBytesSavedDiagnosticData() :
+            AbstractUnsignedIntegerDiagnosticData(DIAG_ID_CLOUD_VITALS_BYTES_SAVED, DIAG_NAME_CLOUD_VITALS_BYTES_SAVED) {
+    }
+
+    virtual int get(IntType& val) override {
+        const auto encoder = _vitals.deltaEncoder();
+        val = encoder ? encoder->bytesSaved() : 0;
+        return 0; // OK
+    }
+};
+
+VitalsBytesSavedDiagnosticData g_vitalsBytesSavedDiagData;
+
 // These properties are forwarded to the protocol instance as is
 static_assert(SPARK_CLOUD_PING_INTERVAL == (int)particle::protocol::Connection::PING,
         "The value of SPARK_CLOUD_PING_INTERVAL has changed");
@@ -70,6 +87,11 @@ static_assert(SPARK_CLOUD_FAST_OTA_ENABLED == (int)particle::protocol::Connectio
 
 } // namespace
 
+particle::system::VitalsDeltaEncoder* particle::system::vitalsDeltaEncoder(void)
+{
+    return _vitals.deltaEncoder();
+}
+
 SubscriptionScope::Enum convert(Spark_Subscription_Scope_TypeDef subscription_type)
 {
     return(subscription_type==MY_DEVICES) ? SubscriptionScope::MY_DEVICES : SubscriptionScope::FIREHOSE;
@@ -271,6 +293,9 @@ int spark_set_connection_property(unsigned property, unsigned value, const void*
         particle::CloudConnectionSettings::instance()->setDefaultDisconnectOptions(std::move(opts));
         return 0;
     }
+    case SPARK_CLOUD_VITALS_DELTA_ENCODING: {
+        return _vitals.deltaEncoding(value);
+    }
     // These properties are forwarded to the protocol instance as is
     case SPARK_CLOUD_PING_INTERVAL:
     case SPARK_CLOUD_FAST_OTA_ENABLED: {
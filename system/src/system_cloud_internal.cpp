@@ -30,7 +30,6 @@
 #include "system_user.h"
 #include "spark_wiring_string.h"
 #include "spark_protocol_functions.h"
-#include "append_list.h"
 #include "core_hal.h"
 #include "deviceid_hal.h"
 #include "ota_flash_hal.h"
@@ -48,6 +47,7 @@
 #include "bytes2hexbuf.h"
 #include "system_event.h"
 #include "system_cloud_connection.h"
+#include "system_publish_vitals.h"
 #include "system_network_internal.h"
 #include "str_util.h"
 #include "scope_guard.h"
@@ -136,22 +136,15 @@ ProtocolFacade* system_cloud_protocol_instance(void)
     return sp;
 }
 
-static append_list<User_Var_Lookup_Table_t> vars(5);
-static append_list<User_Func_Lookup_Table_t> funcs(5);
+static UserVarRegistry vars;
+static UserFuncRegistry funcs;
 
 User_Var_Lookup_Table_t* find_var_by_key(const char* varKey)
 {
-    for (int i = vars.size(); i-->0; )
-    {
-        if (0 == strncmp(vars[i].userVarKey, varKey, USER_VAR_KEY_LENGTH))
-        {
-            return &vars[i];
-        }
-    }
-    return NULL;
+    return vars.find(varKey);
 }
 
-template<typename T> T* add_if_sufficient_describe(append_list<T>& list, const char* name, const char* itemType, const T& value) {
+template<typename T, typename TraitsT> T* add_if_sufficient_describe(particle::protocol::CloudRegistry<T, TraitsT>& list, const char* name, const char* itemType, const T& value) {
 	T* result = list.add(value);
 	if (result) {
 		spark_protocol_describe_data data;
@@ -168,7 +161,7 @@ template<typename T> T* add_if_sufficient_describe(append_list<T>& list, const c
 		}
 	}
 	if (!result) {
-		ERROR("Cannot add %s named %d: insufficient storage", itemType, name);
+		ERROR("Cannot add %s named %s: insufficient storage", itemType, name);
 	}
 	return result;
 }
@@ -186,27 +179,21 @@ User_Var_Lookup_Table_t* find_var_by_key_or_add(const char* varKey, const void*
 	}
 	memcpy(item.userVarKey, varKey, USER_VAR_KEY_LENGTH);
 
-    User_Var_Lookup_Table_t* result = find_var_by_key(varKey);
-
-    if (!result) {
+    User_Var_Lookup_Table_t* result = nullptr;
+    const int index = vars.indexOf(varKey);
+    if (index < 0) {
     	result = add_if_sufficient_describe(vars, varKey, "variable", item);
     }
     else {
-    	*result = item;
+    	vars.replace(index, item);
+    	result = &vars[index];
     }
     return result;
 }
 
 User_Func_Lookup_Table_t* find_func_by_key(const char* funcKey)
 {
-    for (int i = funcs.size(); i-->0; )
-    {
-        if (0 == strncmp(funcs[i].userFuncKey, funcKey, USER_FUNC_KEY_LENGTH))
-        {
-            return &funcs[i];
-        }
-    }
-    return NULL;
+    return funcs.find(funcKey);
 }
 
 User_Func_Lookup_Table_t* find_func_by_key_or_add(const char* funcKey, const cloud_function_descriptor* desc)
@@ -216,9 +203,11 @@ User_Func_Lookup_Table_t* find_func_by_key_or_add(const char* funcKey, const clo
 	item.pUserFuncData = desc->data;
     memcpy(item.userFuncKey, desc->funcKey, USER_FUNC_KEY_LENGTH);
 
-    User_Func_Lookup_Table_t* result = find_func_by_key(funcKey);
-    if (result) {
-    	*result = item;
+    User_Func_Lookup_Table_t* result = nullptr;
+    const int index = funcs.indexOf(funcKey);
+    if (index >= 0) {
+    	funcs.replace(index, item);
+    	result = &funcs[index];
     }
     else {
     	result = add_if_sufficient_describe(funcs, funcKey, "function", item);
@@ -233,60 +222,12 @@ int call_raw_user_function(void* data, const char* param, void* reserved)
     return (*fn)(p);
 }
 
-inline uint32_t crc(const void* data, size_t len)
-{
-	return HAL_Core_Compute_CRC32((const uint8_t*)data, len);
-}
-
-template <typename T>
-uint32_t crc(const T& t)
-{
-	return crc(&t, sizeof(t));
-}
-
-uint32_t string_crc(const char* s)
-{
-	return crc(s, strlen(s));
-}
-
-/**
- * Computes the checksum of the registered functions.
- * The function name is used to compute the checksum.
- */
-uint32_t compute_functions_checksum()
-{
-	uint32_t checksum = 0;
-	for (int i = funcs.size(); i-->0; )
-    {
-		checksum += string_crc(funcs[i].userFuncKey);
-    }
-	return checksum;
-}
-
-/**
- * Computes the checksum of the registered variables.
- * The checksum is derived from the variable name and type.
- */
-uint32_t compute_variables_checksum()
-{
-	uint32_t checksum = 0;
-	for (int i = vars.size(); i-->0; )
-	{
-		checksum += string_crc(vars[i].userVarKey);
-		checksum += crc(vars[i].userVarType);
-	}
-	return checksum;
-}
-
 /**
  * Computes the checksum of all functions and variables.
  */
 uint32_t compute_describe_app_checksum()
 {
-	uint32_t chk[2];
-	chk[0] = compute_variables_checksum();
-	chk[1] = compute_functions_checksum();
-	return crc(chk, sizeof(chk));
+	return particle::system::compute_describe_app_checksum(vars, funcs);
 }
 
 uint32_t compute_describe_system_checksum()
@@ -1140,6 +1081,11 @@ int Spark_Handshake(bool presence_announce)
     } else if (err != 0) {
         return spark_protocol_to_system_error(err);
     }
+    // The baseline of the delta-encoded vitals is not known to the cloud in a new session
+    const auto vitalsEncoder = particle::system::vitalsDeltaEncoder();
+    if (vitalsEncoder) {
+        vitalsEncoder->reset();
+    }
     if (!session_resumed) {
         char buf[CLAIM_CODE_SIZE + 1];
         if (!HAL_Get_Claim_Code(buf, sizeof(buf)) && buf[0] != 0 && (uint8_t)buf[0] != 0xff) {
@@ -26,6 +26,7 @@
 #include "spark_wiring_diagnostics.h"
 #include "spark_wiring_cloud.h"
 #include "atomic_flag_mutex.h"
+#include "system_cloud_registry.h"
 
 void Spark_Signal(bool on, unsigned, void*);
 void Spark_SetTime(unsigned long dateTime);
@@ -46,25 +47,6 @@ int call_raw_user_function(void* data, const char* param, void* reserved);
 
 String spark_deviceID();
 
-struct User_Var_Lookup_Table_t
-{
-    const void *userVar;
-    Spark_Data_TypeDef userVarType;
-    char userVarKey[USER_VAR_KEY_LENGTH+1];
-
-    const void* (*update)(const char* name, Spark_Data_TypeDef varType, const void* var, void* reserved);
-    int (*copy)(const void* var, void** data, size_t* size);
-};
-
-
-struct User_Func_Lookup_Table_t
-{
-    void* pUserFuncData;
-    cloud_function_t pUserFunc;
-    char userFuncKey[USER_FUNC_KEY_LENGTH+1];
-};
-
-
 User_Var_Lookup_Table_t* find_var_by_key_or_add(const char* varKey, const void* userVarData, Spark_Data_TypeDef userVarType, spark_variable_t* extra);
 User_Func_Lookup_Table_t* find_func_by_key_or_add(const char* funcKey, const cloud_function_descriptor* desc);
 
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "system_cloud.h"
+#include "core_hal.h"
+#include "cloud_registry.h"
+
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+struct User_Var_Lookup_Table_t
+{
+    const void *userVar;
+    Spark_Data_TypeDef userVarType;
+    char userVarKey[USER_VAR_KEY_LENGTH+1];
+
+    const void* (*update)(const char* name, Spark_Data_TypeDef varType, const void* var, void* reserved);
+    int (*copy)(const void* var, void** data, size_t* size);
+};
+
+
+struct User_Func_Lookup_Table_t
+{
+    void* pUserFuncData;
+    cloud_function_t pUserFunc;
+    char userFuncKey[USER_FUNC_KEY_LENGTH+1];
+};
+
+namespace particle {
+
+namespace system {
+
+inline uint32_t crc(const void* data, size_t len)
+{
+    return HAL_Core_Compute_CRC32((const uint8_t*)data, len);
+}
+
+template <typename T>
+inline uint32_t crc(const T& t)
+{
+    return crc(&t, sizeof(t));
+}
+
+inline uint32_t string_crc(const char* s)
+{
+    return crc(s, strlen(s));
+}
+
+struct UserVarTraits {
+    static const size_t KEY_LENGTH = USER_VAR_KEY_LENGTH;
+
+    static const char* key(const User_Var_Lookup_Table_t& item) {
+        return item.userVarKey;
+    }
+
+    // The checksum is derived from the variable name and type
+    static uint32_t checksum(const User_Var_Lookup_Table_t& item) {
+        return string_crc(item.userVarKey) + crc(item.userVarType);
+    }
+};
+
+struct UserFuncTraits {
+    static const size_t KEY_LENGTH = USER_FUNC_KEY_LENGTH;
+
+    static const char* key(const User_Func_Lookup_Table_t& item) {
+        return item.userFuncKey;
+    }
+
+    // The function name is used to compute the checksum
+    static uint32_t checksum(const User_Func_Lookup_Table_t& item) {
+        return string_crc(item.userFuncKey);
+    }
+};
+
+typedef protocol::CloudRegistry<User_Var_Lookup_Table_t, UserVarTraits> UserVarRegistry;
+typedef protocol::CloudRegistry<User_Func_Lookup_Table_t, UserFuncTraits> UserFuncRegistry;
+
+/**
+ * Computes the checksum of all functions and variables.
+ */
+inline uint32_t compute_describe_app_checksum(const UserVarRegistry& vars, const UserFuncRegistry& funcs)
+{
+    uint32_t chk[2];
+    chk[0] = vars.checksum();
+    chk[1] = funcs.checksum();
+    return crc(chk, sizeof(chk));
+}
+
+} // namespace system
+
+} // namespace particle
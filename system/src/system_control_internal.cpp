@@ -74,6 +74,28 @@ int formatReplyData(ctrl_request* req, ReplyFormatterCallback callback, void* da
     }
 }
 
+// Formats the diagnostic data directly into the reply buffer. The size of the binary data is
+// known upfront, so unlike formatReplyData() this function never has to format the data twice
+int formatBinaryDiagReplyData(ctrl_request* req) {
+    const int size = system_diag_data_binary_size(0 /* count */);
+    if (size < 0) {
+        return size;
+    }
+    int ret = system_ctrl_alloc_reply_data(req, size, nullptr);
+    if (ret != 0) {
+        return ret;
+    }
+    BufferAppender appender(req->reply_data, size);
+    ret = system_format_diag_data(nullptr, 0, SYSTEM_FORMAT_DIAG_FLAG_BINARY, BufferAppender::callback, &appender,
+            nullptr);
+    if (ret != 0 || appender.dataSize() != (size_t)size) {
+        system_ctrl_alloc_reply_data(req, 0, nullptr);
+        return (ret != 0) ? ret : SYSTEM_ERROR_INTERNAL;
+    }
+    req->reply_size = size;
+    return 0;
+}
+
 SystemControl g_systemControl;
 
 } // particle::system::
@@ -197,9 +219,15 @@ void SystemControl::processRequest(ctrl_request* req, ControlRequestChannel* /*
         break;
     }
     case CTRL_REQUEST_DIAGNOSTIC_INFO: {
-        if (req->request_size > 0) {
+        uint32_t flags = 0;
+        if (req->request_size == sizeof(flags)) {
+            memcpy(&flags, req->request_data, sizeof(flags));
+        }
+        if (req->request_size > 0 && req->request_size != sizeof(flags)) {
             // TODO: Querying a part of the diagnostic data is not supported
             setResult(req, SYSTEM_ERROR_NOT_SUPPORTED);
+        } else if (flags & SYSTEM_FORMAT_DIAG_FLAG_BINARY) {
+            setResult(req, formatBinaryDiagReplyData(req));
         } else {
             struct Formatter {
                 static int callback(Appender* appender, void* data) {
@@ -24,7 +24,7 @@ namespace
  * @sa template <class Timer> particle::cloud::VitalsPublisher<Timer>::publish
  * @sa template <class Timer> particle::cloud::VitalsPublisher<Timer>::publishFromTimer
  */
-inline int postDescription()
+inline int postDescription(spark_protocol_post_description_data* handler = nullptr)
 {
     int error;
 
@@ -32,7 +32,7 @@ inline int postDescription()
     {
         // Transmit CoAP message via communication layer
         error = spark_protocol_post_description(spark_protocol_instance(),
-                                                particle::protocol::DESCRIBE_METRICS, nullptr);
+                                                particle::protocol::DESCRIBE_METRICS, handler);
 
         // Convert `protocol` error to `system` error
         error = spark_protocol_to_system_error(error);
@@ -40,6 +40,10 @@ inline int postDescription()
     else
     {
         error = SYSTEM_ERROR_INVALID_STATE;
+        if (handler)
+        {
+            handler->handler_callback(error, nullptr, handler->handler_data, nullptr);
+        }
     }
 
     return error;
@@ -49,12 +53,187 @@ inline int postDescription()
 
 namespace particle { namespace system {
 
+VitalsDeltaEncoder::VitalsDeltaEncoder(unsigned maxDeltas_)
+    : _bytes_saved(0),
+      _encoded_bytes_saved(0),
+      _deltas(0),
+      _max_deltas(maxDeltas_),
+      _capture_id(0),
+      _encoded_id(0),
+      _type(FULL),
+      _encoded(false),
+      _capturing(false)
+{
+}
+
+unsigned VitalsDeltaEncoder::startCapture(void)
+{
+    _capturing = true;
+    return ++_capture_id;
+}
+
+void VitalsDeltaEncoder::stopCapture(void)
+{
+    _capturing = false;
+}
+
+bool VitalsDeltaEncoder::capturing(void) const
+{
+    return _capturing;
+}
+
+void VitalsDeltaEncoder::beginSnapshot(void)
+{
+    _current.clear();
+    _encoded = false;
+}
+
+int VitalsDeltaEncoder::addSource(uint16_t id_, int32_t value_, bool error_)
+{
+    if (!_current.isEmpty() && _current.last().id >= id_)
+    {
+        return SYSTEM_ERROR_INVALID_ARGUMENT;
+    }
+    if (!_current.append(Record{id_, error_, value_}))
+    {
+        return SYSTEM_ERROR_NO_MEMORY;
+    }
+    return SYSTEM_ERROR_NONE;
+}
+
+bool VitalsDeltaEncoder::canEncodeDelta(void) const
+{
+    if (_acked.isEmpty() || _deltas >= _max_deltas || _acked.size() != _current.size())
+    {
+        return false;
+    }
+    // The set of sources is fixed once the diagnostics service is started
+    for (int i = 0; i < _current.size(); ++i)
+    {
+        if (_current.at(i).id != _acked.at(i).id)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int VitalsDeltaEncoder::encode(appender_fn append_, void* appendData_)
+{
+    struct Writer : Appender
+    {
+        appender_fn fn;
+        void* data;
+        size_t size;
+
+        bool append(const uint8_t* d, size_t n) override
+        {
+            size += n;
+            return fn(data, d, n);
+        }
+
+        bool appendSignedVarint(int32_t val)
+        {
+            char buf[maxUnsignedVarintSize<uint32_t>()];
+            const size_t n = encodeSignedVarint(buf, sizeof(buf), val);
+            return append((const uint8_t*)buf, n);
+        }
+    } writer;
+    writer.fn = append_;
+    writer.data = appendData_;
+    writer.size = 0;
+
+    _type = canEncodeDelta() ? DELTA : FULL;
+    unsigned count = 0;
+    for (int i = 0; i < _current.size(); ++i)
+    {
+        const Record& r = _current.at(i);
+        if (_type == FULL || r.value != _acked.at(i).value || r.error != _acked.at(i).error)
+        {
+            ++count;
+        }
+    }
+    if (!writer.appendUInt16LE(0) || !writer.appendUInt16LE(_type) || !writer.appendUnsignedVarint(count))
+    {
+        return SYSTEM_ERROR_TOO_LARGE;
+    }
+    uint16_t prev_id = 0;
+    for (int i = 0; i < _current.size(); ++i)
+    {
+        const Record& r = _current.at(i);
+        int32_t value = r.value;
+        if (_type == DELTA)
+        {
+            const Record& a = _acked.at(i);
+            if (r.value == a.value && r.error == a.error)
+            {
+                continue;
+            }
+            value = (int32_t)((uint32_t)r.value - (uint32_t)a.value);
+        }
+        if (!writer.appendUnsignedVarint(((unsigned)(r.id - prev_id) << 1) | (r.error ? 1 : 0)) ||
+            !writer.appendSignedVarint(value))
+        {
+            return SYSTEM_ERROR_TOO_LARGE;
+        }
+        prev_id = r.id;
+    }
+    // Size of the same data in the fixed-size binary format. The savings are counted once the
+    // snapshot is acknowledged
+    const size_t full_size = sizeof(uint16_t) * 2 + _current.size() * (sizeof(uint16_t) + sizeof(int32_t));
+    _encoded_bytes_saved = (full_size > writer.size) ? full_size - writer.size : 0;
+    _encoded = true;
+    _encoded_id = _capture_id;
+    return SYSTEM_ERROR_NONE;
+}
+
+void VitalsDeltaEncoder::acknowledge(void)
+{
+    if (!_encoded)
+    {
+        return;
+    }
+    _deltas = (_type == DELTA) ? _deltas + 1 : 0;
+    _bytes_saved += _encoded_bytes_saved;
+    swap(_acked, _current);
+    _current.clear();
+    _encoded = false;
+}
+
+void VitalsDeltaEncoder::acknowledge(unsigned snapshot_)
+{
+    if (_encoded && snapshot_ == _encoded_id)
+    {
+        acknowledge();
+    }
+}
+
+void VitalsDeltaEncoder::reset(void)
+{
+    _acked.clear();
+    _current.clear();
+    _deltas = 0;
+    _encoded = false;
+}
+
+VitalsDeltaEncoder::SnapshotType VitalsDeltaEncoder::lastSnapshotType(void) const
+{
+    return _type;
+}
+
+size_t VitalsDeltaEncoder::bytesSaved(void) const
+{
+    return _bytes_saved;
+}
+
 template <class Timer>
 VitalsPublisher<Timer>::VitalsPublisher(Timer* timer_)
     : _period_s(std::numeric_limits<system_tick_t>::max()),
       _timer(timer_ ? timer_
                     : new Timer(_period_s, &VitalsPublisher::publishFromTimer, *this, false)),
-      _timer_owner(!timer_)
+      _timer_owner(!timer_),
+      _encoder(nullptr),
+      _encoder_generation(0)
 {
 }
 
@@ -66,6 +245,31 @@ VitalsPublisher<Timer>::~VitalsPublisher(void)
     {
         delete _timer;
     }
+    delete _encoder;
+}
+
+template <class Timer>
+VitalsDeltaEncoder* VitalsPublisher<Timer>::deltaEncoder(void) const
+{
+    return _encoder;
+}
+
+template <class Timer>
+int VitalsPublisher<Timer>::deltaEncoding(unsigned maxDeltas_)
+{
+    delete _encoder;
+    _encoder = nullptr;
+    // Invalidates the acknowledgements of the snapshots issued by the previous encoder
+    ++_encoder_generation;
+    if (maxDeltas_)
+    {
+        _encoder = new (std::nothrow) VitalsDeltaEncoder(maxDeltas_);
+        if (!_encoder)
+        {
+            return SYSTEM_ERROR_NO_MEMORY;
+        }
+    }
+    return SYSTEM_ERROR_NONE;
 }
 
 template <class Timer>
@@ -115,7 +319,71 @@ void VitalsPublisher<Timer>::period(system_tick_t period_s_)
 template <class Timer>
 int VitalsPublisher<Timer>::publish(void)
 {
-    return postDescription();
+    return postVitals();
+}
+
+namespace
+{
+
+struct VitalsAckContext
+{
+    void* publisher;
+    unsigned generation;
+    unsigned snapshot;
+};
+
+} // namespace
+
+template <class Timer>
+int VitalsPublisher<Timer>::postVitals(void)
+{
+    if (!_encoder)
+    {
+        return postDescription();
+    }
+    const auto ctx = new (std::nothrow) VitalsAckContext;
+    if (!ctx)
+    {
+        // Without a way to track the acknowledgement, the vitals are sent in full
+        _encoder->reset();
+        return postDescription();
+    }
+    ctx->publisher = this;
+    ctx->generation = _encoder_generation;
+    // The snapshot is encoded synchronously while the describe message is being built, and it
+    // becomes the baseline for subsequent snapshots only once the cloud acknowledges it
+    ctx->snapshot = _encoder->startCapture();
+    spark_protocol_post_description_data d = {};
+    d.size = sizeof(d);
+    d.handler_callback = vitalsAcknowledged;
+    d.handler_data = ctx;
+    const int error = postDescription(&d);
+    if (_encoder)
+    {
+        _encoder->stopCapture();
+    }
+    return error;
+}
+
+template <class Timer>
+void VitalsPublisher<Timer>::vitalsAcknowledged(int error_, const void* data_, void* callbackData_, void* reserved_)
+{
+    const auto ctx = static_cast<VitalsAckContext*>(callbackData_);
+    const auto publisher = static_cast<VitalsPublisher*>(ctx->publisher);
+    // Ignore the result if delta encoding has been reconfigured in the meantime
+    if (publisher->_encoder && publisher->_encoder_generation == ctx->generation)
+    {
+        if (error_ == SYSTEM_ERROR_NONE)
+        {
+            publisher->_encoder->acknowledge(ctx->snapshot);
+        }
+        else
+        {
+            // The cloud may have missed the snapshot, so the next one is full
+            publisher->_encoder->reset();
+        }
+    }
+    delete ctx;
 }
 
 // Functionality covered by E2E tests
@@ -127,14 +395,20 @@ int VitalsPublisher<Timer>::publish(void)
 template <class Timer>
 void VitalsPublisher<Timer>::publishFromTimer(void)
 {
-    const auto task = new (std::nothrow) ISRTaskQueue::Task;
+    struct PublishTask : ISRTaskQueue::Task
+    {
+        VitalsPublisher* publisher;
+    };
+    const auto task = new (std::nothrow) PublishTask;
     if (!task)
     {
         return;
     }
+    task->publisher = this;
     task->func = [](ISRTaskQueue::Task* task) {
-        delete task;
-        postDescription();
+        const auto publisher = static_cast<PublishTask*>(task)->publisher;
+        delete static_cast<PublishTask*>(task);
+        publisher->postVitals();
     };
     SystemISRTaskQueue.enqueue(task);
 }
@@ -5,7 +5,9 @@
 #include <cstddef>
 #include <functional>
 
+#include "appender.h"
 #include "spark_protocol_functions.h"
+#include "spark_wiring_vector.h"
 #include "system_tick_hal.h"
 
 namespace particle
@@ -13,6 +15,151 @@ namespace particle
 namespace system
 {
 
+/**
+ * @class VitalsDeltaEncoder system_publish_vitals.h
+ * @brief Delta encoding of the vitals information
+ *
+ * Keeps the last acknowledged snapshot of the diagnostic data and encodes
+ * subsequent snapshots as a list of changed sources only. A full snapshot is
+ * encoded initially, after a reset (e.g. on reconnection) and after every
+ * \p maxDeltas delta snapshots.
+ *
+ * Only snapshots requested via \p startCapture are delta encoded, vitals
+ * requested by the cloud are always formatted in full.
+ *
+ * Encoded data:
+ * - uint16_t Always 0, distinguishes the data from the fixed-size binary format
+ * - uint16_t Snapshot type (\p FULL or \p DELTA)
+ * - varint Number of records
+ * - Records sorted by source ID. Every record contains a varint with the
+ *   difference between the source ID and the ID of the previous record,
+ *   shifted left by one bit, with bit 0 set if the value is an error code,
+ *   followed by a ZigZag varint with the value. In a delta snapshot, the value
+ *   is relative to the value in the last acknowledged snapshot
+ */
+class VitalsDeltaEncoder
+{
+public:
+    enum SnapshotType
+    {
+        FULL = 0,
+        DELTA = 1
+    };
+
+    static const unsigned DEFAULT_MAX_DELTAS = 10;
+
+    /**
+     * @brief Constructor
+     *
+     * @param[in] maxDeltas The maximum number of delta snapshots between full snapshots
+     */
+    explicit VitalsDeltaEncoder(unsigned maxDeltas = DEFAULT_MAX_DELTAS);
+
+    /**
+     * @brief Start capturing a snapshot for a vitals publish
+     *
+     * @returns The ID of the snapshot, to be passed to \p acknowledge
+     */
+    unsigned startCapture(void);
+
+    /**
+     * @brief Stop capturing the snapshot
+     */
+    void stopCapture(void);
+
+    /**
+     * @brief Check whether a snapshot for a vitals publish is being captured
+     */
+    bool capturing(void) const;
+
+    /**
+     * @brief Start a new snapshot
+     *
+     * Discards a snapshot that has been encoded but not acknowledged.
+     */
+    void beginSnapshot(void);
+
+    /**
+     * @brief Add a source to the current snapshot
+     *
+     * @param[in] id The source ID. Sources must be added in ascending order of their IDs
+     * @param[in] value The source value or error code
+     * @param[in] error Set to \p true if \p value is an error code
+     *
+     * @returns \p system_error_t result code
+     * @retval \p system_error_t::SYSTEM_ERROR_NONE
+     * @retval \p system_error_t::SYSTEM_ERROR_INVALID_ARGUMENT
+     * @retval \p system_error_t::SYSTEM_ERROR_NO_MEMORY
+     */
+    int addSource(uint16_t id, int32_t value, bool error = false);
+
+    /**
+     * @brief Encode the current snapshot
+     *
+     * @param[in] append The appender function
+     * @param[in] appendData Opaque data passed to the appender function
+     *
+     * @returns \p system_error_t result code
+     * @retval \p system_error_t::SYSTEM_ERROR_NONE
+     * @retval \p system_error_t::SYSTEM_ERROR_TOO_LARGE
+     */
+    int encode(appender_fn append, void* appendData);
+
+    /**
+     * @brief Mark the last encoded snapshot as received by the cloud
+     */
+    void acknowledge(void);
+
+    /**
+     * @brief Mark a snapshot as received by the cloud
+     *
+     * Has no effect if another snapshot has been encoded since then or if the
+     * encoder has been reset.
+     *
+     * @param[in] snapshot The snapshot ID returned by \p startCapture
+     */
+    void acknowledge(unsigned snapshot);
+
+    /**
+     * @brief Encode the next snapshot in full
+     */
+    void reset(void);
+
+    /**
+     * @brief Type of the last encoded snapshot
+     */
+    SnapshotType lastSnapshotType(void) const;
+
+    /**
+     * @brief Number of bytes saved compared to the fixed-size binary format
+     *
+     * Only acknowledged snapshots are counted.
+     */
+    size_t bytesSaved(void) const;
+
+private:
+    struct Record
+    {
+        uint16_t id;
+        bool error;
+        int32_t value;
+    };
+
+    spark::Vector<Record> _acked;
+    spark::Vector<Record> _current;
+    size_t _bytes_saved;
+    size_t _encoded_bytes_saved;
+    unsigned _deltas;
+    const unsigned _max_deltas;
+    unsigned _capture_id;
+    unsigned _encoded_id;
+    SnapshotType _type;
+    bool _encoded;
+    bool _capturing;
+
+    bool canEncodeDelta(void) const;
+};
+
 /**
  * @class VitalsPublisher system_publish_vitals.h
  * @brief Publish vitals information
@@ -46,6 +193,25 @@ public:
      */
     virtual ~VitalsPublisher(void);
 
+    /**
+     * @brief Fetch the delta encoder
+     *
+     * @return The delta encoder, or \p nullptr if delta encoding is disabled
+     */
+    VitalsDeltaEncoder* deltaEncoder(void) const;
+
+    /**
+     * @brief Enable or disable delta encoding of the vitals information
+     *
+     * @param[in] maxDeltas The maximum number of delta snapshots between full
+     *                      snapshots, or 0 to disable delta encoding
+     *
+     * @returns \p system_error_t result code
+     * @retval \p system_error_t::SYSTEM_ERROR_NONE
+     * @retval \p system_error_t::SYSTEM_ERROR_NO_MEMORY
+     */
+    int deltaEncoding(unsigned maxDeltas);
+
     /**
      * @brief Disable periodic publishing
      */
@@ -84,6 +250,18 @@ private:
     system_tick_t _period_s;
     Timer* const _timer;
     const bool _timer_owner;
+    VitalsDeltaEncoder* _encoder;
+    unsigned _encoder_generation;
+
+    /**
+     * @brief Post vitals and update the state of the delta encoder
+     */
+    int postVitals(void);
+
+    /**
+     * @brief Update the state of the delta encoder when the vitals are acknowledged
+     */
+    static void vitalsAcknowledged(int error, const void* data, void* callbackData, void* reserved);
 
     /**
      * @brief Publish vitals from Timer callback
@@ -94,6 +272,13 @@ private:
     void publishFromTimer(void);
 };
 
+/**
+ * @brief Fetch the delta encoder of the system vitals publisher
+ *
+ * @return The delta encoder, or \p nullptr if delta encoding is disabled
+ */
+VitalsDeltaEncoder* vitalsDeltaEncoder(void);
+
 } // namespace system
 } // namespace particle
 
@@ -34,6 +34,7 @@
 #include "system_network.h"
 #include "system_ymodem.h"
 #include "system_task.h"
+#include "system_publish_vitals.h"
 #include "firmware_update.h"
 #include "module_info.h"
 #include "spark_protocol_functions.h"
@@ -823,6 +824,10 @@ class BinaryDiagnosticsFormatter : public AbstractDiagnosticsFormatter<BinaryDia
 	using id = typeof(diag_source::id);
 
 public:
+	// Every record has the same size, which makes it possible to allocate the output buffer upfront
+	static const size_t HEADER_SIZE = sizeof(uint16_t) * 2;
+	static const size_t RECORD_SIZE = sizeof(id) + sizeof(value);
+
 	BinaryDiagnosticsFormatter(AppendData& appender_) : data(appender_) {}
 
 
@@ -857,13 +862,49 @@ public:
 };
 
 
+class DeltaDiagnosticsFormatter : public AbstractDiagnosticsFormatter<DeltaDiagnosticsFormatter> {
+
+	particle::system::VitalsDeltaEncoder& encoder;
+	appender_fn append;
+	void* appendData;
+
+public:
+	DeltaDiagnosticsFormatter(particle::system::VitalsDeltaEncoder& encoder_, appender_fn append_, void* appendData_) :
+			encoder(encoder_), append(append_), appendData(appendData_) {}
+
+	inline bool openDocument() {
+		encoder.beginSnapshot();
+		return true;
+	}
+
+	inline bool closeDocument() {
+		return encoder.encode(append, appendData) == 0;
+	}
+
+	inline bool formatSourceError(const diag_source* src, int error) {
+		return encoder.addSource(src->id, error, true /* error */) == 0;
+	}
+
+	inline bool isSourceOk(const diag_source* src) {
+	    return true;
+	}
+
+	inline bool formatSourceInt(const diag_source* src, AbstractIntegerDiagnosticData::IntType val) {
+		return encoder.addSource(src->id, val) == 0;
+	}
+
+	inline bool formatSourceUnsignedInt(const diag_source* src, AbstractUnsignedIntegerDiagnosticData::IntType val) {
+		return encoder.addSource(src->id, (int32_t)val) == 0;
+	}
+};
+
 } // namespace
 
 
 
 int system_format_diag_data(const uint16_t* id, size_t count, unsigned flags, appender_fn append, void* append_data,
         void* reserved) {
-	if (flags & 1) {
+	if (flags & SYSTEM_FORMAT_DIAG_FLAG_BINARY) {
 		AppendData data(append, append_data);
 		BinaryDiagnosticsFormatter fmt(data);
 	    return fmt.format(id, count, flags);
@@ -875,7 +916,24 @@ int system_format_diag_data(const uint16_t* id, size_t count, unsigned flags, ap
 	}
 }
 
+int system_diag_data_binary_size(size_t count) {
+	if (!count) {
+		const int ret = diag_enum_sources(nullptr, &count, nullptr, nullptr);
+		if (ret != 0) {
+			return ret;
+		}
+	}
+	return BinaryDiagnosticsFormatter::HEADER_SIZE + count * BinaryDiagnosticsFormatter::RECORD_SIZE;
+}
+
 bool system_metrics(appender_fn appender, void* append_data, uint32_t flags, uint32_t page, void* reserved) {
+    // Only the vitals published by the device are delta encoded, the vitals requested by the
+    // cloud are always formatted in full
+    const auto encoder = particle::system::vitalsDeltaEncoder();
+    if ((flags & SYSTEM_FORMAT_DIAG_FLAG_BINARY) && encoder && encoder->capturing()) {
+        DeltaDiagnosticsFormatter fmt(*encoder, appender, append_data);
+        return fmt.format(nullptr, 0, flags) == 0;
+    }
     const int ret = system_format_diag_data(nullptr, 0, flags, appender, append_data, nullptr);
     return ret == 0;
 };
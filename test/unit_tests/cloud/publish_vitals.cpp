@@ -15,7 +15,11 @@
  * License along with this library; if not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstring>
+#include <functional>
 #include <limits>
+#include <map>
+#include <string>
 
 #include "active_object.h"
 #include "protocol_selector.h"
@@ -32,6 +36,8 @@ int spark_cloud_flag_connected_result;
 
 bool spark_protocol_post_description_called;
 int spark_protocol_post_description_result;
+spark_protocol_post_description_data spark_protocol_post_description_handler;
+std::function<void()> spark_protocol_post_description_hook;
 
 ISRTaskQueue SystemISRTaskQueue;
 
@@ -51,9 +57,17 @@ extern "C"
         return nullptr;
     }
 
-    int spark_protocol_post_description(ProtocolFacade*, int, void*)
+    int spark_protocol_post_description(ProtocolFacade*, int, void* reserved)
     {
         spark_protocol_post_description_called = true;
+        if (reserved)
+        {
+            spark_protocol_post_description_handler = *static_cast<spark_protocol_post_description_data*>(reserved);
+        }
+        if (spark_protocol_post_description_hook)
+        {
+            spark_protocol_post_description_hook();
+        }
         return spark_protocol_post_description_result;
     }
 
@@ -63,6 +77,70 @@ extern "C"
     }
 }
 
+namespace
+{
+
+struct DecodedSnapshot
+{
+    uint16_t type;
+    std::map<uint16_t, int32_t> values;
+    std::map<uint16_t, bool> errors;
+};
+
+bool appendToString(void* data, const uint8_t* bytes, size_t size)
+{
+    static_cast<std::string*>(data)->append((const char*)bytes, size);
+    return true;
+}
+
+std::string encodeSnapshot(particle::system::VitalsDeltaEncoder& encoder,
+                           const std::map<uint16_t, int32_t>& values)
+{
+    encoder.beginSnapshot();
+    for (const auto& v : values)
+    {
+        REQUIRE(encoder.addSource(v.first, v.second) == SYSTEM_ERROR_NONE);
+    }
+    std::string data;
+    REQUIRE(encoder.encode(appendToString, &data) == SYSTEM_ERROR_NONE);
+    return data;
+}
+
+DecodedSnapshot decodeSnapshot(const std::string& data)
+{
+    DecodedSnapshot s = {};
+    REQUIRE(data.size() >= 4);
+    uint16_t marker = 0;
+    memcpy(&marker, data.data(), sizeof(marker));
+    REQUIRE(marker == 0);
+    memcpy(&s.type, data.data() + 2, sizeof(s.type));
+    const char* p = data.data() + 4;
+    const char* const end = data.data() + data.size();
+    unsigned count = 0;
+    int n = particle::decodeUnsignedVarint(p, end - p, &count);
+    REQUIRE(n > 0);
+    p += n;
+    uint16_t id = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        unsigned key = 0;
+        n = particle::decodeUnsignedVarint(p, end - p, &key);
+        REQUIRE(n > 0);
+        p += n;
+        int32_t value = 0;
+        n = particle::decodeSignedVarint(p, end - p, &value);
+        REQUIRE(n > 0);
+        p += n;
+        id += key >> 1;
+        s.values[id] = value;
+        s.errors[id] = key & 1;
+    }
+    CHECK(p == end);
+    return s;
+}
+
+} // namespace
+
 // ASSUMPTION!!! - Period "getter" method works correctly - without being testing.
 
 TEST_CASE("Construction", "[VitalsPublisher::VitalsPublisher]")
@@ -378,3 +456,339 @@ TEST_CASE("Publishing vitals", "[VitalsPublisher::publish]")
         }
     }
 }
+
+TEST_CASE("Delta encoding", "[VitalsDeltaEncoder]")
+{
+    using particle::system::VitalsDeltaEncoder;
+
+    const std::map<uint16_t, int32_t> SNAPSHOT = {{1, 10}, {2, -20}, {6, 123456}, {32768, 0}};
+
+    SECTION("Snapshot type")
+    {
+        GIVEN("A new encoder")
+        {
+            VitalsDeltaEncoder encoder(2);
+
+            WHEN("The first snapshot is encoded")
+            {
+                const auto data = encodeSnapshot(encoder, SNAPSHOT);
+
+                THEN("All sources are encoded in full")
+                {
+                    const auto s = decodeSnapshot(data);
+                    CHECK(VitalsDeltaEncoder::FULL == s.type);
+                    CHECK(VitalsDeltaEncoder::FULL == encoder.lastSnapshotType());
+                    CHECK(SNAPSHOT == s.values);
+                }
+            }
+
+            WHEN("The previous snapshot was not acknowledged")
+            {
+                encodeSnapshot(encoder, SNAPSHOT);
+                const auto data = encodeSnapshot(encoder, SNAPSHOT);
+
+                THEN("The snapshot is encoded in full")
+                {
+                    CHECK(VitalsDeltaEncoder::FULL == decodeSnapshot(data).type);
+                }
+            }
+
+            WHEN("The previous snapshot was acknowledged")
+            {
+                encodeSnapshot(encoder, SNAPSHOT);
+                encoder.acknowledge();
+                auto changed = SNAPSHOT;
+                changed[2] = -25;
+                changed[32768] = 1;
+                const auto data = encodeSnapshot(encoder, changed);
+
+                THEN("Only the changed sources are encoded relative to the acknowledged values")
+                {
+                    const auto s = decodeSnapshot(data);
+                    CHECK(VitalsDeltaEncoder::DELTA == s.type);
+                    const std::map<uint16_t, int32_t> expected = {{2, -5}, {32768, 1}};
+                    CHECK(expected == s.values);
+                }
+            }
+
+            WHEN("The maximum number of delta snapshots is reached")
+            {
+                encodeSnapshot(encoder, SNAPSHOT);
+                encoder.acknowledge();
+                encodeSnapshot(encoder, SNAPSHOT);
+                encoder.acknowledge();
+                encodeSnapshot(encoder, SNAPSHOT);
+                encoder.acknowledge();
+                const auto data = encodeSnapshot(encoder, SNAPSHOT);
+
+                THEN("The snapshot is encoded in full")
+                {
+                    CHECK(VitalsDeltaEncoder::FULL == decodeSnapshot(data).type);
+                }
+            }
+
+            WHEN("The set of sources changes")
+            {
+                encodeSnapshot(encoder, SNAPSHOT);
+                encoder.acknowledge();
+                auto changed = SNAPSHOT;
+                changed[3] = 0;
+                const auto data = encodeSnapshot(encoder, changed);
+
+                THEN("The snapshot is encoded in full")
+                {
+                    CHECK(VitalsDeltaEncoder::FULL == decodeSnapshot(data).type);
+                }
+            }
+
+            WHEN("The encoder is reset")
+            {
+                encodeSnapshot(encoder, SNAPSHOT);
+                encoder.acknowledge();
+                encoder.reset();
+                const auto data = encodeSnapshot(encoder, SNAPSHOT);
+
+                THEN("The snapshot is encoded in full")
+                {
+                    CHECK(VitalsDeltaEncoder::FULL == decodeSnapshot(data).type);
+                }
+            }
+        }
+    }
+
+    SECTION("Error codes")
+    {
+        GIVEN("A source that failed to provide its value")
+        {
+            VitalsDeltaEncoder encoder;
+            encoder.beginSnapshot();
+            REQUIRE(encoder.addSource(1, 10) == SYSTEM_ERROR_NONE);
+            REQUIRE(encoder.addSource(2, SYSTEM_ERROR_UNKNOWN, true) == SYSTEM_ERROR_NONE);
+
+            WHEN("The snapshot is encoded")
+            {
+                std::string data;
+                REQUIRE(encoder.encode(appendToString, &data) == SYSTEM_ERROR_NONE);
+
+                THEN("The error code is flagged")
+                {
+                    const auto s = decodeSnapshot(data);
+                    CHECK_FALSE(s.errors.at(1));
+                    CHECK(s.errors.at(2));
+                    CHECK(SYSTEM_ERROR_UNKNOWN == s.values.at(2));
+                }
+            }
+        }
+
+        GIVEN("Sources that are not sorted by ID")
+        {
+            VitalsDeltaEncoder encoder;
+            encoder.beginSnapshot();
+            REQUIRE(encoder.addSource(2, 0) == SYSTEM_ERROR_NONE);
+
+            THEN("The source is rejected")
+            {
+                CHECK(SYSTEM_ERROR_INVALID_ARGUMENT == encoder.addSource(1, 0));
+                CHECK(SYSTEM_ERROR_INVALID_ARGUMENT == encoder.addSource(2, 0));
+            }
+        }
+    }
+
+    SECTION("Bytes saved")
+    {
+        GIVEN("An acknowledged snapshot")
+        {
+            VitalsDeltaEncoder encoder;
+            const auto full = encodeSnapshot(encoder, SNAPSHOT);
+            encoder.acknowledge();
+            const size_t FIXED_SIZE = 4 + SNAPSHOT.size() * 6;
+            CHECK(FIXED_SIZE - full.size() == encoder.bytesSaved());
+
+            WHEN("An unchanged snapshot is encoded and acknowledged")
+            {
+                const auto delta = encodeSnapshot(encoder, SNAPSHOT);
+                encoder.acknowledge();
+
+                THEN("The savings are accumulated")
+                {
+                    CHECK(5 == delta.size());
+                    CHECK((FIXED_SIZE - full.size()) + (FIXED_SIZE - delta.size()) == encoder.bytesSaved());
+                }
+            }
+
+            WHEN("A snapshot is encoded but not acknowledged")
+            {
+                encodeSnapshot(encoder, SNAPSHOT);
+
+                THEN("The savings are not counted")
+                {
+                    CHECK(FIXED_SIZE - full.size() == encoder.bytesSaved());
+                }
+            }
+
+            WHEN("A snapshot is encoded again before it is acknowledged")
+            {
+                encodeSnapshot(encoder, SNAPSHOT);
+                const auto delta = encodeSnapshot(encoder, SNAPSHOT);
+                encoder.acknowledge();
+
+                THEN("The savings are counted once")
+                {
+                    CHECK((FIXED_SIZE - full.size()) + (FIXED_SIZE - delta.size()) == encoder.bytesSaved());
+                }
+            }
+        }
+
+        GIVEN("A snapshot that is not acknowledged")
+        {
+            VitalsDeltaEncoder encoder;
+            encodeSnapshot(encoder, SNAPSHOT);
+
+            THEN("No savings are reported")
+            {
+                CHECK(0 == encoder.bytesSaved());
+            }
+        }
+    }
+}
+
+TEST_CASE("Delta encoding mode", "[VitalsPublisher::deltaEncoding]")
+{
+    SECTION("Encoder state")
+    {
+        GIVEN("A VitalsPublisher")
+        {
+            particle::system::VitalsPublisher<particle::mock_type::Timer> vp;
+
+            THEN("Delta encoding is disabled by default")
+            {
+                CHECK(nullptr == vp.deltaEncoder());
+            }
+
+            WHEN("Delta encoding is enabled and then disabled")
+            {
+                CHECK(SYSTEM_ERROR_NONE == vp.deltaEncoding(5));
+                CHECK(nullptr != vp.deltaEncoder());
+                CHECK(SYSTEM_ERROR_NONE == vp.deltaEncoding(0));
+
+                THEN("The encoder is released")
+                {
+                    CHECK(nullptr == vp.deltaEncoder());
+                }
+            }
+        }
+
+        GIVEN("A disconnected VitalsPublisher with an acknowledged snapshot")
+        {
+            spark_cloud_flag_connected_result = false;
+
+            particle::system::VitalsPublisher<particle::mock_type::Timer> vp;
+            REQUIRE(SYSTEM_ERROR_NONE == vp.deltaEncoding(5));
+            encodeSnapshot(*vp.deltaEncoder(), {{1, 1}});
+            vp.deltaEncoder()->acknowledge();
+
+            WHEN("Publish Invoked")
+            {
+                CHECK(SYSTEM_ERROR_INVALID_STATE == vp.publish());
+
+                THEN("The next snapshot is encoded in full")
+                {
+                    const auto data = encodeSnapshot(*vp.deltaEncoder(), {{1, 1}});
+                    CHECK(particle::system::VitalsDeltaEncoder::FULL == decodeSnapshot(data).type);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Delta encoded publishing", "[VitalsPublisher::publish]")
+{
+    using particle::system::VitalsDeltaEncoder;
+
+    const std::map<uint16_t, int32_t> SNAPSHOT = {{1, 10}, {2, 20}};
+
+    spark_cloud_flag_connected_result = true;
+    spark_protocol_post_description_result = SYSTEM_ERROR_NONE;
+    spark_protocol_post_description_handler = {};
+
+    particle::system::VitalsPublisher<particle::mock_type::Timer> vp;
+    REQUIRE(SYSTEM_ERROR_NONE == vp.deltaEncoding(5));
+    const auto encoder = vp.deltaEncoder();
+
+    // Encodes a snapshot while the describe message is being built
+    std::string data;
+    bool captured = false;
+    spark_protocol_post_description_hook = [&]() {
+        const auto e = vp.deltaEncoder();
+        captured = e->capturing();
+        data = encodeSnapshot(*e, SNAPSHOT);
+    };
+    const auto ack = [](const spark_protocol_post_description_data& h, int error) {
+        REQUIRE(h.handler_callback);
+        h.handler_callback(error, nullptr, h.handler_data, nullptr);
+    };
+
+    SECTION("Only the vitals published by the device are captured")
+    {
+        CHECK_FALSE(encoder->capturing());
+        REQUIRE(SYSTEM_ERROR_NONE == vp.publish());
+        CHECK(captured);
+        CHECK_FALSE(encoder->capturing());
+        ack(spark_protocol_post_description_handler, SYSTEM_ERROR_NONE);
+    }
+
+    SECTION("The baseline is not updated until the vitals are acknowledged")
+    {
+        REQUIRE(SYSTEM_ERROR_NONE == vp.publish());
+        const auto first = spark_protocol_post_description_handler;
+        REQUIRE(SYSTEM_ERROR_NONE == vp.publish());
+        CHECK(VitalsDeltaEncoder::FULL == decodeSnapshot(data).type);
+        const auto second = spark_protocol_post_description_handler;
+
+        // A late acknowledgement of an older snapshot is ignored
+        ack(first, SYSTEM_ERROR_NONE);
+        ack(second, SYSTEM_ERROR_NONE);
+        REQUIRE(SYSTEM_ERROR_NONE == vp.publish());
+        CHECK(VitalsDeltaEncoder::DELTA == decodeSnapshot(data).type);
+        ack(spark_protocol_post_description_handler, SYSTEM_ERROR_NONE);
+    }
+
+    SECTION("The next snapshot is full if the vitals are not acknowledged")
+    {
+        REQUIRE(SYSTEM_ERROR_NONE == vp.publish());
+        ack(spark_protocol_post_description_handler, SYSTEM_ERROR_NONE);
+        REQUIRE(SYSTEM_ERROR_NONE == vp.publish());
+        CHECK(VitalsDeltaEncoder::DELTA == decodeSnapshot(data).type);
+        ack(spark_protocol_post_description_handler, SYSTEM_ERROR_TIMEOUT);
+        REQUIRE(SYSTEM_ERROR_NONE == vp.publish());
+        CHECK(VitalsDeltaEncoder::FULL == decodeSnapshot(data).type);
+        ack(spark_protocol_post_description_handler, SYSTEM_ERROR_NONE);
+    }
+
+    SECTION("A late acknowledgement is ignored after delta encoding is reconfigured")
+    {
+        REQUIRE(SYSTEM_ERROR_NONE == vp.publish());
+        const auto stale = spark_protocol_post_description_handler;
+        // The new encoder is likely to be allocated at the address of the old one
+        REQUIRE(SYSTEM_ERROR_NONE == vp.deltaEncoding(5));
+        REQUIRE(SYSTEM_ERROR_NONE == vp.publish());
+        ack(spark_protocol_post_description_handler, SYSTEM_ERROR_NONE);
+
+        ack(stale, SYSTEM_ERROR_TIMEOUT);
+        REQUIRE(SYSTEM_ERROR_NONE == vp.publish());
+        CHECK(VitalsDeltaEncoder::DELTA == decodeSnapshot(data).type);
+        ack(spark_protocol_post_description_handler, SYSTEM_ERROR_NONE);
+    }
+
+    SECTION("The next snapshot is full after the encoder is reset")
+    {
+        REQUIRE(SYSTEM_ERROR_NONE == vp.publish());
+        ack(spark_protocol_post_description_handler, SYSTEM_ERROR_NONE);
+        encoder->reset(); // New cloud session
+        REQUIRE(SYSTEM_ERROR_NONE == vp.publish());
+        CHECK(VitalsDeltaEncoder::FULL == decodeSnapshot(data).type);
+        ack(spark_protocol_post_description_handler, SYSTEM_ERROR_NONE);
+    }
+
+    spark_protocol_post_description_hook = nullptr;
+}
@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cloud_registry.h"
+#include "system_cloud_registry.h"
+#include "protocol.h"
+
+#include "util/coap_message_channel.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <cstdio>
+
+using namespace particle;
+using namespace particle::protocol;
+
+namespace {
+
+const size_t TEST_KEY_LENGTH = 12;
+
+struct TestVariable {
+    char key[TEST_KEY_LENGTH + 1];
+    int type;
+    int value;
+};
+
+struct TestVariableTraits {
+    static const size_t KEY_LENGTH = TEST_KEY_LENGTH;
+
+    static const char* key(const TestVariable& v) {
+        return v.key;
+    }
+
+    static uint32_t checksum(const TestVariable& v) {
+        uint32_t h = v.type;
+        for (const char* p = v.key; *p; ++p) {
+            h = h * 31 + (uint8_t)*p;
+        }
+        return h;
+    }
+};
+
+typedef CloudRegistry<TestVariable, TestVariableTraits> TestRegistry;
+
+TestVariable makeVariable(const char* key, int type = SparkReturnType::INT, int value = 0) {
+    TestVariable v = {};
+    strncpy(v.key, key, TEST_KEY_LENGTH);
+    v.type = type;
+    v.value = value;
+    return v;
+}
+
+uint32_t computeChecksum(const TestRegistry& reg) {
+    uint32_t sum = 0;
+    for (int i = 0; i < reg.size(); ++i) {
+        sum += TestVariableTraits::checksum(reg[i]);
+    }
+    return sum;
+}
+
+std::string makeKey(int i) {
+    char buf[16] = {};
+    snprintf(buf, sizeof(buf), "var%d", i);
+    return buf;
+}
+
+class DescribeProtocol: public Protocol {
+public:
+    explicit DescribeProtocol(MessageChannel& channel) :
+            Protocol(channel) {
+    }
+
+    void init(const char* id, const SparkKeys& keys, const SparkCallbacks& callbacks,
+            const SparkDescriptor& descriptor) override {
+        Protocol::init(callbacks, descriptor);
+    }
+
+    size_t build_hello(Message& message, uint16_t flags) override {
+        return 0;
+    }
+
+    int command(ProtocolCommands::Enum command, uint32_t value, const void* data) override {
+        return 0;
+    }
+
+    int get_status(protocol_status* status) const override {
+        status->flags = 0;
+        return 0;
+    }
+};
+
+TestRegistry describeFuncs;
+TestRegistry describeVars;
+
+int numFunctions() {
+    return describeFuncs.size();
+}
+
+const char* getFunctionKey(int i) {
+    return describeFuncs[i].key;
+}
+
+int numVariables() {
+    return describeVars.size();
+}
+
+const char* getVariableKey(int i) {
+    return describeVars[i].key;
+}
+
+SparkReturnType::Enum variableType(const char* key) {
+    const auto v = describeVars.find(key);
+    REQUIRE(v);
+    return (SparkReturnType::Enum)v->type;
+}
+
+User_Var_Lookup_Table_t makeUserVar(const char* key, Spark_Data_TypeDef type) {
+    User_Var_Lookup_Table_t v = {};
+    strncpy(v.userVarKey, key, USER_VAR_KEY_LENGTH);
+    v.userVarType = type;
+    return v;
+}
+
+User_Func_Lookup_Table_t makeUserFunc(const char* key) {
+    User_Func_Lookup_Table_t f = {};
+    strncpy(f.userFuncKey, key, USER_FUNC_KEY_LENGTH);
+    return f;
+}
+
+uint32_t crc(const void* data, size_t size) {
+    return HAL_Core_Compute_CRC32((const uint8_t*)data, size);
+}
+
+// Checksum of the application describe as it was computed before CloudRegistry was introduced
+uint32_t legacyDescribeAppChecksum(const particle::system::UserVarRegistry& vars,
+        const particle::system::UserFuncRegistry& funcs) {
+    uint32_t chk[2] = {};
+    for (int i = vars.size(); i-- > 0;) {
+        chk[0] += crc(vars[i].userVarKey, strlen(vars[i].userVarKey));
+        chk[0] += crc(&vars[i].userVarType, sizeof(vars[i].userVarType));
+    }
+    for (int i = funcs.size(); i-- > 0;) {
+        chk[1] += crc(funcs[i].userFuncKey, strlen(funcs[i].userFuncKey));
+    }
+    return crc(chk, sizeof(chk));
+}
+
+std::string buildDescribe() {
+    SparkKeys keys = {};
+    SparkCallbacks callbacks = {};
+    callbacks.size = sizeof(callbacks);
+    SparkDescriptor descriptor = {};
+    descriptor.size = sizeof(descriptor);
+    descriptor.num_functions = numFunctions;
+    descriptor.get_function_key = getFunctionKey;
+    descriptor.num_variables = numVariables;
+    descriptor.get_variable_key = getVariableKey;
+    descriptor.variable_type = variableType;
+    test::CoapMessageChannel channel; // Not used
+    DescribeProtocol p(channel);
+    p.init("", keys, callbacks, descriptor);
+    char buf[1024] = {};
+    BufferAppender appender((uint8_t*)buf, sizeof(buf) - 1);
+    p.build_describe_message(appender, DESCRIBE_APPLICATION);
+    REQUIRE(appender.dataSize() < sizeof(buf));
+    return std::string(buf, appender.dataSize());
+}
+
+} // namespace
+
+TEST_CASE("CloudRegistry") {
+    TestRegistry reg;
+
+    SECTION("an empty registry has no entries") {
+        CHECK(reg.size() == 0);
+        CHECK(reg.find("a") == nullptr);
+        CHECK(reg.indexOf("") == -1);
+        CHECK(reg.checksum() == 0);
+    }
+
+    SECTION("entries can be found by key") {
+        REQUIRE(reg.add(makeVariable("temp", SparkReturnType::DOUBLE, 1)));
+        REQUIRE(reg.add(makeVariable("humidity", SparkReturnType::INT, 2)));
+        REQUIRE(reg.add(makeVariable("status", SparkReturnType::STRING, 3)));
+        CHECK(reg.size() == 3);
+        CHECK(reg.indexOf("temp") == 0);
+        CHECK(reg.indexOf("humidity") == 1);
+        CHECK(reg.indexOf("status") == 2);
+        auto v = reg.find("humidity");
+        REQUIRE(v);
+        CHECK(v->value == 2);
+        CHECK(reg.find("hum") == nullptr);
+        CHECK(reg.find("humidity2") == nullptr);
+        CHECK(reg.find("") == nullptr);
+    }
+
+    SECTION("keys are compared by their first KEY_LENGTH characters") {
+        REQUIRE(reg.add(makeVariable("abcdefghijkl")));
+        CHECK(reg.indexOf("abcdefghijkl") == 0);
+        CHECK(reg.indexOf("abcdefghijklmnop") == 0);
+        CHECK(reg.indexOf("abcdefghijk") == -1);
+    }
+
+    SECTION("entries are kept in the order of registration") {
+        const int n = 100;
+        for (int i = 0; i < n; ++i) {
+            REQUIRE(reg.add(makeVariable(makeKey(i).c_str(), SparkReturnType::INT, i)));
+        }
+        REQUIRE(reg.size() == n);
+        for (int i = 0; i < n; ++i) {
+            CHECK(std::string(reg[i].key) == makeKey(i));
+            CHECK(reg.indexOf(makeKey(i).c_str()) == i);
+        }
+        CHECK(reg.find(makeKey(n).c_str()) == nullptr);
+    }
+
+    SECTION("entries can be replaced") {
+        REQUIRE(reg.add(makeVariable("a", SparkReturnType::INT, 1)));
+        REQUIRE(reg.add(makeVariable("b", SparkReturnType::INT, 2)));
+        reg.replace(0, makeVariable("a", SparkReturnType::STRING, 3));
+        CHECK(reg.size() == 2);
+        auto v = reg.find("a");
+        REQUIRE(v);
+        CHECK(v->type == SparkReturnType::STRING);
+        CHECK(v->value == 3);
+        CHECK(reg.checksum() == computeChecksum(reg));
+    }
+
+    SECTION("entries can be removed") {
+        const int n = 40;
+        for (int i = 0; i < n; ++i) {
+            REQUIRE(reg.add(makeVariable(makeKey(i).c_str(), SparkReturnType::INT, i)));
+        }
+        reg.removeAt(n - 1);
+        reg.removeAt(0);
+        reg.removeAt(10);
+        CHECK(reg.size() == n - 3);
+        CHECK(reg.find(makeKey(0).c_str()) == nullptr);
+        CHECK(reg.find(makeKey(11).c_str()) == nullptr);
+        CHECK(reg.find(makeKey(n - 1).c_str()) == nullptr);
+        for (int i = 0; i < reg.size(); ++i) {
+            CHECK(reg.indexOf(reg[i].key) == i);
+        }
+        CHECK(reg.checksum() == computeChecksum(reg));
+        reg.clear();
+        CHECK(reg.size() == 0);
+        CHECK(reg.checksum() == 0);
+        CHECK(reg.find(makeKey(1).c_str()) == nullptr);
+    }
+
+    SECTION("the checksum doesn't depend on the order of registration") {
+        TestRegistry reg2;
+        const int n = 20;
+        for (int i = 0; i < n; ++i) {
+            REQUIRE(reg.add(makeVariable(makeKey(i).c_str(), i % 3)));
+            REQUIRE(reg2.add(makeVariable(makeKey(n - i - 1).c_str(), (n - i - 1) % 3)));
+            CHECK(reg.checksum() == computeChecksum(reg));
+        }
+        CHECK(reg.checksum() == reg2.checksum());
+        reg.replace(5, makeVariable(makeKey(5).c_str(), 7));
+        CHECK(reg.checksum() != reg2.checksum());
+        CHECK(reg.checksum() == computeChecksum(reg));
+    }
+
+    SECTION("the number of entries is not limited by the index") {
+        const size_t count = 1000;
+        for (size_t i = 0; i < count; ++i) {
+            REQUIRE(reg.add(makeVariable(makeKey(i).c_str())));
+        }
+        CHECK((size_t)reg.size() == count);
+        for (size_t i = 0; i < count; ++i) {
+            CHECK(reg.indexOf(makeKey(i).c_str()) == (int)i);
+        }
+        CHECK(reg.indexOf("extra") == -1);
+        reg.removeAt(0);
+        CHECK(reg.indexOf(makeKey(0).c_str()) == -1);
+        CHECK(reg.indexOf(makeKey(count - 1).c_str()) == (int)count - 2);
+    }
+}
+
+TEST_CASE("Describe message is generated from the registered functions and variables") {
+    describeFuncs.clear();
+    describeVars.clear();
+
+    SECTION("empty application") {
+        CHECK(buildDescribe() == "{\"f\":[],\"v\":{}}");
+    }
+
+    SECTION("functions and variables are listed in the order of registration") {
+        REQUIRE(describeFuncs.add(makeVariable("reset")));
+        REQUIRE(describeFuncs.add(makeVariable("led")));
+        REQUIRE(describeVars.add(makeVariable("temp", SparkReturnType::DOUBLE)));
+        REQUIRE(describeVars.add(makeVariable("name", SparkReturnType::STRING)));
+        REQUIRE(describeVars.add(makeVariable("on", SparkReturnType::BOOLEAN)));
+        CHECK(buildDescribe() == "{\"f\":[\"reset\",\"led\"],\"v\":{\"temp\":9,\"name\":4,\"on\":1}}");
+    }
+
+    SECTION("a replaced variable keeps its position") {
+        REQUIRE(describeVars.add(makeVariable("a", SparkReturnType::INT)));
+        REQUIRE(describeVars.add(makeVariable("b", SparkReturnType::INT)));
+        describeVars.replace(describeVars.indexOf("a"), makeVariable("a", SparkReturnType::STRING));
+        CHECK(buildDescribe() == "{\"f\":[],\"v\":{\"a\":4,\"b\":2}}");
+    }
+
+    SECTION("large application") {
+        std::string expected = "{\"f\":[],\"v\":{";
+        for (int i = 0; i < 60; ++i) {
+            const auto key = makeKey(i);
+            REQUIRE(describeVars.add(makeVariable(key.c_str(), SparkReturnType::INT)));
+            if (i) {
+                expected += ',';
+            }
+            expected += "\"" + key + "\":2";
+        }
+        expected += "}}";
+        CHECK(buildDescribe() == expected);
+    }
+
+    describeFuncs.clear();
+    describeVars.clear();
+}
+
+TEST_CASE("Application describe checksum") {
+    particle::system::UserVarRegistry vars;
+    particle::system::UserFuncRegistry funcs;
+
+    SECTION("matches the sum of the per-entry checksums") {
+        CHECK(particle::system::compute_describe_app_checksum(vars, funcs) == legacyDescribeAppChecksum(vars, funcs));
+        REQUIRE(vars.add(makeUserVar("temp", CLOUD_VAR_DOUBLE)));
+        REQUIRE(vars.add(makeUserVar("name", CLOUD_VAR_STRING)));
+        REQUIRE(funcs.add(makeUserFunc("reset")));
+        CHECK(particle::system::compute_describe_app_checksum(vars, funcs) == legacyDescribeAppChecksum(vars, funcs));
+        for (int i = 0; i < 50; ++i) {
+            REQUIRE(vars.add(makeUserVar(makeKey(i).c_str(), (i % 2) ? CLOUD_VAR_INT : CLOUD_VAR_BOOLEAN)));
+            REQUIRE(funcs.add(makeUserFunc(("fn" + makeKey(i)).c_str())));
+            CHECK(particle::system::compute_describe_app_checksum(vars, funcs) == legacyDescribeAppChecksum(vars, funcs));
+        }
+        vars.replace(vars.indexOf("temp"), makeUserVar("temp", CLOUD_VAR_INT));
+        funcs.removeAt(funcs.indexOf("reset"));
+        CHECK(particle::system::compute_describe_app_checksum(vars, funcs) == legacyDescribeAppChecksum(vars, funcs));
+    }
+
+    SECTION("depends on the names and types of the variables and the names of the functions") {
+        REQUIRE(vars.add(makeUserVar("temp", CLOUD_VAR_DOUBLE)));
+        REQUIRE(funcs.add(makeUserFunc("reset")));
+        const uint32_t chk = particle::system::compute_describe_app_checksum(vars, funcs);
+        vars.replace(0, makeUserVar("temp", CLOUD_VAR_INT));
+        CHECK(particle::system::compute_describe_app_checksum(vars, funcs) != chk);
+        vars.replace(0, makeUserVar("temp", CLOUD_VAR_DOUBLE));
+        CHECK(particle::system::compute_describe_app_checksum(vars, funcs) == chk);
+        funcs.replace(0, makeUserFunc("reboot"));
+        CHECK(particle::system::compute_describe_app_checksum(vars, funcs) != chk);
+    }
+}
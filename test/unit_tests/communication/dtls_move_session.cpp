@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "dtls_move_session.h"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+
+using namespace particle::protocol;
+
+namespace {
+
+const size_t DEVICE_ID_LEN = 12;
+const uint8_t DEVICE_ID[DEVICE_ID_LEN] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb };
+const int ALLOC_ERROR = -1;
+
+struct SendContext {
+    std::string data;
+    const unsigned char* ptr = nullptr;
+    int result = 0;
+    bool partial = false; // If true, the send function returns `result` instead of the packet size
+};
+
+int sendPacket(const unsigned char* buf, uint32_t size, void* ctx) {
+    const auto c = static_cast<SendContext*>(ctx);
+    c->data = std::string((const char*)buf, size);
+    c->ptr = buf;
+    return c->partial ? c->result : size;
+}
+
+std::string expectedRecord(const uint8_t* data, size_t len) {
+    std::string s((const char*)data, len);
+    s[0] = (char)DTLS_MOVE_SESSION_RECORD_TYPE;
+    s.append((const char*)DEVICE_ID, DEVICE_ID_LEN);
+    s.push_back((char)DEVICE_ID_LEN);
+    return s;
+}
+
+} // namespace
+
+TEST_CASE("sendMoveSessionRecord()") {
+    uint8_t buf[64] = {};
+    const size_t len = 10;
+    for (size_t i = 0; i < len; ++i) {
+        buf[i] = i;
+    }
+    buf[0] = DTLS_APPLICATION_DATA_RECORD_TYPE;
+    SendContext ctx;
+
+    SECTION("builds the record in place if there's enough room in the buffer") {
+        const auto expected = expectedRecord(buf, len);
+        int r = sendMoveSessionRecord(buf, len, buf, sizeof(buf), DEVICE_ID, DEVICE_ID_LEN, sendPacket, &ctx, ALLOC_ERROR);
+        CHECK(r == (int)len);
+        CHECK(ctx.ptr == buf);
+        CHECK(ctx.data == expected);
+        // The record type is restored after sending
+        CHECK(buf[0] == DTLS_APPLICATION_DATA_RECORD_TYPE);
+    }
+
+    SECTION("uses a heap copy if the record is too close to the end of the buffer") {
+        const size_t offs = sizeof(buf) - len - DEVICE_ID_LEN; // One byte short
+        buf[offs] = DTLS_APPLICATION_DATA_RECORD_TYPE;
+        const auto expected = expectedRecord(buf + offs, len);
+        int r = sendMoveSessionRecord(buf + offs, len, buf, sizeof(buf), DEVICE_ID, DEVICE_ID_LEN, sendPacket, &ctx, ALLOC_ERROR);
+        CHECK(r == (int)len);
+        CHECK(ctx.ptr != buf + offs);
+        CHECK(ctx.data == expected);
+        // The original buffer is not modified
+        CHECK(buf[offs] == DTLS_APPLICATION_DATA_RECORD_TYPE);
+        CHECK(buf[offs + len] == 0);
+    }
+
+    SECTION("uses a heap copy if the record is not in the buffer") {
+        uint8_t other[32] = {};
+        const auto expected = expectedRecord(buf, len);
+        int r = sendMoveSessionRecord(buf, len, other, sizeof(other), DEVICE_ID, DEVICE_ID_LEN, sendPacket, &ctx, ALLOC_ERROR);
+        CHECK(r == (int)len);
+        CHECK(ctx.ptr != buf);
+        CHECK(ctx.data == expected);
+        CHECK(buf[0] == DTLS_APPLICATION_DATA_RECORD_TYPE);
+        CHECK(buf[len] == 0);
+    }
+
+    SECTION("uses a heap copy if there's no buffer") {
+        const auto expected = expectedRecord(buf, len);
+        int r = sendMoveSessionRecord(buf, len, nullptr, 0, DEVICE_ID, DEVICE_ID_LEN, sendPacket, &ctx, ALLOC_ERROR);
+        CHECK(r == (int)len);
+        CHECK(ctx.ptr != buf);
+        CHECK(ctx.data == expected);
+        CHECK(buf[0] == DTLS_APPLICATION_DATA_RECORD_TYPE);
+    }
+
+    SECTION("returns the result of the send function if the record is not sent entirely") {
+        ctx.partial = true;
+        ctx.result = 0;
+        int r = sendMoveSessionRecord(buf, len, buf, sizeof(buf), DEVICE_ID, DEVICE_ID_LEN, sendPacket, &ctx, ALLOC_ERROR);
+        CHECK(r == 0);
+        CHECK(buf[0] == DTLS_APPLICATION_DATA_RECORD_TYPE);
+        ctx.result = -5;
+        r = sendMoveSessionRecord(buf, len, nullptr, 0, DEVICE_ID, DEVICE_ID_LEN, sendPacket, &ctx, ALLOC_ERROR);
+        CHECK(r == -5);
+    }
+}
@@ -30,7 +30,15 @@ extern "C" uint32_t HAL_Timer_Get_Micro_Seconds()
 
 extern "C" uint32_t HAL_Core_Compute_CRC32(const uint8_t* buf, size_t length)
 {
-	return 0;
+	// CRC-32 (IEEE 802.3)
+	uint32_t crc = 0xffffffff;
+	for (size_t i = 0; i < length; ++i) {
+		crc ^= buf[i];
+		for (int j = 0; j < 8; ++j) {
+			crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+		}
+	}
+	return ~crc;
 }
 
 extern "C" void log_message(int level, const char *category, LogAttributes *attr, void *reserved, const char *fmt, ...)
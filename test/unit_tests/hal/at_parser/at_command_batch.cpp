@@ -0,0 +1,356 @@
+#include "at_command_batch.h"
+#include "at_parser.h"
+#include "at_response.h"
+
+#include "stream.h"
+#include "system_error.h"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace particle;
+
+namespace {
+
+// Simulates a modem that processes command lines with a fixed turnaround time plus a processing
+// time for each command. The time is simulated, the stream blocks only virtually
+class SimulatedModem: public Stream {
+public:
+    struct Response {
+        std::string lines;
+        std::string result;
+    };
+
+    SimulatedModem(unsigned lineLatency, unsigned cmdLatency) :
+            lineLatency_(lineLatency),
+            cmdLatency_(cmdLatency),
+            readyTime_(0),
+            time_(0) {
+    }
+
+    void response(const std::string& cmd, std::string lines, std::string result = "OK") {
+        resps_[cmd] = Response{ std::move(lines), std::move(result) };
+    }
+
+    const std::vector<std::string>& commandLines() const {
+        return cmdLines_;
+    }
+
+    // Returns the number of times the command has been executed
+    unsigned execCount(const std::string& cmd) const {
+        const auto it = execCounts_.find(cmd);
+        return (it != execCounts_.end()) ? it->second : 0;
+    }
+
+    unsigned time() const {
+        return time_;
+    }
+
+    int read(char* data, size_t size) override {
+        if (time_ < readyTime_) {
+            return 0;
+        }
+        size = std::min(size, out_.size());
+        if (data) {
+            memcpy(data, out_.data(), size);
+        }
+        out_.erase(0, size);
+        return size;
+    }
+
+    int peek(char* data, size_t size) override {
+        if (time_ < readyTime_) {
+            return 0;
+        }
+        size = std::min(size, out_.size());
+        memcpy(data, out_.data(), size);
+        return size;
+    }
+
+    int skip(size_t size) override {
+        return read(nullptr, size);
+    }
+
+    int availForRead() override {
+        return (time_ < readyTime_) ? 0 : out_.size();
+    }
+
+    int write(const char* data, size_t size) override {
+        in_.append(data, size);
+        size_t pos = 0;
+        while ((pos = in_.find("\r\n")) != std::string::npos) {
+            processLine(in_.substr(0, pos));
+            in_.erase(0, pos + 2);
+        }
+        return size;
+    }
+
+    int flush() override {
+        return 0;
+    }
+
+    int availForWrite() override {
+        return 1024;
+    }
+
+    int waitEvent(unsigned flags, unsigned timeout) override {
+        if ((flags & Stream::READABLE) && !out_.empty()) {
+            time_ = std::max(time_, readyTime_);
+            return Stream::READABLE;
+        }
+        if (flags & Stream::WRITABLE) {
+            return Stream::WRITABLE;
+        }
+        time_ += timeout;
+        return SYSTEM_ERROR_TIMEOUT;
+    }
+
+private:
+    std::map<std::string, Response> resps_;
+    std::vector<std::string> cmdLines_;
+    std::map<std::string, unsigned> execCounts_;
+    std::string in_;
+    std::string out_;
+    unsigned lineLatency_;
+    unsigned cmdLatency_;
+    unsigned readyTime_;
+    unsigned time_;
+
+    void processLine(const std::string& line) {
+        REQUIRE(line.substr(0, 2) == "AT");
+        cmdLines_.push_back(line);
+        readyTime_ = time_ + lineLatency_;
+        std::string result = "OK";
+        size_t pos = 2;
+        for (;;) {
+            const size_t end = std::min(line.find(';', pos), line.size());
+            const auto cmd = "AT" + line.substr(pos, end - pos);
+            ++execCounts_[cmd];
+            readyTime_ += cmdLatency_;
+            const auto it = resps_.find(cmd);
+            if (it != resps_.end()) {
+                out_ += it->second.lines;
+                result = it->second.result;
+            }
+            if (result != "OK" || end == line.size()) {
+                break;
+            }
+            pos = end + 1;
+        }
+        out_ += "\r\n" + result + "\r\n";
+    }
+};
+
+void initParser(AtParser* parser, Stream* strm) {
+    AtParserConfig conf;
+    conf.stream(strm);
+    conf.commandTerminator(AtCommandTerminator::CRLF);
+    conf.echoEnabled(false);
+    conf.logEnabled(false);
+    conf.commandTimeout(10000);
+    conf.streamTimeout(10000);
+    REQUIRE(parser->init(std::move(conf)) == 0);
+}
+
+int lineHandler(const char* line, void* data) {
+    const auto lines = (std::vector<std::string>*)data;
+    lines->push_back(line);
+    return 0;
+}
+
+// Typical sequence of commands sent to the modem during initialization and registration
+const char* const BRINGUP_COMMANDS[] = {
+    "AT+CMEE=2",
+    "AT+IFC=2,2",
+    "AT+COPS=3,2",
+    "AT+CGEREP=1,0",
+    "AT+CCID",
+    "AT+CGMR",
+    "AT+CIMI",
+    "AT+UMNOPROF?",
+    "AT+UBANDMASK?",
+    "AT+URAT?",
+    "AT+CEDRXS=3,7",
+    "AT+CPSMS=0",
+    "AT+UPSV=0",
+    "AT+CGDCONT=1,\"IP\",\"iot.example.com\"",
+    "AT+CREG=2",
+    "AT+CGREG=2",
+    "AT+CEREG=2",
+    "AT+COPS?",
+    "AT+CREG?",
+    "AT+CGREG?",
+    "AT+CEREG?",
+    "AT+CSQ",
+    "AT+UCGED=5",
+    "AT+UCGED?"
+};
+
+const size_t BRINGUP_COMMAND_COUNT = sizeof(BRINGUP_COMMANDS) / sizeof(BRINGUP_COMMANDS[0]);
+
+} // namespace
+
+TEST_CASE("AtCommandBatch") {
+    SimulatedModem modem(20, 5);
+    AtParser parser;
+    initParser(&parser, &modem);
+
+    SECTION("concatenates consecutive extended commands") {
+        AtCommandBatch batch(&parser, 32);
+        REQUIRE(batch.add("AT+CREG=%d", 2) == 0);
+        REQUIRE(batch.add("AT+CGREG=%d", 2) == 0);
+        REQUIRE(batch.add("AT&C1") == 0);
+        REQUIRE(batch.add("ATE0") == 0);
+        REQUIRE(batch.add("AT+CEREG=2") == 0);
+        REQUIRE(batch.add("AT+COPS=0,2") == 0);
+        REQUIRE(batch.add("AT+CGDCONT=1,\"IP\",\"apn\"") == 0);
+        CHECK(batch.size() == 7);
+        CHECK(batch.exec() == AtResponse::OK);
+        CHECK(batch.failedCommand() == -1);
+        CHECK(batch.commandLineCount() == 4);
+        const std::vector<std::string> expected = {
+            "AT+CREG=2;+CGREG=2;&C1",
+            "ATE0",
+            "AT+CEREG=2;+COPS=0,2",
+            "AT+CGDCONT=1,\"IP\",\"apn\""
+        };
+        CHECK(modem.commandLines() == expected);
+    }
+
+    SECTION("collects response lines in order") {
+        modem.response("AT+CREG?", "\r\n+CREG: 2,5\r\n");
+        modem.response("AT+CGREG?", "\r\n+CGREG: 2,5,\"2B6F\",\"0A38E40F\",7\r\n");
+        modem.response("AT+CEREG?", "\r\n+CEREG: 2,4\r\n");
+        AtCommandBatch batch(&parser);
+        REQUIRE(batch.add("AT+CREG?") == 0);
+        REQUIRE(batch.add("AT+CGREG?") == 0);
+        REQUIRE(batch.add("AT+CEREG?") == 0);
+        std::vector<std::string> lines;
+        CHECK(batch.exec(lineHandler, &lines) == AtResponse::OK);
+        CHECK(batch.commandLineCount() == 1);
+        const std::vector<std::string> expected = {
+            "+CREG: 2,5",
+            "+CGREG: 2,5,\"2B6F\",\"0A38E40F\",7",
+            "+CEREG: 2,4"
+        };
+        CHECK(lines == expected);
+    }
+
+    SECTION("stops at the first failed command line without executing it again") {
+        modem.response("AT+CGREG=2", "", "+CME ERROR: 3");
+        AtCommandBatch batch(&parser);
+        REQUIRE(batch.add("AT+CREG=2") == 0);
+        REQUIRE(batch.add("AT+CGREG=2") == 0);
+        REQUIRE(batch.add("AT+CEREG=2") == 0);
+        REQUIRE(batch.add("ATE0") == 0);
+        CHECK(batch.exec() == AtResponse::CME_ERROR);
+        CHECK(batch.failedCommand() == 0);
+        CHECK(batch.failedCommandCount() == 3);
+        CHECK(batch.resultErrorCode() == 3);
+        const std::vector<std::string> expected = {
+            "AT+CREG=2;+CGREG=2;+CEREG=2"
+        };
+        CHECK(modem.commandLines() == expected);
+        CHECK(modem.execCount("AT+CREG=2") == 1);
+        CHECK(modem.execCount("AT+CGREG=2") == 1);
+        CHECK(modem.execCount("AT+CEREG=2") == 0);
+        CHECK(modem.execCount("ATE0") == 0);
+    }
+
+    SECTION("executes idempotent commands of a failed command line one by one") {
+        modem.response("AT+CREG?", "\r\n+CREG: 2,5\r\n");
+        modem.response("AT+CGREG?", "", "+CME ERROR: 3");
+        AtCommandBatch batch(&parser);
+        REQUIRE(batch.add(AtCommandBatch::IDEMPOTENT, "AT+CREG?") == 0);
+        REQUIRE(batch.add(AtCommandBatch::IDEMPOTENT, "AT+CGREG?") == 0);
+        REQUIRE(batch.add(AtCommandBatch::IDEMPOTENT, "AT+CEREG?") == 0);
+        std::vector<std::string> lines;
+        CHECK(batch.exec(lineHandler, &lines) == AtResponse::CME_ERROR);
+        CHECK(batch.failedCommand() == 1);
+        CHECK(batch.failedCommandCount() == 1);
+        CHECK(batch.resultErrorCode() == 3);
+        const std::vector<std::string> expected = {
+            "AT+CREG?;+CGREG?;+CEREG?",
+            "AT+CREG?",
+            "AT+CGREG?"
+        };
+        CHECK(modem.commandLines() == expected);
+        CHECK(modem.execCount("AT+CREG?") == 2);
+        CHECK(modem.execCount("AT+CGREG?") == 2);
+        CHECK(modem.execCount("AT+CEREG?") == 0);
+        CHECK(lines == std::vector<std::string>{ "+CREG: 2,5", "+CREG: 2,5" });
+    }
+
+    SECTION("doesn't execute a failed command line again if it has non-idempotent commands") {
+        modem.response("AT+CGACT=1,1", "", "+CME ERROR: 30");
+        AtCommandBatch batch(&parser);
+        REQUIRE(batch.add(AtCommandBatch::IDEMPOTENT, "AT+CREG?") == 0);
+        REQUIRE(batch.add("AT+COPS=0,2") == 0);
+        REQUIRE(batch.add("AT+CGACT=1,1") == 0);
+        CHECK(batch.exec() == AtResponse::CME_ERROR);
+        CHECK(batch.failedCommand() == 0);
+        CHECK(batch.failedCommandCount() == 3);
+        CHECK(batch.resultErrorCode() == 30);
+        CHECK(modem.commandLines().size() == 1);
+        CHECK(modem.execCount("AT+CREG?") == 1);
+        CHECK(modem.execCount("AT+COPS=0,2") == 1);
+        CHECK(modem.execCount("AT+CGACT=1,1") == 1);
+    }
+
+    SECTION("can be executed with the commands taking longer than the command line limit") {
+        AtCommandBatch batch(&parser, 8);
+        const std::string data(200, 'A');
+        REQUIRE(batch.add("AT+X=\"%s\"", data.c_str()) == 0);
+        REQUIRE(batch.add("AT+Y") == 0);
+        CHECK(batch.exec() == AtResponse::OK);
+        const std::vector<std::string> expected = {
+            "AT+X=\"" + data + "\"",
+            "AT+Y"
+        };
+        CHECK(modem.commandLines() == expected);
+    }
+}
+
+TEST_CASE("AtCommandBatch benchmark", "[benchmark][.]") {
+    // Turnaround time of a command line, including the UART and muxer latency, and processing
+    // time of a single command in milliseconds
+    const unsigned lineLatency = 40;
+    const unsigned cmdLatency = 10;
+
+    SimulatedModem serialModem(lineLatency, cmdLatency);
+    AtParser serialParser;
+    initParser(&serialParser, &serialModem);
+    auto t1 = std::chrono::steady_clock::now();
+    for (auto cmd: BRINGUP_COMMANDS) {
+        CHECK(serialParser.execCommand("%s", cmd) == AtResponse::OK);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    const auto serialHostTime = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+    SimulatedModem batchModem(lineLatency, cmdLatency);
+    AtParser batchParser;
+    initParser(&batchParser, &batchModem);
+    t1 = std::chrono::steady_clock::now();
+    AtCommandBatch batch(&batchParser);
+    for (auto cmd: BRINGUP_COMMANDS) {
+        CHECK(batch.add("%s", cmd) == 0);
+    }
+    CHECK(batch.exec() == AtResponse::OK);
+    t2 = std::chrono::steady_clock::now();
+    const auto batchHostTime = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+    std::cout << "Bring-up, " << BRINGUP_COMMAND_COUNT << " commands (" << lineLatency << "ms per command line, " <<
+            cmdLatency << "ms per command):" << std::endl;
+    std::cout << "  serial: " << serialModem.commandLines().size() << " command lines, " << serialModem.time() <<
+            "ms simulated, " << serialHostTime << "us host" << std::endl;
+    std::cout << "  batch: " << batchModem.commandLines().size() << " command lines, " << batchModem.time() <<
+            "ms simulated, " << batchHostTime << "us host" << std::endl;
+}
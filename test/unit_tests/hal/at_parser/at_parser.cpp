@@ -0,0 +1,264 @@
+#include "at_parser.h"
+#include "at_response.h"
+
+#include "stream.h"
+#include "system_error.h"
+
+#define CATCH_CONFIG_MAIN
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace particle;
+
+namespace {
+
+// Replays a recorded modem transcript, optionally splitting it into chunks of a fixed size
+class TranscriptStream: public Stream {
+public:
+    explicit TranscriptStream(std::string data = std::string(), size_t chunkSize = 0) :
+            data_(std::move(data)),
+            chunkSize_(chunkSize),
+            pos_(0) {
+    }
+
+    const std::string& output() const {
+        return out_;
+    }
+
+    size_t remaining() const {
+        return data_.size() - pos_;
+    }
+
+    int read(char* data, size_t size) override {
+        size = std::min(size, remaining());
+        if (chunkSize_ > 0) {
+            size = std::min(size, chunkSize_);
+        }
+        if (data) {
+            memcpy(data, data_.data() + pos_, size);
+        }
+        pos_ += size;
+        return size;
+    }
+
+    int peek(char* data, size_t size) override {
+        size = std::min(size, remaining());
+        memcpy(data, data_.data() + pos_, size);
+        return size;
+    }
+
+    int skip(size_t size) override {
+        return read(nullptr, size);
+    }
+
+    int availForRead() override {
+        return remaining();
+    }
+
+    int write(const char* data, size_t size) override {
+        out_.append(data, size);
+        return size;
+    }
+
+    int flush() override {
+        return 0;
+    }
+
+    int availForWrite() override {
+        return 1024;
+    }
+
+    int waitEvent(unsigned flags, unsigned timeout) override {
+        if ((flags & Stream::READABLE) && remaining() > 0) {
+            return Stream::READABLE;
+        }
+        if (flags & Stream::WRITABLE) {
+            return Stream::WRITABLE;
+        }
+        return SYSTEM_ERROR_TIMEOUT;
+    }
+
+private:
+    std::string data_;
+    std::string out_;
+    size_t chunkSize_;
+    size_t pos_;
+};
+
+struct Urc {
+    std::string prefix;
+    std::string line;
+
+    bool operator==(const Urc& urc) const {
+        return prefix == urc.prefix && line == urc.line;
+    }
+};
+
+int urcHandler(AtResponseReader* reader, const char* prefix, void* data) {
+    const auto urcs = (std::vector<Urc>*)data;
+    char buf[256] = {};
+    const int n = reader->readLine(buf, sizeof(buf) - 1);
+    REQUIRE(n >= 0);
+    urcs->push_back(Urc{ prefix, std::string(buf, n) });
+    return 0;
+}
+
+void initParser(AtParser* parser, Stream* strm) {
+    AtParserConfig conf;
+    conf.stream(strm);
+    conf.commandTerminator(AtCommandTerminator::CRLF);
+    conf.echoEnabled(false);
+    conf.logEnabled(false);
+    conf.commandTimeout(1000);
+    conf.streamTimeout(100);
+    REQUIRE(parser->init(std::move(conf)) == 0);
+}
+
+const char* const URC_PREFIXES[] = {
+    "+CREG",
+    "+CGREG",
+    "+CEREG",
+    "+UUSO",
+    "+UUSORD",
+    "+UUSORF",
+    "+UUSOCL"
+};
+
+void addUrcHandlers(AtParser* parser, std::vector<Urc>* urcs) {
+    for (auto prefix: URC_PREFIXES) {
+        REQUIRE(parser->addUrcHandler(prefix, urcHandler, urcs) == 0);
+    }
+}
+
+const std::string URC_TRANSCRIPT =
+        "\r\n+CREG: 5\r\n"
+        "\r\n+UUSORD: 0,32\r\n"
+        "\r\n+CEREG: 1,\"2B6F\",\"0A38E40F\",7\r\n"
+        "\r\n+UUSOCL: 1\r\n"
+        "\r\n+UUSOLI: 2\r\n" // Handled as "+UUSO"
+        "\r\n+CGEV: ME PDN ACT 1\r\n" // No handler
+        "\r\n+UUSORF: 3,\"10.0.0.1\",5684,16\r\n";
+
+const std::vector<Urc> URC_EXPECTED = {
+    { "+CREG", "+CREG: 5" },
+    { "+UUSORD", "+UUSORD: 0,32" },
+    { "+CEREG", "+CEREG: 1,\"2B6F\",\"0A38E40F\",7" },
+    { "+UUSOCL", "+UUSOCL: 1" },
+    { "+UUSO", "+UUSOLI: 2" },
+    { "+UUSORF", "+UUSORF: 3,\"10.0.0.1\",5684,16" }
+};
+
+} // namespace
+
+TEST_CASE("AtParser") {
+    SECTION("dispatches all received URCs to the handlers with the longest matching prefix") {
+        for (size_t chunkSize: { 0, 1, 3, 7 }) {
+            TranscriptStream strm(URC_TRANSCRIPT, chunkSize);
+            AtParser parser;
+            initParser(&parser, &strm);
+            std::vector<Urc> urcs;
+            addUrcHandlers(&parser, &urcs);
+            int count = 0;
+            while (strm.remaining() > 0) {
+                const int r = parser.processUrc();
+                if (r == SYSTEM_ERROR_WOULD_BLOCK) {
+                    continue;
+                }
+                REQUIRE(r >= 0);
+                count += r;
+            }
+            CHECK(count == (int)URC_EXPECTED.size());
+            CHECK(urcs == URC_EXPECTED);
+        }
+    }
+
+    SECTION("processes all buffered URCs in a single call") {
+        TranscriptStream strm(URC_TRANSCRIPT);
+        AtParser parser;
+        initParser(&parser, &strm);
+        std::vector<Urc> urcs;
+        addUrcHandlers(&parser, &urcs);
+        CHECK(parser.processUrc() == (int)URC_EXPECTED.size());
+        CHECK(urcs == URC_EXPECTED);
+        CHECK(parser.processUrc() == SYSTEM_ERROR_WOULD_BLOCK);
+    }
+
+    SECTION("doesn't dispatch URCs to removed handlers") {
+        TranscriptStream strm(URC_TRANSCRIPT);
+        AtParser parser;
+        initParser(&parser, &strm);
+        std::vector<Urc> urcs;
+        addUrcHandlers(&parser, &urcs);
+        parser.removeUrcHandler("+UUSORD");
+        parser.removeUrcHandler("+CREG");
+        CHECK(parser.processUrc() == (int)URC_EXPECTED.size() - 1);
+        const std::vector<Urc> expected = {
+            { "+UUSO", "+UUSORD: 0,32" },
+            { "+CEREG", "+CEREG: 1,\"2B6F\",\"0A38E40F\",7" },
+            { "+UUSOCL", "+UUSOCL: 1" },
+            { "+UUSO", "+UUSOLI: 2" },
+            { "+UUSORF", "+UUSORF: 3,\"10.0.0.1\",5684,16" }
+        };
+        CHECK(urcs == expected);
+    }
+
+    SECTION("replaces the handler registered for the same prefix") {
+        TranscriptStream strm("\r\n+CREG: 5\r\n");
+        AtParser parser;
+        initParser(&parser, &strm);
+        std::vector<Urc> urcs1, urcs2;
+        REQUIRE(parser.addUrcHandler("+CREG", urcHandler, &urcs1) == 0);
+        REQUIRE(parser.addUrcHandler("+CREG", urcHandler, &urcs2) == 0);
+        CHECK(parser.processUrc() == 1);
+        CHECK(urcs1.empty());
+        CHECK(urcs2.size() == 1);
+    }
+
+    SECTION("dispatches URCs received in the middle of a command response") {
+        for (size_t chunkSize: { 0, 1, 5 }) {
+            TranscriptStream strm(
+                    "\r\nOK\r\n"
+                    "\r\n+CREG: 2\r\n"
+                    "\r\n+CSQ: 20,99\r\n"
+                    "\r\n+UUSORD: 0,12\r\n"
+                    "\r\nOK\r\n", chunkSize);
+            AtParser parser;
+            initParser(&parser, &strm);
+            std::vector<Urc> urcs;
+            addUrcHandlers(&parser, &urcs);
+            REQUIRE(parser.execCommand("AT") == AtResponse::OK);
+            auto resp = parser.sendCommand("AT+CSQ");
+            char buf[64] = {};
+            const int n = resp.readLine(buf, sizeof(buf) - 1);
+            REQUIRE(n > 0);
+            CHECK(std::string(buf, n) == "+CSQ: 20,99");
+            CHECK(resp.readResult() == AtResponse::OK);
+            CHECK(strm.output() == "AT\r\nAT+CSQ\r\n");
+            const std::vector<Urc> expected = {
+                { "+CREG", "+CREG: 2" },
+                { "+UUSORD", "+UUSORD: 0,12" }
+            };
+            CHECK(urcs == expected);
+        }
+    }
+
+    SECTION("can read response lines longer than the input buffer") {
+        const std::string data(1000, 'A');
+        TranscriptStream strm("\r\nOK\r\n\r\n" + data + "\r\n\r\n+CME ERROR: 10\r\n", 37);
+        AtParser parser;
+        initParser(&parser, &strm);
+        REQUIRE(parser.execCommand("AT") == AtResponse::OK);
+        auto resp = parser.sendCommand("AT+CCID");
+        const auto line = resp.readLine();
+        REQUIRE(line);
+        CHECK(std::string(line) == data);
+        CHECK(resp.readResult() == AtResponse::CME_ERROR);
+        CHECK(resp.resultErrorCode() == 10);
+    }
+}
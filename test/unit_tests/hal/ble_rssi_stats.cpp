@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ble_rssi_stats.h"
+
+#include <catch2/catch.hpp>
+
+using namespace particle::ble;
+
+TEST_CASE("BleRssiStats") {
+    BleRssiStats stats;
+
+    SECTION("no measurements") {
+        CHECK(stats.last() == BLE_LINK_STATS_RSSI_INVALID);
+        CHECK(stats.min() == BLE_LINK_STATS_RSSI_INVALID);
+        CHECK(stats.max() == BLE_LINK_STATS_RSSI_INVALID);
+        CHECK(stats.average() == BLE_LINK_STATS_RSSI_INVALID);
+        CHECK(stats.count() == 0);
+        for (int i = 0; i < BLE_LINK_STATS_RSSI_BUCKET_COUNT; ++i) {
+            CHECK(stats.histogram(i) == 0);
+        }
+    }
+
+    SECTION("tracks the last, lowest, highest and average measurement") {
+        stats.update(-60);
+        CHECK(stats.last() == -60);
+        CHECK(stats.min() == -60);
+        CHECK(stats.max() == -60);
+        CHECK(stats.average() == -60);
+        stats.update(-72);
+        stats.update(-45);
+        stats.update(-50);
+        CHECK(stats.last() == -50);
+        CHECK(stats.min() == -72);
+        CHECK(stats.max() == -45);
+        CHECK(stats.average() == -57); // -56.75
+        CHECK(stats.count() == 4);
+    }
+
+    SECTION("the average is rounded to the nearest integer") {
+        stats.update(-60);
+        stats.update(-61);
+        stats.update(-61);
+        CHECK(stats.average() == -61); // -60.67
+        stats.reset();
+        stats.update(-60);
+        stats.update(-60);
+        stats.update(-61);
+        CHECK(stats.average() == -60); // -60.33
+        stats.reset();
+        stats.update(5);
+        stats.update(6);
+        stats.update(6);
+        CHECK(stats.average() == 6); // 5.67
+    }
+
+    SECTION("invalid measurements are ignored") {
+        stats.update(-70);
+        stats.update(BLE_LINK_STATS_RSSI_INVALID);
+        CHECK(stats.last() == -70);
+        CHECK(stats.max() == -70);
+        CHECK(stats.count() == 1);
+    }
+
+    SECTION("measurements are counted in the histogram") {
+        const int8_t values[] = { -127, -91, -90, -81, -80, -55, -31, -30, 0, 20 };
+        const int buckets[] = { 0, 0, 1, 1, 2, 4, 6, 7, 7, 7 };
+        for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+            CHECK(BleRssiStats::bucket(values[i]) == buckets[i]);
+            stats.update(values[i]);
+        }
+        const uint32_t expected[BLE_LINK_STATS_RSSI_BUCKET_COUNT] = { 2, 2, 1, 0, 1, 0, 1, 3 };
+        for (int i = 0; i < BLE_LINK_STATS_RSSI_BUCKET_COUNT; ++i) {
+            CHECK(stats.histogram(i) == expected[i]);
+        }
+    }
+
+    SECTION("reset clears all measurements") {
+        stats.update(-40);
+        stats.update(-80);
+        stats.reset();
+        CHECK(stats.last() == BLE_LINK_STATS_RSSI_INVALID);
+        CHECK(stats.min() == BLE_LINK_STATS_RSSI_INVALID);
+        CHECK(stats.max() == BLE_LINK_STATS_RSSI_INVALID);
+        CHECK(stats.average() == BLE_LINK_STATS_RSSI_INVALID);
+        CHECK(stats.count() == 0);
+        CHECK(stats.histogram(BleRssiStats::bucket(-40)) == 0);
+        CHECK(stats.histogram(BleRssiStats::bucket(-80)) == 0);
+        stats.update(-65);
+        CHECK(stats.min() == -65);
+        CHECK(stats.max() == -65);
+    }
+}
+
+TEST_CASE("BleRssiTotals") {
+    BleRssiTotals totals;
+
+    SECTION("no links") {
+        CHECK(totals.min() == BLE_LINK_STATS_RSSI_INVALID);
+        CHECK(totals.max() == BLE_LINK_STATS_RSSI_INVALID);
+        CHECK(totals.average() == BLE_LINK_STATS_RSSI_INVALID);
+    }
+
+    SECTION("aggregates the last measurement of each link") {
+        BleRssiStats link1, link2, link3;
+        link1.update(-90);
+        link1.update(-50); // Only the last measurement is used
+        link2.update(-70);
+        link3.update(-65);
+        totals.add(link1);
+        totals.add(link2);
+        totals.add(link3);
+        CHECK(totals.min() == -70);
+        CHECK(totals.max() == -50);
+        CHECK(totals.average() == -62); // -61.67
+    }
+
+    SECTION("links without measurements are skipped") {
+        BleRssiStats link1, link2;
+        link2.update(-80);
+        totals.add(link1);
+        CHECK(totals.min() == BLE_LINK_STATS_RSSI_INVALID);
+        totals.add(link2);
+        CHECK(totals.min() == -80);
+        CHECK(totals.max() == -80);
+        CHECK(totals.average() == -80);
+    }
+}
@@ -0,0 +1,110 @@
+#include "hw_crc32.h"
+
+#include <catch2/catch.hpp>
+
+#include <zlib.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace {
+
+// Bitwise reference implementation
+uint32_t referenceCrc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int j = 0; j < 8; ++j) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320 : 0);
+        }
+    }
+    return ~crc;
+}
+
+// Byte-wise table implementation, as used by the bootloader
+uint32_t bytewiseCrc32(const uint8_t* data, size_t size) {
+    static uint32_t table[256] = {};
+    if (!table[1]) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int j = 0; j < 8; ++j) {
+                c = (c >> 1) ^ ((c & 1) ? 0xedb88320 : 0);
+            }
+            table[i] = c;
+        }
+    }
+    uint32_t crc = ~0u;
+    while (size--) {
+        crc = table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+std::string randomData(size_t size, unsigned seed = 1) {
+    std::mt19937 gen(seed);
+    std::string s(size, '\0');
+    for (auto& c: s) {
+        c = gen();
+    }
+    return s;
+}
+
+} // namespace
+
+TEST_CASE("Compute_CRC32") {
+    SECTION("computes the CRC of known data") {
+        const auto s = std::string("123456789");
+        CHECK(Compute_CRC32((const uint8_t*)s.data(), s.size(), nullptr) == 0xcbf43926);
+        CHECK(Compute_CRC32(nullptr, 0, nullptr) == 0);
+    }
+
+    SECTION("matches the reference implementation for any size and alignment") {
+        const auto s = randomData(100);
+        for (size_t offs = 0; offs < 8; ++offs) {
+            for (size_t size = 0; size <= s.size() - offs; ++size) {
+                const auto p = (const uint8_t*)s.data() + offs;
+                REQUIRE(Compute_CRC32(p, size, nullptr) == referenceCrc32(p, size));
+            }
+        }
+    }
+
+    SECTION("can compute the CRC of data split into several buffers") {
+        const auto s = randomData(1000);
+        const auto p = (const uint8_t*)s.data();
+        uint32_t crc = 0;
+        for (size_t offs = 0; offs < s.size();) {
+            const size_t n = std::min<size_t>(s.size() - offs, 1 + offs % 37);
+            crc = Compute_CRC32(p + offs, n, &crc);
+            offs += n;
+        }
+        CHECK(crc == referenceCrc32(p, s.size()));
+    }
+}
+
+TEST_CASE("Compute_CRC32 benchmark", "[benchmark][.]") {
+    // Size of a typical system firmware module
+    const auto s = randomData(600 * 1024);
+    const auto p = (const uint8_t*)s.data();
+    const unsigned iterations = 20;
+
+    const auto run = [&](const char* name, uint32_t(*fn)(const uint8_t*, size_t)) {
+        uint32_t crc = 0;
+        const auto t1 = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < iterations; ++i) {
+            crc += fn(p, s.size());
+        }
+        const auto t2 = std::chrono::steady_clock::now();
+        const auto time = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+        std::cout << name << ": " << (time / iterations) << "us per " << s.size() / 1024 << "KB (" <<
+                std::hex << crc << std::dec << ")" << std::endl;
+    };
+    run("byte-wise", bytewiseCrc32);
+    run("Compute_CRC32", [](const uint8_t* data, size_t size) {
+        return Compute_CRC32(data, size, nullptr);
+    });
+    run("zlib", [](const uint8_t* data, size_t size) {
+        return (uint32_t)crc32(0, data, size);
+    });
+}
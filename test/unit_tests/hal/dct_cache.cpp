@@ -0,0 +1,300 @@
+#include "dct_cache.h"
+#include "system_error.h"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace particle;
+
+namespace {
+
+const size_t DCT_SIZE = 8 * 1024 + 100;
+
+// Simulated DCT storage that counts the storage operations. Written data becomes visible in
+// the committed contents only after sync() is called
+class SimulatedStorage: public DctStorage {
+public:
+    SimulatedStorage() :
+            data_(DCT_SIZE, (char)0xff),
+            committed_(data_),
+            readCount_(0),
+            writeCount_(0),
+            syncCount_(0),
+            bytesWritten_(0),
+            writeError_(0) {
+    }
+
+    int read(size_t offset, uint8_t* data, size_t size) override {
+        REQUIRE(offset + size <= data_.size());
+        memcpy(data, data_.data() + offset, size);
+        ++readCount_;
+        return size;
+    }
+
+    int write(size_t offset, const uint8_t* data, size_t size) override {
+        REQUIRE(offset + size <= data_.size());
+        if (writeError_ < 0) {
+            return writeError_;
+        }
+        memcpy(&data_[offset], data, size);
+        ++writeCount_;
+        bytesWritten_ += size;
+        return size;
+    }
+
+    int sync() override {
+        committed_ = data_;
+        ++syncCount_;
+        return 0;
+    }
+
+    const std::string& committed() const {
+        return committed_;
+    }
+
+    unsigned readCount() const {
+        return readCount_;
+    }
+
+    unsigned writeCount() const {
+        return writeCount_;
+    }
+
+    unsigned syncCount() const {
+        return syncCount_;
+    }
+
+    size_t bytesWritten() const {
+        return bytesWritten_;
+    }
+
+    void writeError(int error) {
+        writeError_ = error;
+    }
+
+    void resetCounters() {
+        readCount_ = 0;
+        writeCount_ = 0;
+        syncCount_ = 0;
+        bytesWritten_ = 0;
+    }
+
+private:
+    std::string data_;
+    std::string committed_;
+    unsigned readCount_;
+    unsigned writeCount_;
+    unsigned syncCount_;
+    size_t bytesWritten_;
+    int writeError_;
+};
+
+std::string readString(DctCache* cache, size_t offset, size_t size) {
+    std::string s(size, '\0');
+    REQUIRE(cache->read(offset, (uint8_t*)&s[0], size) == (int)size);
+    return s;
+}
+
+void writeString(DctCache* cache, size_t offset, const std::string& s) {
+    REQUIRE(cache->write(offset, (const uint8_t*)s.data(), s.size()) == (int)s.size());
+}
+
+} // namespace
+
+TEST_CASE("DctCache") {
+    SimulatedStorage storage;
+    DctCache cache(&storage, DCT_SIZE);
+
+    SECTION("repeated reads of the same data don't access the storage") {
+        const auto s = readString(&cache, 100, 4);
+        CHECK(s == std::string(4, (char)0xff));
+        CHECK(storage.readCount() == 1);
+        for (int i = 0; i < 10; ++i) {
+            CHECK(readString(&cache, 100, 4) == s);
+            CHECK(readString(&cache, 200, 8) == std::string(8, (char)0xff));
+        }
+        CHECK(storage.readCount() == 1);
+    }
+
+    SECTION("writes are not committed until the cache is flushed") {
+        writeString(&cache, 10, "abcd");
+        writeString(&cache, 20, "efgh");
+        CHECK(cache.dirty());
+        CHECK(readString(&cache, 10, 14) == std::string("abcd") + std::string(6, (char)0xff) + "efgh");
+        CHECK(storage.committed().substr(10, 4) == std::string(4, (char)0xff));
+        CHECK(cache.flush() == 0);
+        CHECK_FALSE(cache.dirty());
+        CHECK(storage.committed().substr(10, 14) == std::string("abcd") + std::string(6, (char)0xff) + "efgh");
+        // Only the modified range of the block is written
+        CHECK(storage.writeCount() == 1);
+        CHECK(storage.bytesWritten() == 14);
+        CHECK(storage.syncCount() == 1);
+    }
+
+    SECTION("writing unchanged data doesn't make the cache dirty") {
+        writeString(&cache, 300, std::string(16, (char)0xff));
+        CHECK_FALSE(cache.dirty());
+        CHECK(cache.flush() == 0);
+        CHECK(storage.writeCount() == 0);
+        CHECK(storage.syncCount() == 0);
+    }
+
+    SECTION("evicted blocks are written back") {
+        for (size_t i = 0; i <= DctCache::BLOCK_COUNT; ++i) {
+            writeString(&cache, i * DctCache::BLOCK_SIZE + 1, "x");
+        }
+        CHECK(storage.writeCount() == 1);
+        CHECK(cache.flush() == 0);
+        CHECK(storage.writeCount() == DctCache::BLOCK_COUNT + 1);
+        CHECK(storage.syncCount() == 1);
+        for (size_t i = 0; i <= DctCache::BLOCK_COUNT; ++i) {
+            CHECK(storage.committed()[i * DctCache::BLOCK_SIZE + 1] == 'x');
+        }
+    }
+
+    SECTION("large accesses bypass the cache") {
+        std::string s(2000, 'k');
+        writeString(&cache, 1000, s);
+        CHECK(storage.readCount() == 0);
+        CHECK(cache.dirty());
+        CHECK(readString(&cache, 1000, s.size()) == s);
+        CHECK(cache.flush() == 0);
+        CHECK(storage.committed().substr(1000, s.size()) == s);
+    }
+
+    SECTION("large accesses are consistent with the cached data") {
+        writeString(&cache, 1500, "cached");
+        std::string s(2000, 'k');
+        writeString(&cache, 1000, s);
+        CHECK(readString(&cache, 1000, s.size()) == s);
+        writeString(&cache, 1500, "cached");
+        s.replace(500, 6, "cached");
+        CHECK(readString(&cache, 1000, s.size()) == s);
+        CHECK(cache.flush() == 0);
+        CHECK(storage.committed().substr(1000, s.size()) == s);
+    }
+
+    SECTION("matches the storage contents after random accesses") {
+        std::mt19937 gen(1);
+        std::string expected(DCT_SIZE, (char)0xff);
+        for (int i = 0; i < 2000; ++i) {
+            const size_t size = std::uniform_int_distribution<size_t>(1, 1300)(gen);
+            const size_t offs = std::uniform_int_distribution<size_t>(0, DCT_SIZE - size)(gen);
+            if (gen() % 2) {
+                std::string s(size, '\0');
+                for (auto& c: s) {
+                    c = gen();
+                }
+                writeString(&cache, offs, s);
+                expected.replace(offs, size, s);
+            } else {
+                REQUIRE(readString(&cache, offs, size) == expected.substr(offs, size));
+            }
+            if (gen() % 16 == 0) {
+                REQUIRE(cache.flush() == 0);
+                REQUIRE(storage.committed() == expected);
+            }
+        }
+        CHECK(cache.flush() == 0);
+        CHECK(storage.committed() == expected);
+    }
+
+    SECTION("fails on out of range access") {
+        uint8_t b = 0;
+        CHECK(cache.read(DCT_SIZE, &b, 1) == SYSTEM_ERROR_OUT_OF_RANGE);
+        CHECK(cache.write(DCT_SIZE - 1, (const uint8_t*)"ab", 2) == SYSTEM_ERROR_OUT_OF_RANGE);
+    }
+
+    SECTION("a block that fails to be written back is discarded") {
+        writeString(&cache, 10, "abcd");
+        storage.writeError(SYSTEM_ERROR_FLASH_IO);
+        CHECK(cache.flush() == SYSTEM_ERROR_FLASH_IO);
+        storage.writeError(0);
+        // The cached data is reloaded from the storage
+        CHECK(readString(&cache, 10, 4) == std::string(4, (char)0xff));
+        CHECK(cache.flush() == 0);
+        CHECK(storage.writeCount() == 0);
+        CHECK_FALSE(cache.dirty());
+        CHECK(storage.committed().substr(10, 4) == std::string(4, (char)0xff));
+    }
+
+    SECTION("can access the last partial block") {
+        writeString(&cache, DCT_SIZE - 4, "abcd");
+        CHECK(readString(&cache, DCT_SIZE - 4, 4) == "abcd");
+        CHECK(cache.flush() == 0);
+        CHECK(storage.committed().substr(DCT_SIZE - 4) == "abcd");
+    }
+}
+
+TEST_CASE("DctCache benchmark", "[benchmark][.]") {
+    // Typical access pattern of the system: small config fields read frequently and written
+    // occasionally, with an occasional key read
+    struct Access {
+        size_t offset;
+        size_t size;
+        bool write;
+    };
+    const Access accesses[] = {
+        { 0, 32, false }, // System flags
+        { 1728, 4, false }, // Feature flags
+        { 1728, 4, true },
+        { 1732, 4, false }, // Country code
+        { 2946, 1, false }, // Cloud transport
+        { 1600, 24, false }, // IP config
+        { 1736, 63, true }, // Claim code
+        { 1799, 1, true }, // Claimed flag
+        { 0, 32, false },
+        { 1728, 4, false },
+        { 2, 1216, false }, // Device private key
+        { 1218, 384, false } // Device public key
+    };
+    const unsigned iterations = 100;
+
+    SimulatedStorage uncachedStorage;
+    std::vector<uint8_t> buf(2048, 0);
+    auto t1 = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; ++i) {
+        for (const auto& a: accesses) {
+            // Every access reads or writes the storage and writes are committed immediately
+            if (a.write) {
+                uncachedStorage.write(a.offset, buf.data(), a.size);
+                uncachedStorage.sync();
+            } else {
+                uncachedStorage.read(a.offset, buf.data(), a.size);
+            }
+        }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    const auto uncachedTime = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+    SimulatedStorage cachedStorage;
+    DctCache cache(&cachedStorage, DCT_SIZE);
+    t1 = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; ++i) {
+        for (const auto& a: accesses) {
+            // The changes are written when the DCT lock is released, i.e. after each write
+            if (a.write) {
+                buf[0] = i;
+                cache.write(a.offset, buf.data(), a.size);
+                cache.flush();
+            } else {
+                cache.read(a.offset, buf.data(), a.size);
+            }
+        }
+    }
+    t2 = std::chrono::steady_clock::now();
+    const auto cachedTime = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+
+    const size_t count = sizeof(accesses) / sizeof(accesses[0]) * iterations;
+    std::cout << "DCT, " << count << " accesses:" << std::endl;
+    std::cout << "  uncached: " << uncachedStorage.readCount() << " reads, " << uncachedStorage.writeCount() <<
+            " writes, " << uncachedStorage.syncCount() << " commits, " << uncachedTime << "us" << std::endl;
+    std::cout << "  cached: " << cachedStorage.readCount() << " reads, " << cachedStorage.writeCount() <<
+            " writes, " << cachedStorage.syncCount() << " commits, " << cachedTime << "us" << std::endl;
+}
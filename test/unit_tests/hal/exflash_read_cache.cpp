@@ -0,0 +1,204 @@
+#include "exflash_read_cache.h"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const size_t FLASH_SIZE = 64 * 1024;
+
+// Simulated flash that counts the read transactions and checks the alignment requirements
+// of the QSPI peripheral
+class SimulatedFlash {
+public:
+    SimulatedFlash() :
+            data_(FLASH_SIZE, '\0'),
+            readCount_(0),
+            bytesRead_(0),
+            failRead_(false) {
+        std::mt19937 gen(1);
+        for (auto& c: data_) {
+            c = gen();
+        }
+        instance_ = this;
+    }
+
+    ~SimulatedFlash() {
+        instance_ = nullptr;
+    }
+
+    void write(size_t addr, const std::string& data) {
+        data_.replace(addr, data.size(), data);
+    }
+
+    const std::string& data() const {
+        return data_;
+    }
+
+    unsigned readCount() const {
+        return readCount_;
+    }
+
+    size_t bytesRead() const {
+        return bytesRead_;
+    }
+
+    void resetCounters() {
+        readCount_ = 0;
+        bytesRead_ = 0;
+    }
+
+    void failRead(bool fail) {
+        failRead_ = fail;
+    }
+
+    static int read(uintptr_t addr, uint8_t* data, size_t size) {
+        REQUIRE(instance_);
+        REQUIRE(addr % 4 == 0);
+        REQUIRE((uintptr_t)data % 4 == 0);
+        REQUIRE(size % 4 == 0);
+        REQUIRE(size > 0);
+        REQUIRE(addr + size <= FLASH_SIZE);
+        if (instance_->failRead_) {
+            return 1;
+        }
+        memcpy(data, instance_->data_.data() + addr, size);
+        ++instance_->readCount_;
+        instance_->bytesRead_ += size;
+        return 0;
+    }
+
+private:
+    std::string data_;
+    unsigned readCount_;
+    size_t bytesRead_;
+    bool failRead_;
+
+    static SimulatedFlash* instance_;
+};
+
+SimulatedFlash* SimulatedFlash::instance_ = nullptr;
+
+std::string readString(exflash_read_cache* cache, uintptr_t addr, size_t size, size_t bufOffs = 0) {
+    // Use a buffer with the specified alignment
+    std::vector<uint32_t> buf((size + bufOffs + 3) / 4 + 1, 0);
+    const auto p = (uint8_t*)buf.data() + bufOffs;
+    REQUIRE(exflash_read_cache_read(cache, addr, p, size, &SimulatedFlash::read) == 0);
+    return std::string((const char*)p, size);
+}
+
+} // namespace
+
+TEST_CASE("exflash_read_cache") {
+    SimulatedFlash flash;
+    exflash_read_cache cache;
+    exflash_read_cache_init(&cache);
+
+    SECTION("sequential small reads are served from the cache") {
+        for (size_t addr = 0; addr < EXFLASH_READ_CACHE_LINE_SIZE * 4; addr += 4) {
+            REQUIRE(readString(&cache, addr, 4) == flash.data().substr(addr, 4));
+        }
+        CHECK(flash.readCount() == 4);
+        CHECK(flash.bytesRead() == EXFLASH_READ_CACHE_LINE_SIZE * 4);
+    }
+
+    SECTION("unaligned small reads are served from the cache") {
+        CHECK(readString(&cache, 13, 7, 1) == flash.data().substr(13, 7));
+        CHECK(readString(&cache, 21, 3, 3) == flash.data().substr(21, 3));
+        CHECK(readString(&cache, 1, 1, 2) == flash.data().substr(1, 1));
+        CHECK(flash.readCount() == 1);
+    }
+
+    SECTION("small reads crossing a line boundary fill two lines") {
+        const size_t addr = EXFLASH_READ_CACHE_LINE_SIZE - 2;
+        CHECK(readString(&cache, addr, 8) == flash.data().substr(addr, 8));
+        CHECK(flash.readCount() == 2);
+    }
+
+    SECTION("large aligned reads are transferred directly") {
+        const size_t size = EXFLASH_READ_CACHE_LINE_SIZE * 2;
+        CHECK(readString(&cache, 1024, size) == flash.data().substr(1024, size));
+        CHECK(flash.readCount() == 1);
+        CHECK(flash.bytesRead() == size);
+    }
+
+    SECTION("large unaligned reads don't fill the cache") {
+        const size_t size = EXFLASH_READ_CACHE_LINE_SIZE + 5;
+        CHECK(readString(&cache, 1027, size, 1) == flash.data().substr(1027, size));
+        CHECK(flash.bytesRead() < size + 16);
+        CHECK_FALSE(cache.valid);
+    }
+
+    SECTION("invalidated cache is refilled") {
+        CHECK(readString(&cache, 100, 4) == flash.data().substr(100, 4));
+        flash.write(100, "abcd");
+        exflash_read_cache_invalidate(&cache);
+        CHECK(readString(&cache, 100, 4) == "abcd");
+        CHECK(flash.readCount() == 2);
+    }
+
+    SECTION("reads without a cache access the flash every time") {
+        for (int i = 0; i < 3; ++i) {
+            CHECK(readString(nullptr, 101, 6, 3) == flash.data().substr(101, 6));
+        }
+        CHECK(flash.readCount() >= 3);
+        CHECK(flash.bytesRead() <= 3 * 16);
+    }
+
+    SECTION("returns the error of a failed read") {
+        uint8_t buf[4] = {};
+        flash.failRead(true);
+        CHECK(exflash_read_cache_read(&cache, 0, buf, sizeof(buf), &SimulatedFlash::read) == 1);
+        flash.failRead(false);
+        CHECK(readString(&cache, 0, 4) == flash.data().substr(0, 4));
+    }
+
+    SECTION("matches the flash contents after random reads") {
+        std::mt19937 gen(2);
+        for (int i = 0; i < 10000; ++i) {
+            const size_t size = (gen() % 4 == 0) ? std::uniform_int_distribution<size_t>(1, 1000)(gen) :
+                    std::uniform_int_distribution<size_t>(1, 16)(gen);
+            const size_t addr = std::uniform_int_distribution<size_t>(0, FLASH_SIZE - size)(gen);
+            const size_t bufOffs = gen() % 4;
+            exflash_read_cache* c = (gen() % 8 == 0) ? nullptr : &cache;
+            REQUIRE(readString(c, addr, size, bufOffs) == flash.data().substr(addr, size));
+        }
+    }
+}
+
+TEST_CASE("exflash_read_cache benchmark", "[benchmark][.]") {
+    SimulatedFlash flash;
+    uint32_t buf[FLASH_SIZE / 4] = {};
+
+    // CRC calculation over a module that reads the flash 4 bytes at a time, and a file system
+    // that reads 256-byte blocks
+    struct Workload {
+        const char* name;
+        size_t readSize;
+    };
+    const Workload workloads[] = {
+        { "4-byte reads", 4 },
+        { "256-byte reads", 256 }
+    };
+    for (const auto& w: workloads) {
+        for (int cached = 0; cached <= 1; ++cached) {
+            exflash_read_cache cache;
+            exflash_read_cache_init(&cache);
+            flash.resetCounters();
+            const auto t1 = std::chrono::steady_clock::now();
+            for (size_t addr = 0; addr < FLASH_SIZE; addr += w.readSize) {
+                exflash_read_cache_read(cached ? &cache : nullptr, addr, (uint8_t*)buf, w.readSize, &SimulatedFlash::read);
+            }
+            const auto t2 = std::chrono::steady_clock::now();
+            const auto time = std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+            std::cout << w.name << ", " << (cached ? "cached" : "uncached") << ": " << flash.readCount() <<
+                    " transactions, " << flash.bytesRead() << " bytes, " << time << "us" << std::endl;
+        }
+    }
+}
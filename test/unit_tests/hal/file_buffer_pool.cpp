@@ -0,0 +1,106 @@
+#include "file_buffer_pool.h"
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <set>
+#include <vector>
+
+using namespace particle::fs;
+
+namespace {
+
+const size_t BUFFER_SIZE = 256;
+const size_t BUFFER_COUNT = 4;
+
+typedef FileBufferPool<BUFFER_SIZE, BUFFER_COUNT> TestPool;
+
+} // namespace
+
+TEST_CASE("FileBufferPool") {
+    static TestPool pool; // Zero-initialized
+    REQUIRE(pool.usedCount() == 0);
+
+    SECTION("buffers are allocated from the pool") {
+        std::set<void*> bufs;
+        for (size_t i = 0; i < BUFFER_COUNT; ++i) {
+            void* p = pool.alloc(BUFFER_SIZE);
+            REQUIRE(p);
+            CHECK(pool.isPoolBuffer(p));
+            CHECK((uintptr_t)p % 4 == 0);
+            memset(p, i, BUFFER_SIZE);
+            bufs.insert(p);
+        }
+        CHECK(bufs.size() == BUFFER_COUNT);
+        CHECK(pool.usedCount() == BUFFER_COUNT);
+        for (auto p: bufs) {
+            pool.free(p);
+        }
+        CHECK(pool.usedCount() == 0);
+    }
+
+    SECTION("falls back to the heap when the pool is exhausted") {
+        std::vector<void*> bufs;
+        for (size_t i = 0; i < BUFFER_COUNT; ++i) {
+            bufs.push_back(pool.alloc(BUFFER_SIZE));
+        }
+        void* p = pool.alloc(BUFFER_SIZE);
+        REQUIRE(p);
+        CHECK_FALSE(pool.isPoolBuffer(p));
+        CHECK(pool.usedCount() == BUFFER_COUNT);
+        pool.free(p); // Freed to the heap
+        CHECK(pool.usedCount() == BUFFER_COUNT);
+        // A released buffer can be allocated again
+        pool.free(bufs[2]);
+        CHECK(pool.usedCount() == BUFFER_COUNT - 1);
+        CHECK(pool.alloc(16) == bufs[2]);
+        for (auto b: bufs) {
+            pool.free(b);
+        }
+        CHECK(pool.usedCount() == 0);
+    }
+
+    SECTION("allocations larger than a buffer are served from the heap") {
+        void* p = pool.alloc(BUFFER_SIZE + 1);
+        REQUIRE(p);
+        CHECK_FALSE(pool.isPoolBuffer(p));
+        CHECK(pool.usedCount() == 0);
+        memset(p, 0, BUFFER_SIZE + 1);
+        pool.free(p);
+        CHECK(pool.usedCount() == 0);
+    }
+
+    SECTION("freeing a buffer twice doesn't affect other buffers") {
+        void* p1 = pool.alloc(BUFFER_SIZE);
+        void* p2 = pool.alloc(BUFFER_SIZE);
+        pool.free(p1);
+        pool.free(p1);
+        CHECK(pool.usedCount() == 1);
+        // The other buffer is still allocated and is not handed out again
+        void* p3 = pool.alloc(BUFFER_SIZE);
+        void* p4 = pool.alloc(BUFFER_SIZE);
+        CHECK(p3 != p2);
+        CHECK(p4 != p2);
+        CHECK(p3 != p4);
+        CHECK(pool.usedCount() == 3);
+        pool.free(p2);
+        pool.free(p3);
+        pool.free(p4);
+        CHECK(pool.usedCount() == 0);
+    }
+
+    SECTION("pointers into the middle of a buffer are ignored") {
+        void* p = pool.alloc(BUFFER_SIZE);
+        pool.free((uint8_t*)p + 1);
+        CHECK(pool.usedCount() == 1);
+        pool.free(p);
+        CHECK(pool.usedCount() == 0);
+    }
+
+    SECTION("freeing a null pointer has no effect") {
+        void* p = pool.alloc(BUFFER_SIZE);
+        pool.free(nullptr);
+        CHECK(pool.usedCount() == 1);
+        pool.free(p);
+    }
+}
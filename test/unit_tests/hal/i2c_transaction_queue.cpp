@@ -0,0 +1,598 @@
+#include "i2c_transaction_queue.h"
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace particle;
+
+namespace {
+
+int g_irqDisabled = 0;
+
+} // namespace
+
+extern "C" int HAL_disable_irq() {
+    return g_irqDisabled++;
+}
+
+extern "C" void HAL_enable_irq(int mask) {
+    g_irqDisabled = mask;
+}
+
+namespace {
+
+// Simulated I2C bus with a set of devices that expose a register file
+class MockBus: public I2cBus {
+public:
+    MockBus() :
+            current_(nullptr),
+            startError_(0),
+            timerTimeout_(0),
+            time_(0),
+            transferCount_(0),
+            abortCount_(0),
+            recoverCount_(0) {
+    }
+
+    int startTransfer(const hal_i2c_transaction_t* trans) override {
+        REQUIRE(g_irqDisabled > 0);
+        REQUIRE(!current_);
+        if (startError_) {
+            const int r = startError_;
+            startError_ = 0;
+            return r;
+        }
+        current_ = trans;
+        ++transferCount_;
+        return 0;
+    }
+
+    void abortTransfer() override {
+        REQUIRE(g_irqDisabled > 0);
+        REQUIRE(current_);
+        current_ = nullptr;
+        ++abortCount_;
+    }
+
+    void recoverBus() override {
+        REQUIRE(g_irqDisabled == 0);
+        REQUIRE(!current_);
+        ++recoverCount_;
+        if (onRecover_) {
+            onRecover_();
+        }
+    }
+
+    void startTimer(system_tick_t timeout) override {
+        REQUIRE(g_irqDisabled == 0);
+        timerTimeout_ = timeout;
+    }
+
+    system_tick_t millis() override {
+        return time_;
+    }
+
+    // Completes the current transaction as the peripheral would
+    void complete(I2cTransactionQueue* queue) {
+        REQUIRE(current_);
+        const auto trans = current_;
+        current_ = nullptr;
+        int result = 0;
+        auto it = devices_.find(trans->address);
+        if (it == devices_.end()) {
+            result = SYSTEM_ERROR_IO; // Address NACK
+        } else {
+            auto& regs = it->second;
+            size_t reg = 0;
+            if (trans->tx_length > 0) {
+                reg = trans->tx_buffer[0];
+                for (size_t i = 1; i < trans->tx_length; ++i) {
+                    regs[(reg + i - 1) % regs.size()] = trans->tx_buffer[i];
+                }
+            }
+            for (size_t i = 0; i < trans->rx_length; ++i) {
+                trans->rx_buffer[i] = regs[(reg + i) % regs.size()];
+            }
+        }
+        queue->transferDone(result);
+    }
+
+    void addDevice(uint8_t address, const std::string& regs) {
+        devices_[address] = regs;
+    }
+
+    const std::string& device(uint8_t address) {
+        return devices_[address];
+    }
+
+    const hal_i2c_transaction_t* current() const {
+        return current_;
+    }
+
+    void startError(int error) {
+        startError_ = error;
+    }
+
+    system_tick_t timerTimeout() const {
+        return timerTimeout_;
+    }
+
+    void advance(system_tick_t ms) {
+        time_ += ms;
+    }
+
+    unsigned transferCount() const {
+        return transferCount_;
+    }
+
+    unsigned abortCount() const {
+        return abortCount_;
+    }
+
+    unsigned recoverCount() const {
+        return recoverCount_;
+    }
+
+    // Sets a function to call while the bus is being recovered
+    void onRecover(std::function<void()> fn) {
+        onRecover_ = std::move(fn);
+    }
+
+private:
+    std::map<uint8_t, std::string> devices_;
+    const hal_i2c_transaction_t* current_;
+    int startError_;
+    system_tick_t timerTimeout_;
+    system_tick_t time_;
+    unsigned transferCount_;
+    unsigned abortCount_;
+    unsigned recoverCount_;
+    std::function<void()> onRecover_;
+};
+
+struct Result {
+    int id;
+    int result;
+    bool busBusy; // Whether the next transaction was already started when the callback was invoked
+};
+
+struct Transaction {
+    hal_i2c_transaction_t trans;
+    std::vector<Result>* results;
+    MockBus* bus;
+    int id;
+    uint8_t txData[8];
+    uint8_t rxData[8];
+
+    Transaction(int id, uint8_t address, std::vector<Result>* results, MockBus* bus) :
+            trans(),
+            results(results),
+            bus(bus),
+            id(id),
+            txData(),
+            rxData() {
+        trans.size = sizeof(trans);
+        trans.address = address;
+        trans.flags = HAL_I2C_TRANSMISSION_FLAG_STOP;
+        trans.callback = [](int result, void* ctx) {
+            const auto t = (Transaction*)ctx;
+            t->results->push_back({ t->id, result, t->bus->current() != nullptr });
+        };
+        trans.context = this;
+    }
+
+    Transaction& readRegister(uint8_t reg, size_t size) {
+        txData[0] = reg;
+        trans.tx_buffer = txData;
+        trans.tx_length = 1;
+        trans.rx_buffer = rxData;
+        trans.rx_length = size;
+        return *this;
+    }
+
+    std::string received() const {
+        return std::string((const char*)rxData, trans.rx_length);
+    }
+
+    Transaction& writeNoStop(uint8_t reg) {
+        txData[0] = reg;
+        trans.tx_buffer = txData;
+        trans.tx_length = 1;
+        trans.flags = 0;
+        return *this;
+    }
+
+    Transaction& read(size_t size) {
+        trans.rx_buffer = rxData;
+        trans.rx_length = size;
+        return *this;
+    }
+};
+
+} // namespace
+
+TEST_CASE("I2cTransactionQueue") {
+    MockBus bus;
+    bus.addDevice(0x10, "0123456789");
+    bus.addDevice(0x20, "abcdefghij");
+    I2cTransactionQueue queue;
+    queue.init(&bus);
+    std::vector<Result> results;
+
+    SECTION("performs transactions in order") {
+        Transaction t1(1, 0x10, &results, &bus);
+        Transaction t2(2, 0x20, &results, &bus);
+        Transaction t3(3, 0x10, &results, &bus);
+        t1.readRegister(0, 2);
+        t2.readRegister(3, 4);
+        t3.readRegister(8, 3);
+        t1.trans.next = &t2.trans;
+        REQUIRE(queue.push(&t1.trans) == 0);
+        REQUIRE(queue.push(&t3.trans) == 0);
+        CHECK(bus.current() == &t1.trans);
+        CHECK(bus.timerTimeout() == HAL_I2C_DEFAULT_TIMEOUT_MS);
+        bus.complete(&queue);
+        CHECK(bus.current() == &t2.trans);
+        bus.complete(&queue);
+        CHECK(bus.current() == &t3.trans);
+        bus.complete(&queue);
+        CHECK(bus.current() == nullptr);
+        CHECK(queue.isIdle());
+        REQUIRE(results.size() == 3);
+        CHECK(results[0].id == 1);
+        CHECK(results[1].id == 2);
+        CHECK(results[2].id == 3);
+        for (const auto& r: results) {
+            CHECK(r.result == 0);
+        }
+        // The next transaction is started before the callback of the previous one is invoked
+        CHECK(results[0].busBusy);
+        CHECK(results[1].busBusy);
+        CHECK_FALSE(results[2].busBusy);
+        CHECK(t1.received() == "01");
+        CHECK(t2.received() == "defg");
+        CHECK(t3.received() == "890");
+        CHECK(t1.trans.next == nullptr);
+        CHECK(g_irqDisabled == 0);
+    }
+
+    SECTION("a transaction can be queued again from its callback") {
+        struct Poller {
+            Transaction t;
+            I2cTransactionQueue* queue;
+            int remaining;
+        };
+        Poller p = { Transaction(1, 0x10, &results, &bus), &queue, 3 };
+        p.t.readRegister(5, 1);
+        p.t.trans.context = &p;
+        p.t.trans.callback = [](int result, void* ctx) {
+            const auto p = (Poller*)ctx;
+            p->t.results->push_back({ p->t.id, result, false });
+            if (--p->remaining > 0) {
+                REQUIRE(p->queue->push(&p->t.trans) == 0);
+            }
+        };
+        REQUIRE(queue.push(&p.t.trans) == 0);
+        while (bus.current()) {
+            bus.complete(&queue);
+        }
+        CHECK(results.size() == 3);
+        CHECK(bus.transferCount() == 3);
+        CHECK(queue.isIdle());
+    }
+
+    SECTION("reports a NACK and continues with the next transaction") {
+        Transaction t1(1, 0x30, &results, &bus);
+        Transaction t2(2, 0x20, &results, &bus);
+        t1.readRegister(0, 1);
+        t2.readRegister(0, 1);
+        REQUIRE(queue.push(&t1.trans) == 0);
+        REQUIRE(queue.push(&t2.trans) == 0);
+        bus.complete(&queue);
+        bus.complete(&queue);
+        REQUIRE(results.size() == 2);
+        CHECK(results[0].result == SYSTEM_ERROR_IO);
+        CHECK(results[1].result == 0);
+        CHECK(t2.received() == "a");
+    }
+
+    SECTION("reports an error if a transaction fails to start") {
+        Transaction t1(1, 0x10, &results, &bus);
+        Transaction t2(2, 0x10, &results, &bus);
+        t1.readRegister(0, 1);
+        t2.readRegister(1, 1);
+        t1.trans.next = &t2.trans;
+        bus.startError(SYSTEM_ERROR_BUSY);
+        REQUIRE(queue.push(&t1.trans) == 0);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].id == 1);
+        CHECK(results[0].result == SYSTEM_ERROR_BUSY);
+        CHECK(bus.current() == &t2.trans);
+        bus.complete(&queue);
+        REQUIRE(results.size() == 2);
+        CHECK(results[1].result == 0);
+        CHECK(t2.received() == "1");
+    }
+
+    SECTION("aborts a transaction that times out") {
+        Transaction t1(1, 0x10, &results, &bus);
+        Transaction t2(2, 0x10, &results, &bus);
+        t1.readRegister(0, 1);
+        t1.trans.timeout_ms = 50;
+        t2.readRegister(1, 1);
+        t2.trans.timeout_ms = 20;
+        REQUIRE(queue.push(&t1.trans) == 0);
+        REQUIRE(queue.push(&t2.trans) == 0);
+        CHECK(bus.timerTimeout() == 50);
+        bus.advance(30);
+        CHECK(queue.checkTimeout() == 20);
+        CHECK(results.empty());
+        bus.advance(20);
+        CHECK(queue.checkTimeout() == 0);
+        CHECK(bus.abortCount() == 1);
+        CHECK(bus.recoverCount() == 1);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].result == SYSTEM_ERROR_TIMEOUT);
+        CHECK(bus.current() == &t2.trans);
+        CHECK(bus.timerTimeout() == 20);
+        // A late completion notification is ignored once the queue is idle
+        bus.complete(&queue);
+        queue.transferDone(0);
+        CHECK(results.size() == 2);
+        CHECK(queue.checkTimeout() == 0);
+    }
+
+    SECTION("recovers the bus after a timeout without cancelling queued transactions") {
+        Transaction t1(1, 0x10, &results, &bus);
+        Transaction t2(2, 0x20, &results, &bus);
+        Transaction t3(3, 0x10, &results, &bus);
+        t1.readRegister(0, 1);
+        t1.trans.timeout_ms = 10;
+        t2.readRegister(1, 1);
+        t3.readRegister(2, 1);
+        REQUIRE(queue.push(&t1.trans) == 0);
+        REQUIRE(queue.push(&t2.trans) == 0);
+        bool recovered = false;
+        bus.onRecover([&]() {
+            // No transactions are started while the bus is being recovered
+            REQUIRE(queue.push(&t3.trans) == 0);
+            CHECK(bus.current() == nullptr);
+            CHECK(results.empty());
+            recovered = true;
+        });
+        bus.advance(10);
+        CHECK(queue.checkTimeout() == 0);
+        CHECK(recovered);
+        CHECK(bus.abortCount() == 1);
+        CHECK(bus.recoverCount() == 1);
+        REQUIRE(results.size() == 1);
+        CHECK(results[0].result == SYSTEM_ERROR_TIMEOUT);
+        CHECK(bus.current() == &t2.trans);
+        bus.complete(&queue);
+        CHECK(bus.current() == &t3.trans);
+        bus.complete(&queue);
+        CHECK(queue.isIdle());
+        REQUIRE(results.size() == 3);
+        CHECK(results[1].result == 0);
+        CHECK(results[2].result == 0);
+        CHECK(t2.received() == "b");
+        CHECK(t3.received() == "2");
+        // The bus is not recovered after a NACK
+        Transaction t4(4, 0x30, &results, &bus);
+        t4.readRegister(0, 1);
+        REQUIRE(queue.push(&t4.trans) == 0);
+        bus.complete(&queue);
+        CHECK(results.back().result == SYSTEM_ERROR_IO);
+        CHECK(bus.recoverCount() == 1);
+        CHECK(g_irqDisabled == 0);
+    }
+
+    SECTION("holds queued transactions while an exclusive write without a stop condition is pending") {
+        Transaction w(1, 0x10, &results, &bus);
+        Transaction t1(2, 0x20, &results, &bus);
+        Transaction t2(3, 0x20, &results, &bus);
+        Transaction r(4, 0x10, &results, &bus);
+        w.writeNoStop(3);
+        t1.readRegister(0, 1);
+        t2.readRegister(1, 1);
+        r.read(2);
+        REQUIRE(queue.push(&w.trans, true /* exclusive */) == 0);
+        REQUIRE(queue.push(&t1.trans) == 0);
+        bus.complete(&queue); // w
+        CHECK(queue.isHeld());
+        CHECK(bus.current() == nullptr);
+        REQUIRE(queue.push(&t2.trans) == 0);
+        CHECK(bus.current() == nullptr);
+        // The read that completes the repeated start sequence is performed ahead of the others
+        REQUIRE(queue.push(&r.trans, true /* exclusive */) == 0);
+        CHECK_FALSE(queue.isHeld());
+        CHECK(bus.current() == &r.trans);
+        bus.complete(&queue); // r
+        CHECK(bus.current() == &t1.trans);
+        bus.complete(&queue); // t1
+        CHECK(bus.current() == &t2.trans);
+        bus.complete(&queue); // t2
+        CHECK(queue.isIdle());
+        REQUIRE(results.size() == 4);
+        CHECK(results[0].id == 1);
+        CHECK(results[1].id == 4);
+        CHECK(results[2].id == 2);
+        CHECK(results[3].id == 3);
+        for (const auto& res: results) {
+            CHECK(res.result == 0);
+        }
+        CHECK(r.received() == "01"); // The mock device doesn't keep the register address
+        CHECK(t1.received() == "a");
+        CHECK(t2.received() == "b");
+    }
+
+    SECTION("doesn't hold the queue after a failed or non-exclusive write without a stop condition") {
+        Transaction w1(1, 0x30, &results, &bus); // Address NACK
+        Transaction w2(2, 0x10, &results, &bus);
+        Transaction t1(3, 0x20, &results, &bus);
+        w1.writeNoStop(0);
+        w2.writeNoStop(0);
+        t1.readRegister(0, 1);
+        REQUIRE(queue.push(&w1.trans, true /* exclusive */) == 0);
+        REQUIRE(queue.push(&w2.trans) == 0);
+        REQUIRE(queue.push(&t1.trans) == 0);
+        bus.complete(&queue); // w1
+        CHECK_FALSE(queue.isHeld());
+        CHECK(bus.current() == &w2.trans);
+        bus.complete(&queue); // w2
+        CHECK_FALSE(queue.isHeld());
+        CHECK(bus.current() == &t1.trans);
+        bus.complete(&queue); // t1
+        REQUIRE(results.size() == 3);
+        CHECK(results[0].result == SYSTEM_ERROR_IO);
+        CHECK(results[1].result == 0);
+        CHECK(results[2].result == 0);
+    }
+
+    SECTION("cancelling the queue releases the hold") {
+        Transaction w(1, 0x10, &results, &bus);
+        Transaction t1(2, 0x20, &results, &bus);
+        Transaction t2(3, 0x20, &results, &bus);
+        w.writeNoStop(0);
+        t1.readRegister(0, 1);
+        t2.readRegister(1, 1);
+        REQUIRE(queue.push(&w.trans, true /* exclusive */) == 0);
+        REQUIRE(queue.push(&t1.trans) == 0);
+        bus.complete(&queue); // w
+        CHECK(queue.isHeld());
+        queue.cancel();
+        CHECK_FALSE(queue.isHeld());
+        CHECK(bus.abortCount() == 0);
+        REQUIRE(results.size() == 2);
+        CHECK(results[1].result == SYSTEM_ERROR_CANCELLED);
+        REQUIRE(queue.push(&t2.trans) == 0);
+        CHECK(bus.current() == &t2.trans);
+    }
+
+    SECTION("a failed synchronous transfer doesn't affect pending asynchronous transactions") {
+        // The HAL performs synchronous transfers via the same queue. A NACK or a timeout is
+        // handled without resetting the whole bus, as that would cancel the transactions queued
+        // by other callers
+        Transaction t1(1, 0x10, &results, &bus);
+        Transaction sync1(2, 0x30, &results, &bus); // Address NACK
+        Transaction t2(3, 0x20, &results, &bus);
+        Transaction sync2(4, 0x10, &results, &bus); // Times out
+        Transaction t3(5, 0x20, &results, &bus);
+        t1.readRegister(0, 1);
+        sync1.readRegister(0, 1);
+        t2.readRegister(1, 1);
+        sync2.readRegister(2, 1);
+        sync2.trans.timeout_ms = 10;
+        t3.readRegister(2, 1);
+        REQUIRE(queue.push(&t1.trans) == 0);
+        REQUIRE(queue.push(&sync1.trans) == 0);
+        REQUIRE(queue.push(&t2.trans) == 0);
+        REQUIRE(queue.push(&sync2.trans) == 0);
+        REQUIRE(queue.push(&t3.trans) == 0);
+        bus.complete(&queue); // t1
+        bus.complete(&queue); // sync1
+        bus.complete(&queue); // t2
+        CHECK(bus.current() == &sync2.trans);
+        bus.advance(10);
+        CHECK(queue.checkTimeout() == 0);
+        CHECK(bus.abortCount() == 1);
+        CHECK(bus.current() == &t3.trans);
+        bus.complete(&queue); // t3
+        CHECK(queue.isIdle());
+        REQUIRE(results.size() == 5);
+        CHECK(results[0].result == 0);
+        CHECK(results[1].result == SYSTEM_ERROR_IO);
+        CHECK(results[2].result == 0);
+        CHECK(results[3].result == SYSTEM_ERROR_TIMEOUT);
+        CHECK(results[4].result == 0);
+        CHECK(t1.received() == "0");
+        CHECK(t2.received() == "b");
+        CHECK(t3.received() == "c");
+    }
+
+    SECTION("cancels all queued transactions") {
+        Transaction t1(1, 0x10, &results, &bus);
+        Transaction t2(2, 0x10, &results, &bus);
+        Transaction t3(3, 0x10, &results, &bus);
+        t1.readRegister(0, 1);
+        t2.readRegister(0, 1);
+        t3.readRegister(0, 1);
+        t1.trans.next = &t2.trans;
+        t2.trans.next = &t3.trans;
+        REQUIRE(queue.push(&t1.trans) == 0);
+        bus.complete(&queue);
+        queue.cancel();
+        CHECK(bus.abortCount() == 1);
+        CHECK(bus.current() == nullptr);
+        REQUIRE(results.size() == 3);
+        CHECK(results[0].result == 0);
+        CHECK(results[1].result == SYSTEM_ERROR_CANCELLED);
+        CHECK(results[2].result == SYSTEM_ERROR_CANCELLED);
+        CHECK(t2.trans.next == nullptr);
+        CHECK(queue.isIdle());
+    }
+
+    SECTION("validates transactions") {
+        Transaction t1(1, 0x10, &results, &bus);
+        Transaction t2(2, 0x10, &results, &bus);
+        t1.readRegister(0, 1);
+        t1.trans.next = &t2.trans;
+        t2.readRegister(0, 1);
+        t2.trans.rx_buffer = nullptr;
+        CHECK(queue.push(&t1.trans) == SYSTEM_ERROR_INVALID_ARGUMENT);
+        t2.trans.rx_buffer = t2.rxData;
+        t2.trans.tx_buffer = nullptr;
+        CHECK(queue.push(&t1.trans) == SYSTEM_ERROR_INVALID_ARGUMENT);
+        CHECK(queue.push(nullptr) == SYSTEM_ERROR_INVALID_ARGUMENT);
+        CHECK(bus.transferCount() == 0);
+        CHECK(results.empty());
+    }
+
+    SECTION("allows empty transactions") {
+        // Used to check if there's a device with the given address on the bus
+        Transaction t1(1, 0x10, &results, &bus);
+        Transaction t2(2, 0x30, &results, &bus);
+        REQUIRE(queue.push(&t1.trans) == 0);
+        REQUIRE(queue.push(&t2.trans) == 0);
+        bus.complete(&queue);
+        bus.complete(&queue);
+        REQUIRE(results.size() == 2);
+        CHECK(results[0].result == 0);
+        CHECK(results[1].result == SYSTEM_ERROR_IO);
+    }
+
+    SECTION("writes and reads back registers of several devices") {
+        std::deque<Transaction> trans;
+        for (int i = 0; i < 10; ++i) {
+            const uint8_t addr = (i % 2) ? 0x20 : 0x10;
+            trans.emplace_back(i * 2, addr, &results, &bus);
+            auto& w = trans.back();
+            w.txData[0] = i;
+            w.txData[1] = 'A' + i;
+            w.trans.tx_buffer = w.txData;
+            w.trans.tx_length = 2;
+            REQUIRE(queue.push(&w.trans) == 0);
+            trans.emplace_back(i * 2 + 1, addr, &results, &bus);
+            REQUIRE(queue.push(&trans.back().readRegister(i, 1).trans) == 0);
+        }
+        while (bus.current()) {
+            bus.complete(&queue);
+        }
+        REQUIRE(results.size() == 20);
+        for (int i = 0; i < 20; ++i) {
+            CHECK(results[i].id == i);
+            CHECK(results[i].result == 0);
+        }
+        for (int i = 0; i < 10; ++i) {
+            CHECK(trans[i * 2 + 1].received() == std::string(1, 'A' + i));
+        }
+        CHECK(bus.device(0x10) == "A1C3E5G7I9");
+        CHECK(bus.device(0x20) == "aBcDeFgHiJ");
+    }
+}
@@ -1,12 +1,20 @@
 #include "inflate.h"
+#include "ota_inflate_stream.h"
 #include "system_error.h"
 
 #include <boost/iostreams/filter/zlib.hpp>
 #include <boost/iostreams/filtering_streambuf.hpp>
 #include <boost/iostreams/copy.hpp>
 
+#include <zlib.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <functional>
+#include <iostream>
 #include <random>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -22,6 +30,8 @@ class Options {
 public:
     Options() :
             windowBits_(DEFAULT_WINDOW_BITS),
+            level_(Z_DEFAULT_COMPRESSION),
+            strategy_(Z_DEFAULT_STRATEGY),
             hasMoreInput_(false) {
     }
 
@@ -43,8 +53,28 @@ public:
         return windowBits_;
     }
 
+    Options& level(int level) {
+        level_ = level;
+        return *this;
+    }
+
+    int level() const {
+        return level_;
+    }
+
+    Options& strategy(int strategy) {
+        strategy_ = strategy;
+        return *this;
+    }
+
+    int strategy() const {
+        return strategy_;
+    }
+
 private:
     unsigned windowBits_;
+    int level_;
+    int strategy_;
     bool hasMoreInput_;
 };
 
@@ -143,6 +173,8 @@ std::string deflate(const std::string& data, const Options& opts = Options()) {
     filtering_ostreambuf filter;
     zlib_params params;
     params.window_bits = opts.windowBits();
+    params.level = opts.level();
+    params.strategy = opts.strategy();
     params.noheader = true; // Do not add a zlib header
     filter.push(zlib_compressor(params));
     filter.push(dest);
@@ -216,6 +248,76 @@ int dummyOutputCallback(const char* data, size_t size, void* userData) {
     return size;
 }
 
+// Simulated external flash used as a storage for the decompressed module
+class InflateStorage: public particle::OtaInflateStorage {
+public:
+    explicit InflateStorage(size_t size) :
+            data_(size, '\0'),
+            erased_(size, false),
+            eraseCount_(0) {
+    }
+
+    int erase(size_t offset, size_t size) override {
+        REQUIRE(offset % particle::OtaInflateStream::SECTOR_SIZE == 0);
+        REQUIRE(size % particle::OtaInflateStream::SECTOR_SIZE == 0);
+        REQUIRE(offset + size <= data_.size());
+        std::fill(data_.begin() + offset, data_.begin() + offset + size, (char)0xff);
+        std::fill(erased_.begin() + offset, erased_.begin() + offset + size, true);
+        ++eraseCount_;
+        return 0;
+    }
+
+    int write(size_t offset, const uint8_t* data, size_t size) override {
+        REQUIRE(offset + size <= data_.size());
+        for (size_t i = offset; i < offset + size; ++i) {
+            REQUIRE(erased_[i]);
+            erased_[i] = false;
+        }
+        memcpy(&data_[offset], data, size);
+        return 0;
+    }
+
+    std::string data(size_t size) const {
+        return data_.substr(0, size);
+    }
+
+    unsigned eraseCount() const {
+        return eraseCount_;
+    }
+
+private:
+    std::string data_;
+    std::vector<bool> erased_;
+    unsigned eraseCount_;
+};
+
+// Generates a compressed module in the format produced by the build tools
+std::string genCompressedModule(const std::string& decomp, const Options& opts = Options(), size_t suffixSize = 0) {
+    if (!suffixSize) {
+        suffixSize = sizeof(module_info_suffix_t);
+    }
+    const auto comp = deflate(decomp, opts);
+    const size_t moduleSize = sizeof(module_info_t) + sizeof(compressed_module_header) + comp.size() + suffixSize;
+    module_info_t info = {};
+    info.module_start_address = (const void*)0x30000;
+    info.module_end_address = (const void*)(0x30000 + moduleSize);
+    info.flags = MODULE_INFO_FLAG_COMPRESSED;
+    compressed_module_header header = {};
+    header.size = sizeof(header);
+    header.method = 0;
+    header.window_bits = opts.windowBits();
+    header.original_size = decomp.size();
+    std::string d((const char*)&info, sizeof(info));
+    d.append((const char*)&header, sizeof(header));
+    d.append(comp);
+    std::string suffix(suffixSize, '\0');
+    suffix[suffixSize - 2] = suffixSize & 0xff;
+    suffix[suffixSize - 1] = (suffixSize >> 8) & 0xff;
+    d.append(suffix);
+    d.append(4, '\0'); // CRC-32
+    return d;
+}
+
 } // namespace
 
 TEST_CASE("inflate_create()") {
@@ -417,6 +519,70 @@ TEST_CASE("inflate_input()") {
         CHECK(infl.output() == decomp);
     }
 
+    SECTION("passes the output to the callback in aligned blocks") {
+        auto decomp = genCompressibleData(100000);
+        auto comp = deflate(decomp);
+        std::vector<size_t> blocks;
+        infl.outputFn([&blocks](const char* data, size_t size, Output* out) {
+            blocks.push_back(size);
+            return out->append(data, size);
+        });
+        int r = 0;
+        size_t offs = 0;
+        do {
+            auto data = comp.data() + offs;
+            size_t size = std::min<size_t>(100, comp.size() - offs);
+            bool hasMore = (offs + size < comp.size());
+            r = infl.input(data, size, Options().hasMoreInput(hasMore));
+            offs += size;
+        } while (r == INFLATE_NEEDS_MORE_INPUT);
+        CHECK(r == INFLATE_DONE);
+        CHECK(infl.output() == decomp);
+        REQUIRE(blocks.size() == (decomp.size() + INFLATE_OUTPUT_BLOCK_SIZE - 1) / INFLATE_OUTPUT_BLOCK_SIZE);
+        for (size_t i = 0; i < blocks.size() - 1; ++i) {
+            CHECK(blocks[i] == INFLATE_OUTPUT_BLOCK_SIZE);
+        }
+        CHECK(blocks.back() == decomp.size() - (blocks.size() - 1) * INFLATE_OUTPUT_BLOCK_SIZE);
+    }
+
+    SECTION("can decompress data compressed with different settings") {
+        const auto decomp = genCompressibleData(200000) + std::string(10000, 'a') + genRandomData(10000);
+        const Options opts[] = {
+            Options().level(0), // Stored blocks
+            Options().level(1),
+            Options().level(9),
+            Options().strategy(Z_FILTERED),
+            Options().strategy(Z_HUFFMAN_ONLY),
+            Options().strategy(Z_RLE),
+            Options().strategy(Z_FIXED)
+        };
+        for (const auto& opt: opts) {
+            auto comp = deflate(decomp, opt);
+            infl.reset();
+            size_t size = comp.size();
+            int r = infl.input(comp.data(), &size);
+            CHECK(r == INFLATE_DONE);
+            CHECK(size == comp.size());
+            CHECK(infl.output() == decomp);
+        }
+    }
+
+    SECTION("fails gracefully when the compressed data is corrupted") {
+        const auto decomp = genCompressibleData(50000);
+        const auto comp = deflate(decomp);
+        for (unsigned i = 0; i < 500; ++i) {
+            auto data = comp;
+            for (unsigned j = 0; j < 5; ++j) {
+                data[randomSize(0, data.size() - 1)] ^= 1 << randomSize(0, 7);
+            }
+            infl.reset();
+            size_t size = data.size();
+            int r = infl.input(data.data(), &size);
+            // The corrupted data may still happen to be a valid Deflate stream
+            REQUIRE((r == INFLATE_DONE || r == SYSTEM_ERROR_BAD_DATA));
+        }
+    }
+
     SECTION("stress test") {
         for (unsigned i = 0; i < 500; ++i) {
             auto decomp = genCompressibleData(10000, 100000);
@@ -437,3 +603,168 @@ TEST_CASE("inflate_input()") {
         }
     }
 }
+
+TEST_CASE("inflate benchmark", "[benchmark][.]") {
+    // A module binary can be specified via the INFLATE_BENCHMARK_FILE environment variable.
+    // Otherwise, the test executable is used as an example of compiled code
+    const char* file = getenv("INFLATE_BENCHMARK_FILE");
+    if (!file) {
+        file = "/proc/self/exe";
+    }
+    std::string decomp;
+    const auto f = fopen(file, "rb");
+    REQUIRE(f);
+    char buf[4096];
+    size_t n = 0;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        decomp.append(buf, n);
+    }
+    fclose(f);
+    const auto comp = deflate(decomp, Options().level(9));
+    const unsigned iterations = 10;
+    const size_t chunkSize = 512; // Size of an OTA chunk
+    std::cout << file << ": " << decomp.size() << " bytes, " << comp.size() << " bytes compressed" << std::endl;
+
+    const auto report = [&](const char* name, int64_t timeUs) {
+        std::cout << name << ": " << timeUs / iterations << "us per image (" <<
+                (double)decomp.size() * iterations / timeUs << " MB/s)" << std::endl;
+    };
+
+    // inflate_input()
+    Inflate infl;
+    size_t callbackCount = 0;
+    infl.outputFn([&callbackCount](const char* data, size_t size, Output* out) {
+        ++callbackCount;
+        return size;
+    });
+    auto t1 = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; ++i) {
+        infl.reset();
+        int r = 0;
+        for (size_t offs = 0; offs < comp.size();) {
+            size_t size = std::min(chunkSize, comp.size() - offs);
+            r = infl.input(comp.data() + offs, &size, Options().hasMoreInput(offs + size < comp.size()));
+            REQUIRE(r >= 0);
+            offs += size;
+        }
+        REQUIRE(r == INFLATE_DONE);
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    report("inflate_input()", std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count());
+    std::cout << "  " << callbackCount / iterations << " output callbacks per image" << std::endl;
+
+    // zlib, for reference
+    std::string out(1 << INFLATE_MAX_WINDOW_BITS, '\0');
+    t1 = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; ++i) {
+        z_stream z = {};
+        REQUIRE(inflateInit2(&z, -INFLATE_MAX_WINDOW_BITS) == Z_OK);
+        int r = Z_OK;
+        for (size_t offs = 0; offs < comp.size() && r == Z_OK;) {
+            const size_t size = std::min(chunkSize, comp.size() - offs);
+            z.next_in = (Bytef*)comp.data() + offs;
+            z.avail_in = size;
+            do {
+                z.next_out = (Bytef*)&out[0];
+                z.avail_out = out.size();
+                r = inflate(&z, Z_NO_FLUSH);
+            } while (r == Z_OK && z.avail_in > 0);
+            offs += size;
+        }
+        REQUIRE(r == Z_STREAM_END);
+        inflateEnd(&z);
+    }
+    t2 = std::chrono::steady_clock::now();
+    report("zlib", std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count());
+}
+
+TEST_CASE("OtaInflateStream") {
+    const size_t maxOutputSize = 1024 * 1024;
+    InflateStorage storage(maxOutputSize);
+    particle::OtaInflateStream stream;
+    REQUIRE(stream.init(&storage, maxOutputSize) == 0);
+
+    const auto processInChunks = [&stream](const std::string& module, size_t chunkSize) {
+        int r = 0;
+        for (size_t offs = 0; offs < module.size() && r == 0; offs += chunkSize) {
+            const size_t n = std::min(chunkSize, module.size() - offs);
+            r = stream.process(module.data() + offs, n, offs);
+        }
+        return r;
+    };
+
+    SECTION("decompresses a module received in chunks of arbitrary size") {
+        for (size_t chunkSize: { (size_t)1, (size_t)7, (size_t)512, randomSize(100, 1000) }) {
+            const auto decomp = genCompressibleData(50000, 100000);
+            const auto module = genCompressedModule(decomp);
+            REQUIRE(stream.init(&storage, maxOutputSize) == 0);
+            CHECK(processInChunks(module, chunkSize) == 0);
+            CHECK(stream.isDone());
+            CHECK_FALSE(stream.isFailed());
+            CHECK(stream.outputSize() == decomp.size());
+            CHECK(storage.data(decomp.size()) == decomp);
+        }
+    }
+
+    SECTION("erases the storage one sector at a time") {
+        const auto decomp = genCompressibleData(100000);
+        CHECK(processInChunks(genCompressedModule(decomp), 512) == 0);
+        CHECK(stream.isDone());
+        const size_t sectorSize = particle::OtaInflateStream::SECTOR_SIZE;
+        CHECK(storage.eraseCount() == (decomp.size() + sectorSize - 1) / sectorSize);
+    }
+
+    SECTION("works with a smaller window size") {
+        const auto decomp = genCompressibleData(50000);
+        CHECK(processInChunks(genCompressedModule(decomp, Options().windowBits(10)), 512) == 0);
+        CHECK(stream.isDone());
+        CHECK(storage.data(decomp.size()) == decomp);
+    }
+
+    SECTION("fails if the data is received out of order") {
+        const auto module = genCompressedModule(genCompressibleData(50000));
+        CHECK(stream.process(module.data(), 512, 0) == 0);
+        CHECK(stream.process(module.data() + 1024, 512, 1024) == SYSTEM_ERROR_INVALID_STATE);
+        CHECK(stream.isFailed());
+        // Subsequent chunks are ignored
+        CHECK(stream.process(module.data() + 512, 512, 512) < 0);
+        CHECK_FALSE(stream.isDone());
+    }
+
+    SECTION("fails if the window size exceeds the limit") {
+        REQUIRE(stream.init(&storage, maxOutputSize, 12 /* maxWindowBits */) == 0);
+        const auto module = genCompressedModule(genCompressibleData(50000), Options().windowBits(15));
+        CHECK(processInChunks(module, 512) == SYSTEM_ERROR_NOT_SUPPORTED);
+        CHECK(stream.isFailed());
+    }
+
+    SECTION("fails if the decompressed module is too large") {
+        REQUIRE(stream.init(&storage, 10000) == 0);
+        CHECK(processInChunks(genCompressedModule(genCompressibleData(50000)), 512) == SYSTEM_ERROR_TOO_LARGE);
+        CHECK(stream.isFailed());
+    }
+
+    SECTION("fails if the module is not compressed") {
+        auto module = genCompressedModule(genCompressibleData(50000));
+        module_info_t info = {};
+        memcpy(&info, module.data(), sizeof(info));
+        info.flags = 0;
+        memcpy(&module[0], &info, sizeof(info));
+        CHECK(processInChunks(module, 512) == SYSTEM_ERROR_NOT_SUPPORTED);
+    }
+
+    SECTION("fails if the compressed data is malformed") {
+        auto module = genCompressedModule(genCompressibleData(50000));
+        const auto junk = genRandomData(1000);
+        module.replace(sizeof(module_info_t) + sizeof(compressed_module_header) + 1000, junk.size(), junk);
+        CHECK(processInChunks(module, 512) == SYSTEM_ERROR_BAD_DATA);
+        CHECK_FALSE(stream.isDone());
+    }
+
+    SECTION("fails if the module suffix is larger than expected") {
+        // Such a module can still be decompressed by the bootloader
+        const auto module = genCompressedModule(genCompressibleData(50000), Options(), sizeof(module_info_suffix_t) + 16);
+        CHECK(processInChunks(module, 512) == SYSTEM_ERROR_BAD_DATA);
+        CHECK_FALSE(stream.isDone());
+    }
+}
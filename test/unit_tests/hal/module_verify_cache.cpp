@@ -0,0 +1,92 @@
+#include "module_verify_cache.h"
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+
+namespace {
+
+const uint32_t BOOTLOADER_ADDR = 0xf4000;
+const uint32_t SYSTEM_PART_ADDR = 0x30000;
+const uint32_t USER_PART_ADDR = 0xd4000;
+
+void addModule(module_verify_cache* cache, uint32_t addr, uint32_t length, uint32_t crc) {
+    module_verify_cache_add(cache, module_verify_cache_generation(cache), addr, length, crc);
+}
+
+} // namespace
+
+TEST_CASE("module_verify_cache") {
+    module_verify_cache cache;
+    memset(&cache, 0xa5, sizeof(cache));
+    module_verify_cache_init(&cache);
+
+    SECTION("is empty after initialization") {
+        CHECK_FALSE(module_verify_cache_find(&cache, SYSTEM_PART_ADDR, 0x1000, 0));
+        CHECK_FALSE(module_verify_cache_find(&cache, 0, 0, 0));
+    }
+
+    SECTION("finds a module only if its address, length and CRC match") {
+        addModule(&cache, SYSTEM_PART_ADDR, 0x1000, 0x12345678);
+        CHECK(module_verify_cache_find(&cache, SYSTEM_PART_ADDR, 0x1000, 0x12345678));
+        CHECK_FALSE(module_verify_cache_find(&cache, SYSTEM_PART_ADDR, 0x1000, 0x12345679));
+        CHECK_FALSE(module_verify_cache_find(&cache, SYSTEM_PART_ADDR, 0x1004, 0x12345678));
+        CHECK_FALSE(module_verify_cache_find(&cache, SYSTEM_PART_ADDR + 4, 0x1000, 0x12345678));
+    }
+
+    SECTION("keeps its contents across re-initialization") {
+        addModule(&cache, SYSTEM_PART_ADDR, 0x1000, 1);
+        addModule(&cache, USER_PART_ADDR, 0x100, 2);
+        module_verify_cache_init(&cache);
+        CHECK(module_verify_cache_find(&cache, SYSTEM_PART_ADDR, 0x1000, 1));
+        CHECK(module_verify_cache_find(&cache, USER_PART_ADDR, 0x100, 2));
+    }
+
+    SECTION("is reset if its contents are corrupted") {
+        addModule(&cache, SYSTEM_PART_ADDR, 0x1000, 1);
+        cache.entries[0].crc ^= 0x100;
+        module_verify_cache_init(&cache);
+        CHECK_FALSE(module_verify_cache_find(&cache, SYSTEM_PART_ADDR, 0x1000, 1 ^ 0x100));
+        CHECK_FALSE(module_verify_cache_find(&cache, SYSTEM_PART_ADDR, 0x1000, 1));
+    }
+
+    SECTION("replaces the entry of a module at the same address") {
+        addModule(&cache, USER_PART_ADDR, 0x100, 1);
+        addModule(&cache, USER_PART_ADDR, 0x200, 2);
+        CHECK_FALSE(module_verify_cache_find(&cache, USER_PART_ADDR, 0x100, 1));
+        CHECK(module_verify_cache_find(&cache, USER_PART_ADDR, 0x200, 2));
+    }
+
+    SECTION("evicts the oldest entry when full") {
+        for (uint32_t i = 0; i <= MODULE_VERIFY_CACHE_ENTRY_COUNT; ++i) {
+            addModule(&cache, i * 0x1000, 0x100, i);
+        }
+        CHECK_FALSE(module_verify_cache_find(&cache, 0, 0x100, 0));
+        for (uint32_t i = 1; i <= MODULE_VERIFY_CACHE_ENTRY_COUNT; ++i) {
+            CHECK(module_verify_cache_find(&cache, i * 0x1000, 0x100, i));
+        }
+    }
+
+    SECTION("invalidates the modules overlapping with a modified region") {
+        addModule(&cache, SYSTEM_PART_ADDR, 0x1000, 1);
+        addModule(&cache, USER_PART_ADDR, 0x100, 2);
+        addModule(&cache, BOOTLOADER_ADDR, 0x100, 3);
+        // Region right before the module
+        module_verify_cache_invalidate(&cache, SYSTEM_PART_ADDR - 0x1000, 0x1000);
+        CHECK(module_verify_cache_find(&cache, SYSTEM_PART_ADDR, 0x1000, 1));
+        // CRC stored after the module data
+        module_verify_cache_invalidate(&cache, USER_PART_ADDR + 0x100, 4);
+        CHECK_FALSE(module_verify_cache_find(&cache, USER_PART_ADDR, 0x100, 2));
+        // Region in the middle of the module
+        module_verify_cache_invalidate(&cache, SYSTEM_PART_ADDR + 0x800, 1);
+        CHECK_FALSE(module_verify_cache_find(&cache, SYSTEM_PART_ADDR, 0x1000, 1));
+        CHECK(module_verify_cache_find(&cache, BOOTLOADER_ADDR, 0x100, 3));
+    }
+
+    SECTION("doesn't add a module if the cache was invalidated during the verification") {
+        const uint32_t gen = module_verify_cache_generation(&cache);
+        module_verify_cache_invalidate(&cache, USER_PART_ADDR, 0x1000);
+        module_verify_cache_add(&cache, gen, USER_PART_ADDR, 0x100, 1);
+        CHECK_FALSE(module_verify_cache_find(&cache, USER_PART_ADDR, 0x100, 1));
+    }
+}
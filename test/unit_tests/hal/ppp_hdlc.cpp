@@ -0,0 +1,504 @@
+#include "ppp_hdlc.h"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace particle::net::ppp;
+
+namespace {
+
+struct Frame {
+    uint16_t protocol;
+    std::string data;
+
+    bool operator==(const Frame& f) const {
+        return protocol == f.protocol && data == f.data;
+    }
+};
+
+// Collects decoded frames, splitting them into segments of a fixed size like a pbuf chain
+class TestSink {
+public:
+    explicit TestSink(size_t segmentSize = 64) :
+            segmentSize_(segmentSize),
+            segmentLimit_(0) {
+    }
+
+    bool begin(uint16_t protocol) {
+        REQUIRE(!active_);
+        active_ = true;
+        current_ = Frame{ protocol, std::string() };
+        segment_.clear();
+        segments_ = 1;
+        return true;
+    }
+
+    uint8_t* buffer(size_t* size) {
+        REQUIRE(active_);
+        if (segment_.size() == segmentSize_) {
+            if (segmentLimit_ && segments_ + 1 > segmentLimit_) {
+                return nullptr;
+            }
+            current_.data.append(segment_);
+            segment_.clear();
+            ++segments_;
+        }
+        const size_t offs = segment_.size();
+        segment_.resize(segmentSize_);
+        used_ = offs;
+        *size = segmentSize_ - offs;
+        return (uint8_t*)&segment_[offs];
+    }
+
+    void commit(size_t size) {
+        REQUIRE(active_);
+        REQUIRE(used_ + size <= segmentSize_);
+        segment_.resize(used_ + size);
+    }
+
+    void end(size_t trim) {
+        REQUIRE(active_);
+        current_.data.append(segment_);
+        REQUIRE(current_.data.size() >= trim);
+        current_.data.resize(current_.data.size() - trim);
+        frames_.push_back(current_);
+        active_ = false;
+    }
+
+    void abort() {
+        REQUIRE(active_);
+        active_ = false;
+        ++aborted_;
+    }
+
+    // Maximum number of segments per frame (0 - no limit)
+    void segmentLimit(size_t limit) {
+        segmentLimit_ = limit;
+    }
+
+    const std::vector<Frame>& frames() const {
+        return frames_;
+    }
+
+    unsigned aborted() const {
+        return aborted_;
+    }
+
+    bool active() const {
+        return active_;
+    }
+
+private:
+    std::vector<Frame> frames_;
+    Frame current_;
+    std::string segment_;
+    size_t segmentSize_;
+    size_t segmentLimit_;
+    size_t segments_ = 0;
+    size_t used_ = 0;
+    unsigned aborted_ = 0;
+    bool active_ = false;
+};
+
+struct EncodeOptions {
+    bool compressAddress = false;
+    bool compressProtocol = false;
+    uint32_t accm = 0xffffffff;
+    bool corruptFcs = false;
+};
+
+void appendEscaped(std::string* out, uint8_t c, uint32_t accm) {
+    if (c == hdlc::FLAG || c == hdlc::ESCAPE || (c < 0x20 && (accm & (1ul << c)))) {
+        out->push_back(hdlc::ESCAPE);
+        out->push_back(c ^ hdlc::TRANS);
+    } else {
+        out->push_back(c);
+    }
+}
+
+// Reference encoder
+std::string encode(const Frame& frame, const EncodeOptions& opts = EncodeOptions()) {
+    std::string raw;
+    if (!opts.compressAddress) {
+        raw.push_back(hdlc::ALLSTATIONS);
+        raw.push_back(hdlc::UI);
+    }
+    if (!opts.compressProtocol || (frame.protocol >> 8) != 0 || !(frame.protocol & 1)) {
+        raw.push_back(frame.protocol >> 8);
+    }
+    raw.push_back(frame.protocol & 0xff);
+    raw.append(frame.data);
+    uint16_t fcs = hdlc::fcs16(hdlc::FCS_INIT, (const uint8_t*)raw.data(), raw.size()) ^ 0xffff;
+    if (opts.corruptFcs) {
+        fcs ^= 0x0101;
+    }
+    raw.push_back(fcs & 0xff);
+    raw.push_back(fcs >> 8);
+    std::string out;
+    out.push_back(hdlc::FLAG);
+    for (uint8_t c: raw) {
+        appendEscaped(&out, c, opts.accm);
+    }
+    out.push_back(hdlc::FLAG);
+    return out;
+}
+
+std::string randomData(std::mt19937& rand, size_t size) {
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::string s;
+    s.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        s.push_back((char)byte(rand));
+    }
+    return s;
+}
+
+template<typename DecoderT>
+void inputChunks(DecoderT* decoder, const std::string& data, std::mt19937& rand, size_t maxChunkSize) {
+    std::uniform_int_distribution<size_t> chunk(1, maxChunkSize);
+    size_t offs = 0;
+    while (offs < data.size()) {
+        const size_t n = std::min(chunk(rand), data.size() - offs);
+        decoder->input((const uint8_t*)data.data() + offs, n);
+        offs += n;
+    }
+}
+
+// Writes frames into a fixed buffer, used in the benchmark
+class BenchmarkSink {
+public:
+    bool begin(uint16_t protocol) {
+        size_ = 0;
+        return true;
+    }
+
+    uint8_t* buffer(size_t* size) {
+        *size = sizeof(buf_) - size_;
+        return buf_ + size_;
+    }
+
+    void commit(size_t size) {
+        size_ += size;
+    }
+
+    void end(size_t trim) {
+        bytes_ += size_ - trim;
+    }
+
+    void abort() {
+    }
+
+    size_t bytes() const {
+        return bytes_;
+    }
+
+private:
+    uint8_t buf_[2048];
+    size_t size_ = 0;
+    size_t bytes_ = 0;
+};
+
+// Byte-at-a-time decoder modelled after pppos_input(), used as a baseline in the benchmark
+class ReferenceDecoder {
+public:
+    void input(const uint8_t* data, size_t size) {
+        while (size--) {
+            uint8_t c = *data++;
+            if (c == hdlc::ESCAPE) {
+                escaped_ = true;
+            } else if (c == hdlc::FLAG) {
+                if (state_ == DATA && fcs_ == hdlc::FCS_GOOD && frame_.size() >= hdlc::FCS_SIZE) {
+                    frame_.resize(frame_.size() - hdlc::FCS_SIZE);
+                    ++frames_;
+                }
+                frame_.clear();
+                state_ = ADDRESS;
+                fcs_ = hdlc::FCS_INIT;
+                escaped_ = false;
+            } else if (c < 0x20 && (accm_ & (1ul << c))) {
+                // Discard
+            } else {
+                if (escaped_) {
+                    escaped_ = false;
+                    c ^= hdlc::TRANS;
+                }
+                fcs_ = hdlc::fcs16(fcs_, &c, 1);
+                switch (state_) {
+                case ADDRESS:
+                    if (c == hdlc::ALLSTATIONS) {
+                        state_ = CONTROL;
+                        break;
+                    }
+                    // Fall through
+                case CONTROL:
+                    if (c == hdlc::UI) {
+                        state_ = PROTOCOL1;
+                        break;
+                    }
+                    // Fall through
+                case PROTOCOL1:
+                    state_ = (c & 1) ? DATA : PROTOCOL2;
+                    break;
+                case PROTOCOL2:
+                    state_ = DATA;
+                    break;
+                case DATA:
+                    frame_.push_back(c);
+                    break;
+                }
+            }
+        }
+    }
+
+    unsigned frames() const {
+        return frames_;
+    }
+
+private:
+    enum State {
+        ADDRESS,
+        CONTROL,
+        PROTOCOL1,
+        PROTOCOL2,
+        DATA
+    };
+
+    std::string frame_;
+    uint32_t accm_ = 0;
+    uint16_t fcs_ = hdlc::FCS_INIT;
+    State state_ = ADDRESS;
+    bool escaped_ = false;
+    unsigned frames_ = 0;
+};
+
+} // namespace
+
+TEST_CASE("hdlc::fcs16()") {
+    SECTION("computes FCS-16 as defined in RFC 1662") {
+        const std::string s = "123456789";
+        // Check value of the CRC-16/X-25 algorithm
+        CHECK((hdlc::fcs16(hdlc::FCS_INIT, (const uint8_t*)s.data(), s.size()) ^ 0xffff) == 0x906e);
+        CHECK(hdlc::fcs16(hdlc::FCS_INIT, nullptr, 0) == hdlc::FCS_INIT);
+    }
+    SECTION("matches the bitwise algorithm for any data length") {
+        std::mt19937 rand(4);
+        const std::string s = randomData(rand, 64);
+        for (size_t n = 0; n <= s.size(); ++n) {
+            uint16_t fcs = hdlc::FCS_INIT;
+            for (size_t i = 0; i < n; ++i) {
+                fcs ^= (uint8_t)s[i];
+                for (int j = 0; j < 8; ++j) {
+                    fcs = (fcs & 1) ? (fcs >> 1) ^ 0x8408 : fcs >> 1;
+                }
+            }
+            CHECK(hdlc::fcs16(hdlc::FCS_INIT, (const uint8_t*)s.data(), n) == fcs);
+        }
+    }
+    SECTION("can be computed incrementally") {
+        std::mt19937 rand(1);
+        const std::string s = randomData(rand, 1000);
+        const uint16_t fcs = hdlc::fcs16(hdlc::FCS_INIT, (const uint8_t*)s.data(), s.size());
+        for (size_t i = 0; i < s.size(); i += 37) {
+            uint16_t f = hdlc::fcs16(hdlc::FCS_INIT, (const uint8_t*)s.data(), i);
+            f = hdlc::fcs16(f, (const uint8_t*)s.data() + i, s.size() - i);
+            CHECK(f == fcs);
+        }
+    }
+}
+
+TEST_CASE("HdlcDecoder") {
+    std::mt19937 rand(2);
+    TestSink sink;
+    HdlcDecoder<TestSink> decoder(&sink);
+
+    SECTION("decodes frames with uncompressed and compressed header fields") {
+        const Frame f1 = { 0xc021, "\x01\x02\x00\x0a\x02\x06\x00\x00\x00\x00" };
+        const Frame f2 = { 0x0021, randomData(rand, 100) };
+        const Frame f3 = { 0x0021, randomData(rand, 100) };
+        EncodeOptions opts;
+        std::string data = encode(f1, opts);
+        opts.compressAddress = true;
+        data += encode(f2, opts);
+        opts.compressProtocol = true;
+        data += encode(f3, opts);
+        decoder.input((const uint8_t*)data.data(), data.size());
+        REQUIRE(sink.frames().size() == 3);
+        CHECK(sink.frames()[0] == f1);
+        CHECK(sink.frames()[1] == f2);
+        CHECK(sink.frames()[2] == f3);
+        CHECK(decoder.frames() == 3);
+        CHECK(!sink.active());
+    }
+    SECTION("decodes frames split at arbitrary boundaries") {
+        std::vector<Frame> frames;
+        std::string data;
+        for (int i = 0; i < 200; ++i) {
+            const Frame f = { 0x0021, randomData(rand, rand() % 1500 + 1) };
+            frames.push_back(f);
+            data += encode(f);
+        }
+        for (size_t chunkSize: { 1, 7, 127, 1509 }) {
+            TestSink sink(256);
+            HdlcDecoder<TestSink> decoder(&sink);
+            inputChunks(&decoder, data, rand, chunkSize);
+            CHECK(sink.frames() == frames);
+            CHECK(decoder.fcsErrors() == 0);
+        }
+    }
+    SECTION("skips data preceding the first flag sequence") {
+        const Frame f = { 0x0021, "abc" };
+        const std::string data = "garbage" + encode(f);
+        decoder.input((const uint8_t*)data.data(), data.size());
+        REQUIRE(sink.frames().size() == 1);
+        CHECK(sink.frames()[0] == f);
+        CHECK(decoder.lengthErrors() == 0);
+    }
+    SECTION("drops frames with invalid FCS") {
+        const Frame f = { 0x0021, "abcd" };
+        EncodeOptions opts;
+        opts.corruptFcs = true;
+        const std::string data = encode(f, opts) + encode(f);
+        decoder.input((const uint8_t*)data.data(), data.size());
+        REQUIRE(sink.frames().size() == 1);
+        CHECK(sink.frames()[0] == f);
+        CHECK(decoder.fcsErrors() == 1);
+        CHECK(sink.aborted() == 1);
+    }
+    SECTION("drops frames that are too short") {
+        const Frame f = { 0x0021, "abcd" };
+        const std::string data = std::string("\x7e\xff\x03\x7e", 4) + encode(f);
+        decoder.input((const uint8_t*)data.data(), data.size());
+        REQUIRE(sink.frames().size() == 1);
+        CHECK(sink.frames()[0] == f);
+        CHECK(decoder.lengthErrors() == 1);
+    }
+    SECTION("handles the abort sequence") {
+        const Frame f = { 0x0021, "abcd" };
+        std::string aborted = encode(f);
+        aborted.insert(aborted.size() - 1, 1, hdlc::ESCAPE);
+        const std::string data = aborted + encode(f);
+        decoder.input((const uint8_t*)data.data(), data.size());
+        REQUIRE(sink.frames().size() == 1);
+        CHECK(sink.frames()[0] == f);
+        CHECK(sink.aborted() == 1);
+    }
+    SECTION("discards control characters that are set in the ACCM") {
+        const Frame f = { 0x0021, randomData(rand, 200) };
+        EncodeOptions opts;
+        opts.accm = 0xffffffff;
+        std::string data = encode(f, opts);
+        // Inserted by the link
+        data.insert(20, "\x11\x13", 2);
+        decoder.accm(0x000a0000);
+        decoder.input((const uint8_t*)data.data(), data.size());
+        REQUIRE(sink.frames().size() == 1);
+        CHECK(sink.frames()[0] == f);
+    }
+    SECTION("finds flag, escape and control characters at any position") {
+        // Exercise the word-at-a-time scanner with special characters at all offsets within a word
+        for (size_t pos = 0; pos < 12; ++pos) {
+            for (uint8_t c: { hdlc::FLAG, hdlc::ESCAPE, (uint8_t)0x11 }) {
+                std::string d(16, 'a');
+                d[pos] = c;
+                const Frame f = { 0x0021, d };
+                EncodeOptions opts;
+                opts.accm = 0x000a0000;
+                const std::string data = encode(f, opts);
+                TestSink sink;
+                HdlcDecoder<TestSink> decoder(&sink);
+                decoder.accm(0x000a0000);
+                decoder.input((const uint8_t*)data.data(), data.size());
+                REQUIRE(sink.frames().size() == 1);
+                CHECK(sink.frames()[0] == f);
+            }
+        }
+    }
+    SECTION("passes unescaped control characters if the ACCM is empty") {
+        const Frame f = { 0x0021, std::string("\x00\x01\x11\x13\x1f", 5) };
+        EncodeOptions opts;
+        opts.accm = 0;
+        const std::string data = encode(f, opts);
+        decoder.input((const uint8_t*)data.data(), data.size());
+        REQUIRE(sink.frames().size() == 1);
+        CHECK(sink.frames()[0] == f);
+    }
+    SECTION("drops a frame if the sink runs out of memory and recovers") {
+        const Frame big = { 0x0021, randomData(rand, 1000) };
+        const Frame small = { 0x0021, "abcd" };
+        sink.segmentLimit(4);
+        const std::string data = encode(big) + encode(small);
+        decoder.input((const uint8_t*)data.data(), data.size());
+        REQUIRE(sink.frames().size() == 1);
+        CHECK(sink.frames()[0] == small);
+        CHECK(decoder.dropped() == 1);
+        CHECK(decoder.fcsErrors() == 0);
+    }
+    SECTION("reset() discards the frame being received") {
+        const Frame f = { 0x0021, "abcd" };
+        const std::string data = encode(f);
+        decoder.input((const uint8_t*)data.data(), data.size() / 2);
+        CHECK(sink.active());
+        decoder.reset();
+        CHECK(!sink.active());
+        // The remaining part of the frame is skipped
+        decoder.input((const uint8_t*)data.data() + data.size() / 2, data.size() - data.size() / 2);
+        decoder.input((const uint8_t*)data.data(), data.size());
+        REQUIRE(sink.frames().size() == 1);
+        CHECK(sink.frames()[0] == f);
+    }
+}
+
+TEST_CASE("HdlcDecoder benchmark", "[ppp][benchmark][.]") {
+    using namespace std::chrono;
+    std::mt19937 rand(3);
+    // IP traffic with mostly full-sized packets, escaped with a zero ACCM, as received from the modem
+    std::string data;
+    EncodeOptions opts;
+    opts.accm = 0;
+    opts.compressAddress = true;
+    opts.compressProtocol = true;
+    unsigned frameCount = 0;
+    while (data.size() < 1024 * 1024) {
+        const size_t size = (rand() % 4) ? 1500 : rand() % 100 + 40;
+        data += encode({ 0x0021, randomData(rand, size) }, opts);
+        ++frameCount;
+    }
+    // Muxer frame sized chunks
+    const size_t chunkSize = 1509;
+    const unsigned iterations = 20;
+
+    auto t1 = high_resolution_clock::now();
+    unsigned frames = 0;
+    for (unsigned i = 0; i < iterations; ++i) {
+        ReferenceDecoder decoder;
+        for (size_t offs = 0; offs < data.size(); offs += chunkSize) {
+            decoder.input((const uint8_t*)data.data() + offs, std::min(chunkSize, data.size() - offs));
+        }
+        frames += decoder.frames();
+    }
+    const auto refTime = duration_cast<microseconds>(high_resolution_clock::now() - t1).count();
+    REQUIRE(frames == frameCount * iterations);
+
+    t1 = high_resolution_clock::now();
+    frames = 0;
+    for (unsigned i = 0; i < iterations; ++i) {
+        BenchmarkSink sink;
+        HdlcDecoder<BenchmarkSink> decoder(&sink);
+        for (size_t offs = 0; offs < data.size(); offs += chunkSize) {
+            decoder.input((const uint8_t*)data.data() + offs, std::min(chunkSize, data.size() - offs));
+        }
+        frames += decoder.frames();
+    }
+    const auto decoderTime = duration_cast<microseconds>(high_resolution_clock::now() - t1).count();
+    REQUIRE(frames == frameCount * iterations);
+
+    const double mb = (double)data.size() * iterations / (1024 * 1024);
+    std::cout << "PPP input: " << data.size() << " bytes, " << frameCount << " frames" << std::endl;
+    std::cout << "  Byte-at-a-time decoder: " << mb / refTime * 1000000 << " MB/s" << std::endl;
+    std::cout << "  HdlcDecoder: " << mb / decoderTime * 1000000 << " MB/s" << std::endl;
+}
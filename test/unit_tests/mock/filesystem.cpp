@@ -87,6 +87,9 @@ Filesystem::Filesystem(MockRepository* mocks) :
     mocks_->OnCallFunc(lfs_remove).Do([this](lfs_t* lfs, const char* path) {
         return this->remove(lfs, path);
     });
+    mocks_->OnCallFunc(lfs_rename).Do([this](lfs_t* lfs, const char* oldPath, const char* newPath) {
+        return this->rename(lfs, oldPath, newPath);
+    });
 }
 
 Filesystem::~Filesystem() noexcept(false) {
@@ -452,6 +455,41 @@ int Filesystem::remove(lfs_t* lfs, const char* path) {
     }
 }
 
+int Filesystem::rename(lfs_t* lfs, const char* oldPath, const char* newPath) {
+    try {
+        if (!lfs || lfs != &filesystem_get_instance(nullptr)->instance || !oldPath || !newPath) {
+            throw std::runtime_error("lfs_rename() has been called with invalid arguments");
+        }
+        const auto src = findEntry(oldPath);
+        if (!src) {
+            return LFS_ERR_NOENT;
+        }
+        if (src->type != EntryType::FILE) {
+            // Not needed by the current tests
+            throw std::runtime_error("lfs_rename() is only supported for files");
+        }
+        if (!src->fds.empty()) {
+            throw std::runtime_error("Detected an attempt to rename an open file");
+        }
+        auto dest = findEntry(newPath);
+        if (dest == src) {
+            return 0;
+        }
+        if (!dest) {
+            dest = createEntry(newPath, EntryType::FILE);
+        } else if (dest->type != EntryType::FILE) {
+            return LFS_ERR_ISDIR;
+        } else if (!dest->fds.empty()) {
+            throw std::runtime_error("Detected an attempt to replace an open file");
+        }
+        dest->data = std::move(src->data);
+        removeEntry(src);
+        return 0;
+    } catch (const FileError& e) {
+        return e.code();
+    }
+}
+
 } // namespace test
 
 } // namespace particle
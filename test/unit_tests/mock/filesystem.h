@@ -94,6 +94,7 @@ private:
     int truncate(lfs_t* lfs, lfs_file_t* file, lfs_off_t size);
     int sync(lfs_t* lfs, lfs_file_t* file);
     int remove(lfs_t* lfs, const char* path);
+    int rename(lfs_t* lfs, const char* oldPath, const char* newPath);
 };
 
 inline bool Filesystem::hasOpenFiles() const {
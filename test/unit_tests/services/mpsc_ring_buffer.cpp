@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mpsc_ring_buffer.h"
+
+#include <catch2/catch.hpp>
+
+#include <thread>
+#include <vector>
+#include <string>
+
+using namespace particle::services;
+
+namespace {
+
+void write(MpscRingBuffer* buf, const MpscRingBuffer::Reservation& r, const std::string& str) {
+    buf->write(r, 0, (const uint8_t*)str.data(), str.size());
+}
+
+bool put(MpscRingBuffer* buf, const std::string& str) {
+    MpscRingBuffer::Reservation r = {};
+    if (buf->reserve(str.size(), str.size(), &r) != str.size()) {
+        return false;
+    }
+    write(buf, r, str);
+    buf->commit();
+    return true;
+}
+
+std::string get(MpscRingBuffer* buf) {
+    std::string s;
+    for (;;) {
+        size_t n = 0;
+        const auto p = buf->consume(&n);
+        if (!n) {
+            break;
+        }
+        s.append((const char*)p, n);
+        buf->consumeCommit(n);
+    }
+    return s;
+}
+
+// Allows a test to interrupt a producer between releasing the buffer and publishing its data
+class TestRingBuffer: public MpscRingBuffer {
+public:
+    using MpscRingBuffer::release;
+    using MpscRingBuffer::publish;
+};
+
+} // namespace
+
+TEST_CASE("MpscRingBuffer") {
+    uint8_t data[10] = {};
+    MpscRingBuffer buf;
+    buf.init(data, sizeof(data));
+
+    SECTION("is empty after initialization") {
+        CHECK(buf.empty());
+        CHECK(buf.size() == 10);
+        CHECK(buf.space() == 10);
+        CHECK(buf.consumable() == 0);
+    }
+
+    SECTION("makes committed data available to the consumer") {
+        CHECK(put(&buf, "abcd"));
+        CHECK(!buf.empty());
+        CHECK(buf.space() == 6);
+        CHECK(buf.consumable() == 4);
+        CHECK(get(&buf) == "abcd");
+        CHECK(buf.empty());
+        CHECK(buf.space() == 10);
+    }
+
+    SECTION("handles wrap-around") {
+        for (int i = 0; i < 100; ++i) {
+            const std::string s = std::to_string(i * 123457);
+            REQUIRE(put(&buf, s));
+            REQUIRE(get(&buf) == s);
+        }
+        CHECK(buf.empty());
+    }
+
+    SECTION("splits wrapped data into contiguous blocks") {
+        CHECK(put(&buf, "abcdefgh"));
+        CHECK(get(&buf) == "abcdefgh");
+        CHECK(put(&buf, "1234"));
+        size_t n = 0;
+        buf.consume(&n);
+        CHECK(n == 2);
+        CHECK(get(&buf) == "1234");
+    }
+
+    SECTION("reserves as much space as available") {
+        CHECK(put(&buf, "abcdef"));
+        MpscRingBuffer::Reservation r = {};
+        CHECK(buf.reserve(1, 10, &r) == 4);
+        write(&buf, r, "ghij");
+        buf.commit();
+        CHECK(buf.space() == 0);
+        CHECK(buf.reserve(1, 10, &r) == 0);
+        CHECK(get(&buf) == "abcdefghij");
+    }
+
+    SECTION("fails to reserve less than the minimum size") {
+        CHECK(put(&buf, "abcdefg"));
+        MpscRingBuffer::Reservation r = {};
+        CHECK(buf.reserve(4, 4, &r) == 0);
+        CHECK(buf.space() == 3);
+        CHECK(get(&buf) == "abcdefg");
+    }
+
+    SECTION("hides committed data until all concurrent producers have committed") {
+        MpscRingBuffer::Reservation r1 = {}, r2 = {}, r3 = {};
+        CHECK(buf.reserve(3, 3, &r1) == 3);
+        CHECK(buf.reserve(3, 3, &r2) == 3);
+        CHECK(!buf.empty());
+        write(&buf, r2, "def");
+        CHECK(!buf.commit());
+        CHECK(buf.consumable() == 0);
+        // A producer that preempted the other ones
+        CHECK(buf.reserve(2, 2, &r3) == 2);
+        write(&buf, r3, "gh");
+        CHECK(!buf.commit());
+        CHECK(buf.consumable() == 0);
+        write(&buf, r1, "abc");
+        CHECK(buf.commit());
+        CHECK(get(&buf) == "abcdefgh");
+        CHECK(buf.empty());
+    }
+
+    SECTION("keeps previously committed data available while there are active producers") {
+        CHECK(put(&buf, "abc"));
+        MpscRingBuffer::Reservation r = {};
+        CHECK(buf.reserve(2, 2, &r) == 2);
+        CHECK(buf.consumable() == 3);
+        CHECK(get(&buf) == "abc");
+        write(&buf, r, "de");
+        CHECK(buf.commit());
+        CHECK(get(&buf) == "de");
+    }
+
+    SECTION("reports a preempted reservation that holds back a full buffer") {
+        MpscRingBuffer::Reservation r = {};
+        CHECK(!buf.pending());
+        // A producer is preempted between reserving and committing its region
+        CHECK(buf.reserve(2, 2, &r) == 2);
+        CHECK(buf.pending());
+        // Other producers fill the rest of the buffer
+        CHECK(put(&buf, "cdefgh"));
+        CHECK(put(&buf, "ij"));
+        CHECK(buf.space() == 0);
+        CHECK(buf.consumable() == 0);
+        CHECK(buf.pending());
+        MpscRingBuffer::Reservation r2 = {};
+        CHECK(buf.reserve(1, 1, &r2) == 0);
+        // The preempted producer resumes
+        write(&buf, r, "ab");
+        CHECK(buf.commit());
+        CHECK(!buf.pending());
+        CHECK(get(&buf) == "abcdefghij");
+        CHECK(buf.space() == 10);
+    }
+
+    SECTION("can be reset") {
+        CHECK(put(&buf, "abc"));
+        buf.reset();
+        CHECK(buf.empty());
+        CHECK(buf.space() == 10);
+    }
+}
+
+TEST_CASE("MpscRingBuffer doesn't move the committed position backwards") {
+    uint8_t data[16] = {};
+    TestRingBuffer buf;
+    buf.init(data, sizeof(data));
+    // Producer A releases the buffer and gets preempted before publishing its data
+    MpscRingBuffer::Reservation r = {};
+    REQUIRE(buf.reserve(4, 4, &r) == 4);
+    write(&buf, r, "AAAA");
+    uint32_t pos = 0;
+    REQUIRE(buf.release(&pos));
+    // Producer B commits its data, which makes the data of both producers available
+    REQUIRE(put(&buf, "BBBB"));
+    CHECK(get(&buf) == "AAAABBBB");
+    REQUIRE(buf.empty());
+    // Producer A resumes
+    buf.publish(pos);
+    REQUIRE(buf.consumable() == 0);
+    CHECK(buf.empty());
+    CHECK(buf.space() == sizeof(data));
+    REQUIRE(put(&buf, "CCCC"));
+    CHECK(get(&buf) == "CCCC");
+    CHECK(buf.empty());
+}
+
+TEST_CASE("MpscRingBuffer with concurrent producers") {
+    const unsigned PRODUCER_COUNT = 4;
+    const unsigned ITERATIONS = 20000;
+    uint8_t data[61] = {};
+    MpscRingBuffer buf;
+    buf.init(data, sizeof(data));
+    // Each producer writes its index followed by a counter, so that the consumer can validate
+    // the order of the records sent by each individual producer
+    std::vector<std::thread> producers;
+    for (unsigned i = 0; i < PRODUCER_COUNT; ++i) {
+        producers.emplace_back([&buf, i]() {
+            for (unsigned j = 0; j < ITERATIONS; ++j) {
+                const uint8_t rec[3] = { (uint8_t)i, (uint8_t)(j >> 8), (uint8_t)j };
+                MpscRingBuffer::Reservation r = {};
+                while (!buf.reserve(sizeof(rec), sizeof(rec), &r)) {
+                    std::this_thread::yield();
+                }
+                buf.write(r, 0, rec, sizeof(rec));
+                buf.commit();
+            }
+        });
+    }
+    unsigned counters[PRODUCER_COUNT] = {};
+    std::vector<uint8_t> rec;
+    unsigned total = 0;
+    bool ok = true;
+    while (total < PRODUCER_COUNT * ITERATIONS && ok) {
+        size_t n = 0;
+        const auto p = buf.consume(&n);
+        if (!n) {
+            std::this_thread::yield();
+            continue;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            rec.push_back(p[i]);
+            if (rec.size() == 3) {
+                const unsigned id = rec[0];
+                const unsigned cnt = ((unsigned)rec[1] << 8) | rec[2];
+                if (id >= PRODUCER_COUNT || cnt != (counters[id] & 0xffff)) {
+                    ok = false;
+                    break;
+                }
+                ++counters[id];
+                ++total;
+                rec.clear();
+            }
+        }
+        buf.consumeCommit(n);
+    }
+    for (auto& t: producers) {
+        t.join();
+    }
+    CHECK(ok);
+    CHECK(total == PRODUCER_COUNT * ITERATIONS);
+    CHECK(buf.empty());
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2020 Particle Industries, Inc.  All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation, either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "tlv_file.h"
+#include "system_error.h"
+
+#include "mock/filesystem.h"
+
+#include <catch2/catch.hpp>
+#include <hippomocks.h>
+
+#include <string>
+
+using namespace particle;
+using namespace particle::services::settings;
+
+namespace {
+
+const char* const FILE_NAME = "cache.dat";
+const char* const TMP_FILE_NAME = "cache.dat.tmp";
+
+std::string get(TlvFile* tlv, uint16_t key, int index = 0) {
+    char buf[256] = {};
+    const auto r = tlv->get(key, (uint8_t*)buf, sizeof(buf), index);
+    if (r < 0) {
+        return std::string();
+    }
+    return std::string(buf, r);
+}
+
+int set(TlvFile* tlv, uint16_t key, const std::string& value, int index = -1) {
+    return tlv->set(key, (const uint8_t*)value.data(), value.size(), index);
+}
+
+int add(TlvFile* tlv, uint16_t key, const std::string& value) {
+    return tlv->add(key, (const uint8_t*)value.data(), value.size());
+}
+
+std::string entry(uint16_t key, const std::string& value, uint16_t flags = 0) {
+    const char h[] = { (char)0xad, (char)0x4e, (char)(key & 0xff), (char)(key >> 8),
+            (char)(value.size() & 0xff), (char)(value.size() >> 8), (char)(flags & 0xff), (char)(flags >> 8) };
+    return std::string(h, sizeof(h)) + value;
+}
+
+std::string footer(uint32_t size, uint16_t version, uint32_t magic = 0) {
+    if (!magic) {
+        magic = version ? TLV_FILE_MAGICK : TLV_FILE_MAGICK_V0;
+    }
+    const char f[] = { 0, 0, 0, 0, (char)(size & 0xff), (char)((size >> 8) & 0xff), 0, 0, 0, 0,
+            (char)(version & 0xff), (char)(version >> 8), (char)(magic & 0xff), (char)((magic >> 8) & 0xff),
+            (char)((magic >> 16) & 0xff), (char)(magic >> 24) };
+    return std::string(f, sizeof(f));
+}
+
+} // namespace
+
+TEST_CASE("TlvFile") {
+    MockRepository mocks;
+    test::Filesystem fs(&mocks);
+    TlvFile tlv(FILE_NAME);
+
+    SECTION("creates an empty file") {
+        REQUIRE(tlv.init() == 0);
+        CHECK(tlv.size() == 16);
+        CHECK(tlv.fileVersion() == tlv.currentVersion());
+        CHECK(tlv.get(1, nullptr, 0) == SYSTEM_ERROR_NOT_FOUND);
+        CHECK(tlv.deInit() == 0);
+    }
+
+    SECTION("stores and replaces values") {
+        REQUIRE(tlv.init() == 0);
+        CHECK(set(&tlv, 1, "abc") == 0);
+        CHECK(set(&tlv, 2, "de") == 0);
+        CHECK(get(&tlv, 1) == "abc");
+        CHECK(get(&tlv, 2) == "de");
+        CHECK(set(&tlv, 1, "fghij") == 0);
+        CHECK(get(&tlv, 1) == "fghij");
+        CHECK(get(&tlv, 2) == "de");
+        CHECK(tlv.deInit() == 0);
+    }
+
+    SECTION("keeps the values across reinitialization") {
+        REQUIRE(tlv.init() == 0);
+        CHECK(set(&tlv, 1, "abc") == 0);
+        CHECK(set(&tlv, 2, "de") == 0);
+        CHECK(set(&tlv, 1, "fgh") == 0);
+        CHECK(tlv.del(2) == 0);
+        CHECK(tlv.deInit() == 0);
+        TlvFile tlv2(FILE_NAME);
+        REQUIRE(tlv2.init() == 0);
+        CHECK(get(&tlv2, 1) == "fgh");
+        CHECK(tlv2.get(2, nullptr, 0) == SYSTEM_ERROR_NOT_FOUND);
+        CHECK(tlv2.deInit() == 0);
+    }
+
+    SECTION("supports multiple values for a key") {
+        REQUIRE(tlv.init() == 0);
+        CHECK(add(&tlv, 1, "a") == 0);
+        CHECK(add(&tlv, 2, "x") == 0);
+        CHECK(add(&tlv, 1, "b") == 0);
+        CHECK(add(&tlv, 1, "c") == 0);
+        CHECK(get(&tlv, 1, 0) == "a");
+        CHECK(get(&tlv, 1, 1) == "b");
+        CHECK(get(&tlv, 1, 2) == "c");
+        CHECK(get(&tlv, 1, -1) == "c");
+        CHECK(tlv.get(1, nullptr, 0, 3) == SYSTEM_ERROR_NOT_FOUND);
+        CHECK(tlv.del(1, 1) == 0);
+        CHECK(get(&tlv, 1, 0) == "a");
+        CHECK(get(&tlv, 1, 1) == "c");
+        CHECK(tlv.del(1) == 0);
+        CHECK(tlv.get(1, nullptr, 0) == SYSTEM_ERROR_NOT_FOUND);
+        CHECK(tlv.del(1) == SYSTEM_ERROR_NOT_FOUND);
+        CHECK(get(&tlv, 2) == "x");
+        CHECK(tlv.deInit() == 0);
+    }
+
+    SECTION("marks deleted entries instead of moving the remaining data") {
+        REQUIRE(tlv.init() == 0);
+        CHECK(set(&tlv, 1, "abc") == 0);
+        CHECK(set(&tlv, 2, "de") == 0);
+        CHECK(tlv.del(1) == 0);
+        CHECK(tlv.deInit() == 0);
+        CHECK(fs.readFile(FILE_NAME) == entry(1, "abc", TLV_HEADER_FLAG_DELETED) + entry(2, "de") + footer(21, 1));
+    }
+
+    SECTION("compacts the file once enough data is deleted") {
+        REQUIRE(tlv.init() == 0);
+        const std::string value(100, 'x');
+        CHECK(set(&tlv, 1, "abc") == 0);
+        for (int i = 0; i < 4; ++i) {
+            CHECK(set(&tlv, 2, value + std::to_string(i)) == 0);
+        }
+        CHECK(set(&tlv, 3, "de") == 0);
+        CHECK(get(&tlv, 1) == "abc");
+        CHECK(get(&tlv, 2) == value + "3");
+        CHECK(get(&tlv, 3) == "de");
+        CHECK(tlv.deInit() == 0);
+        CHECK(fs.readFile(FILE_NAME) == entry(1, "abc") + entry(2, value + "3") + entry(3, "de") + footer(130, 1));
+    }
+
+    SECTION("compacts the file on request") {
+        REQUIRE(tlv.init() == 0);
+        CHECK(set(&tlv, 1, "abc") == 0);
+        CHECK(set(&tlv, 2, "de") == 0);
+        CHECK(set(&tlv, 1, "fg") == 0);
+        CHECK(tlv.compact() == 0);
+        CHECK(get(&tlv, 1) == "fg");
+        CHECK(get(&tlv, 2) == "de");
+        CHECK(set(&tlv, 2, "hi") == 0);
+        CHECK(get(&tlv, 2) == "hi");
+        CHECK(tlv.deInit() == 0);
+        CHECK(fs.readFile(FILE_NAME) == entry(2, "de", TLV_HEADER_FLAG_DELETED) + entry(1, "fg") + entry(2, "hi") + footer(30, 1));
+        CHECK(!fs.hasFile(TMP_FILE_NAME));
+    }
+
+    SECTION("replaces a temporary file left by an interrupted compaction") {
+        fs.writeFile(TMP_FILE_NAME, entry(1, "xyz") + footer(11, 1));
+        REQUIRE(tlv.init() == 0);
+        CHECK(set(&tlv, 1, "abc") == 0);
+        CHECK(set(&tlv, 1, "de") == 0);
+        CHECK(tlv.compact() == 0);
+        CHECK(get(&tlv, 1) == "de");
+        CHECK(tlv.deInit() == 0);
+        CHECK(fs.readFile(FILE_NAME) == entry(1, "de") + footer(10, 1));
+        CHECK(!fs.hasFile(TMP_FILE_NAME));
+    }
+
+    SECTION("keeps the original file if the compaction fails") {
+        // The temporary file cannot be created
+        fs.createDir(TMP_FILE_NAME);
+        REQUIRE(tlv.init() == 0);
+        CHECK(set(&tlv, 1, "abc") == 0);
+        CHECK(set(&tlv, 1, "de") == 0);
+        CHECK(tlv.compact() < 0);
+        CHECK(get(&tlv, 1) == "de");
+        CHECK(set(&tlv, 2, "fg") == 0);
+        CHECK(get(&tlv, 2) == "fg");
+        CHECK(tlv.deInit() == 0);
+        CHECK(fs.readFile(FILE_NAME) == entry(1, "abc", TLV_HEADER_FLAG_DELETED) + entry(1, "de") + entry(2, "fg") + footer(31, 1));
+    }
+
+    SECTION("reads files created by previous versions") {
+        fs.writeFile(FILE_NAME, entry(1, "abc") + entry(2, "de") + footer(21, 0));
+        REQUIRE(tlv.init() == 0);
+        CHECK(tlv.fileVersion() == 0);
+        CHECK(get(&tlv, 1) == "abc");
+        CHECK(get(&tlv, 2) == "de");
+        CHECK(tlv.deInit() == 0);
+    }
+
+    SECTION("upgrades files created by previous versions when an entry is deleted") {
+        fs.writeFile(FILE_NAME, entry(1, "abc") + entry(2, "de") + footer(21, 0));
+        REQUIRE(tlv.init() == 0);
+        CHECK(tlv.del(1) == 0);
+        CHECK(tlv.fileVersion() == tlv.currentVersion());
+        CHECK(tlv.deInit() == 0);
+        CHECK(fs.readFile(FILE_NAME) == entry(1, "abc", TLV_HEADER_FLAG_DELETED) + entry(2, "de") + footer(21, 1));
+    }
+
+    SECTION("discards files with the magic number of the previous version and a newer version") {
+        fs.writeFile(FILE_NAME, entry(1, "abc") + footer(11, 1, TLV_FILE_MAGICK_V0));
+        REQUIRE(tlv.init() == 0);
+        CHECK(tlv.get(1, nullptr, 0) == SYSTEM_ERROR_NOT_FOUND);
+        CHECK(tlv.deInit() == 0);
+        CHECK(fs.readFile(FILE_NAME) == footer(0, 1));
+    }
+
+    SECTION("discards files created by newer versions") {
+        fs.writeFile(FILE_NAME, entry(1, "abc") + footer(11, 2));
+        REQUIRE(tlv.init() == 0);
+        CHECK(tlv.get(1, nullptr, 0) == SYSTEM_ERROR_NOT_FOUND);
+        CHECK(tlv.deInit() == 0);
+        CHECK(fs.readFile(FILE_NAME) == footer(0, 1));
+    }
+}
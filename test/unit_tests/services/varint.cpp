@@ -225,3 +225,54 @@ TEST_CASE("maxUnsignedVarintSize()") {
         CHECK(r == maxUnsignedVarintSize<uint64_t>());
     }
 }
+
+TEST_CASE("encodeSignedVarint()") {
+    SECTION("encodes values with a small magnitude using a small number of bytes") {
+        char buf[8] = {};
+        // 0
+        auto r = encodeSignedVarint(buf, sizeof(buf), 0);
+        CHECK(r == 1);
+        CHECK(memcmp(buf, "\x00", 1) == 0);
+        // -1
+        r = encodeSignedVarint(buf, sizeof(buf), -1);
+        CHECK(r == 1);
+        CHECK(memcmp(buf, "\x01", 1) == 0);
+        // 1
+        r = encodeSignedVarint(buf, sizeof(buf), 1);
+        CHECK(r == 1);
+        CHECK(memcmp(buf, "\x02", 1) == 0);
+        // -64
+        r = encodeSignedVarint(buf, sizeof(buf), -64);
+        CHECK(r == 1);
+        CHECK(memcmp(buf, "\x7f", 1) == 0);
+        // 64
+        r = encodeSignedVarint(buf, sizeof(buf), 64);
+        CHECK(r == 2);
+        CHECK(memcmp(buf, "\x80\x01", 2) == 0);
+        // INT32_MIN
+        r = encodeSignedVarint(buf, sizeof(buf), std::numeric_limits<int32_t>::min());
+        CHECK(r == 5);
+        CHECK(memcmp(buf, "\xff\xff\xff\xff\x0f", 5) == 0);
+    }
+}
+
+TEST_CASE("decodeSignedVarint()") {
+    SECTION("fails if the varint data is incomplete") {
+        int32_t v = 0;
+        char buf[] = "\x80";
+        auto r = decodeSignedVarint(buf, 1, &v);
+        CHECK(r == SYSTEM_ERROR_NOT_ENOUGH_DATA);
+    }
+
+    SECTION("decodes values encoded with encodeSignedVarint()") {
+        for (int32_t val: { 0, 1, -1, 63, -64, 64, 1000, -1000, std::numeric_limits<int32_t>::max(),
+                std::numeric_limits<int32_t>::min() }) {
+            char buf[8] = {};
+            const auto n = encodeSignedVarint(buf, sizeof(buf), val);
+            int32_t v = 0;
+            auto r = decodeSignedVarint(buf, sizeof(buf), &v);
+            CHECK(r == n);
+            CHECK(v == val);
+        }
+    }
+}
@@ -22,6 +22,10 @@ filesystem_t* filesystem_get_instance(void* reserved) {
     return &fs;
 }
 
+int filesystem_mount(filesystem_t* fs) {
+    return 0;
+}
+
 int filesystem_lock(filesystem_t* fs) {
     return 0;
 }
@@ -69,3 +73,15 @@ int lfs_file_sync(lfs_t* lfs, lfs_file_t* file) {
 int lfs_remove(lfs_t* lfs, const char* path) {
     return 0;
 }
+
+int lfs_rename(lfs_t* lfs, const char* oldpath, const char* newpath) {
+    return 0;
+}
+
+int lfs_stat(lfs_t* lfs, const char* path, struct lfs_info* info) {
+    return LFS_ERR_NOENT;
+}
+
+int lfs_mkdir(lfs_t* lfs, const char* path) {
+    return 0;
+}
@@ -61,9 +61,20 @@ enum lfs_whence_flags {
     LFS_SEEK_END = 2
 };
 
+enum lfs_type {
+    LFS_TYPE_REG = 0x001,
+    LFS_TYPE_DIR = 0x002
+};
+
 typedef struct lfs {
 } lfs_t;
 
+struct lfs_info {
+    uint8_t type;
+    lfs_size_t size;
+    char name[256];
+};
+
 typedef struct lfs_file {
     size_t pos;
     int flags;
@@ -88,9 +99,13 @@ lfs_soff_t lfs_file_tell(lfs_t* lfs, lfs_file_t* file);
 int lfs_file_truncate(lfs_t* lfs, lfs_file_t* file, lfs_off_t size);
 int lfs_file_sync(lfs_t* lfs, lfs_file_t* file);
 int lfs_remove(lfs_t* lfs, const char* path);
+int lfs_rename(lfs_t* lfs, const char* oldpath, const char* newpath);
+int lfs_stat(lfs_t* lfs, const char* path, struct lfs_info* info);
+int lfs_mkdir(lfs_t* lfs, const char* path);
 // TODO: Add stubs for remaining API functions
 
 filesystem_t* filesystem_get_instance(void* reserved);
+int filesystem_mount(filesystem_t* fs);
 int filesystem_lock(filesystem_t* fs);
 int filesystem_unlock(filesystem_t* fs);
 
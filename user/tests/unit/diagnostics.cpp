@@ -533,6 +533,36 @@ TEST_CASE("Service API") {
             CHECK(diag_get_source(d3.id(), nullptr /* src */, nullptr) == 0);
             CHECK(diag_get_source(4, nullptr, nullptr) == SYSTEM_ERROR_NOT_FOUND);
         }
+
+        SECTION("returns data sources with system and application-specific IDs") {
+            auto d4 = DiagSource(DIAG_ID_USER).add();
+            auto d5 = DiagSource(DIAG_ID_USER + 10).add();
+            diag.start();
+            for (uint16_t id: { d1.id(), d2.id(), d3.id(), d4.id(), d5.id() }) {
+                const diag_source* d = nullptr;
+                CHECK(diag_get_source(id, &d, nullptr) == 0);
+                REQUIRE(d != nullptr);
+                CHECK(d->id == id);
+            }
+            CHECK(diag_get_source(0, nullptr, nullptr) == SYSTEM_ERROR_NOT_FOUND);
+            CHECK(diag_get_source(DIAG_ID_USER - 1, nullptr, nullptr) == SYSTEM_ERROR_NOT_FOUND);
+            CHECK(diag_get_source(DIAG_ID_USER + 1, nullptr, nullptr) == SYSTEM_ERROR_NOT_FOUND);
+            CHECK(diag_get_source(DIAG_ID_USER + 11, nullptr, nullptr) == SYSTEM_ERROR_NOT_FOUND);
+        }
+
+        SECTION("returns data sources with sparse IDs") {
+            auto d4 = DiagSource(1000).add();
+            auto d5 = DiagSource(65535).add();
+            diag.start();
+            for (uint16_t id: { d1.id(), d4.id(), d5.id() }) {
+                const diag_source* d = nullptr;
+                CHECK(diag_get_source(id, &d, nullptr) == 0);
+                REQUIRE(d != nullptr);
+                CHECK(d->id == id);
+            }
+            CHECK(diag_get_source(999, nullptr, nullptr) == SYSTEM_ERROR_NOT_FOUND);
+            CHECK(diag_get_source(DIAG_ID_USER, nullptr, nullptr) == SYSTEM_ERROR_NOT_FOUND);
+        }
     }
 
     SECTION("diag_command()") {
@@ -652,6 +682,40 @@ TEST_CASE("Wiring API") {
         testIntegerDiagnosticData<IntegerDiagnosticData, AtomicConcurrency>(diag);
     }
 
+    SECTION("UnsignedIntegerDiagnosticData") {
+        AtomicUnsignedIntegerDiagnosticData d(1);
+        diag.start();
+        CHECK(++d == 1);
+        CHECK(d++ == 1);
+        CHECK((d += 3) == 5);
+        CHECK(--d == 4);
+        CHECK((d -= 4) == 0);
+        d = 10;
+        uint32_t val = 0;
+        CHECK(AbstractUnsignedIntegerDiagnosticData::get(1, val) == 0);
+        CHECK(val == 10);
+    }
+
+    SECTION("HistogramDiagnosticData") {
+        const int32_t bounds[] = { -80, -60, -40 };
+        HistogramDiagnosticData<4> d(1, bounds);
+        diag.start();
+        for (int32_t val: { -100, -80, -79, -60, -50, -40, -10, 0 }) {
+            d.add(val);
+        }
+        CHECK(d.bucket(0) == 2);
+        CHECK(d.bucket(1) == 2);
+        CHECK(d.bucket(2) == 2);
+        CHECK(d.bucket(3) == 2);
+        CHECK(d.count() == 8);
+        uint32_t val = 0;
+        CHECK(AbstractUnsignedIntegerDiagnosticData::get(1, val) == 0);
+        CHECK(val == 8);
+        d.reset();
+        CHECK(d.count() == 0);
+        CHECK(d.bucket(0) == 0);
+    }
+
     SECTION("PersistentIntegerDiagnosticData") {
         testPersistentIntegerDiagnosticData<PersistentIntegerDiagnosticData, NoConcurrency>(diag);
         // testPersistentIntegerDiagnosticData<PersistentIntegerDiagnosticData, AtomicConcurrency>(diag);
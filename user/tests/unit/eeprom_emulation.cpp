@@ -4,6 +4,8 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <chrono>
+#include <iostream>
 #include "eeprom_emulation.h"
 #include "flash_storage.h"
 
@@ -18,7 +20,8 @@ const uintptr_t PageBase2 = TestBase + TestPageSize;
 const size_t PageSize2 = TestPageSize / 4;
 
 using TestStore = RAMFlashStorage<TestBase, TestPageCount, TestPageSize>;
-using TestEEPROM = EEPROMEmulation<TestStore, PageBase1, PageSize1, PageBase2, PageSize2>;
+using TestEEPROM = EEPROMEmulation<TestStore, PageBase1, PageSize1, PageBase2, PageSize2, true>;
+using ScanningEEPROM = EEPROMEmulation<TestStore, PageBase1, PageSize1, PageBase2, PageSize2>;
 using Record = TestEEPROM::Record;
 
 // Alias some constants, otherwise the linker is having issues when
@@ -1338,3 +1341,84 @@ TEST_CASE("Page swap with data in multiple batches", "[eeprom]")
         REQUIRE(dataRead == data);
     }
 }
+
+TEST_CASE("Index is not allocated unless enabled", "[eeprom]")
+{
+    struct Tester: ScanningEEPROM
+    {
+        bool hasIndex() const
+        {
+            return (bool)recordOffsets;
+        }
+    };
+
+    Tester eeprom;
+    eeprom.init();
+
+    // Enough writes to fill the active page and perform page swaps
+    uint8_t data[100];
+    for(unsigned i = 0; i < 100; i++)
+    {
+        std::memset(data, i, sizeof(data));
+        eeprom.put(10, data, sizeof(data));
+    }
+
+    uint8_t dataRead[sizeof(data)];
+    eeprom.get(10, dataRead, sizeof(dataRead));
+    REQUIRE(std::memcmp(data, dataRead, sizeof(data)) == 0);
+
+    uint8_t value;
+    eeprom.get(9, value);
+    REQUIRE(value == 0xFF);
+
+    REQUIRE_FALSE(eeprom.hasIndex());
+}
+
+TEST_CASE("EEPROM throughput benchmark", "[eeprom][benchmark][.]")
+{
+    using namespace std::chrono;
+
+    struct Config
+    {
+        uint8_t data[100];
+    };
+
+    const unsigned iterations = 2000;
+    // Discarding the index before each operation makes every access scan
+    // the page, which corresponds to the behavior without the index
+    for(bool scan: { true, false })
+    {
+        TestEEPROM eeprom;
+        eeprom.init();
+
+        Config config;
+        std::memset(&config, 0, sizeof(config));
+        auto t1 = high_resolution_clock::now();
+        for(unsigned i = 0; i < iterations; i++)
+        {
+            config.data[i % sizeof(config.data)] = i;
+            if(scan)
+            {
+                eeprom.invalidateIndex();
+            }
+            eeprom.put(0, &config, sizeof(config));
+        }
+        const auto putTime = duration_cast<microseconds>(high_resolution_clock::now() - t1).count();
+
+        Config readConfig;
+        t1 = high_resolution_clock::now();
+        for(unsigned i = 0; i < iterations; i++)
+        {
+            if(scan)
+            {
+                eeprom.invalidateIndex();
+            }
+            eeprom.get(0, &readConfig, sizeof(readConfig));
+        }
+        const auto getTime = duration_cast<microseconds>(high_resolution_clock::now() - t1).count();
+        REQUIRE(std::memcmp(&config, &readConfig, sizeof(config)) == 0);
+
+        std::cout << (scan ? "Page scan" : "RAM index") << ", " << iterations << " operations with a " <<
+                sizeof(Config) << "-byte struct: put " << putTime << " us, get " << getTime << " us" << std::endl;
+    }
+}
@@ -7,7 +7,10 @@
 #include <boost/variant.hpp>
 
 #include <deque>
+#include <vector>
 #include <string>
+#include <chrono>
+#include <iostream>
 #include <cstdlib>
 #include <cfloat> // for constants
 
@@ -166,6 +169,86 @@ private:
     }
 };
 
+// Records events reported by JSONStreamParser in a compact text form
+class StreamRecorder: public JSONStreamParser {
+public:
+    explicit StreamRecorder(size_t maxStringSize = DEFAULT_MAX_STRING_SIZE) :
+            JSONStreamParser(maxStringSize) {
+    }
+
+    const std::string& events() const {
+        return s_;
+    }
+
+protected:
+    virtual bool beginArray() override {
+        s_ += '[';
+        return true;
+    }
+
+    virtual bool endArray() override {
+        s_ += ']';
+        return true;
+    }
+
+    virtual bool beginObject() override {
+        s_ += '{';
+        return true;
+    }
+
+    virtual bool endObject() override {
+        s_ += '}';
+        return true;
+    }
+
+    virtual bool name(const char *name, size_t size) override {
+        CHECK(strlen(name) == size);
+        s_ += "n(" + std::string(name, size) + ')';
+        return true;
+    }
+
+    virtual bool value(JSONType type, const char *data, size_t size) override {
+        static const char* const types[] = { "invalid", "null", "bool", "number", "string", "array", "object" };
+        s_ += std::string(types[type]) + '(' + std::string(data, size) + ')';
+        return true;
+    }
+
+private:
+    std::string s_;
+};
+
+// Parses JSON document with JSONStreamParser, splitting it into chunks of specified size
+inline std::string parseStream(const std::string &json, size_t chunkSize = 0) {
+    StreamRecorder p;
+    if (!chunkSize) {
+        chunkSize = json.size();
+    }
+    for (size_t i = 0; i < json.size(); i += chunkSize) {
+        if (!p.parse(json.data() + i, std::min(chunkSize, json.size() - i))) {
+            return "error";
+        }
+    }
+    if (!p.finish()) {
+        return "error";
+    }
+    return p.events();
+}
+
+// Generates a JSON document of roughly specified size resembling a typical configuration blob
+inline std::string makeDocument(size_t size) {
+    std::string s = "{";
+    for (unsigned i = 0; s.size() < size; ++i) {
+        if (i) {
+            s += ',';
+        }
+        const std::string n = std::to_string(i);
+        s += "\"prop" + n + "\":{\"id\":" + n + ",\"name\":\"Item \\\"" + n + "\\\"\",\"enabled\":true,"
+                "\"values\":[1.5,-2,3e2,null],\"tags\":[\"a\",\"b\",\"c\"]}";
+    }
+    s += '}';
+    return s;
+}
+
 inline JSONValue parse(const std::string &json) {
     return JSONValue::parseCopy(json.data(), json.size());
 }
@@ -341,6 +424,20 @@ TEST_CASE("Parsing JSON") {
         }
     }
 
+    SECTION("large array") {
+        std::string json = "[0";
+        for (int i = 1; i < 1000; ++i) {
+            json += ',' + std::to_string(i % 10);
+        }
+        json += ']';
+        Checker c = check(json.c_str()); // Token store needs to grow while parsing
+        c.beginArray();
+        for (int i = 0; i < 1000; ++i) {
+            c.number(i % 10);
+        }
+        c.endArray();
+    }
+
     SECTION("parsing errors") {
         check("").invalid(); // Empty source data
         check("[").invalid(); // Malformed array
@@ -1082,6 +1179,198 @@ TEST_CASE("JSONObjectIterator") {
     }
 }
 
+TEST_CASE("JSONObjectIndex") {
+    SECTION("construction") {
+        JSONObjectIndex idx1;
+        CHECK(idx1.count() == 0);
+        CHECK(idx1.value("a").isValid() == false);
+        CHECK(idx1.has("a") == false);
+        JSONObjectIndex idx2(parse("[1,2,3]")); // Constructing from non-object value
+        CHECK(idx2.count() == 0);
+        CHECK(idx2.has("1") == false);
+        JSONObjectIndex idx3(parse("{}"));
+        CHECK(idx3.count() == 0);
+        CHECK(idx3.has("") == false);
+    }
+
+    SECTION("lookup") {
+        const JSONObjectIndex idx(parse("{\"a\":1,\"b\":{\"c\":[2,3],\"d\":4},\"e\\\"\":\"x\",\"\":null,\"f\":[{},[]],\"g\":true}"));
+        CHECK(idx.count() == 6);
+        check(idx.value("a")).number(1);
+        check(idx.value("b")).beginObject()
+                .name("c").beginArray()
+                        .number(2)
+                        .number(3)
+                        .endArray()
+                .name("d").number(4)
+                .endObject();
+        check(idx.value("e\"")).string("x"); // Names are unescaped
+        check(idx.value("")).null();
+        check(idx.value(String("g"))).boolean(true);
+        CHECK(idx.has("f") == true);
+        CHECK(idx.has("c") == false); // Nested properties are not indexed
+        CHECK(idx.has("ab") == false);
+        CHECK(idx.value("a", 0).isNull() == true); // Empty name
+    }
+
+    SECTION("duplicate names") {
+        const JSONObjectIndex idx(parse("{\"a\":1,\"b\":2,\"a\":3}"));
+        CHECK(idx.count() == 3);
+        check(idx.value("a")).number(1); // First property wins
+        check(idx.value("b")).number(2);
+    }
+
+    SECTION("large object") {
+        const JSONValue v = JSONValue::parseCopy(makeDocument(16384).c_str());
+        const JSONObjectIndex idx(v);
+        REQUIRE(idx.count() > 100);
+        JSONObjectIterator it(v);
+        while (it.next()) {
+            const JSONValue v2 = idx.value((const char*)it.name());
+            REQUIRE(v2.isObject());
+            CHECK(JSONObjectIndex(v2).value("id").toInt() == JSONObjectIndex(it.value()).value("id").toInt());
+        }
+    }
+}
+
+TEST_CASE("JSONStreamParser") {
+    SECTION("primitives") {
+        CHECK(parseStream("null") == "null(null)");
+        CHECK(parseStream("true") == "bool(true)");
+        CHECK(parseStream(" false ") == "bool(false)");
+        CHECK(parseStream("-12.5e+3") == "number(-12.5e+3)");
+        CHECK(parseStream("\"abc\"") == "string(abc)");
+        CHECK(parseStream("\"\"") == "string()");
+    }
+
+    SECTION("escaped characters") {
+        CHECK(parseStream("\"\\\"\\/\\\\\\b\\f\\n\\r\\t\"") == "string(\"/\\\b\f\n\r\t)");
+        CHECK(parseStream("\"a\\u0041b\"") == "string(aAb)");
+        CHECK(parseStream("\"\\u2014\"") == "string(\\u2014)"); // Unicode characters are not processed
+    }
+
+    SECTION("compound values") {
+        CHECK(parseStream("[]") == "[]");
+        CHECK(parseStream("{}") == "{}");
+        CHECK(parseStream("[null,true,2,3.14,\"abcd\"]") == "[null(null)bool(true)number(2)number(3.14)string(abcd)]");
+        CHECK(parseStream("{ \"a\" : 1 , \"b\" : [ {} , [ ] ] , \"c\" : { \"d\" : \"e\" } }") ==
+                "{n(a)number(1)n(b)[{}[]]n(c){n(d)string(e)}}");
+    }
+
+    SECTION("chunked input") {
+        const std::string json = "{\"1.1\":1.1,\"1.2\":[true,false,null,\"a\\\\b\\u0043\"],\"1.3\":{\"2.1\":-21}}";
+        const std::string expected = parseStream(json);
+        REQUIRE(expected == "{n(1.1)number(1.1)n(1.2)[bool(true)bool(false)null(null)string(a\\bC)]n(1.3){n(2.1)number(-21)}}");
+        for (size_t i = 1; i < json.size(); ++i) {
+            CHECK(parseStream(json, i) == expected);
+        }
+    }
+
+    SECTION("large document") {
+        const std::string json = makeDocument(16384);
+        CHECK(parseStream(json, 61) == parseStream(json));
+    }
+
+    SECTION("parsing errors") {
+        CHECK(parseStream("") == "error"); // Empty source data
+        CHECK(parseStream("[") == "error"); // Malformed array
+        CHECK(parseStream("]") == "error");
+        CHECK(parseStream("[1,") == "error");
+        CHECK(parseStream("[1}") == "error");
+        CHECK(parseStream("{") == "error"); // Malformed object
+        CHECK(parseStream("}") == "error");
+        CHECK(parseStream("{null") == "error");
+        CHECK(parseStream("{1") == "error");
+        CHECK(parseStream("{\"1\"") == "error");
+        CHECK(parseStream("{\"1\":") == "error");
+        CHECK(parseStream("{\"1\":1]") == "error");
+        CHECK(parseStream("\"\\x\"") == "error"); // Unknown escaped character
+        CHECK(parseStream("\"\\u000x\"") == "error"); // Invalid hex value
+        CHECK(parseStream("\"abc") == "error"); // Unterminated string
+        CHECK(parseStream("nul") == "error"); // Invalid literal names
+        CHECK(parseStream("True") == "error");
+        CHECK(parseStream("1a") == "error");
+        CHECK(parseStream("1 2") == "error"); // Data after the end of the document
+    }
+
+    SECTION("string size limit") {
+        StreamRecorder p(4);
+        CHECK(p.parse("[\"abcd\",") == true);
+        CHECK(p.parse("\"abcde\"]") == false);
+        CHECK(p.isError() == true);
+        CHECK(p.parse("1") == false); // Error state is persistent
+        p.reset();
+        CHECK(p.parse("1234") == true);
+        CHECK(p.finish() == true);
+        CHECK(p.isDone() == true);
+    }
+
+    SECTION("nesting limit") {
+        StreamRecorder p;
+        CHECK(p.parse(std::string(JSONStreamParser::MAX_DEPTH, '[').c_str()) == true);
+        CHECK(p.depth() == JSONStreamParser::MAX_DEPTH);
+        CHECK(p.parse("[") == false);
+    }
+}
+
+TEST_CASE("JSON parsing benchmark", "[json][benchmark][.]") {
+    using namespace std::chrono;
+    const unsigned iterations = 200;
+    for (size_t size: { 1024, 4096, 16384 }) {
+        const std::string json = makeDocument(size);
+        // JSONValue::parseCopy()
+        auto t1 = high_resolution_clock::now();
+        for (unsigned i = 0; i < iterations; ++i) {
+            REQUIRE(JSONValue::parseCopy(json.data(), json.size()).isObject());
+        }
+        const auto copyTime = duration_cast<microseconds>(high_resolution_clock::now() - t1).count();
+        // JSONValue::parse()
+        std::string buf;
+        t1 = high_resolution_clock::now();
+        for (unsigned i = 0; i < iterations; ++i) {
+            buf = json;
+            REQUIRE(JSONValue::parse(&buf[0], buf.size()).isObject());
+        }
+        const auto inPlaceTime = duration_cast<microseconds>(high_resolution_clock::now() - t1).count();
+        // JSONStreamParser, 512-byte chunks
+        t1 = high_resolution_clock::now();
+        for (unsigned i = 0; i < iterations; ++i) {
+            JSONStreamParser p;
+            for (size_t j = 0; j < json.size(); j += 512) {
+                REQUIRE(p.parse(json.data() + j, std::min((size_t)512, json.size() - j)));
+            }
+            REQUIRE(p.finish());
+        }
+        const auto streamTime = duration_cast<microseconds>(high_resolution_clock::now() - t1).count();
+        // Property lookups: JSONObjectIterator vs JSONObjectIndex
+        const JSONValue v = JSONValue::parseCopy(json.data(), json.size());
+        JSONObjectIterator it(v);
+        std::vector<std::string> names;
+        while (it.next()) {
+            names.push_back((const char*)it.name());
+        }
+        t1 = high_resolution_clock::now();
+        for (const auto &name: names) {
+            JSONObjectIterator it(v);
+            while (it.next() && it.name() != name.c_str()) {
+            }
+        }
+        const auto iterTime = duration_cast<microseconds>(high_resolution_clock::now() - t1).count();
+        t1 = high_resolution_clock::now();
+        const JSONObjectIndex idx(v);
+        for (const auto &name: names) {
+            REQUIRE(idx.has(name.c_str()));
+        }
+        const auto indexTime = duration_cast<microseconds>(high_resolution_clock::now() - t1).count();
+        std::cout << "JSON document: " << json.size() << " bytes, " << names.size() << " properties" << std::endl;
+        std::cout << "  parseCopy(): " << (double)copyTime / iterations << " us" << std::endl;
+        std::cout << "  parse(): " << (double)inPlaceTime / iterations << " us" << std::endl;
+        std::cout << "  JSONStreamParser: " << (double)streamTime / iterations << " us" << std::endl;
+        std::cout << "  Lookup of all properties (JSONObjectIterator): " << iterTime << " us" << std::endl;
+        std::cout << "  Lookup of all properties (JSONObjectIndex): " << indexTime << " us" << std::endl;
+    }
+}
+
 TEST_CASE("JSONStreamWriter") {
     SECTION("construction") {
         test::OutputStream strm;
@@ -59,6 +59,11 @@ public:
         SimpleStaticPool(ptr, size) {
     }
 
+    // Size of a block that holds an allocation of the given size without rounding to a size class
+    static size_t exactBlockSize(size_t size) {
+        return blockSizeFor(size);
+    }
+
     size_t available() const {
         size_t sz = (begin_ + size_) - ptr_;
         for (BlockHeader* b = freeList_; b != nullptr; b = b->next) {
@@ -259,3 +264,136 @@ TEST_CASE("SimpleStaticPool") {
 
     testPool<TestSimpleStaticPool>(buf.data(), buf.size());
 }
+
+TEST_CASE("SimpleBasePool size classes and coalescing") {
+    Mocks mocks;
+
+    std::vector<uint8_t> buf(16384);
+    TestSimpleStaticPool pool(buf.data(), buf.size());
+
+    SECTION("Freed small blocks are reused for requests of the same size class") {
+        void* a = pool.allocate(10);
+        void* b = pool.allocate(10);
+        void* c = pool.allocate(10);
+        REQUIRE((a && b && c));
+        pool.deallocate(b);
+        // Not returned to the general free list
+        CHECK(pool.freeList() == nullptr);
+        CHECK(pool.allocate(9) == b);
+        pool.deallocate(a);
+        CHECK(pool.allocate(12) == a);
+    }
+
+    SECTION("Adjacent large blocks are coalesced") {
+        void* a = pool.allocate(2000);
+        void* b = pool.allocate(2000);
+        // Use up the remaining space
+        void* c = pool.allocate(pool.available() - sizeof(TestSimpleStaticPool::BlockHeaderT) * 2);
+        REQUIRE((a && b && c));
+        pool.deallocate(a);
+        pool.deallocate(b);
+        REQUIRE(pool.freeList() != nullptr);
+        CHECK(pool.freeList()->next == nullptr);
+        CHECK(pool.freeList() == pool.freeListEnd());
+        // The merged block is split to satisfy a smaller request
+        CHECK(pool.allocate(3000) == a);
+        CHECK(pool.freeList() != nullptr);
+    }
+
+    SECTION("Small blocks are reclaimed when the pool runs out of memory") {
+        std::vector<void*> blocks;
+        while (void* p = pool.allocate(1)) {
+            blocks.push_back(p);
+        }
+        REQUIRE(blocks.size() > 4);
+        // Free two adjacent small blocks in the middle of the pool
+        pool.deallocate(blocks[1]);
+        pool.deallocate(blocks[2]);
+        CHECK(pool.allocate(sizeof(uintptr_t) * 4) == blocks[1]);
+    }
+
+    SECTION("Rounding to a size class doesn't reduce the capacity of a small pool") {
+        for (size_t poolSize: { 512, 1024, 2048 }) {
+            for (size_t size: { 100, 264, 700 }) {
+                TestSimpleStaticPool p(buf.data(), poolSize);
+                const size_t count = poolSize / TestSimpleStaticPool::exactBlockSize(size);
+                size_t n = 0;
+                while (p.allocate(size)) {
+                    ++n;
+                }
+                CHECK(n == count);
+            }
+        }
+    }
+
+    SECTION("Statistics") {
+        SimpleBasePool::Stats stats = {};
+        pool.getStats(&stats);
+        CHECK(stats.total == buf.size());
+        CHECK(stats.used == 0);
+        CHECK(stats.fragmentation == 0);
+
+        void* a = pool.allocate(100);
+        void* b = pool.allocate(100);
+        void* c = pool.allocate(100);
+        pool.getStats(&stats);
+        CHECK(stats.used > 300);
+        CHECK(stats.peak == stats.used);
+        CHECK(stats.allocCount == 3);
+        const size_t peak = stats.peak;
+
+        pool.deallocate(b);
+        pool.getStats(&stats);
+        CHECK(stats.used < peak);
+        CHECK(stats.peak == peak);
+        CHECK(stats.fragmentation > 0);
+
+        CHECK(pool.allocate(buf.size()) == nullptr);
+        pool.getStats(&stats);
+        CHECK(stats.failedCount == 1);
+
+        pool.deallocate(a);
+        pool.deallocate(c);
+        pool.getStats(&stats);
+        CHECK(stats.used == 0);
+        CHECK(stats.fragmentation == 0);
+        CHECK(stats.largestFree == buf.size() - sizeof(TestSimpleStaticPool::BlockHeaderT));
+    }
+
+    SECTION("Random allocations") {
+        std::random_device r;
+        std::default_random_engine e1(r());
+        std::uniform_int_distribution<size_t> sizeDist(0, 300);
+        std::vector<std::pair<uint8_t*, size_t>> blocks;
+        uint8_t pattern = 0;
+        for (int i = 0; i < 20000; ++i) {
+            if (blocks.empty() || (e1() % 3) != 0) {
+                const size_t size = (e1() % 10 == 0) ? sizeDist(e1) * 8 : sizeDist(e1);
+                auto p = static_cast<uint8_t*>(pool.allocate(size));
+                if (p) {
+                    memset(p, ++pattern, size);
+                    blocks.push_back(std::make_pair(p, size));
+                }
+            } else {
+                const size_t idx = e1() % blocks.size();
+                const auto blk = blocks[idx];
+                // Check that the block hasn't been overwritten by another allocation
+                bool ok = true;
+                for (size_t j = 1; j < blk.second; ++j) {
+                    if (blk.first[j] != blk.first[0]) {
+                        ok = false;
+                    }
+                }
+                REQUIRE(ok);
+                pool.deallocate(blk.first);
+                blocks.erase(blocks.begin() + idx);
+            }
+        }
+        for (const auto& blk: blocks) {
+            pool.deallocate(blk.first);
+        }
+        CHECK(pool.available() == buf.size());
+        CHECK(pool.freeList() == nullptr);
+        CHECK(pool.freeListEnd() == nullptr);
+    }
+}
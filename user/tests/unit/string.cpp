@@ -1,10 +1,19 @@
 
 #include <iostream>
+#include <chrono>
+#include <string>
 #include <limits.h>
 #include "catch.hpp"
 
 #include "spark_wiring_string.h"
 
+namespace {
+
+// Prevents the compiler from optimizing out benchmarked code
+volatile size_t benchmarkSink = 0;
+
+} // namespace
+
 TEST_CASE("Can use HEX radix with String numeric conversion constructors") {
 
     REQUIRE(!strcmp(String(32, HEX),"20"));
@@ -101,3 +110,134 @@ TEST_CASE("Substring with left and right after the end returns until the end of
 TEST_CASE("Substring with flipped left and right returns the correct substring") {
     REQUIRE(String("test123").substring(5, 3)==String("t1"));
 }
+
+TEST_CASE("Concatenation grows the buffer geometrically") {
+    String s;
+    unsigned reallocs = 0;
+    unsigned capacity = s.bufferCapacity();
+    for (unsigned i = 0; i < 1000; ++i) {
+        s += 'x';
+        if (s.bufferCapacity() != capacity) {
+            capacity = s.bufferCapacity();
+            ++reallocs;
+        }
+    }
+    REQUIRE(s.length() == 1000);
+    REQUIRE(reallocs < 20);
+}
+
+TEST_CASE("Concatenating a string to itself") {
+    String s("0123456789012345");
+    s += s;
+    REQUIRE(s == "01234567890123450123456789012345");
+    s.concat(s.c_str() + 16);
+    REQUIRE(s == "012345678901234501234567890123450123456789012345");
+}
+
+TEST_CASE("Concatenating a non null-terminated buffer") {
+    String s("abc");
+    const char buf[] = { 'd', 'e', 'f' };
+    String t(buf, 2);
+    REQUIRE(t == "de");
+    s += t;
+    REQUIRE(s == "abcde");
+}
+
+TEST_CASE("Moving a string") {
+    SECTION("short") {
+        String s1("abc");
+        String s2(std::move(s1));
+        REQUIRE(s2 == "abc");
+        String s3;
+        s3 = std::move(s2);
+        REQUIRE(s3 == "abc");
+    }
+    SECTION("heap") {
+        String s1(std::string(100, 'a').c_str());
+        const char* p = s1.c_str();
+        String s2(std::move(s1));
+        REQUIRE(s2.c_str() == p); // Buffer is taken over
+        String s3;
+        s3 = std::move(s2);
+        REQUIRE(s3.c_str() == p);
+        String s4;
+        s4 += std::move(s3);
+        REQUIRE(s4.c_str() == p);
+    }
+    SECTION("invalid") {
+        String s1((const char*)nullptr);
+        REQUIRE(s1.c_str() == nullptr);
+        String s2("abc");
+        s2 = std::move(s1);
+        REQUIRE(s2.c_str() == nullptr);
+    }
+    SECTION("sum of temporaries") {
+        const String s = String("abc") + "def" + String(std::string(50, 'g').c_str()) + 'h';
+        REQUIRE(s.length() == 57);
+        REQUIRE(s.startsWith("abcdefggg"));
+        REQUIRE(s.endsWith("gh"));
+    }
+}
+
+TEST_CASE("Can append formatted output to a string") {
+    String s("n=");
+    REQUIRE(s.concatFormat("%d", 42));
+    REQUIRE(s == "n=42");
+    REQUIRE(s.concatFormat(" %s", std::string(100, 'x').c_str()));
+    REQUIRE(s.length() == 105);
+    REQUIRE(s.startsWith("n=42 xxx"));
+    String s2;
+    s2.reserve(200);
+    const char* p = s2.c_str();
+    for (unsigned i = 0; i < 10; ++i) {
+        REQUIRE(s2.concatFormat("%u,", i));
+    }
+    REQUIRE(s2 == "0,1,2,3,4,5,6,7,8,9,");
+    REQUIRE(s2.c_str() == p); // No reallocation
+}
+
+TEST_CASE("String concatenation benchmark", "[string][benchmark][.]") {
+    using namespace std::chrono;
+    const unsigned iterations = 100000;
+    auto run = [](const char* name, unsigned n, void(*fn)()) {
+        const auto t1 = high_resolution_clock::now();
+        for (unsigned i = 0; i < n; ++i) {
+            fn();
+        }
+        const auto t = duration_cast<nanoseconds>(high_resolution_clock::now() - t1).count();
+        std::cout << name << ": " << (double)t / n << " ns" << std::endl;
+    };
+    benchmarkSink = 0;
+    run("Short string construction", iterations, []() {
+        String s("Argon-1234");
+        benchmarkSink += s.length();
+    });
+    run("Sum of short strings", iterations, []() {
+        String s = String("name=") + "dev" + '-' + 42;
+        benchmarkSink += s.length();
+    });
+    run("Appending characters one by one (256)", iterations / 100, []() {
+        String s;
+        for (unsigned i = 0; i < 256; ++i) {
+            s += (char)('a' + i % 26);
+        }
+        benchmarkSink += s.length();
+    });
+    run("Appending numbers (64)", iterations / 100, []() {
+        String s;
+        for (int i = 0; i < 64; ++i) {
+            s += i;
+            s += ',';
+        }
+        benchmarkSink += s.length();
+    });
+    run("Formatting into reserved capacity (64)", iterations / 100, []() {
+        String s;
+        s.reserve(512);
+        for (int i = 0; i < 64; ++i) {
+            s.concatFormat("%d,", i);
+        }
+        benchmarkSink += s.length();
+    });
+    REQUIRE(benchmarkSink > 0);
+}
@@ -31,3 +31,21 @@ test(i2c_hal_backwards_compatibility)
     API_COMPILE(HAL_I2C_Acquire(i2c, NULL));
     API_COMPILE(HAL_I2C_Release(i2c, NULL)); 
 }
+
+#if HAL_PLATFORM_I2C_TRANSACTION_QUEUE
+test(i2c_transaction_queue)
+{
+    uint8_t reg = 0x0f;
+    uint8_t buf[2] = {};
+    WireTransaction trans[] = {
+        WireTransaction(0x40).write(&reg, 1).read(buf, sizeof(buf)),
+        WireTransaction(0x41).write(buf, 2).stop(false).timeout(std::chrono::milliseconds(50))
+                .onComplete([](int result, void* context) {}, nullptr)
+    };
+    API_COMPILE({ int r = Wire.transfer(trans, 2); (void)r; });
+
+#if Wiring_Wire1
+    API_COMPILE({ int r = Wire1.transfer(trans, 2); (void)r; });
+#endif // Wiring_Wire1
+}
+#endif // HAL_PLATFORM_I2C_TRANSACTION_QUEUE
@@ -165,6 +165,23 @@ test(spi_transfer)
 #endif // Wiring_SPI2
 }
 
+#if HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+test(spi_transaction_queue)
+{
+    uint8_t buf[4] = {};
+    SPITransaction trans[] = {
+        SPITransaction(buf, nullptr, sizeof(buf)).chipSelect(D5).keepSelected(),
+        SPITransaction("abc", buf, 3).chipSelect(D5).settings(SPISettings(8*MHZ, MSBFIRST, SPI_MODE0))
+                .onComplete([](int result, void* context) {}, nullptr)
+    };
+    API_COMPILE({ int r = SPI.transfer(trans, 2); (void)r; });
+
+#if Wiring_SPI1
+    API_COMPILE({ int r = SPI1.transfer(trans, 2); (void)r; });
+#endif // Wiring_SPI1
+}
+#endif // HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+
 test(spi_slave)
 {
     API_COMPILE(SPI.onSelect(nullptr));
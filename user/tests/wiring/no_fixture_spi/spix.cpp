@@ -683,3 +683,46 @@ test(SPIX_22_SPI_Transfer_Buffer_In_Flash) {
 
     SPI.end();
 }
+
+#if HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+test(SPIX_23_SPI_Transaction_Queue) {
+    constexpr unsigned int transferSize = 1024;
+    static const char flashData[transferSize] = "Stored in flash";
+    static uint8_t ramData[transferSize] = {};
+    static uint8_t rxData[transferSize] = {};
+    static volatile unsigned completed = 0;
+    static volatile int lastResult = 0;
+    const auto onComplete = [](int result, void* context) {
+        if (result == 0 && (unsigned)context == completed) {
+            ++completed;
+        } else {
+            lastResult = (result != 0) ? result : -1;
+        }
+    };
+    completed = 0;
+    lastResult = 0;
+
+    SPI.setClockSpeed(SPI_CLOCK_SPEED);
+    SPI.begin();
+    assertTrue(SPI.isEnabled());
+
+    SPITransaction trans[] = {
+        SPITransaction(flashData, rxData, transferSize).chipSelect(D5).keepSelected().onComplete(onComplete, (void*)0),
+        SPITransaction(ramData, nullptr, transferSize).chipSelect(D5).onComplete(onComplete, (void*)1),
+        SPITransaction(nullptr, rxData, transferSize).settings(SPISettings(SPI_CLOCK_SPEED / 2, LSBFIRST, SPI_MODE0))
+                .onComplete(onComplete, (void*)2)
+    };
+    const system_tick_t start = millis();
+    assertEqual(SPI.transfer(trans, 3), 0);
+    while (completed < 3 && lastResult == 0 && millis() - start < 1000) {
+        delay(1);
+    }
+    assertEqual((int)lastResult, 0);
+    assertEqual((unsigned)completed, 3);
+    assertEqual(digitalRead(D5), HIGH);
+
+    // Transactions can't be queued when the interface is disabled
+    SPI.end();
+    assertNotEqual(SPI.transfer(trans, 3), 0);
+}
+#endif // HAL_PLATFORM_SPI_TRANSACTION_QUEUE
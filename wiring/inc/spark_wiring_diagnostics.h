@@ -27,6 +27,7 @@
 #include "underlying_type.h"
 #include "debug.h"
 
+#include <algorithm>
 #include <atomic>
 
 #define PARTICLE_RETAINED_INTEGER_DIAGNOSTIC_DATA(_var, _id, _name, _val, ...) \
@@ -327,6 +328,120 @@ private:
     }
 };
 
+template<>
+class UnsignedIntegerDiagnosticData<AtomicConcurrency>: public AbstractUnsignedIntegerDiagnosticData {
+public:
+    explicit UnsignedIntegerDiagnosticData(DiagnosticDataId id, IntType val = 0) :
+            UnsignedIntegerDiagnosticData(id, nullptr, val) {
+    }
+
+    UnsignedIntegerDiagnosticData(DiagnosticDataId id, const char* name, IntType val = 0) :
+            AbstractUnsignedIntegerDiagnosticData(id, name),
+            val_(val) {
+    }
+
+    IntType operator++() {
+        return (val_.fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+
+    IntType operator++(int) {
+        return val_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    IntType operator--() {
+        return (val_.fetch_sub(1, std::memory_order_relaxed) - 1);
+    }
+
+    IntType operator--(int) {
+        return val_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    IntType operator+=(IntType val) {
+        return (val_.fetch_add(val, std::memory_order_relaxed) + val);
+    }
+
+    IntType operator-=(IntType val) {
+        return (val_.fetch_sub(val, std::memory_order_relaxed) - val);
+    }
+
+    UnsignedIntegerDiagnosticData& operator=(IntType val) {
+        val_.store(val, std::memory_order_relaxed);
+        return *this;
+    }
+
+    operator IntType() const {
+        return val_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<IntType> val_;
+
+    virtual int get(IntType& val) override { // AbstractUnsignedIntegerDiagnosticData
+        val = val_.load(std::memory_order_relaxed);
+        return SYSTEM_ERROR_NONE;
+    }
+};
+
+// Lock-free histogram that can be updated from an ISR. The data source reports the total number
+// of samples, while the per-bucket counters are available via bucket(). A sample is counted in
+// the first bucket whose upper bound is greater than or equal to the sample value; the last
+// bucket collects all samples above the largest bound
+template<size_t BucketCountT>
+class HistogramDiagnosticData: public AbstractUnsignedIntegerDiagnosticData {
+public:
+    typedef int32_t ValueType;
+
+    static const size_t BUCKET_COUNT = BucketCountT;
+
+    HistogramDiagnosticData(DiagnosticDataId id, const ValueType (&bounds)[BucketCountT - 1]) :
+            HistogramDiagnosticData(id, nullptr, bounds) {
+    }
+
+    HistogramDiagnosticData(DiagnosticDataId id, const char* name, const ValueType (&bounds)[BucketCountT - 1]) :
+            AbstractUnsignedIntegerDiagnosticData(id, name),
+            count_(0) {
+        static_assert(BucketCountT >= 2, "Histogram should have at least 2 buckets");
+        std::copy(bounds, bounds + BucketCountT - 1, bounds_);
+        for (auto& b: buckets_) {
+            b.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void add(ValueType val) {
+        size_t i = 0;
+        while (i < BucketCountT - 1 && val > bounds_[i]) {
+            ++i;
+        }
+        buckets_[i].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    IntType bucket(size_t index) const {
+        return buckets_[index].load(std::memory_order_relaxed);
+    }
+
+    IntType count() const {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+    void reset() {
+        for (auto& b: buckets_) {
+            b.store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    ValueType bounds_[BucketCountT - 1];
+    std::atomic<IntType> buckets_[BucketCountT];
+    std::atomic<IntType> count_;
+
+    virtual int get(IntType& val) override { // AbstractUnsignedIntegerDiagnosticData
+        val = count_.load(std::memory_order_relaxed);
+        return SYSTEM_ERROR_NONE;
+    }
+};
+
 template<typename StorageT, typename ConcurrencyT = NoConcurrency>
 class PersistentIntegerDiagnosticData:
         public AbstractIntegerDiagnosticData,
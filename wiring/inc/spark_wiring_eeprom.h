@@ -118,6 +118,12 @@ struct EEPtr{
     This object represents the entire EEPROM space.
     It wraps the functionality of EEPtr and EERef into a basic interface.
     This class is also 100% backwards compatible with earlier Arduino core releases.
+
+    On the Photon and Electron, the EEPROM is emulated in Flash and every access scans
+    the records of the active Flash page. When the system firmware is built with
+    EEPROM_EMULATION_INDEX=1, an index of the records is allocated on the heap on the
+    first EEPROM access and kept for the lifetime of the device. It takes 2 bytes per
+    EEPROM cell (about 4KB) and makes get() and put() of large objects several times faster.
 ***/
 
 struct EEPROMClass{
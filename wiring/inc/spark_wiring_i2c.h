@@ -32,6 +32,8 @@
 #include "i2c_hal.h"
 #include <chrono>
 
+typedef void (*wiring_i2c_transaction_callback_t)(int result, void* context);
+
 class WireTransmission {
 public:
   WireTransmission(uint8_t address)
@@ -82,6 +84,78 @@ private:
   system_tick_t timeout_;
 };
 
+#if HAL_PLATFORM_I2C_TRANSACTION_QUEUE
+
+/**
+ * A transaction that can be queued with `TwoWire::transfer(WireTransaction*, size_t)`.
+ *
+ * The data is written first and then read back using a repeated start condition. The transaction
+ * object and its buffers must remain valid until the transaction completes.
+ */
+class WireTransaction {
+public:
+  WireTransaction(uint8_t address)
+      : trans_() {
+    trans_.size = sizeof(trans_);
+    trans_.address = address;
+    trans_.timeout_ms = HAL_I2C_DEFAULT_TIMEOUT_MS;
+    trans_.flags = HAL_I2C_TRANSMISSION_FLAG_STOP;
+  }
+
+  WireTransaction() = delete;
+
+  /**
+   * Sets the data to write. The data must be located in RAM.
+   */
+  WireTransaction& write(const void* data, size_t size) {
+    trans_.tx_buffer = (const uint8_t*)data;
+    trans_.tx_length = size;
+    return *this;
+  }
+
+  /**
+   * Sets the buffer for the data to read.
+   */
+  WireTransaction& read(void* data, size_t size) {
+    trans_.rx_buffer = (uint8_t*)data;
+    trans_.rx_length = size;
+    return *this;
+  }
+
+  WireTransaction& timeout(system_tick_t ms) {
+    trans_.timeout_ms = ms;
+    return *this;
+  }
+
+  WireTransaction& timeout(std::chrono::milliseconds ms) {
+    return timeout((system_tick_t)ms.count());
+  }
+
+  /**
+   * Sets whether a stop condition is generated after a write-only transaction.
+   */
+  WireTransaction& stop(bool stop) {
+    trans_.flags = stop ? HAL_I2C_TRANSMISSION_FLAG_STOP : 0;
+    return *this;
+  }
+
+  /**
+   * Sets the callback invoked when the transaction completes. The callback can be invoked
+   * in an ISR context.
+   */
+  WireTransaction& onComplete(wiring_i2c_transaction_callback_t callback, void* context = nullptr) {
+    trans_.callback = callback;
+    trans_.context = context;
+    return *this;
+  }
+
+private:
+  friend class TwoWire;
+  hal_i2c_transaction_t trans_;
+};
+
+#endif // HAL_PLATFORM_I2C_TRANSACTION_QUEUE
+
 class TwoWire : public Stream
 {
 private:
@@ -108,6 +182,22 @@ public:
   size_t requestFrom(uint8_t, size_t);
   size_t requestFrom(uint8_t, size_t, uint8_t);
   size_t requestFrom(const WireTransmission& transfer);
+#if HAL_PLATFORM_I2C_TRANSACTION_QUEUE
+  /**
+   * Queues a batch of transactions and returns immediately.
+   *
+   * The transactions are performed in order, after any previously queued transactions.
+   * Use `WireTransaction::onComplete()` to get notified when they complete.
+   *
+   * Queued transactions don't acquire the lock taken by `lock()`, so they can be performed
+   * between the synchronous calls of a thread that holds it. A pending `endTransmission(false)`
+   * is an exception: the queued transactions wait until the next synchronous call, e.g.
+   * `requestFrom()`, completes the repeated start sequence.
+   *
+   * @return 0 on success, or a negative result code in case of an error.
+   */
+  int transfer(WireTransaction* transactions, size_t count);
+#endif // HAL_PLATFORM_I2C_TRANSACTION_QUEUE
   virtual size_t write(uint8_t);
   virtual size_t write(const uint8_t *, size_t);
   virtual int available(void);
@@ -24,6 +24,7 @@
 #include "jsmn.h"
 
 #include <cstring>
+#include <cstdlib>
 #include <memory>
 
 namespace spark {
@@ -48,6 +49,7 @@ enum JSONType {
 class JSONString;
 class JSONArrayIterator;
 class JSONObjectIterator;
+class JSONObjectIndex;
 
 // Immutable JSON value
 class JSONValue {
@@ -80,13 +82,14 @@ private:
 
     JSONValue(const jsmntok_t *token, detail::JSONDataPtr data);
 
-    static bool tokenize(const char *json, size_t size, jsmntok_t **tokens, size_t *count);
+    static bool tokenize(const char *json, size_t size, size_t extraSize, jsmntok_t **tokens, size_t *count);
     static bool stringize(jsmntok_t *tokens, size_t count, char *json);
     static bool unescape(jsmntok_t *token, char *json);
 
     friend class JSONString;
     friend class JSONArrayIterator;
     friend class JSONObjectIterator;
+    friend class JSONObjectIndex;
 };
 
 class JSONString {
@@ -159,6 +162,109 @@ private:
     JSONObjectIterator(const jsmntok_t *token, detail::JSONDataPtr data);
 };
 
+// Index of object's properties that allows looking up property values by name without iterating
+// over the entire object. Lookups take logarithmic time with respect to the number of properties
+class JSONObjectIndex {
+public:
+    JSONObjectIndex();
+    explicit JSONObjectIndex(const JSONValue &value);
+
+    JSONValue value(const char *name) const; // Returns invalid value if property is not found
+    JSONValue value(const char *name, size_t size) const;
+    JSONValue value(const String &name) const;
+
+    bool has(const char *name) const;
+    bool has(const String &name) const;
+
+    size_t count() const; // Returns number of properties
+
+private:
+    struct Entry {
+        uint32_t hash; // Hash of the property name
+        const jsmntok_t *name; // Name token
+    };
+
+    detail::JSONDataPtr d_;
+    std::shared_ptr<Entry> e_;
+    size_t n_;
+
+    const jsmntok_t* find(const char *name, size_t size) const;
+
+    static uint32_t hash(const char *name, size_t size);
+};
+
+// Incremental JSON parser. The input data can be passed to the parser in chunks of arbitrary size,
+// e.g. as it's received from the network, and elements of the document are reported via virtual
+// methods as soon as they're parsed, without building a token tree or keeping the source data.
+// Names and values of strings and primitives are unescaped and passed to the handler methods as
+// null-terminated strings
+class JSONStreamParser {
+public:
+    enum {
+        DEFAULT_MAX_STRING_SIZE = 256, // Default maximum size of a name or value, not including term. null
+        MAX_DEPTH = 32 // Maximum nesting level of arrays and objects
+    };
+
+    explicit JSONStreamParser(size_t maxStringSize = DEFAULT_MAX_STRING_SIZE);
+    virtual ~JSONStreamParser();
+
+    bool parse(const char *data, size_t size); // Returns false on a parsing error
+    bool parse(const char *data);
+    bool finish(); // Signals the end of the input data. Returns false if the document is incomplete
+
+    void reset();
+
+    bool isDone() const; // Returns true if a complete document has been parsed
+    bool isError() const;
+
+    size_t depth() const; // Returns current nesting level
+
+protected:
+    // Handler methods. Returning false from any of these methods aborts parsing
+    virtual bool beginArray();
+    virtual bool endArray();
+    virtual bool beginObject();
+    virtual bool endObject();
+    virtual bool name(const char *name, size_t size);
+    virtual bool value(JSONType type, const char *data, size_t size);
+
+private:
+    enum State {
+        VALUE, // Expecting value
+        VALUE_OR_END, // Expecting value or end of an array
+        NAME, // Expecting name of object's property
+        NAME_OR_END, // Expecting name of object's property or end of an object
+        SEPARATOR, // Expecting name separator
+        NEXT_OR_END, // Expecting value separator or end of a compound value
+        STRING, // Parsing string
+        ESCAPE, // Parsing escaped character
+        UNICODE, // Parsing escaped Unicode character
+        PRIMITIVE, // Parsing number or literal name
+        DONE, // Document has been parsed
+        FAILED // Parsing error
+    };
+
+    char *buf_; // String buffer
+    size_t bufSize_, maxBufSize_, n_;
+    uint32_t objects_; // Bit mask of compound values: 1 - object, 0 - array
+    uint8_t depth_; // Nesting level
+    uint8_t hexCount_; // Number of parsed hex digits of an escaped Unicode character
+    uint8_t state_;
+    bool isName_; // Set if parsed string is a property name
+
+    bool beginValue(char c);
+    bool endValue();
+    bool endString();
+    bool endPrimitive();
+    bool appendString(const char *data, size_t size);
+    bool appendString(char c);
+    bool setError();
+
+    // This class is non-copyable
+    JSONStreamParser(const JSONStreamParser&) = delete;
+    JSONStreamParser& operator=(const JSONStreamParser&) = delete;
+};
+
 // Abstract JSON document writer
 class JSONWriter {
 public:
@@ -368,6 +474,81 @@ inline size_t spark::JSONObjectIterator::count() const {
     return n_;
 }
 
+// spark::JSONObjectIndex
+inline spark::JSONObjectIndex::JSONObjectIndex() :
+        n_(0) {
+}
+
+inline spark::JSONValue spark::JSONObjectIndex::value(const char *name) const {
+    return value(name, strlen(name));
+}
+
+inline spark::JSONValue spark::JSONObjectIndex::value(const String &name) const {
+    return value(name.c_str(), name.length());
+}
+
+inline bool spark::JSONObjectIndex::has(const char *name) const {
+    return find(name, strlen(name));
+}
+
+inline bool spark::JSONObjectIndex::has(const String &name) const {
+    return find(name.c_str(), name.length());
+}
+
+inline size_t spark::JSONObjectIndex::count() const {
+    return n_;
+}
+
+// spark::JSONStreamParser
+inline spark::JSONStreamParser::~JSONStreamParser() {
+    free(buf_);
+}
+
+inline bool spark::JSONStreamParser::parse(const char *data) {
+    return parse(data, strlen(data));
+}
+
+inline bool spark::JSONStreamParser::isDone() const {
+    return state_ == DONE;
+}
+
+inline bool spark::JSONStreamParser::isError() const {
+    return state_ == FAILED;
+}
+
+inline size_t spark::JSONStreamParser::depth() const {
+    return depth_;
+}
+
+inline bool spark::JSONStreamParser::beginArray() {
+    return true;
+}
+
+inline bool spark::JSONStreamParser::endArray() {
+    return true;
+}
+
+inline bool spark::JSONStreamParser::beginObject() {
+    return true;
+}
+
+inline bool spark::JSONStreamParser::endObject() {
+    return true;
+}
+
+inline bool spark::JSONStreamParser::name(const char*, size_t) {
+    return true;
+}
+
+inline bool spark::JSONStreamParser::value(JSONType, const char*, size_t) {
+    return true;
+}
+
+inline bool spark::JSONStreamParser::setError() {
+    state_ = FAILED;
+    return false;
+}
+
 // spark::JSONWriter
 inline spark::JSONWriter::JSONWriter() :
         state_(BEGIN) {
@@ -35,6 +35,7 @@ class SPIClass;
 
 typedef void (*wiring_spi_dma_transfercomplete_callback_t)(void);
 typedef void (*wiring_spi_select_callback_t)(uint8_t);
+typedef void (*wiring_spi_transaction_callback_t)(int result, void* context);
 
 enum FrequencyScale
 {
@@ -141,6 +142,73 @@ private:
 // Compatibility typedef
 typedef SPISettings __SPISettings;
 
+#if HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+
+/**
+ * A transaction that can be queued with `SPIClass::transfer(SPITransaction*, size_t)`.
+ *
+ * The transaction object and its buffers must remain valid until the transaction completes.
+ */
+class SPITransaction {
+public:
+  SPITransaction(const void* tx_buffer, void* rx_buffer, size_t length)
+    : trans_(),
+      hasSettings_(false)
+  {
+    trans_.size = sizeof(trans_);
+    trans_.tx_buffer = tx_buffer;
+    trans_.rx_buffer = rx_buffer;
+    trans_.length = length;
+    trans_.cs_pin = PIN_INVALID;
+  }
+
+  /**
+   * Sets the CS pin that is asserted for the duration of the transaction.
+   */
+  SPITransaction& chipSelect(pin_t pin) {
+    trans_.cs_pin = pin;
+    return *this;
+  }
+
+  /**
+   * Sets the settings used for this transaction only.
+   */
+  SPITransaction& settings(const SPISettings& settings) {
+    settings_ = settings;
+    hasSettings_ = true;
+    return *this;
+  }
+
+  /**
+   * Keeps the CS pin asserted if the next queued transaction uses the same pin.
+   */
+  SPITransaction& keepSelected(bool keep = true) {
+    if (keep) {
+      trans_.flags |= HAL_SPI_TRANSACTION_FLAG_KEEP_SELECTED;
+    } else {
+      trans_.flags &= ~HAL_SPI_TRANSACTION_FLAG_KEEP_SELECTED;
+    }
+    return *this;
+  }
+
+  /**
+   * Sets the callback invoked in an ISR context when the transaction completes.
+   */
+  SPITransaction& onComplete(wiring_spi_transaction_callback_t callback, void* context = nullptr) {
+    trans_.callback = callback;
+    trans_.context = context;
+    return *this;
+  }
+
+private:
+  friend class ::SPIClass;
+  hal_spi_transaction_t trans_;
+  SPISettings settings_;
+  bool hasSettings_;
+};
+
+#endif // HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+
 }
 
 // NOTE: when modifying this class (method signatures, adding/removing methods)
@@ -230,6 +298,17 @@ public:
 
   byte transfer(byte _data);
   void transfer(const void* tx_buffer, void* rx_buffer, size_t length, wiring_spi_dma_transfercomplete_callback_t user_callback);
+#if HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+  /**
+   * Queues a batch of transactions and returns immediately.
+   *
+   * The transactions are performed back-to-back, in order, after any previously queued
+   * transactions. Use `SPITransaction::onComplete()` to get notified when they complete.
+   *
+   * @return 0 on success, or a negative result code in case of an error.
+   */
+  int transfer(particle::SPITransaction* transactions, size_t count);
+#endif // HAL_PLATFORM_SPI_TRANSACTION_QUEUE
 
   void attachInterrupt();
   void detachInterrupt();
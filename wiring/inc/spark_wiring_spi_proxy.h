@@ -78,6 +78,11 @@ public:
     void transfer(const void* tx_buffer, void* rx_buffer, size_t length, wiring_spi_dma_transfercomplete_callback_t user_callback) {
         instance().transfer(tx_buffer, rx_buffer, length, user_callback);
     }
+#if HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+    int transfer(particle::SPITransaction* transactions, size_t count) {
+        return instance().transfer(transactions, count);
+    }
+#endif // HAL_PLATFORM_SPI_TRANSACTION_QUEUE
     void attachInterrupt() {
         instance().attachInterrupt();
     }
@@ -91,6 +91,7 @@ public:
 	// invalid string (i.e., "if (s)" will be true afterwards)
 	unsigned char reserve(unsigned int size);
 	inline unsigned int length(void) const {return len;}
+	inline unsigned int bufferCapacity(void) const {return capacity;}
 
 	// creates a copy of the assigned value.  if the value is null or
 	// invalid, or if the memory allocation fails, the string will be
@@ -121,10 +122,23 @@ public:
 	unsigned char concat(unsigned long num);
 	unsigned char concat(float num);
 	unsigned char concat(double num);
+	#ifdef __GXX_EXPERIMENTAL_CXX0X__
+	unsigned char concat(String &&str);
+	#endif
+
+	// appends formatted output to the string. the output is written directly
+	// into the spare capacity of the string, which is grown only if the
+	// output doesn't fit. returns true on success, false on failure (in
+	// which case, the string is left unchanged)
+	unsigned char concatFormat(const char *format, ...) __attribute__((format(printf, 2, 3)));
+	unsigned char concatFormatV(const char *format, va_list args);
 
 	// if there's not enough memory for the concatenated value, the string
 	// will be left unchanged (but this isn't signalled in any way)
 	String & operator += (const String &rhs)	{concat(rhs); return (*this);}
+	#ifdef __GXX_EXPERIMENTAL_CXX0X__
+	String & operator += (String &&rhs)		{concat(static_cast<String&&>(rhs)); return (*this);}
+	#endif
 	String & operator += (const char *cstr)		{concat(cstr); return (*this);}
 	String & operator += (char c)			{concat(c); return (*this);}
 	String & operator += (unsigned char num)		{concat(num); return (*this);}
@@ -208,6 +222,7 @@ protected:
 	void init(void);
 	void invalidate(void);
 	unsigned char changeBuffer(unsigned int maxStrLen);
+	unsigned char growBuffer(unsigned int maxStrLen);
 	unsigned char concat(const char *cstr, unsigned int length);
 
 	// copy and move
@@ -226,6 +241,9 @@ class StringSumHelper : public String
 {
 public:
 	StringSumHelper(const String &s) : String(s) {}
+	#ifdef __GXX_EXPERIMENTAL_CXX0X__
+	StringSumHelper(String &&s) : String(static_cast<String&&>(s)) {}
+	#endif
 	StringSumHelper(const char *p) : String(p) {}
 	StringSumHelper(char c) : String(c) {}
 	StringSumHelper(unsigned char num) : String(num) {}
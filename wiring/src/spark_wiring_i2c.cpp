@@ -27,6 +27,8 @@
 #include "spark_wiring_i2c.h"
 #include "i2c_hal.h"
 #include "spark_wiring_thread.h"
+#include "system_error.h"
+#include "check.h"
 
 // Constructors ////////////////////////////////////////////////////////////////
 
@@ -90,6 +92,16 @@ size_t TwoWire::requestFrom(const WireTransmission& transfer) {
   return hal_i2c_request_ex(_i2c, &conf, nullptr);
 }
 
+#if HAL_PLATFORM_I2C_TRANSACTION_QUEUE
+int TwoWire::transfer(WireTransaction* transactions, size_t count) {
+  CHECK_TRUE(transactions && count > 0, SYSTEM_ERROR_INVALID_ARGUMENT);
+  for (size_t i = 0; i < count; ++i) {
+    transactions[i].trans_.next = (i + 1 < count) ? &transactions[i + 1].trans_ : nullptr;
+  }
+  return hal_i2c_queue_transactions(_i2c, &transactions[0].trans_, nullptr);
+}
+#endif // HAL_PLATFORM_I2C_TRANSACTION_QUEUE
+
 void TwoWire::beginTransmission(uint8_t address)
 {
 	hal_i2c_begin_transmission(_i2c, address, NULL);
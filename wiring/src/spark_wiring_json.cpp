@@ -25,6 +25,19 @@
 
 namespace {
 
+// Estimated average number of bytes of JSON data per token
+const size_t AVG_TOKEN_SIZE = 8;
+
+// Minimum number of tokens allocated for a token store
+const size_t MIN_TOKEN_STORE_CAPACITY = 8;
+
+// FNV-1a hash parameters
+const uint32_t FNV_OFFSET_BASIS = 2166136261u;
+const uint32_t FNV_PRIME = 16777619u;
+
+// Initial size of the string buffer used by JSONStreamParser
+const size_t MIN_STREAM_BUFFER_SIZE = 32;
+
 // Skips token and all its children tokens if any
 const jsmntok_t* skipToken(const jsmntok_t *t) {
     size_t n = 1;
@@ -66,21 +79,16 @@ bool hexToInt(const char *s, size_t size, uint32_t *val) {
 
 // spark::detail::JSONData
 struct spark::detail::JSONData {
-    jsmntok_t *tokens;
+    jsmntok_t *tokens; // Token store. If the JSON data is owned by this object, it's stored after the tokens
     char *json;
-    bool freeJson;
 
     JSONData() :
             tokens(nullptr),
-            json(nullptr),
-            freeJson(false) {
+            json(nullptr) {
     }
 
     ~JSONData() {
-        delete[] tokens;
-        if (freeJson) {
-            delete[] json;
-        }
+        free(tokens);
     }
 };
 
@@ -182,7 +190,7 @@ spark::JSONValue spark::JSONValue::parse(char *json, size_t size) {
         return JSONValue();
     }
     size_t tokenCount = 0;
-    if (!tokenize(json, size, &d->tokens, &tokenCount)) {
+    if (!tokenize(json, size, 0, &d->tokens, &tokenCount)) {
         return JSONValue();
     }
     const jsmntok_t *t = d->tokens; // Root token
@@ -190,19 +198,20 @@ spark::JSONValue spark::JSONValue::parse(char *json, size_t size) {
         // RFC 7159 allows JSON document to consist of a single primitive value, such as a number.
         // In this case, original data is copied to a larger buffer to ensure room for term. null
         // character (see stringize() method)
-        d->json = new(std::nothrow) char[size + 1];
-        if (!d->json) {
+        const auto tokens = (jsmntok_t*)realloc(d->tokens, tokenCount * sizeof(jsmntok_t) + size + 1);
+        if (!tokens) {
             return JSONValue();
         }
+        d->tokens = tokens;
+        d->json = (char*)(tokens + tokenCount);
         memcpy(d->json, json, size);
-        d->freeJson = true; // Set ownership flag
     } else {
         d->json = json;
     }
     if (!stringize(d->tokens, tokenCount, d->json)) {
         return JSONValue();
     }
-    return JSONValue(t, d);
+    return JSONValue(d->tokens, d);
 }
 
 spark::JSONValue spark::JSONValue::parseCopy(const char *json, size_t size) {
@@ -210,39 +219,57 @@ spark::JSONValue spark::JSONValue::parseCopy(const char *json, size_t size) {
     if (!d) {
         return JSONValue();
     }
+    // Tokens and a copy of the JSON data share the same allocation
     size_t tokenCount = 0;
-    if (!tokenize(json, size, &d->tokens, &tokenCount)) {
-        return JSONValue();
-    }
-    d->json = new(std::nothrow) char[size + 1];
-    if (!d->json) {
+    if (!tokenize(json, size, size + 1, &d->tokens, &tokenCount)) {
         return JSONValue();
     }
+    d->json = (char*)(d->tokens + tokenCount);
     memcpy(d->json, json, size); // TODO: Copy only token data
-    d->freeJson = true;
     if (!stringize(d->tokens, tokenCount, d->json)) {
         return JSONValue();
     }
     return JSONValue(d->tokens, d);
 }
 
-bool spark::JSONValue::tokenize(const char *json, size_t size, jsmntok_t **tokens, size_t *count) {
+bool spark::JSONValue::tokenize(const char *json, size_t size, size_t extraSize, jsmntok_t **tokens, size_t *count) {
+    // The initial capacity of the token store is estimated based on the size of the JSON data.
+    // If it's not sufficient, the store is grown and jsmn_parse() resumes parsing from the token
+    // that couldn't be allocated, so in most cases the data is scanned only once
+    size_t capacity = std::max(size / AVG_TOKEN_SIZE, MIN_TOKEN_STORE_CAPACITY);
+    jsmntok_t *t = nullptr;
     jsmn_parser parser;
     parser.size = sizeof(jsmn_parser);
     jsmn_init(&parser, nullptr);
-    const int n = jsmn_parse(&parser, json, size, nullptr, 0, nullptr); // Get number of tokens
-    if (n <= 0) {
-        return false; // Parsing error
+    for (;;) {
+        const auto t2 = (jsmntok_t*)realloc(t, capacity * sizeof(jsmntok_t));
+        if (!t2) {
+            free(t);
+            return false;
+        }
+        t = t2;
+        const int ret = jsmn_parse(&parser, json, size, t, capacity, nullptr);
+        if (ret >= 0) {
+            break;
+        }
+        if (ret != JSMN_ERROR_NOMEM) {
+            free(t);
+            return false; // Parsing error
+        }
+        capacity *= 2;
     }
-    std::unique_ptr<jsmntok_t[]> t(new(std::nothrow) jsmntok_t[n]);
-    if (!t) {
-        return false;
+    const size_t n = parser.toknext;
+    if (!n) {
+        free(t);
+        return false; // No data
     }
-    jsmn_init(&parser, nullptr); // Reset parser
-    if (jsmn_parse(&parser, json, size, t.get(), n, nullptr) <= 0) {
+    // Release unused capacity and reserve space for the caller's data
+    const auto t2 = (jsmntok_t*)realloc(t, n * sizeof(jsmntok_t) + extraSize);
+    if (!t2) {
+        free(t);
         return false;
     }
-    *tokens = t.release();
+    *tokens = t2;
     *count = n;
     return true;
 }
@@ -403,6 +430,394 @@ bool spark::JSONArrayIterator::next() {
     return true;
 }
 
+// spark::JSONObjectIndex
+spark::JSONObjectIndex::JSONObjectIndex(const JSONValue &val) :
+        JSONObjectIndex() {
+    const jsmntok_t *t = val.t_;
+    if (!t || t->type != JSMN_OBJECT || !t->size) {
+        return;
+    }
+    const size_t n = t->size;
+    e_.reset(new(std::nothrow) Entry[n], std::default_delete<Entry[]>());
+    if (!e_) {
+        return;
+    }
+    Entry *e = e_.get();
+    t = t + 1; // First property's name
+    for (size_t i = 0; i < n; ++i) {
+        e[i].hash = hash(val.d_->json + t->start, t->end - t->start);
+        e[i].name = t;
+        if (i != n - 1) {
+            t = skipToken(t + 1); // Skip value
+        }
+    }
+    // Entries with equal hashes are ordered by their position in the document, so that lookups
+    // return the first property with a given name, same as JSONObjectIterator would
+    std::sort(e, e + n, [](const Entry &e1, const Entry &e2) {
+        return (e1.hash < e2.hash) || (e1.hash == e2.hash && e1.name < e2.name);
+    });
+    d_ = val.d_;
+    n_ = n;
+}
+
+spark::JSONValue spark::JSONObjectIndex::value(const char *name, size_t size) const {
+    const jsmntok_t* const t = find(name, size);
+    if (!t) {
+        return JSONValue();
+    }
+    return JSONValue(t + 1, d_);
+}
+
+const jsmntok_t* spark::JSONObjectIndex::find(const char *name, size_t size) const {
+    if (!n_) {
+        return nullptr;
+    }
+    const uint32_t h = hash(name, size);
+    const Entry* const begin = e_.get();
+    const Entry* const end = begin + n_;
+    const Entry *e = std::lower_bound(begin, end, h, [](const Entry &e, uint32_t h) {
+        return e.hash < h;
+    });
+    for (; e != end && e->hash == h; ++e) {
+        const jsmntok_t* const t = e->name;
+        if ((size_t)(t->end - t->start) == size && memcmp(d_->json + t->start, name, size) == 0) {
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+uint32_t spark::JSONObjectIndex::hash(const char *name, size_t size) {
+    uint32_t h = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < size; ++i) {
+        h = (h ^ (uint8_t)name[i]) * FNV_PRIME;
+    }
+    return h;
+}
+
+// spark::JSONStreamParser
+spark::JSONStreamParser::JSONStreamParser(size_t maxStringSize) :
+        buf_(nullptr),
+        bufSize_(0),
+        maxBufSize_(maxStringSize + 1), // Reserve space for term. null
+        n_(0),
+        objects_(0),
+        depth_(0),
+        hexCount_(0),
+        state_(VALUE),
+        isName_(false) {
+}
+
+bool spark::JSONStreamParser::parse(const char *data, size_t size) {
+    const char* const end = data + size;
+    const char *s = data;
+    while (s != end) {
+        switch (state_) {
+        case STRING: {
+            // Copy all characters up to the closing quotation mark or escape character at once
+            const char *s1 = s;
+            while (s != end && *s != '"' && *s != '\\') {
+                ++s;
+            }
+            if (s != s1 && !appendString(s1, s - s1)) {
+                return false;
+            }
+            if (s == end) {
+                break;
+            }
+            if (*s == '\\') {
+                state_ = ESCAPE;
+            } else if (!endString()) {
+                return false;
+            }
+            ++s;
+            break;
+        }
+        case ESCAPE: {
+            char c = 0;
+            switch (*s) {
+            case '"':
+            case '\\':
+            case '/':
+                c = *s;
+                break;
+            case 'b': // Backspace
+                c = 0x08;
+                break;
+            case 't': // Tab
+                c = 0x09;
+                break;
+            case 'n': // Line feed
+                c = 0x0a;
+                break;
+            case 'f': // Form feed
+                c = 0x0c;
+                break;
+            case 'r': // Carriage return
+                c = 0x0d;
+                break;
+            case 'u': // Arbitrary character, e.g. "\u001f"
+                // Escaped sequence is buffered as is until all its hex digits are parsed
+                if (!appendString("\\u", 2)) {
+                    return false;
+                }
+                hexCount_ = 0;
+                state_ = UNICODE;
+                ++s;
+                continue;
+            default:
+                return setError(); // Invalid escaped sequence
+            }
+            if (!appendString(c)) {
+                return false;
+            }
+            state_ = STRING;
+            ++s;
+            break;
+        }
+        case UNICODE: {
+            if (!appendString(*s)) {
+                return false;
+            }
+            ++s;
+            if (++hexCount_ < 4) {
+                break;
+            }
+            uint32_t u = 0; // Unicode code point or UTF-16 surrogate pair
+            if (!hexToInt(buf_ + n_ - 4, 4, &u)) {
+                return setError(); // Invalid escaped sequence
+            }
+            if (u <= 0x7f) { // Processing only code points within the basic latin block
+                n_ -= 6;
+                buf_[n_++] = u;
+            }
+            state_ = STRING;
+            break;
+        }
+        case PRIMITIVE: {
+            const char c = *s;
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == ',' || c == ']' || c == '}') {
+                if (!endPrimitive()) {
+                    return false;
+                }
+                continue; // Process delimiter character in the new state
+            }
+            if (!appendString(c)) {
+                return false;
+            }
+            ++s;
+            break;
+        }
+        case FAILED:
+            return false;
+        default: {
+            const char c = *s;
+            ++s;
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                break; // Skip whitespace
+            }
+            switch (state_) {
+            case VALUE:
+                if (!beginValue(c)) {
+                    return false;
+                }
+                break;
+            case VALUE_OR_END:
+                if (c == ']') {
+                    if (!endValue()) {
+                        return false;
+                    }
+                } else if (!beginValue(c)) {
+                    return false;
+                }
+                break;
+            case NAME_OR_END:
+                if (c == '}') {
+                    if (!endValue()) {
+                        return false;
+                    }
+                    break;
+                }
+                // Fall through
+            case NAME:
+                if (c != '"') {
+                    return setError();
+                }
+                n_ = 0;
+                isName_ = true;
+                state_ = STRING;
+                break;
+            case SEPARATOR:
+                if (c != ':') {
+                    return setError();
+                }
+                state_ = VALUE;
+                break;
+            case NEXT_OR_END: {
+                const bool isObject = objects_ & (1u << (depth_ - 1));
+                if (c == ',') {
+                    state_ = isObject ? NAME : VALUE;
+                } else if (c == (isObject ? '}' : ']')) {
+                    if (!endValue()) {
+                        return false;
+                    }
+                } else {
+                    return setError();
+                }
+                break;
+            }
+            default: // DONE
+                return setError(); // Unexpected data after the end of the document
+            }
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+bool spark::JSONStreamParser::finish() {
+    if (state_ == PRIMITIVE && !endPrimitive()) {
+        return false;
+    }
+    if (state_ != DONE) {
+        return setError(); // Unexpected end of data
+    }
+    return true;
+}
+
+void spark::JSONStreamParser::reset() {
+    n_ = 0;
+    objects_ = 0;
+    depth_ = 0;
+    hexCount_ = 0;
+    state_ = VALUE;
+    isName_ = false;
+}
+
+bool spark::JSONStreamParser::beginValue(char c) {
+    switch (c) {
+    case '{':
+    case '[': {
+        if (depth_ == MAX_DEPTH) {
+            return setError();
+        }
+        const bool isObject = (c == '{');
+        if (isObject) {
+            objects_ |= (1u << depth_);
+        } else {
+            objects_ &= ~(1u << depth_);
+        }
+        ++depth_;
+        if (!(isObject ? beginObject() : beginArray())) {
+            return setError();
+        }
+        state_ = isObject ? NAME_OR_END : VALUE_OR_END;
+        return true;
+    }
+    case '"':
+        n_ = 0;
+        isName_ = false;
+        state_ = STRING;
+        return true;
+    case ']':
+    case '}':
+    case ',':
+    case ':':
+        return setError();
+    default:
+        n_ = 0;
+        state_ = PRIMITIVE;
+        return appendString(c);
+    }
+}
+
+bool spark::JSONStreamParser::endValue() {
+    if (state_ == VALUE_OR_END || state_ == NAME_OR_END || state_ == NEXT_OR_END) {
+        // End of a compound value
+        --depth_;
+        const bool isObject = objects_ & (1u << depth_);
+        if (!(isObject ? endObject() : endArray())) {
+            return setError();
+        }
+    }
+    state_ = depth_ ? NEXT_OR_END : DONE;
+    return true;
+}
+
+bool spark::JSONStreamParser::endString() {
+    if (!appendString('\0')) {
+        return false;
+    }
+    --n_; // Term. null is not a part of the string
+    if (isName_) {
+        if (!name(buf_, n_)) {
+            return setError();
+        }
+        state_ = SEPARATOR;
+        return true;
+    }
+    if (!value(JSON_TYPE_STRING, buf_, n_)) {
+        return setError();
+    }
+    return endValue();
+}
+
+bool spark::JSONStreamParser::endPrimitive() {
+    if (!appendString('\0')) {
+        return false;
+    }
+    --n_;
+    JSONType type = JSON_TYPE_INVALID;
+    const char c = buf_[0];
+    if (c == '-' || (c >= '0' && c <= '9')) {
+        type = JSON_TYPE_NUMBER;
+        for (size_t i = 1; i < n_; ++i) {
+            const char c = buf_[i];
+            if (!((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-')) {
+                return setError();
+            }
+        }
+    } else if (strcmp(buf_, "true") == 0 || strcmp(buf_, "false") == 0) {
+        type = JSON_TYPE_BOOL;
+    } else if (strcmp(buf_, "null") == 0) {
+        type = JSON_TYPE_NULL;
+    } else {
+        return setError();
+    }
+    if (!value(type, buf_, n_)) {
+        return setError();
+    }
+    state_ = VALUE; // Not a compound value
+    return endValue();
+}
+
+bool spark::JSONStreamParser::appendString(const char *data, size_t size) {
+    if (n_ + size > bufSize_) {
+        if (n_ + size > maxBufSize_) {
+            return setError(); // String is too long
+        }
+        size_t n = std::max(bufSize_ * 2, (size_t)MIN_STREAM_BUFFER_SIZE);
+        while (n < n_ + size) {
+            n *= 2;
+        }
+        n = std::min(n, maxBufSize_);
+        const auto buf = (char*)realloc(buf_, n);
+        if (!buf) {
+            return setError();
+        }
+        buf_ = buf;
+        bufSize_ = n;
+    }
+    memcpy(buf_ + n_, data, size);
+    n_ += size;
+    return true;
+}
+
+bool spark::JSONStreamParser::appendString(char c) {
+    return appendString(&c, 1);
+}
+
 // spark::JSONWriter
 spark::JSONWriter& spark::JSONWriter::beginArray() {
     writeSeparator();
@@ -285,6 +285,43 @@ void SPIClass::transfer(const void* tx_buffer, void* rx_buffer, size_t length,
     }
 }
 
+#if HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+
+int SPIClass::transfer(particle::SPITransaction* transactions, size_t count)
+{
+    CHECK_TRUE(transactions && count > 0, SYSTEM_ERROR_INVALID_ARGUMENT);
+    CHECK(lock());
+    hal_spi_info_t spi_info;
+    querySpiInfo(_spi, &spi_info);
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto& trans = transactions[i].trans_;
+        const auto& settings = transactions[i].settings_;
+        trans.flags &= ~(HAL_SPI_TRANSACTION_FLAG_SETTINGS | HAL_SPI_TRANSACTION_FLAG_DEFAULT_SETTINGS);
+        if (transactions[i].hasSettings_)
+        {
+            if (settings.default_)
+            {
+                trans.flags |= HAL_SPI_TRANSACTION_FLAG_DEFAULT_SETTINGS;
+            }
+            else
+            {
+                unsigned int clock;
+                computeClockDivider((unsigned int)spi_info.system_clock, settings.clock_, trans.clock_div, clock);
+                trans.bit_order = settings.bitOrder_;
+                trans.data_mode = settings.dataMode_;
+                trans.flags |= HAL_SPI_TRANSACTION_FLAG_SETTINGS;
+            }
+        }
+        trans.next = (i + 1 < count) ? &transactions[i + 1].trans_ : nullptr;
+    }
+    const int r = hal_spi_queue_transactions(_spi, &transactions[0].trans_, nullptr);
+    unlock();
+    return r;
+}
+
+#endif // HAL_PLATFORM_SPI_TRANSACTION_QUEUE
+
 void SPIClass::transferCancel()
 {
     if (!lock())
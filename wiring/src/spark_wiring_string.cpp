@@ -213,6 +213,17 @@ unsigned char String::changeBuffer(unsigned int maxStrLen)
 	return 0;
 }
 
+unsigned char String::growBuffer(unsigned int maxStrLen)
+{
+	// grow geometrically so that repeated concatenation takes amortized
+	// constant time and doesn't fragment the heap with many reallocations
+	if (buffer && capacity >= maxStrLen) return 1;
+	unsigned int newCapacity = capacity + capacity / 2;
+	if (newCapacity < maxStrLen) newCapacity = maxStrLen;
+	if (buffer && changeBuffer(newCapacity)) return 1;
+	return reserve(maxStrLen); // retry with the exact size
+}
+
 /*********************************************/
 /*  Copy and Move                            */
 /*********************************************/
@@ -224,7 +235,7 @@ String & String::copy(const char *cstr, unsigned int length)
 		return *this;
 	}
 	len = length;
-	memcpy(buffer, cstr, length);
+	memmove(buffer, cstr, length);
 	buffer[len] = 0;
 	return *this;
 }
@@ -236,15 +247,20 @@ String & String::copy(const __FlashStringHelper *pstr, unsigned int length) {
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 void String::move(String &rhs)
 {
+	if (!rhs.buffer) {
+		invalidate();
+		return;
+	}
 	if (buffer) {
 		if (capacity >= rhs.len) {
-			strcpy(buffer, rhs.buffer);
+			// there's no point in releasing our own buffer if it's large enough
+			memcpy(buffer, rhs.buffer, rhs.len + 1);
 			len = rhs.len;
 			rhs.len = 0;
+			rhs.buffer[0] = 0;
 			return;
-		} else {
-			free(buffer);
 		}
+		free(buffer);
 	}
 	buffer = rhs.buffer;
 	capacity = rhs.capacity;
@@ -309,12 +325,31 @@ unsigned char String::concat(const char *cstr, unsigned int length)
 	unsigned int newlen = len + length;
 	if (!cstr) return 0;
 	if (length == 0) return 1;
-	if (!reserve(newlen)) return 0;
-	strcpy(buffer + len, cstr);
+	// the source may point to this string's own buffer, which can be
+	// reallocated below
+	const bool self = buffer && cstr >= buffer && cstr <= buffer + len;
+	const unsigned int offset = self ? cstr - buffer : 0;
+	if (!growBuffer(newlen)) return 0;
+	if (self) cstr = buffer + offset;
+	memcpy(buffer + len, cstr, length);
 	len = newlen;
+	buffer[len] = 0;
 	return 1;
 }
 
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+unsigned char String::concat(String &&s)
+{
+	if (!s.buffer) return 0;
+	if (len == 0) {
+		// nothing to preserve, take over the other string's buffer
+		move(s);
+		return buffer != NULL;
+	}
+	return concat(s.buffer, s.len);
+}
+#endif
+
 unsigned char String::concat(const char *cstr)
 {
 	if (!cstr) return 0;
@@ -811,22 +846,49 @@ String::String(const Printable& printable)
     printable.printTo(help);
 }
 
-String String::format(const char* fmt, ...)
+unsigned char String::concatFormat(const char* fmt, ...)
 {
     va_list marker;
     va_start(marker, fmt);
-    const int bufsize = 5;
-    char test[bufsize];
-    size_t n = vsnprintf(test, bufsize, fmt, marker);
+    const unsigned char ret = concatFormatV(fmt, marker);
     va_end(marker);
+    return ret;
+}
 
-    String result;
-    result.reserve(n);  // internally adds +1 for null terminator
-    if (result.buffer) {
-        va_start(marker, fmt);
-        n = vsnprintf(result.buffer, n+1, fmt, marker);
-        va_end(marker);
-        result.len = n;
+unsigned char String::concatFormatV(const char* fmt, va_list args)
+{
+    if (!buffer && !reserve(0)) {
+        return 0;
+    }
+    // try formatting into the spare capacity first, in most cases the
+    // output fits and no second pass is needed
+    va_list args2;
+    va_copy(args2, args);
+    const int n = vsnprintf(buffer + len, capacity - len + 1, fmt, args2);
+    va_end(args2);
+    if (n < 0) {
+        buffer[len] = 0;
+        return 0;
     }
+    if ((unsigned int)n > capacity - len) {
+        if (!growBuffer(len + n)) {
+            buffer[len] = 0;
+            return 0;
+        }
+        va_copy(args2, args);
+        vsnprintf(buffer + len, n + 1, fmt, args2);
+        va_end(args2);
+    }
+    len += n;
+    return 1;
+}
+
+String String::format(const char* fmt, ...)
+{
+    va_list marker;
+    va_start(marker, fmt);
+    String result;
+    result.concatFormatV(fmt, marker);
+    va_end(marker);
     return result;
 }